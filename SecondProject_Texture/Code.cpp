@@ -1,317 +1,1083 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <stb/stb_image.h>
-#include <custom/program.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "allocationTracker.h"
+#include "animation.h"
+#include "assetReloader.h"
+#include "constTransform.h"
+#include "dynamicResolution.h"
+#include "entityWorld.h"
+#include "frameArena.h"
+#include "framePacer.h"
+#include "gpuResources.h"
+#include "gpuTransforms.h"
+#include "glCapture.h"
+#include "glReplay.h"
+#include "imageDecoder.h"
+#include "meshLod.h"
+#include "occlusionCuller.h"
+#include "overdrawCounter.h"
+#include "particleSystem.h"
+#include "renderComponents.h"
+#include "sceneFile.h"
+#include "sceneGraph.h"
+#include "sequenceTexture.h"
+#include "shaderVariants.h"
+#include "softwareRasterizer.h"
+#include "spriteBatch.h"
+#include "startupGraph.h"
+#include "terrainStreamer.h"
+#include "textureLoader.h"
+#include "textureStreamer.h"
 
 // Translation includes
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-// 2D Array setup
-using glm2DArray = std::vector<glm::vec3>;
+// One draw for the CPU transform path, the list gets rebuilt in the frame arena every frame
+struct DrawItem {
+     const glm::mat4* model;
+     MeshHandle mesh;
+     Material material;
+     Bounds bounds;
+     float depth; // Distance in front of the camera, for sorting
+};
+
+// Triangles the picked detail levels add up to, against what everything at full detail would be
+struct LodStats {
+     int triangles;
+     int fullDetailTriangles;
+};
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
-void doAllTransformations(glm::mat4& translationMatrix, glm2DArray translationVals, float rotationAngles[], glm2DArray rotationAxes, glm2DArray scaleValues);
-void updateRotationAngle(int whichRotationAsIndex, float newValue, float rotationAngles[]);
+bool keyPressed(GLFWwindow* window, int key, bool& wasDown);
+AnimationClip makeSpinClip();
+void buildCubeScene(SceneGraph& scene, std::vector<SceneGraph::Node>& cubeNodes);
+void buildRoundedCube(int subdivisions, float rounding, std::vector<float>& vertices, std::vector<unsigned int>& indices);
+LodStats selectLods(EntityWorld& world, const SceneGraph& scene, bool fromParents, const glm::mat4& view, int framebufferHeight, bool useLods);
+void animateCubes(Animator& animator, float seconds, SceneGraph& scene, const std::vector<SceneGraph::Node>& cubeNodes);
+void updateCpuTransforms(Animator& animator, float seconds, SceneGraph& scene, const std::vector<SceneGraph::Node>& cubeNodes, EntityWorld& world);
+DrawItem* buildDrawList(EntityWorld& world, FrameArena& arena, const glm::mat4& view, bool frontToBack, size_t& count);
+float maxAxisScale(const glm::mat4& model);
+float pixelsPerUnit(const glm::mat4& view, const glm::mat4& model, const glm::vec3& center, int viewportHeight);
+size_t cullOccludedDraws(OcclusionCuller& culler, EntityWorld& world, FrameArena& arena, DrawItem* draws, size_t count, const glm::mat4& view,
+     const glm::mat4& projection, float nearPlane, int framebufferHeight);
+int checkSteadyStateAllocations(int frames);
+int checkBakedTransforms();
+int renderSoftwareFrame(const char* outputPath, float seconds, int width, int height);
+int benchmarkLods(int frames, float cameraDistance);
 
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-int main() {
-     // GLFW setup
-     glfwInit();
-     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-     // Initial window creation and viewport setup
-     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Window Title", NULL, NULL);
-     if (!window) {
-          std::cout << "Failed to create GLFW window" << std::endl;
-          glfwTerminate();
-          return -1;
+// Frame pacing
+const int SWAP_INTERVAL = 1; // 0 = no vsync, 1 = vsync, -1 = adaptive vsync
+const double TARGET_FPS = 0.0; // 0 = no frame limiter
+const bool LOW_LATENCY = false; // Sample input as late as possible before drawing
+// Only draw when something changes (M toggles it), Space pauses the animation so there's a chance for nothing to change
+const bool ON_DEMAND_RENDERING = false;
+
+// Texture streaming, only the mip levels big enough to matter on screen are kept in VRAM
+const bool STREAM_TEXTURES = true;
+const size_t TEXTURE_BUDGET_BYTES = 64 * 1024 * 1024;
+// What the buffers and textures main makes itself can add up to before a warning, streamed textures have their own budget above
+const size_t GPU_MEMORY_BUDGET_BYTES = 128 * 1024 * 1024;
+
+// Depth pre-pass (P), front to back draw order for the CPU path (F) and counting shaded fragments (O), all switchable while running
+// The GPU path draws in instance order, so front to back does nothing until G switches to the CPU path, the title says when it's
+// waiting on that
+const bool DEPTH_PREPASS = true;
+const bool FRONT_TO_BACK = true;
+const bool COUNT_OVERDRAW = false;
+
+// Render the scene offscreen at whatever fraction of the window keeps its GPU time near the target, then stretch it over the
+// window (R toggles it), the sharpening makes up a little for the blur from stretching
+const bool DYNAMIC_RESOLUTION = false;
+const double RESOLUTION_TARGET_MS = 8.0;
+const float MIN_RESOLUTION_SCALE = 0.5f;
+const float UPSCALE_SHARPNESS = 0.25f;
+
+// CPU occlusion culling for the CPU transform path (C toggles it), anything hidden behind the big nearby cubes isn't drawn
+// The occluders are rasterized from the CPU path's matrices, so like front to back it waits on G, and the title says so
+const bool OCCLUSION_CULLING = true;
+const int OCCLUSION_BUFFER_WIDTH = 256;
+const int OCCLUSION_BUFFER_HEIGHT = 192;
+const float OCCLUDER_MIN_PIXELS = 100.0f; // How big across on screen something has to be before it's worth rasterizing as an occluder
+const int MAX_OCCLUDERS = 8;
+
+// Detail levels for the cubes (L toggles them), the GL cubes are tessellated with rounded edges so there's something to simplify
+const bool USE_LODS = true;
+const int CUBE_SUBDIVISIONS = 24;
+const float CUBE_ROUNDING = 0.08f;
+const float LOD_REDUCTION = 0.5f; // Each level aims for this fraction of the last one's triangles
+const float LOD_MAX_PIXEL_ERROR = 1.0f; // How far a level's surface can be off on screen before a finer one is needed
+const float LOD_HYSTERESIS = 0.25f; // Going coarser waits until the error is this much under the limit
+
+// A numbered image sequence played like a video on the first cube, it's skipped if there are no frames
+const char* SEQUENCE_PATTERN = "sequence/frame_%04d.jpg";
+const double SEQUENCE_FPS = 30.0;
+
+// Where the cubes go, made from a text scene with --convert-scene, the built in cubes get used if it isn't there
+const char* SCENE_PATH = "scene.bin";
+
+// Procedural ground under the cubes that scrolls towards the camera (T toggles it), chunks are made on the thread pool as they come
+// into range
+const bool SHOW_TERRAIN = false;
+const float TERRAIN_SPEED = 4.0f; // World units a second
+const float TERRAIN_DEPTH = -4.0f;
+
+// Fountains of particles drawn as billboards on the rectangle's quad (E toggles them), they emit just fast enough to keep about
+// MAX_PARTICLES alive
+const bool SHOW_PARTICLES = false;
+const size_t MAX_PARTICLES = 1 << 20;
+const int PARTICLE_FOUNTAINS = 8;
+const uint32_t FOUNTAIN_COLORS[] = { 0x403080ff, 0x40ff8040, 0x4080ff60, 0x40c040ff }; // RGBA8, red in the low byte
+
+// A swirl of 2D sprites over the finished frame (B toggles it), spread over a few textures so the batch has runs to sort into
+const bool SHOW_SPRITES = false;
+const int SPRITE_COUNT = 5000;
+const int SPRITE_TEXTURES = 4;
+
+// Startup's task timings in chrome://tracing format, written once the first frame is up when the app's run with --trace-startup
+const char* STARTUP_TRACE_PATH = "startup_trace.json";
+
+// Build the model matrices in a compute shader when there's GL 4.3, G switches between that and the CPU path while running
+// Front to back order and occlusion culling need the CPU path's draw list, so they're off while this is
+const bool GPU_TRANSFORMS = true;
+
+// Per-frame scratch memory, it grows on its own if a frame needs more
+const size_t FRAME_ARENA_BYTES = 256 * 1024;
+// Frames to let caches and pools fill up before the render loop is expected to stop allocating
+const int ALLOCATION_WARMUP_FRAMES = 120;
+// --check-allocations tops the scene up to this many cubes, enough that the animation and culling get split into several thread
+// pool tasks rather than running in one on the calling thread
+const size_t ALLOCATION_CHECK_CUBES = 4096;
+
+// Where the built in cubes go, the GL and software renderers both draw the rounded cube from buildRoundedCube at each of them
+constexpr float cubePositions[][3] = {
+     { 0.0f,  0.0f,  0.0f }, // Original
+     { 2.0f,  5.0f, -15.0f },
+     { -1.5f, -2.2f, -2.5f },
+     { -3.8f, -2.0f, -12.3f },
+     { 2.4f, -0.4f, -3.5f },
+     { -1.7f,  3.0f, -7.5f },
+     { 1.3f, -2.0f, -2.5f },
+     { 1.5f,  2.0f, -2.5f },
+     { 1.5f,  0.2f, -1.5f },
+     { -1.3f,  1.0f, -1.5f }
+};
+constexpr int NUM_CUBES = sizeof(cubePositions) / sizeof(cubePositions[0]);
+const float CUBE_TILT_DEGREES = 20.0f; // Each built in cube is tipped this much further about x than the last
+
+// Each cube spins about a point a quarter of the way in from its corner at half size, translate * spin * scale
+// The scale's the same on every axis so it can go before the spin instead of after, which leaves the pivot constant and folded
+// into the cube's placement, the animation only has the rotation left to do
+constexpr ConstMat4 SPIN_PIVOT = constTranslate(-0.25f, -0.25f, 0.25f) * constScale(0.5f, 0.5f, 0.5f);
+
+// The built in cubes' placements with the pivot already on the end, worked out by the compiler
+constexpr std::array<ConstMat4, NUM_CUBES> DEFAULT_CUBES = [] {
+     std::array<ConstMat4, NUM_CUBES> placements = {};
+     for (int i = 0; i < NUM_CUBES; i++) {
+          placements[i] = constTranslate(cubePositions[i][0], cubePositions[i][1], cubePositions[i][2])
+               * constRotate(CUBE_TILT_DEGREES * i, 1.0f, 0.0f, 0.0f) * SPIN_PIVOT;
      }
-     glfwMakeContextCurrent(window);
+     return placements;
+}();
+static_assert(constMaxDifference(DEFAULT_CUBES[0], SPIN_PIVOT) == 0.0f, "The first cube isn't moved or tipped");
 
-     // Load glad
-     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-          std::cout << "Failed to initialize GLAD" << std::endl;
-          return -1;
+// The camera never moves
+constexpr ConstMat4 CAMERA_VIEW = constTranslate(0.0f, 0.0f, -3.0f);
+
+int main(int argc, char* argv[]) {
+     // Command line tools that don't need a window
+     if (argc >= 3 && strcmp(argv[1], "--benchmark-decode") == 0) {
+          int iterations = argc >= 4 ? atoi(argv[3]) : 10;
+          return benchmarkImageDecoders(argv[2], iterations) ? 0 : -1;
+     }
+     if (argc >= 2 && strcmp(argv[1], "--benchmark-ecs") == 0) {
+          size_t count = argc >= 3 ? (size_t)atol(argv[2]) : 500000;
+          return benchmarkEntityWorld(count) ? 0 : -1;
+     }
+     if (argc >= 2 && strcmp(argv[1], "--check-allocations") == 0) {
+          int frames = argc >= 3 ? atoi(argv[2]) : 1000;
+          return checkSteadyStateAllocations(frames);
+     }
+     if (argc >= 2 && strcmp(argv[1], "--check-transforms") == 0) {
+          return checkBakedTransforms();
+     }
+     if (argc >= 2 && strcmp(argv[1], "--benchmark-animation") == 0) {
+          size_t instances = argc >= 3 ? (size_t)atol(argv[2]) : 10000;
+          int frames = argc >= 4 ? atoi(argv[3]) : 600;
+          return benchmarkAnimation(instances, frames) ? 0 : -1;
+     }
+     if (argc >= 2 && strcmp(argv[1], "--benchmark-lod") == 0) {
+          int frames = argc >= 3 ? atoi(argv[2]) : 20;
+          float cameraDistance = argc >= 4 ? (float)atof(argv[3]) : 3.0f;
+          return benchmarkLods(frames, cameraDistance);
+     }
+     if (argc >= 2 && strcmp(argv[1], "--benchmark-particles") == 0) {
+          size_t count = argc >= 3 ? (size_t)atol(argv[2]) : MAX_PARTICLES;
+          int frames = argc >= 4 ? atoi(argv[3]) : 300;
+          return benchmarkParticles(count, frames) ? 0 : -1;
+     }
+     if (argc >= 2 && strcmp(argv[1], "--benchmark-sprites") == 0) {
+          size_t count = argc >= 3 ? (size_t)atol(argv[2]) : 100000;
+          int textures = argc >= 4 ? atoi(argv[3]) : 8;
+          int frames = argc >= 5 ? atoi(argv[4]) : 200;
+          return benchmarkSprites(count, textures, frames) ? 0 : -1;
+     }
+     if (argc >= 2 && strcmp(argv[1], "--benchmark-terrain") == 0) {
+          int chunks = argc >= 3 ? atoi(argv[2]) : 256;
+          return benchmarkTerrain(chunks) ? 0 : -1;
+     }
+     if (argc >= 4 && strcmp(argv[1], "--convert-scene") == 0) {
+          return convertSceneText(argv[2], argv[3]) ? 0 : -1;
+     }
+     if (argc >= 3 && strcmp(argv[1], "--software-render") == 0) {
+          float seconds = argc >= 4 ? (float)atof(argv[3]) : 0.0f;
+          int width = argc >= 5 ? atoi(argv[4]) : SCR_WIDTH;
+          int height = argc >= 6 ? atoi(argv[5]) : SCR_HEIGHT;
+          if (width <= 0 || height <= 0) {
+               std::cout << "Usage: --software-render <output.ppm> [seconds] [width] [height]" << std::endl;
+               return -1;
+          }
+          return renderSoftwareFrame(argv[2], seconds, width, height);
+     }
+     if (argc >= 3 && strcmp(argv[1], "--replay") == 0) {
+          int loops = argc >= 4 ? atoi(argv[3]) : 1;
+          return replayGlCapture(argv[2], loops);
+     }
+     // Not a tool, runs the app as normal and records its GL calls for --replay
+     // Anything the recorder can't see is left off for the whole run: the compute paths load their own function pointers, and
+     // hot reload calls GL on a second context the replay doesn't have
+     const char* capturePath = nullptr;
+     int captureFrames = 0, captureWarmupFrames = 0;
+     if (argc >= 3 && strcmp(argv[1], "--capture") == 0) {
+          capturePath = argv[2];
+          captureFrames = argc >= 4 ? atoi(argv[3]) : 60;
+          captureWarmupFrames = argc >= 5 ? atoi(argv[4]) : 60;
+     }
+     // Also runs the app as normal, on its own or after --capture and its arguments
+     bool traceStartup = false;
+     for (int i = 1; i < argc; i++) {
+          traceStartup = traceStartup || strcmp(argv[i], "--trace-startup") == 0;
      }
-     
-     glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-     glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-
-     // Setup shaders
-     Program recProgram("vertexShader.vert", "fragmentShader.vert");
-
-     // Cube stuff
-     float cubeVertices[] = {
-          // Viewport coords   // Color            // Texture coords
-          // Front
-          0.5f,  0.5f,  0.5f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, // front top right     0
-          0.5f, -0.5f,  0.5f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f, // front bottom right  1
-         -0.5f, -0.5f,  0.5f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, // front bottom left   2
-         -0.5f,  0.5f,  0.5f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f, // front top left      3
-         // Back
-          0.5f,  0.5f, -0.5f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, // back top right      4
-          0.5f, -0.5f, -0.5f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f, // back bottom right   5
-         -0.5f, -0.5f, -0.5f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, // back bottom left    6
-         -0.5f,  0.5f, -0.5f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f  // back top left       7
-     };
 
-     unsigned int cubeIndices[] = {
-          // Front
-          2, 1, 3,
-          3, 1, 0,
-          // Back
-          6, 5, 7,
-          7, 5, 4,
-          // Right
-          0, 1, 5,
-          0, 5, 4,
-          // Left
-          7, 6, 2,
-          7, 2, 3,
-          // Top
-          7, 3, 0,
-          7, 0, 4,
-          // Bottom
-          6, 2, 1,
-          6, 1, 5
-     };
-     GLsizei numOfCubeIndices = sizeof(cubeIndices) / sizeof(unsigned int);
-
-     glm::vec3 cubePositions[] = {
-          glm::vec3(0.0f,  0.0f,  0.0f), // Original
-          glm::vec3(2.0f,  5.0f, -15.0f),
-          glm::vec3(-1.5f, -2.2f, -2.5f),
-          glm::vec3(-3.8f, -2.0f, -12.3f),
-          glm::vec3(2.4f, -0.4f, -3.5f),
-          glm::vec3(-1.7f,  3.0f, -7.5f),
-          glm::vec3(1.3f, -2.0f, -2.5f),
-          glm::vec3(1.5f,  2.0f, -2.5f),
-          glm::vec3(1.5f,  0.2f, -1.5f),
-          glm::vec3(-1.3f,  1.0f, -1.5f)
-     };
+     // Everything before the first frame is a graph of tasks, so the CPU side (building the cube's detail levels, decoding
+     // images, reading the scene) runs on the thread pool while the main thread makes the window and compiles shaders
+     // Anything touching GL or GLFW is a main thread task, the rest can run anywhere once what it needs is ready
+     StartupGraph startup;
+     GLFWwindow* window = nullptr;
 
+     // Setup shaders, each material's features pick a variant of the same two files
+     ShaderVariants cubeShaders("vertexShader.vert", "fragmentShader.vert");
 
-     // Buffers and VAO
-     unsigned int VBOcube, VAOcube, EBOcube;
-     glGenVertexArrays(1, &VAOcube);
-     glGenBuffers(1, &VBOcube);
-     glGenBuffers(1, &EBOcube);
-
-     glBindVertexArray(VAOcube);
-     glBindBuffer(GL_ARRAY_BUFFER, VBOcube);
-     glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
-     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOcube);
-     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
-
-     // Vertex attribs
-     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)0);
-     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)(3 * sizeof(float)));
-     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)(6 * sizeof(float)));
-     glEnableVertexAttribArray(0);
-     glEnableVertexAttribArray(1);
-     glEnableVertexAttribArray(2);
-
-     // Unbind stuff
-     glBindBuffer(GL_ARRAY_BUFFER, 0);
-     glBindVertexArray(0);
-     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-
-     // Setup shape data
-     float recVertices[] = {
-          // Viewport coords   // Color            // Texture coords
-          0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, // top right
-          0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f, // bottom right
-         -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, // bottom left
-         -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f  // top left
-     };
+     // Cube stuff, the detail levels all index the same vertices so one VBO and one EBO hold the whole chain
+     std::vector<float> cubeMeshVertices;
+     std::vector<unsigned int> cubeMeshIndices;
+     MeshLodChain cubeLods;
+     // Buffers, textures and VAOs made here are owned by the registry, which counts their memory and frees them
+     GpuResourceRegistry gpuResources(GPU_MEMORY_BUDGET_BYTES);
+     GpuResource cubeVertexArray, cubeVertexBuffer, cubeIndexBuffer;
+     GpuResource recVertexArray, recVertexBuffer, recIndexBuffer;
+     unsigned int VAOcube = 0; // The MeshHandles hold the raw name, the draw loop compares them every object
 
-     unsigned int recIndices[] = {
-          2, 1, 3, // Bottom triangle
-          3, 1, 0  // Top triangle
-     };
-     GLsizei numOfRecIndices = sizeof(recIndices) / sizeof(unsigned int); // So the draw call uses a calculated value isntead of a set one, less error prone
+     // Setup image and texture 
+     TextureStreamer streamer(TEXTURE_BUDGET_BYTES);
+     unsigned int texture = 0, texture2 = 0;
+     ImageData containerImage, smileImage; // Decoded off the main thread when the textures aren't streamed
+     GpuResource containerTexture, smileTexture; // The registry owns them when they aren't, the streamer does when they are
+     SequenceTexture sequence;
+     unsigned int sequenceTexture = 0;
+
+     // Each cube is placed by its own node, with a child node underneath that spins it
+     // The spin nodes are driven by a keyframed clip, one animator instance per cube
+     SceneGraph scene;
+     std::vector<SceneGraph::Node> cubeNodes;
+     AnimationClip spinClip;
+     Animator animator;
+     GpuTransformUpdater gpuTransforms;
+     bool useGpuTransforms = false;
+
+     // Everything that gets drawn is an entity, the render loop walks them a chunk at a time
+     EntityWorld world;
+     // The sequence cube shows the video on its own, the rest mix the smiley over the container
+     Material cubeMaterial = { { &texture, &texture2 }, SHADER_TEXTURE | SHADER_TEXTURE_MIX };
+     Material sequenceMaterial = { { &sequenceTexture, &texture2 }, SHADER_TEXTURE };
 
-     // Buffers and VAO
-     unsigned int VBO, VAO, EBO;
-     glGenVertexArrays(1, &VAO);
-     glGenBuffers(1, &VBO);
-     glGenBuffers(1, &EBO);
+     // Average shaded fragments per pixel, to see what the pre-pass and draw order save
+     OverdrawCounter overdraw;
+     bool countOverdraw = false;
+     DynamicResolution resolution;
+     bool dynamicResolution = false;
+     TerrainStreamer terrain;
+     bool showTerrain = false;
+     ParticleSettings particleSettings;
+     particleSettings.maxParticles = MAX_PARTICLES;
+     ParticleSystem particles(particleSettings);
+     bool showParticles = false;
+     SpriteBatch sprites;
+     unsigned int spriteTextures[SPRITE_TEXTURES] = {};
+     bool showSprites = false;
 
-     glBindVertexArray(VAO);
-     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-     glBufferData(GL_ARRAY_BUFFER, sizeof(recVertices), recVertices, GL_STATIC_DRAW);
-     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(recIndices), recIndices, GL_STATIC_DRAW);
+     StartupGraph::Task windowTask = startup.add("window", StartupGraph::MAIN_THREAD, [&]() {
+          // GLFW setup
+          glfwInit();
+          glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+          glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5); // 4.5 rather than 4.6 so it also runs on Mesa's llvmpipe
+          glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+          // Initial window creation and viewport setup
+          window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Window Title", NULL, NULL);
+          if (!window) {
+               std::cout << "Failed to create GLFW window" << std::endl;
+               return false;
+          }
+          glfwMakeContextCurrent(window);
+          return true;
+     });
+
+     StartupGraph::Task gladTask = startup.add("glad", StartupGraph::MAIN_THREAD, [&]() {
+          // Load glad
+          if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+               std::cout << "Failed to initialize GLAD" << std::endl;
+               return false;
+          }
+          // Before anything else touches GL, the replay has to make everything itself
+          if (capturePath) {
+               int framebufferWidth, framebufferHeight;
+               glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+               startGlCapture(capturePath, framebufferWidth, framebufferHeight, captureWarmupFrames, captureFrames);
+          }
+          glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+          glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+          return true;
+     }, { windowTask });
+
+     StartupGraph::Task cubeMeshTask = startup.add("cube detail levels", StartupGraph::ANY_THREAD, [&]() {
+          buildRoundedCube(CUBE_SUBDIVISIONS, CUBE_ROUNDING, cubeMeshVertices, cubeMeshIndices);
+          cubeLods.build(cubeMeshVertices.data(), 8, cubeMeshVertices.size() / 8, cubeMeshIndices.data(), cubeMeshIndices.size(), LOD_REDUCTION);
+          return true;
+     });
+
+     StartupGraph::Task cubeBufferTask = startup.add("cube buffers", StartupGraph::MAIN_THREAD, [&]() {
+          // Buffers and VAO
+          cubeVertexArray = gpuResources.create(GPU_VERTEX_ARRAY, "cube vertex array");
+          cubeVertexBuffer = gpuResources.create(GPU_BUFFER, "cube vertices");
+          cubeIndexBuffer = gpuResources.create(GPU_BUFFER, "cube indices");
+          VAOcube = cubeVertexArray.get();
+
+          glBindVertexArray(VAOcube);
+          glBindBuffer(GL_ARRAY_BUFFER, cubeVertexBuffer.get());
+          glBufferData(GL_ARRAY_BUFFER, cubeMeshVertices.size() * sizeof(float), cubeMeshVertices.data(), GL_STATIC_DRAW);
+          glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeIndexBuffer.get());
+          glBufferData(GL_ELEMENT_ARRAY_BUFFER, cubeLods.getIndices().size() * sizeof(unsigned int), cubeLods.getIndices().data(), GL_STATIC_DRAW);
 
           // Vertex attribs
-     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)0);
-     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)(3 * sizeof(float)));
-     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)(6 * sizeof(float)));
-     glEnableVertexAttribArray(0);
-     glEnableVertexAttribArray(1);
-     glEnableVertexAttribArray(2);
+          glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)0);
+          glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)(3 * sizeof(float)));
+          glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)(6 * sizeof(float)));
+          glEnableVertexAttribArray(0);
+          glEnableVertexAttribArray(1);
+          glEnableVertexAttribArray(2);
+
+          // Unbind stuff
+          glBindBuffer(GL_ARRAY_BUFFER, 0);
+          glBindVertexArray(0);
+          glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+          gpuResources.measure(cubeVertexBuffer.getHandle());
+          gpuResources.measure(cubeIndexBuffer.getHandle());
+          return true;
+     }, { gladTask, cubeMeshTask });
 
-     glBindBuffer(GL_ARRAY_BUFFER, 0);
-     glBindVertexArray(0);
-     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+     StartupGraph::Task rectangleTask = startup.add("rectangle buffers", StartupGraph::MAIN_THREAD, [&]() {
+          // Setup shape data
+          float recVertices[] = {
+               // Viewport coords   // Color            // Texture coords
+               0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, // top right
+               0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f, // bottom right
+              -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f, // bottom left
+              -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f  // top left
+          };
 
-     // Setup image and texture 
-          // Texture setup
-     unsigned int texture;
-     glGenTextures(1, &texture);
-     glBindTexture(GL_TEXTURE_2D, texture);
-               // Params
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-          // Image
-     int width, height, nrChannels;
-     unsigned char* data = stbi_load("container.jpg", &width, &height, &nrChannels, 0);
-               // Attempt to load image into texture
-     if (data) {
-          // Load image into texture
-          glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-          glGenerateMipmap(GL_TEXTURE_2D);
+          unsigned int recIndices[] = {
+               2, 1, 3, // Bottom triangle
+               3, 1, 0  // Top triangle
+          };
+
+          // Buffers and VAO
+          recVertexArray = gpuResources.create(GPU_VERTEX_ARRAY, "rectangle vertex array");
+          recVertexBuffer = gpuResources.create(GPU_BUFFER, "rectangle vertices");
+          recIndexBuffer = gpuResources.create(GPU_BUFFER, "rectangle indices");
+
+          glBindVertexArray(recVertexArray.get());
+          glBindBuffer(GL_ARRAY_BUFFER, recVertexBuffer.get());
+          glBufferData(GL_ARRAY_BUFFER, sizeof(recVertices), recVertices, GL_STATIC_DRAW);
+          glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, recIndexBuffer.get());
+          glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(recIndices), recIndices, GL_STATIC_DRAW);
+
+               // Vertex attribs
+          glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)0);
+          glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)(3 * sizeof(float)));
+          glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void*)(6 * sizeof(float)));
+          glEnableVertexAttribArray(0);
+          glEnableVertexAttribArray(1);
+          glEnableVertexAttribArray(2);
+
+          glBindBuffer(GL_ARRAY_BUFFER, 0);
+          glBindVertexArray(0);
+          glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+          gpuResources.measure(recVertexBuffer.getHandle());
+          gpuResources.measure(recIndexBuffer.getHandle());
+          return true;
+     }, { gladTask });
+
+     // Decoding (or checking and building the mip caches) is the slow part of a texture, so it happens off the main thread
+     // A texture that fails to load just ends up 0, same as before, so these never fail the graph
+     StartupGraph::Task containerFileTask = startup.add("container.jpg", StartupGraph::ANY_THREAD, [&]() {
+          if (STREAM_TEXTURES) {
+               TextureStreamer::prepareMipCache("container.jpg", false);
+          }
+          else {
+               loadImage("container.jpg", false, containerImage);
+          }
+          return true;
+     });
+     StartupGraph::Task smileFileTask = startup.add("awesomeSmile.png", StartupGraph::ANY_THREAD, [&]() {
+          if (STREAM_TEXTURES) {
+               TextureStreamer::prepareMipCache("awesomeSmile.png", true);
+          }
+          else {
+               loadImage("awesomeSmile.png", true, smileImage); // The smiley needs flipping, the container looks the same either way
+          }
+          return true;
+     });
+
+     startup.add("textures", StartupGraph::MAIN_THREAD, [&]() {
+          if (STREAM_TEXTURES) {
+               texture = streamer.addTexture("container.jpg", false);
+               texture2 = streamer.addTexture("awesomeSmile.png", true);
+          }
+          else {
+               containerTexture = gpuResources.adopt(GPU_TEXTURE, createTexture(containerImage), "container.jpg");
+               smileTexture = gpuResources.adopt(GPU_TEXTURE, createTexture(smileImage), "awesomeSmile.png");
+               texture = containerTexture.get();
+               texture2 = smileTexture.get();
+               freeImage(containerImage);
+               freeImage(smileImage);
+          }
+          return true;
+     }, { gladTask, containerFileTask, smileFileTask });
+
+     StartupGraph::Task sequenceTask = startup.add("sequence", StartupGraph::MAIN_THREAD, [&]() {
+          sequenceTexture = sequence.create(SEQUENCE_PATTERN, 0, SEQUENCE_FPS, true);
+          return true;
+     }, { gladTask });
+
+     StartupGraph::Task sceneTask = startup.add("scene", StartupGraph::ANY_THREAD, [&]() {
+          buildCubeScene(scene, cubeNodes);
+          spinClip = makeSpinClip();
+          for (size_t i = 0; i < cubeNodes.size(); i++) {
+               animator.addInstance(&spinClip);
+          }
+          scene.update();
+          return true;
+     });
+
+     // The same clips can be sampled on the GPU instead, the placement nodes become each object's parent matrix
+     StartupGraph::Task gpuTransformTask = startup.add("gpu transforms", StartupGraph::MAIN_THREAD, [&]() {
+          if (GPU_TRANSFORMS && !capturePath && gpuTransforms.create("transformUpdate.comp")) {
+               for (size_t i = 0; i < cubeNodes.size(); i++) {
+                    gpuTransforms.addObject(&spinClip, scene.getWorldTransform(scene.getParent(cubeNodes[i])));
+               }
+               gpuTransforms.attachInstanceBuffer(VAOcube, 3);
+               useGpuTransforms = true;
+          }
+          return true;
+     }, { gladTask, sceneTask, cubeBufferTask });
+
+     StartupGraph::Task overdrawTask = startup.add("overdraw counter", StartupGraph::MAIN_THREAD, [&]() {
+          countOverdraw = COUNT_OVERDRAW && !capturePath && overdraw.create();
+          return true;
+     }, { gladTask });
+
+     startup.add("dynamic resolution", StartupGraph::MAIN_THREAD, [&]() {
+          if (resolution.create("upscale.vert", "upscale.frag")) {
+               resolution.setTargetMs(RESOLUTION_TARGET_MS);
+               resolution.setScaleLimits(MIN_RESOLUTION_SCALE, 1.0f);
+               resolution.setSharpness(UPSCALE_SHARPNESS);
+               dynamicResolution = DYNAMIC_RESOLUTION;
+          }
+          return true;
+     }, { gladTask });
+
+     // The fountains stand in a ring behind the cubes, each particle is an instance of the rectangle
+     startup.add("particles", StartupGraph::MAIN_THREAD, [&]() {
+          for (int i = 0; i < PARTICLE_FOUNTAINS; i++) {
+               float angle = i * 2.0f * 3.14159265f / PARTICLE_FOUNTAINS;
+               ParticleEmitter fountain;
+               fountain.position = glm::vec3(std::cos(angle) * 6.0f, -3.0f, -8.0f + std::sin(angle) * 6.0f);
+               fountain.speed = 7.0f;
+               fountain.spread = 0.2f;
+               fountain.size = 0.04f;
+               fountain.color = FOUNTAIN_COLORS[i % (sizeof(FOUNTAIN_COLORS) / sizeof(FOUNTAIN_COLORS[0]))];
+               fountain.rate = (float)MAX_PARTICLES / ((fountain.minLifeSeconds + fountain.maxLifeSeconds) * 0.5f) / PARTICLE_FOUNTAINS;
+               particles.addEmitter(fountain);
+          }
+          // Made even when they start hidden so E can still show them
+          showParticles = particles.create("particle.vert", "particle.frag", recVertexArray.get(), 6) && SHOW_PARTICLES;
+          return true;
+     }, { gladTask, rectangleTask });
+
+     startup.add("sprites", StartupGraph::MAIN_THREAD, [&]() {
+          if (!sprites.create("sprite.vert", "sprite.frag", SPRITE_COUNT)) {
+               return true;
+          }
+          for (unsigned int& texture : spriteTextures) {
+               texture = createSpriteShapeTexture(32);
+          }
+          showSprites = SHOW_SPRITES;
+          return true;
+     }, { gladTask });
+
+     startup.add("terrain", StartupGraph::MAIN_THREAD, [&]() {
+          // Made even when it starts hidden so T can still show it
+          showTerrain = terrain.create() && SHOW_TERRAIN;
+          return true;
+     }, { gladTask });
+
+     // The coarsest detail level is the occluder, it's made of points on the surface so it never sticks out past the real thing
+     startup.add("entities", StartupGraph::ANY_THREAD, [&]() {
+          const MeshLodLevel& coarsestCube = cubeLods.getLevels()[cubeLods.getLevelCount() - 1];
+          for (size_t i = 0; i < cubeNodes.size(); i++) {
+               world.create(Transform{ glm::mat4(1.0f) }, SceneNode{ cubeNodes[i] }, GpuInstance{ (uint32_t)i }, MeshHandle{ VAOcube, 0, cubeLods.getLevels()[0].indexCount },
+                    (i == 0 && sequenceTexture) ? sequenceMaterial : cubeMaterial, Bounds{ glm::vec3(0.0f), 0.87f }, // 0.87 is half a unit cube's diagonal
+                    Occluder{ cubeMeshVertices.data(), 8, cubeLods.getIndices().data() + coarsestCube.firstIndex, coarsestCube.indexCount },
+                    MeshLods{ cubeLods.getLevels(), cubeLods.getLevelCount(), 0 });
+          }
+          return true;
+     }, { cubeBufferTask, sceneTask, sequenceTask });
+
+     // Compile every variant the materials can use up front so switching modes doesn't hitch
+     startup.add("shaders", StartupGraph::MAIN_THREAD, [&]() {
+          uint32_t transformVariants[2] = { 0, SHADER_INSTANCED };
+          uint32_t materialFeatures[2] = { cubeMaterial.shaderFeatures, sequenceMaterial.shaderFeatures };
+          for (uint32_t transformFeatures : transformVariants) {
+               if (transformFeatures == SHADER_INSTANCED && !gpuTransforms.isSupported()) {
+                    continue;
+               }
+               cubeShaders.get(SHADER_DEPTH_ONLY | transformFeatures);
+               for (uint32_t features : materialFeatures) {
+                    cubeShaders.get(features | transformFeatures);
+                    if (overdraw.isSupported()) {
+                         cubeShaders.get(features | transformFeatures | SHADER_COUNT_FRAGMENTS);
+                    }
+               }
+          }
+          // The terrain only ever uses the uniform model matrix
+          cubeShaders.get(SHADER_VERTEX_COLOR);
+          if (overdraw.isSupported()) {
+               cubeShaders.get(SHADER_VERTEX_COLOR | SHADER_COUNT_FRAGMENTS);
+          }
+          return true;
+     }, { gladTask, gpuTransformTask, overdrawTask });
+
+     if (!startup.run()) {
+          glfwTerminate();
+          return -1;
      }
-     else {
-          std::cout << "Failed to load texture" << std::endl;
-     }
-     stbi_image_free(data); // Free the image data once we've finished loading it    
-
-          // Second image
-     unsigned int texture2;
-     glGenTextures(1, &texture2);
-     glBindTexture(GL_TEXTURE_2D, texture2); // This should kick "texture" off
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // The new texture doesn't have these bound yet, we need to do so again
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-     stbi_set_flip_vertically_on_load(true);
-     data = stbi_load("awesomeSmile.png", &width, &height, &nrChannels, 0); // The setup was done before, so just bopy and paste
-     if (data) {
-          // Load image into texture
-          // .png has A value so we need to specify that when loading, note we still store it as GL_RGB
-          glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-          glGenerateMipmap(GL_TEXTURE_2D);
+     std::cout << "Cube detail levels:";
+     for (int i = 0; i < cubeLods.getLevelCount(); i++) {
+          std::cout << " " << cubeLods.getLevels()[i].indexCount / 3;
+     }
+     std::cout << " triangles, built in " << cubeLods.getBuildMs() << " ms" << std::endl;
+
+     FramePacingSettings pacingSettings;
+     pacingSettings.swapInterval = SWAP_INTERVAL;
+     pacingSettings.targetFps = TARGET_FPS;
+     pacingSettings.lowLatency = LOW_LATENCY;
+     pacingSettings.onDemand = ON_DEMAND_RENDERING;
+     FramePacer pacer(window, pacingSettings);
+     bool onDemand = ON_DEMAND_RENDERING;
+     // Finished loads need a frame to show up in, even if nothing else is happening
+     streamer.setReadCallback([&pacer]() { pacer.requestRedraw(); });
+
+     // Hot reload, saving a shader or texture swaps it in without restarting
+     AssetReloader reloader(window);
+     reloader.setReadyCallback([&pacer]() { pacer.requestRedraw(); });
+     reloader.watchShaderVariants(cubeShaders);
+     if (STREAM_TEXTURES) {
+          reloader.watchStreamedTexture(texture, "container.jpg", false, streamer);
+          reloader.watchStreamedTexture(texture2, "awesomeSmile.png", true, streamer);
      }
      else {
-          std::cout << "Failed to load texture" << std::endl;
+          reloader.watchTexture(texture, "container.jpg", false, &gpuResources, containerTexture.getHandle());
+          reloader.watchTexture(texture2, "awesomeSmile.png", true, &gpuResources, smileTexture.getHandle());
+     }
+     if (!capturePath) {
+          reloader.start();
      }
-     stbi_image_free(data); // Free the image data once we've finished loading it   
-
-     // The uniforms only need to be set once, so they can be done outside the loop
-     // You still need to use the program before setting them
-     recProgram.use();
-     // We need to send the location values
-     glUniform1i(glGetUniformLocation(recProgram.ID, "ourTexture"), 0); // set it manually
-     recProgram.setInt("ourTexture2", 1); // or with shader class
 
-     // 3D matrices
-     unsigned int modelLoc = glGetUniformLocation(recProgram.ID, "model");
-     unsigned int viewLoc = glGetUniformLocation(recProgram.ID, "view");
-     unsigned int projectionLoc = glGetUniformLocation(recProgram.ID, "projection");
+     bool depthPrepass = DEPTH_PREPASS;
+     bool frontToBack = FRONT_TO_BACK;
+     OcclusionCuller occlusion(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+     bool occlusionCulling = OCCLUSION_CULLING;
+     bool useLods = USE_LODS;
+     LodStats lodStats = { 0, 0 };
+     double lodFrameMs[2] = { 0.0, 0.0 }; // Last average frame time with detail levels off and on, to see what they save
 
-          // Transformation
-     unsigned int transformLoc = glGetUniformLocation(recProgram.ID, "transform");
-     
+     glEnable(GL_DEPTH_TEST);
 
-          // Arrays for holding the various transformation information needed by glm
+     // Animation time only moves while it isn't paused, so a paused scene really is still and on demand mode can stop drawing
+     double animationSeconds = 0.0;
+     double lastFrameSeconds = glfwGetTime();
+     bool animationPaused = false;
+     double cpuPercent[2] = { 0.0, 0.0 }; // Last CPU use measured drawing continuously and on demand, to see what idling saves
 
-     glm2DArray translationVectors{
-          { 0.25,  0.25, 0.25},
-          {-0.50, -0.50, 0.0}
-     };
-     float rotationAngles[] = { // The number of entries here needs to match the number entires in rotationAxes
-          45.0,
-          90.0
-     };
-     glm2DArray rotationAxes = {
-          {0.0, 0.0, 1.0},
-          {1.0, 0.0, 0.0}
-     };
-     glm2DArray scaleVectors = {
-          {0.5, 0.5, 0.5}
-     };
+     // CPU time spent on transforms, averaged over the same window as the frame stats
+     double transformMsTotal = 0.0;
+     int transformFrames = 0;
+     bool gpuKeyWasDown = false, prepassKeyWasDown = false, orderKeyWasDown = false, overdrawKeyWasDown = false, cullKeyWasDown = false, lodKeyWasDown = false,
+          resolutionKeyWasDown = false, onDemandKeyWasDown = false, pauseKeyWasDown = false, terrainKeyWasDown = false,
+          particleKeyWasDown = false, spriteKeyWasDown = false;
 
-     glEnable(GL_DEPTH_TEST);
+     // Nothing the render thread does each frame should need the heap once it's warmed up
+     FrameArena frameArena(FRAME_ARENA_BYTES);
+     AllocationTracker allocations;
+     uint64_t steadyStateAllocations = 0;
 
      // Render loop
      while (!glfwWindowShouldClose(window)) {
+          // Poll events, in low latency mode this waits until just before the frame needs to start and in on demand mode it
+          // sleeps until something wants a frame
+          pacer.beginFrame();
+          allocations.beginFrame();
+          frameArena.reset();
+
+          // Swap in anything the reloader finished last frame, before any drawing starts
+          reloader.swapReadyAssets();
+
           // Input
           processInput(window);
+          if (keyPressed(window, GLFW_KEY_G, gpuKeyWasDown) && gpuTransforms.isSupported()) {
+               useGpuTransforms = !useGpuTransforms;
+          }
+          if (keyPressed(window, GLFW_KEY_P, prepassKeyWasDown)) {
+               depthPrepass = !depthPrepass;
+          }
+          if (keyPressed(window, GLFW_KEY_F, orderKeyWasDown)) {
+               frontToBack = !frontToBack;
+          }
+          if (keyPressed(window, GLFW_KEY_C, cullKeyWasDown)) {
+               occlusionCulling = !occlusionCulling;
+          }
+          if (keyPressed(window, GLFW_KEY_L, lodKeyWasDown)) {
+               useLods = !useLods;
+          }
+          if (keyPressed(window, GLFW_KEY_R, resolutionKeyWasDown) && resolution.isSupported()) {
+               dynamicResolution = !dynamicResolution;
+          }
+          if (keyPressed(window, GLFW_KEY_M, onDemandKeyWasDown)) {
+               onDemand = !onDemand;
+               pacer.setOnDemand(onDemand);
+          }
+          if (keyPressed(window, GLFW_KEY_T, terrainKeyWasDown) && terrain.isSupported()) {
+               showTerrain = !showTerrain;
+          }
+          if (keyPressed(window, GLFW_KEY_E, particleKeyWasDown) && particles.isSupported()) {
+               showParticles = !showParticles;
+          }
+          if (keyPressed(window, GLFW_KEY_B, spriteKeyWasDown) && sprites.isSupported()) {
+               showSprites = !showSprites;
+          }
+          if (keyPressed(window, GLFW_KEY_SPACE, pauseKeyWasDown)) {
+               animationPaused = !animationPaused;
+          }
+          double frameSeconds = glfwGetTime();
+          double animationStep = animationPaused ? 0.0 : frameSeconds - lastFrameSeconds;
+          animationSeconds += animationStep;
+          lastFrameSeconds = frameSeconds;
+          if (keyPressed(window, GLFW_KEY_O, overdrawKeyWasDown)) {
+               countOverdraw = !countOverdraw && !capturePath && (overdraw.isSupported() || overdraw.create());
+          }
+
+          // Transformation, either a compute dispatch or sampling the clips and walking the scene graph here
+          auto transformStart = std::chrono::steady_clock::now();
+          if (useGpuTransforms) {
+               gpuTransforms.update((float)animationSeconds);
+          }
+          else {
+               updateCpuTransforms(animator, (float)animationSeconds, scene, cubeNodes, world);
+          }
+          transformMsTotal += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - transformStart).count();
+          transformFrames++;
+
+          // Uploads the step that ran during the last frame and starts the next one, which runs while this frame draws
+          if (showParticles) {
+               particles.update((float)animationStep);
+          }
+
+          // The scene goes into the offscreen target at whatever size keeps the GPU on target, or straight into the window
+          // This comes after the transforms so the compute dispatch's timer query has finished before the scene's starts
+          int framebufferWidth, framebufferHeight;
+          glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+          if (dynamicResolution) {
+               resolution.beginScene(framebufferWidth, framebufferHeight);
+          }
+          else {
+               glViewport(0, 0, framebufferWidth, framebufferHeight);
+          }
+          // Everything that works in pixels from here on goes by what's actually being rendered
+          int renderWidth = dynamicResolution ? resolution.getRenderWidth() : framebufferWidth;
+          int renderHeight = dynamicResolution ? resolution.getRenderHeight() : framebufferHeight;
 
           // Render/draw
           glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
           glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-               // Shader texture activations
-          glActiveTexture(GL_TEXTURE0);
-          glBindTexture(GL_TEXTURE_2D, texture);
-          glActiveTexture(GL_TEXTURE1);
-          glBindTexture(GL_TEXTURE_2D, texture2);
-          
-          recProgram.use(); // Even though we only have one program we should use it here for practice; if we wanted to use multiple we would need to
-          // Transformation
-          glm::mat4 trans = glm::mat4(1.0f);
-          float dynamicInRadians = (float)glfwGetTime() * (180/ 3.1415);
-          updateRotationAngle(0, dynamicInRadians, rotationAngles);
-          updateRotationAngle(1, dynamicInRadians, rotationAngles);
-          doAllTransformations(trans, translationVectors, rotationAngles, rotationAxes, scaleVectors);
-          
           // 3D stuff
           
-          glm::mat4 view = glm::mat4(1.0f); // Camera
+          glm::mat4 view = toMat4(CAMERA_VIEW); // Camera
           glm::mat4 projection = glm::mat4(1.0f); // Clip/perspective
           
-          
-          view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
-          projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+          const float nearPlane = 0.1f;
+          // The window's shape rather than the starting size, a minimised window has no size at all
+          float aspect = framebufferHeight > 0 ? (float)framebufferWidth / (float)framebufferHeight : (float)SCR_WIDTH / (float)SCR_HEIGHT;
+          projection = glm::perspective(glm::radians(45.0f), aspect, nearPlane, 100.0f);
 
-          // Send uniforms information
-          glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(trans));
+          // The terrain slides towards the camera, which is the same as the camera moving over it the other way
+          float terrainTravel = (float)animationSeconds * TERRAIN_SPEED;
+          glm::mat4 terrainModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, TERRAIN_DEPTH, terrainTravel));
 
-          
-          glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-               // We set the projection matrix each frame here, but in practice it rarely changes and so its better to set it once outside the render loop
-          glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-          
-          glBindVertexArray(VAOcube);
+          // Picks each mesh's detail level before anything reads the MeshHandles
+          lodStats = selectLods(world, scene, useGpuTransforms, view, renderHeight, useLods);
+
+          // Draw every renderable, only binding programs, textures and VAOs when they change from the last object
+          // The instanced variants read their model matrices from the compute shader's output instead of a uniform
+          uint32_t transformFeatures = useGpuTransforms ? (uint32_t)SHADER_INSTANCED : 0;
+          uint32_t passFeatures = 0;
+          bool depthOnly = false;
+          ShaderVariant boundShader;
+          bool shaderBound = false;
+          unsigned int boundTextures[2] = { 0, 0 };
+          unsigned int boundVAO = 0;
+          // Everything drawn in the depth pre-pass shares one program with no textures
+          auto shaderFeaturesFor = [&](const Material& material) {
+               return (depthOnly ? (uint32_t)SHADER_DEPTH_ONLY : material.shaderFeatures) | passFeatures;
+          };
+          auto bindMaterial = [&](const MeshHandle& mesh, const Material& material) {
+               uint32_t features = shaderFeaturesFor(material);
+               if (!shaderBound || features != boundShader.features) {
+                    boundShader = cubeShaders.get(features);
+                    shaderBound = true;
+                    glUseProgram(boundShader.program);
+
+                    // Send uniforms information, the spin is already part of each cube's world matrix
+                    glUniformMatrix4fv(boundShader.transform, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+                    glUniformMatrix4fv(boundShader.view, 1, GL_FALSE, glm::value_ptr(view));
+                    // Every variant has its own copy, so they get set whenever the program changes rather than once a frame
+                    glUniformMatrix4fv(boundShader.projection, 1, GL_FALSE, glm::value_ptr(projection));
+               }
+
+                    // Shader texture activations
+               for (int unit = 0; unit < 2 && !depthOnly; unit++) {
+                    unsigned int textureName = *material.textures[unit];
+                    if (textureName != boundTextures[unit]) {
+                         glActiveTexture(GL_TEXTURE0 + unit);
+                         glBindTexture(GL_TEXTURE_2D, textureName);
+                         boundTextures[unit] = textureName;
+                    }
+               }
+               if (mesh.vao != boundVAO) {
+                    glBindVertexArray(mesh.vao);
+                    boundVAO = mesh.vao;
+               }
+          };
+
+          // Tell the streamer how big this object is on screen so it knows which mips its textures need
+          auto requestTextureSizes = [&](const glm::mat4& model, const Bounds& bounds) {
+               if (depthOnly) {
+                    return;
+               }
+               glm::vec4 viewPosition = view * model * glm::vec4(bounds.center, 1.0f);
+               float distance = glm::length(glm::vec3(viewPosition.x, viewPosition.y, viewPosition.z));
+               float screenPixels = TextureStreamer::projectedSizePixels(bounds.radius * maxAxisScale(model), distance, glm::radians(45.0f), renderHeight);
+               streamer.requestSize(boundTextures[0], screenPixels);
+               streamer.requestSize(boundTextures[1], screenPixels);
+          };
+
+          // The CPU path's list gets built once and drawn by both passes
+          size_t drawCount = 0;
+          DrawItem* draws = nullptr;
+          if (!useGpuTransforms) {
+               draws = buildDrawList(world, frameArena, view, frontToBack, drawCount);
+               if (occlusionCulling) {
+                    drawCount = cullOccludedDraws(occlusion, world, frameArena, draws, drawCount, view, projection, nearPlane, renderHeight);
+               }
+          }
+
+          auto drawScene = [&]() {
+               if (useGpuTransforms) {
+                    // Runs of entities with consecutive instances and the same mesh and material go out as one instanced draw
+                    // Instances draw in index order, so front to back doesn't apply here and only the pre-pass saves any shading
+                    MeshHandle runMesh = { 0, 0, 0 };
+                    uint32_t runFirst = 0, runCount = 0;
+                    auto flushRun = [&]() {
+                         if (runCount > 0) {
+                              gpuTransforms.draw(runMesh.firstIndex, runMesh.indexCount, runFirst, runCount);
+                         }
+                         runCount = 0;
+                    };
+                    world.forEachChunk<SceneNode, GpuInstance, MeshHandle, Material, Bounds>([&](size_t count, SceneNode* nodes, GpuInstance* instances, MeshHandle* meshes, Material* materials, Bounds* bounds) {
+                         for (size_t i = 0; i < count; i++) {
+                              bool sameMaterial = shaderFeaturesFor(materials[i]) == boundShader.features
+                                   && (depthOnly || (*materials[i].textures[0] == boundTextures[0] && *materials[i].textures[1] == boundTextures[1]));
+                              bool sameMesh = meshes[i].vao == boundVAO && meshes[i].firstIndex == runMesh.firstIndex && meshes[i].indexCount == runMesh.indexCount;
+                              if (runCount == 0 || instances[i].index != runFirst + runCount || !sameMesh || !sameMaterial) {
+                                   flushRun();
+                                   bindMaterial(meshes[i], materials[i]);
+                                   runMesh = meshes[i];
+                                   runFirst = instances[i].index;
+                              }
+                              runCount++;
+
+                              // The final matrices never come back from the GPU, the parent's is close enough for picking mip levels
+                              SceneGraph::Node parent = scene.getParent(nodes[i].node);
+                              requestTextureSizes(scene.getWorldTransform(parent == SceneGraph::NO_PARENT ? nodes[i].node : parent), bounds[i]);
+                         }
+                    });
+                    flushRun();
+               }
+               else {
+                    for (size_t i = 0; i < drawCount; i++) {
+                         bindMaterial(draws[i].mesh, draws[i].material);
+
+                         const glm::mat4& model = *draws[i].model; // Worldspace
+                         glUniformMatrix4fv(boundShader.model, 1, GL_FALSE, glm::value_ptr(model));
+                         glDrawElements(GL_TRIANGLES, draws[i].mesh.indexCount, GL_UNSIGNED_INT, (void*)(draws[i].mesh.firstIndex * sizeof(unsigned int)));
+                         requestTextureSizes(model, draws[i].bounds);
+                    }
+               }
+
+               // Its chunks already have the lighting in their vertex colours, so it needs neither textures nor instancing
+               if (showTerrain) {
+                    uint32_t features = (depthOnly ? (uint32_t)SHADER_DEPTH_ONLY : (uint32_t)SHADER_VERTEX_COLOR) | (passFeatures & SHADER_COUNT_FRAGMENTS);
+                    ShaderVariant terrainShader = cubeShaders.get(features);
+                    glUseProgram(terrainShader.program);
+                    glUniformMatrix4fv(terrainShader.transform, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+                    glUniformMatrix4fv(terrainShader.model, 1, GL_FALSE, glm::value_ptr(terrainModel));
+                    glUniformMatrix4fv(terrainShader.view, 1, GL_FALSE, glm::value_ptr(view));
+                    glUniformMatrix4fv(terrainShader.projection, 1, GL_FALSE, glm::value_ptr(projection));
+                    terrain.draw();
+                    // The next pass has to bind its own program and VAO again
+                    shaderBound = false;
+                    boundVAO = 0;
+               }
+          };
 
-          for (int i = 0; i < 10; i++) {
-               glm::mat4 model = glm::mat4(1.0f); // Worldspace
-               model = glm::translate(model, cubePositions[i]);
-               float angle = 20.0f * i;
-               model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.0f, 0.0f));
-               glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-               glDrawElements(GL_TRIANGLES, numOfCubeIndices, GL_UNSIGNED_INT, 0);
+          // Depth pre-pass, lays down the nearest depth everywhere so the colour pass only shades the fragments that end up visible
+          if (depthPrepass) {
+               depthOnly = true;
+               passFeatures = transformFeatures;
+               glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+               drawScene();
+               glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+               glDepthFunc(GL_LEQUAL); // The colour pass lands on exactly the same depths
+               glDepthMask(GL_FALSE);
+               depthOnly = false;
           }
+
+          // A frame where every counter is still in flight is drawn with the normal variants, there's no counter bound to bump
+          bool countingPass = countOverdraw && overdraw.beginPass();
+          passFeatures = transformFeatures | (countingPass ? (uint32_t)SHADER_COUNT_FRAGMENTS : 0);
+          drawScene();
+          if (countingPass) {
+               overdraw.endPass(renderWidth, renderHeight);
+          }
+          // Last, since they don't write depth and blend over everything
+          if (showParticles) {
+               particles.draw(view, projection);
+          }
+          glDepthFunc(GL_LESS);
+          glDepthMask(GL_TRUE);
           
           glBindVertexArray(0);
 
-          // Poll events
-          glfwPollEvents();
+          // Stretch the scene over the window
+          if (dynamicResolution) {
+               resolution.endScene();
+          }
+
+          // The sprites go on top at the window's full resolution, each one circles the middle at its own radius and speed
+          if (showSprites) {
+               sprites.begin(framebufferWidth, framebufferHeight);
+               glm::vec2 middle = glm::vec2(framebufferWidth, framebufferHeight) * 0.5f;
+               float maxRadius = std::min(framebufferWidth, framebufferHeight) * 0.45f;
+               for (int i = 0; i < SPRITE_COUNT; i++) {
+                    float along = (i + 0.5f) / SPRITE_COUNT;
+                    float angle = i * 2.39996f + (float)animationSeconds * (0.2f + 0.8f * (1.0f - along));
+                    Sprite sprite;
+                    sprite.position = middle + glm::vec2(std::cos(angle), std::sin(angle)) * (maxRadius * std::sqrt(along));
+                    sprite.size = glm::vec2(6.0f + 10.0f * along);
+                    sprite.rotation = angle;
+                    sprite.texture = spriteTextures[i % SPRITE_TEXTURES];
+                    sprite.layer = (i / SPRITE_TEXTURES) % 4;
+                    uint32_t shade = (uint32_t)(255.0f * along);
+                    sprite.tint = 0xa0000000u | (shade << 16) | ((255 - shade) << 8) | 0xff;
+                    sprites.draw(sprite);
+               }
+               sprites.end();
+          }
+
+          uint64_t levelsStreamedBefore = streamer.getStats().levelsStreamedIn;
+          streamer.update();
+          sequence.update(animationSeconds);
+          // Only streams while it's shown, so leaving it off doesn't keep the thread pool busy
+          if (showTerrain) {
+               glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+               terrain.update(glm::vec3(glm::inverse(terrainModel) * glm::vec4(cameraPosition, 1.0f)));
+          }
+
+          // On demand mode draws again straight away while anything's moving, or something that just loaded could lead to more
+          // (a new mip level makes room to ask for the next one), or the reloader has something waiting on its fence, or there
+          // are terrain chunks still on their way
+          if (!animationPaused || streamer.getStats().levelsStreamedIn != levelsStreamedBefore || reloader.hasReadyAssets() || terrain.isBusy()) {
+               pacer.requestRedraw();
+          }
+
+          // Swap buffers, and sleep off the rest of the frame if there's a frame limit
+          pacer.endFrame();
+          gpuResources.endFrame();
+          endGlCaptureFrame();
+
+          // Startup's trace waits for the first frame so it can say how long it took to get something on screen
+          if (startup.getFirstFrameMs() == 0.0) {
+               startup.markFirstFrame();
+               startup.printTrace();
+               if (traceStartup) {
+                    startup.writeChromeTrace(STARTUP_TRACE_PATH);
+               }
+          }
+
+          allocations.endFrame();
+          if (allocations.getFrames() > ALLOCATION_WARMUP_FRAMES && allocations.getLastFrame().allocations > 0) {
+               if (steadyStateAllocations == 0) {
+                    std::cout << "Render loop allocated " << allocations.getLastFrame().allocations << " times (" << allocations.getLastFrame().bytes
+                         << " bytes) in frame " << allocations.getFrames() << " after warming up" << std::endl;
+               }
+               steadyStateAllocations += allocations.getLastFrame().allocations;
+          }
 
-          // Swap buffers
-          glfwSwapBuffers(window);
+          if (pacer.statsUpdated()) {
+               const FrameStats& stats = pacer.getStats();
+               lodFrameMs[useLods ? 1 : 0] = stats.averageFrameMs;
+               cpuPercent[onDemand ? 1 : 0] = stats.cpuPercent;
+               const TextureStreamingStats& streaming = streamer.getStats();
+               double transformMs = transformFrames > 0 ? transformMsTotal / transformFrames : 0.0;
+               transformMsTotal = 0.0;
+               transformFrames = 0;
+               char transformText[64];
+               if (useGpuTransforms) {
+                    snprintf(transformText, sizeof(transformText), "GPU %.3f ms (cpu %.3f)", gpuTransforms.getStats().gpuMs, transformMs);
+               }
+               else {
+                    snprintf(transformText, sizeof(transformText), "CPU %.3f ms", transformMs);
+               }
+               char sequenceText[96] = "";
+               if (sequenceTexture) {
+                    const SequenceTextureStats& playback = sequence.getStats();
+                    snprintf(sequenceText, sizeof(sequenceText), " | sequence %llu dropped, %.1f MB/s", (unsigned long long)playback.framesDropped, playback.uploadMBps);
+               }
+               char overdrawText[64] = "";
+               if (countOverdraw && overdraw.getStats().active) {
+                    snprintf(overdrawText, sizeof(overdrawText), " | overdraw %.2f frags/px", overdraw.getStats().fragmentsPerPixel);
+               }
+               char occlusionText[96] = "";
+               if (occlusionCulling && useGpuTransforms) {
+                    snprintf(occlusionText, sizeof(occlusionText), " | occlusion off (GPU transforms)");
+               }
+               else if (occlusionCulling) {
+                    const OcclusionStats& culled = occlusion.getStats();
+                    snprintf(occlusionText, sizeof(occlusionText), " | occluded %d/%d (%d occluders) %.3f ms", culled.occluded, culled.tested, culled.occluders,
+                         culled.rasterMs + culled.pyramidMs + culled.testMs);
+               }
+               char lodText[96];
+               snprintf(lodText, sizeof(lodText), " | %s %d/%d tris (%.2f ms with, %.2f ms without)", useLods ? "lod" : "no lod", lodStats.triangles,
+                    lodStats.fullDetailTriangles, lodFrameMs[1], lodFrameMs[0]);
+               // Memory main owns through the registry, the streamed textures are the "textures" figure before it
+               const GpuMemoryStats& memory = gpuResources.getStats();
+               const double MB = 1024.0 * 1024.0;
+               char memoryText[128];
+               snprintf(memoryText, sizeof(memoryText), "gpu %.1f/%.0f MB%s (buffers %.1f, textures %.1f, mips %.1f, %d retiring)", memory.totalBytes / MB,
+                    memory.budgetBytes / MB, memory.overBudget ? " OVER" : "", memory.bytes[GPU_MEMORY_BUFFERS] / MB, memory.bytes[GPU_MEMORY_TEXTURES] / MB,
+                    memory.bytes[GPU_MEMORY_MIPS] / MB, memory.retiring);
+               char resolutionText[96] = "";
+               if (dynamicResolution) {
+                    const DynamicResolutionStats& scaling = resolution.getStats();
+                    snprintf(resolutionText, sizeof(resolutionText), " | resolution %.0f%% %dx%d, scene %.2f ms", scaling.scale * 100.0f, scaling.renderWidth,
+                         scaling.renderHeight, scaling.sceneGpuMs);
+               }
+               char terrainText[128] = "";
+               if (showTerrain) {
+                    const TerrainStats& ground = terrain.getStats();
+                    snprintf(terrainText, sizeof(terrainText), " | terrain %d/%d chunks (%d pending), %.1f M verts/s, %.2f ms a chunk, upload %.3f ms %.0f KB",
+                         ground.residentChunks, ground.slots, ground.pendingChunks, ground.verticesPerSecond / 1e6, ground.generateMsPerChunk, ground.uploadMsPerFrame,
+                         ground.uploadKBPerFrame);
+               }
+               char particleText[128] = "";
+               if (showParticles) {
+                    const ParticleStats& fountains = particles.getStats();
+                    snprintf(particleText, sizeof(particleText), " | particles %zu, step %.2f ms (compact %.2f, emit %.2f), wait %.2f ms, upload %.2f ms %.1f MB",
+                         fountains.alive, fountains.simulateMs + fountains.compactMs + fountains.emitMs, fountains.compactMs, fountains.emitMs, fountains.waitMs,
+                         fountains.uploadMs, fountains.uploadMB);
+               }
+               char spriteText[96] = "";
+               if (showSprites) {
+                    const SpriteBatchStats& batched = sprites.getStats();
+                    snprintf(spriteText, sizeof(spriteText), " | sprites %zu in %d draws, %.3f ms (sort %.3f, vertices %.3f)", batched.sprites, batched.drawCalls,
+                         batched.sortMs + batched.writeMs + batched.submitMs, batched.sortMs, batched.writeMs);
+               }
+               char pacingText[128];
+               snprintf(pacingText, sizeof(pacingText), " | %s%s, %d frames, cpu %.1f%% (continuous %.1f%%, on demand %.1f%%)", onDemand ? "on demand" : "continuous",
+                    animationPaused ? " paused" : "", stats.frames, stats.cpuPercent, cpuPercent[0], cpuPercent[1]);
+               char title[1024];
+               snprintf(title, sizeof(title), "Window Title | %.2f ms (jitter %.2f, max %.2f) | input latency %.2f ms (max %.2f) | textures %.1f/%.1f MB, %d/%d mips, %.1f MB/s | %s | transforms %s | %llu allocs in %llu frames, arena %zu KB | %s%s%s%s%s%s%s%s%s%s%s",
+                    stats.averageFrameMs, stats.jitterMs, stats.maxFrameMs, stats.averageLatencyMs, stats.maxLatencyMs,
+                    streaming.residentBytes / MB, streaming.budgetBytes / MB, streaming.residentLevels, streaming.totalLevels, streaming.uploadMBps, memoryText,
+                    transformText, (unsigned long long)steadyStateAllocations, (unsigned long long)allocations.getFramesThatAllocated(), frameArena.getPeak() / 1024,
+                    depthPrepass ? "pre-pass" : "no pre-pass", frontToBack ? (useGpuTransforms ? ", front to back off (GPU transforms)" : ", front to back") : "", overdrawText, occlusionText, lodText, resolutionText, sequenceText, terrainText, particleText, spriteText, pacingText);
+               glfwSetWindowTitle(window, title);
+          }
      }
 
      // Cleanup and return
-     glDeleteVertexArrays(1, &VAO);
-     glDeleteBuffers(1, &EBO);
-     glDeleteBuffers(1, &VBO);
-     recProgram.deleteProgram();
+     stopGlCapture();
+     reloader.stop();
+     streamer.setReadCallback(nullptr); // The pacer goes before the streamer's reader thread does
+     streamer.deleteTextures();
+     sequence.deleteResources();
+     terrain.deleteResources();
+     particles.deleteResources();
+     sprites.deleteResources();
+     glDeleteTextures(SPRITE_TEXTURES, spriteTextures);
+     overdraw.deleteResources();
+     resolution.deleteResources();
+     gpuTransforms.deleteResources();
+     gpuResources.deleteResources();
+     cubeShaders.deleteResources();
 
      glfwTerminate();
      return 0;
@@ -324,6 +1090,14 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height) {
      glViewport(0, 0, width, height);
 }
 
+// True on the frame the key goes down, for keys that toggle something
+bool keyPressed(GLFWwindow* window, int key, bool& wasDown) {
+     bool down = glfwGetKey(window, key) == GLFW_PRESS;
+     bool pressed = down && !wasDown;
+     wasDown = down;
+     return pressed;
+}
+
 // General user input (keyboard only for now)
 void processInput(GLFWwindow* window) {
      if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
@@ -331,42 +1105,482 @@ void processInput(GLFWwindow* window) {
      }
 }
 
-// Does all transformation/translation changes to the object via glm functions
-void doAllTransformations(glm::mat4 &translationMatrix, glm2DArray translationVals, float rotationAngles[], glm2DArray rotationAxes, glm2DArray scaleValues) {
-     // Translations
-     for (int i = 0; i < translationVals.size(); i++) {
-          translationMatrix = glm::translate(translationMatrix, translationVals.at(i));
+// The spin every cube gets before its model matrix as keyframes, a turn about z and x together every 2 pi seconds
+// The keys are close enough together that slerping between them is indistinguishable from the exact rotation
+// It's only the rotation, the translation and scale around it are SPIN_PIVOT and already part of the cube's placement
+AnimationClip makeSpinClip() {
+     const int ROTATION_KEYS = 64;
+     const float PERIOD = 2.0f * 3.14159265f;
+     AnimationClip clip;
+     for (int i = 0; i <= ROTATION_KEYS; i++) {
+          float angle = PERIOD * i / ROTATION_KEYS;
+          clip.addRotationKey(angle, glm::angleAxis(angle, glm::vec3(0.0f, 0.0f, 1.0f)) * glm::angleAxis(angle, glm::vec3(1.0f, 0.0f, 0.0f)));
      }
+     return clip;
+}
 
-     // Rotations
-          // Make sure the number of angles matches the number of rotation axes
-     int anglesLength = sizeof(rotationAngles) / sizeof (float);
-     int axesLength = rotationAxes.size();
-     if (anglesLength == axesLength) {
-          for (int i = 0; i < rotationAxes.size(); i++) {
-               translationMatrix = glm::rotate(translationMatrix, glm::radians(rotationAngles[i]), rotationAxes.at(i));
+// One placement node per cube with a spin node under it, cubeNodes gets the spin nodes since those are what get drawn
+// The placements are read straight out of the mapped scene file, which is closed again once the nodes have them, or they're the
+// cubes the scene had before there were scene files, which are baked in already
+void buildCubeScene(SceneGraph& scene, std::vector<SceneGraph::Node>& cubeNodes) {
+     auto start = std::chrono::steady_clock::now();
+     cubeNodes.clear();
+     SceneFile file;
+     if (!file.open(SCENE_PATH)) {
+          std::cout << "Using the built in cubes" << std::endl;
+          cubeNodes.reserve(NUM_CUBES);
+          for (const ConstMat4& placement : DEFAULT_CUBES) {
+               cubeNodes.push_back(scene.addNode(glm::mat4(1.0f), scene.addNode(toMat4(placement))));
           }
+          return;
      }
-     else {
-          std::cout << "Numer of rotation angles doesn't match number of rotation axes: No rotation occruing" << std::endl;
+
+     ScenePlacements placements = file.getPlacements();
+     std::cout << "Mapped " << placements.count << " objects from " << SCENE_PATH << " in "
+          << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+     glm::mat4 pivot = toMat4(SPIN_PIVOT);
+     cubeNodes.reserve(placements.count);
+     for (size_t i = 0; i < placements.count; i++) {
+          SceneGraph::Node placement = scene.addNode(placementMatrix(placements, i) * pivot);
+          cubeNodes.push_back(scene.addNode(glm::mat4(1.0f), placement));
      }
-     
-     // Scalings
-     for (int i = 0; i < scaleValues.size(); i++) {
-          translationMatrix = glm::scale(translationMatrix, scaleValues.at(i));
+}
+
+// The unit cube again, but with every face split into a subdivisions x subdivisions grid and the edges and corners rounded off,
+// which gives the detail levels something to take away
+// Faces don't share vertices since their texture coords differ, but grid points along a shared edge come out at exactly the same
+// position, so the simplifier can tell it's a seam
+void buildRoundedCube(int subdivisions, float rounding, std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+     // The axis the face points along, then the axes its texture's u and v run along, picked so the triangles wind counter clockwise
+     const struct {
+          int normalAxis, normalSign;
+          int uAxis, uSign;
+          int vAxis, vSign;
+     } faces[6] = {
+          { 2, 1, 0, 1, 1, 1 }, // Front
+          { 2, -1, 0, -1, 1, 1 }, // Back
+          { 0, 1, 2, -1, 1, 1 }, // Right
+          { 0, -1, 2, 1, 1, 1 }, // Left
+          { 1, 1, 0, 1, 2, -1 }, // Top
+          { 1, -1, 0, 1, 2, 1 } // Bottom
+     };
+     vertices.clear();
+     indices.clear();
+     float inner = 0.5f - rounding;
+     for (const auto& face : faces) {
+          unsigned int firstVertex = (unsigned int)(vertices.size() / 8);
+          for (int j = 0; j <= subdivisions; j++) {
+               for (int i = 0; i <= subdivisions; i++) {
+                    // Whole grid steps first, so every face touching a point works out the same floats for it
+                    int steps[3];
+                    steps[face.normalAxis] = face.normalSign > 0 ? subdivisions : 0;
+                    steps[face.uAxis] = face.uSign > 0 ? i : subdivisions - i;
+                    steps[face.vAxis] = face.vSign > 0 ? j : subdivisions - j;
+                    glm::vec3 position((float)steps[0] / subdivisions - 0.5f, (float)steps[1] / subdivisions - 0.5f, (float)steps[2] / subdivisions - 0.5f);
+
+                    // Pulled in to a sphere of the rounding radius around the nearest point of a smaller cube
+                    glm::vec3 core(glm::clamp(position.x, -inner, inner), glm::clamp(position.y, -inner, inner), glm::clamp(position.z, -inner, inner));
+                    glm::vec3 offset = position - core;
+                    if (glm::length(offset) > 0.0f) {
+                         position = core + glm::normalize(offset) * rounding;
+                    }
+
+                    float vertex[8] = { position.x, position.y, position.z, 1.0f, 1.0f, 1.0f, (float)i / subdivisions, (float)j / subdivisions };
+                    vertices.insert(vertices.end(), vertex, vertex + 8);
+               }
+          }
+          for (int j = 0; j < subdivisions; j++) {
+               for (int i = 0; i < subdivisions; i++) {
+                    unsigned int corner = firstVertex + j * (subdivisions + 1) + i;
+                    unsigned int above = corner + subdivisions + 1;
+                    unsigned int quad[6] = { corner, corner + 1, above + 1, corner, above + 1, above };
+                    indices.insert(indices.end(), quad, quad + 6);
+               }
+          }
      }
 }
 
-void updateRotationAngle(int whichRotationAsIndex, float newValue , float rotationAngles[]) {
-     if (whichRotationAsIndex < 0) {
-          return;
+// Samples the spin clip and hands each cube's result to its spin node
+void animateCubes(Animator& animator, float seconds, SceneGraph& scene, const std::vector<SceneGraph::Node>& cubeNodes) {
+     animator.sample(seconds);
+     for (size_t i = 0; i < cubeNodes.size(); i++) {
+          scene.setLocalTransform(cubeNodes[i], animator.getTransform((Animator::Instance)i));
      }
+}
 
-     int numOfRotations = sizeof(rotationAngles) / sizeof(float);
-     if (whichRotationAsIndex < numOfRotations) {
-          rotationAngles[whichRotationAsIndex] = newValue;
+// Everything the CPU transform path does each frame before drawing
+void updateCpuTransforms(Animator& animator, float seconds, SceneGraph& scene, const std::vector<SceneGraph::Node>& cubeNodes, EntityWorld& world) {
+     // Only the spin nodes change so the placements don't get recomputed
+     animateCubes(animator, seconds, scene, cubeNodes);
+     scene.update();
+
+     // Copy out the world matrices that moved
+     world.forEachChunk<SceneNode, Transform>([&](size_t count, SceneNode* nodes, Transform* transforms) {
+          for (size_t i = 0; i < count; i++) {
+               if (scene.worldChanged(nodes[i].node)) {
+                    transforms[i].world = scene.getWorldTransform(nodes[i].node);
+               }
+          }
+     });
+}
+
+// Every renderable in the order it should be drawn, grouped by shader, VAO and textures so the draw loop binds as little as possible
+// frontToBack draws the nearest first instead, so the depth test stops hidden fragments being shaded even without a pre-pass
+// Lives in the arena so it's gone at the next reset
+DrawItem* buildDrawList(EntityWorld& world, FrameArena& arena, const glm::mat4& view, bool frontToBack, size_t& count) {
+     DrawItem* draws = arena.allocateArray<DrawItem>(world.size());
+     count = 0;
+     world.forEachChunk<Transform, MeshHandle, Material, Bounds>([&](size_t rows, Transform* transforms, MeshHandle* meshes, Material* materials, Bounds* bounds) {
+          for (size_t i = 0; i < rows; i++) {
+               // The camera looks down -z
+               glm::vec4 viewCenter = view * transforms[i].world * glm::vec4(bounds[i].center, 1.0f);
+               draws[count++] = { &transforms[i].world, meshes[i], materials[i], bounds[i], -viewCenter.z };
+          }
+     });
+     if (frontToBack) {
+          std::sort(draws, draws + count, [](const DrawItem& a, const DrawItem& b) {
+               return a.depth < b.depth;
+          });
+          return draws;
      }
-     else {
-          std::cout << "Given index is beyond size of rotationAngles: No change made" << std::endl;
+     std::sort(draws, draws + count, [](const DrawItem& a, const DrawItem& b) {
+          // Program changes cost the most, so they go first
+          if (a.material.shaderFeatures != b.material.shaderFeatures) {
+               return a.material.shaderFeatures < b.material.shaderFeatures;
+          }
+          if (a.mesh.vao != b.mesh.vao) {
+               return a.mesh.vao < b.mesh.vao;
+          }
+          if (*a.material.textures[0] != *b.material.textures[0]) {
+               return *a.material.textures[0] < *b.material.textures[0];
+          }
+          return *a.material.textures[1] < *b.material.textures[1];
+     });
+     return draws;
+}
+
+// Largest scale along any of the model's axes, for growing a bounding sphere to fit
+float maxAxisScale(const glm::mat4& model) {
+     return std::sqrt(std::max(glm::dot(model[0], model[0]), std::max(glm::dot(model[1], model[1]), glm::dot(model[2], model[2]))));
+}
+
+// How many pixels one unit of the model's mesh covers on screen around center, for turning a detail level's error into pixels
+float pixelsPerUnit(const glm::mat4& view, const glm::mat4& model, const glm::vec3& center, int viewportHeight) {
+     float distance = -(view * model * glm::vec4(center, 1.0f)).z;
+     // projectedSizePixels wants a radius, and a whole unit across is a radius of a half
+     return TextureStreamer::projectedSizePixels(0.5f * maxAxisScale(model), distance, glm::radians(45.0f), viewportHeight);
+}
+
+// Rasterizes the occluders that are big on screen and drops every draw hidden behind them, keeping the rest in order
+// Returns how many draws are left
+size_t cullOccludedDraws(OcclusionCuller& culler, EntityWorld& world, FrameArena& arena, DrawItem* draws, size_t count, const glm::mat4& view,
+     const glm::mat4& projection, float nearPlane, int framebufferHeight) {
+     culler.beginFrame(view, projection, nearPlane);
+     int occluders = 0;
+     world.forEachChunk<Transform, Occluder, Bounds>([&](size_t rows, Transform* transforms, Occluder* meshes, Bounds* bounds) {
+          for (size_t i = 0; i < rows && occluders < MAX_OCCLUDERS; i++) {
+               const glm::mat4& model = transforms[i].world;
+               float distance = -(view * model * glm::vec4(bounds[i].center, 1.0f)).z;
+               float screenPixels = TextureStreamer::projectedSizePixels(bounds[i].radius * maxAxisScale(model), distance, glm::radians(45.0f), framebufferHeight);
+               if (distance > nearPlane && screenPixels >= OCCLUDER_MIN_PIXELS) {
+                    culler.addOccluder(meshes[i].vertices, meshes[i].floatsPerVertex, meshes[i].indices, meshes[i].indexCount, model);
+                    occluders++;
+               }
+          }
+     });
+
+     glm::vec4* spheres = arena.allocateArray<glm::vec4>(count);
+     uint8_t* visible = arena.allocateArray<uint8_t>(count);
+     for (size_t i = 0; i < count; i++) {
+          const glm::mat4& model = *draws[i].model;
+          spheres[i] = glm::vec4(glm::vec3(model * glm::vec4(draws[i].bounds.center, 1.0f)), draws[i].bounds.radius * maxAxisScale(model));
+     }
+     culler.testSpheres(spheres, count, visible);
+
+     size_t kept = 0;
+     for (size_t i = 0; i < count; i++) {
+          if (visible[i]) {
+               draws[kept++] = draws[i];
+          }
+     }
+     return kept;
+}
+
+// Points every mesh that has detail levels at the one it needs for its size on screen, or at full detail with useLods off
+// The GPU path's matrices never come back, so fromParents goes by the placement node's instead, like the texture streaming does
+LodStats selectLods(EntityWorld& world, const SceneGraph& scene, bool fromParents, const glm::mat4& view, int framebufferHeight, bool useLods) {
+     LodStats stats = { 0, 0 };
+     world.forEachChunk<Transform, SceneNode, Bounds, MeshLods, MeshHandle>([&](size_t rows, Transform* transforms, SceneNode* nodes, Bounds* bounds,
+          MeshLods* lods, MeshHandle* meshes) {
+          for (size_t i = 0; i < rows; i++) {
+               int level = 0;
+               if (useLods) {
+                    const glm::mat4* model = &transforms[i].world;
+                    if (fromParents) {
+                         SceneGraph::Node parent = scene.getParent(nodes[i].node);
+                         model = &scene.getWorldTransform(parent == SceneGraph::NO_PARENT ? nodes[i].node : parent);
+                    }
+                    level = selectLodLevel(lods[i].levels, lods[i].levelCount, lods[i].current, pixelsPerUnit(view, *model, bounds[i].center, framebufferHeight),
+                         LOD_MAX_PIXEL_ERROR, LOD_HYSTERESIS);
+               }
+               lods[i].current = level;
+               meshes[i].firstIndex = lods[i].levels[level].firstIndex;
+               meshes[i].indexCount = lods[i].levels[level].indexCount;
+               stats.triangles += meshes[i].indexCount / 3;
+               stats.fullDetailTriangles += lods[i].levels[0].indexCount / 3;
+          }
+     });
+     return stats;
+}
+
+// Draws one frame of the cube scene on the CPU and saves it, doesn't need a window or a GL driver
+int renderSoftwareFrame(const char* outputPath, float seconds, int width, int height) {
+     ImageData containerImage, smileImage;
+     if (!loadImage("container.jpg", false, containerImage)) {
+          return -1;
+     }
+     if (!loadImage("awesomeSmile.png", true, smileImage)) {
+          freeImage(containerImage);
+          return -1;
+     }
+     SoftwareTexture texture, texture2;
+     texture.create(containerImage);
+     texture2.create(smileImage);
+     freeImage(containerImage);
+     freeImage(smileImage);
+
+     SceneGraph scene;
+     std::vector<SceneGraph::Node> cubeNodes;
+     buildCubeScene(scene, cubeNodes);
+     AnimationClip spinClip = makeSpinClip();
+     Animator animator;
+     for (size_t i = 0; i < cubeNodes.size(); i++) {
+          animator.addInstance(&spinClip);
+     }
+     animateCubes(animator, seconds, scene, cubeNodes);
+     scene.update();
+
+     glm::mat4 view = toMat4(CAMERA_VIEW);
+     glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
+
+     SoftwareRasterizer rasterizer(width, height);
+     rasterizer.clear(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+     rasterizer.bindTextures(&texture, &texture2);
+     // The same mesh the GL path draws at full detail, which is its first detail level
+     std::vector<float> cubeMeshVertices;
+     std::vector<unsigned int> cubeMeshIndices;
+     buildRoundedCube(CUBE_SUBDIVISIONS, CUBE_ROUNDING, cubeMeshVertices, cubeMeshIndices);
+     for (size_t i = 0; i < cubeNodes.size(); i++) {
+          rasterizer.drawElements(cubeMeshVertices.data(), cubeMeshIndices.data(), (int)cubeMeshIndices.size(), projection * view * scene.getWorldTransform(cubeNodes[i]));
+     }
+     rasterizer.flush();
+
+     const SoftwareRenderStats& stats = rasterizer.getStats();
+     std::cout << width << "x" << height << ": " << stats.drawnTriangles << " triangles (" << stats.binnedTriangles << " tile bins), "
+          << stats.geometryMs << " ms geometry, " << stats.rasterMs << " ms raster" << std::endl;
+     return rasterizer.writePPM(outputPath) ? 0 : -1;
+}
+
+// Renders the rounded cube scene on the CPU at full detail and then with detail levels, for `--benchmark-lod [frames] [camera distance]`
+// The software rasterizer's time stands in for the GPU's, so it shows what the levels save without needing a window or a GL driver
+int benchmarkLods(int frames, float cameraDistance) {
+     if (frames <= 0) {
+          std::cout << "Nothing to benchmark" << std::endl;
+          return -1;
+     }
+     std::vector<float> vertices;
+     std::vector<unsigned int> indices;
+     buildRoundedCube(CUBE_SUBDIVISIONS, CUBE_ROUNDING, vertices, indices);
+     MeshLodChain chain;
+     chain.build(vertices.data(), 8, vertices.size() / 8, indices.data(), indices.size(), LOD_REDUCTION);
+     std::cout << "Built " << chain.getLevelCount() << " detail levels in " << chain.getBuildMs() << " ms" << std::endl;
+     // A level gets picked once error * pixels per unit is under the limit, and pixels per unit falls off with distance
+     float pixelsPerUnitAtOne = pixelsPerUnit(glm::mat4(1.0f), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1.0f)), glm::vec3(0.0f), SCR_HEIGHT);
+     for (int i = 0; i < chain.getLevelCount(); i++) {
+          const MeshLodLevel& level = chain.getLevels()[i];
+          std::cout << "  level " << i << ": " << level.indexCount / 3 << " triangles, error " << level.error;
+          if (i > 0) {
+               std::cout << ", used from " << level.error * pixelsPerUnitAtOne / (LOD_MAX_PIXEL_ERROR * (1.0f - LOD_HYSTERESIS)) << " units away unscaled";
+          }
+          std::cout << std::endl;
+     }
+
+     ImageData containerImage, smileImage;
+     if (!loadImage("container.jpg", false, containerImage)) {
+          return -1;
+     }
+     if (!loadImage("awesomeSmile.png", true, smileImage)) {
+          freeImage(containerImage);
+          return -1;
      }
-}
\ No newline at end of file
+     SoftwareTexture texture, texture2;
+     texture.create(containerImage);
+     texture2.create(smileImage);
+     freeImage(containerImage);
+     freeImage(smileImage);
+
+     SceneGraph scene;
+     std::vector<SceneGraph::Node> cubeNodes;
+     buildCubeScene(scene, cubeNodes);
+     AnimationClip spinClip = makeSpinClip();
+     Animator animator;
+     for (size_t i = 0; i < cubeNodes.size(); i++) {
+          animator.addInstance(&spinClip);
+     }
+     glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -cameraDistance));
+     glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+     SoftwareRasterizer rasterizer(SCR_WIDTH, SCR_HEIGHT);
+
+     double frameMs[2];
+     long long triangles[2];
+     std::vector<int> currentLevels(cubeNodes.size(), 0);
+     for (int useLods = 0; useLods < 2; useLods++) {
+          double totalMs = 0.0;
+          triangles[useLods] = 0;
+          for (int frame = 0; frame < frames; frame++) {
+               animateCubes(animator, frame / 60.0f, scene, cubeNodes);
+               scene.update();
+
+               auto start = std::chrono::steady_clock::now();
+               rasterizer.clear(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+               rasterizer.bindTextures(&texture, &texture2);
+               for (size_t i = 0; i < cubeNodes.size(); i++) {
+                    const glm::mat4& model = scene.getWorldTransform(cubeNodes[i]);
+                    int level = 0;
+                    if (useLods) {
+                         currentLevels[i] = selectLodLevel(chain.getLevels(), chain.getLevelCount(), currentLevels[i], pixelsPerUnit(view, model, glm::vec3(0.0f), SCR_HEIGHT),
+                              LOD_MAX_PIXEL_ERROR, LOD_HYSTERESIS);
+                         level = currentLevels[i];
+                    }
+                    const MeshLodLevel& drawn = chain.getLevels()[level];
+                    rasterizer.drawElements(vertices.data(), chain.getIndices().data() + drawn.firstIndex, drawn.indexCount, projection * view * model);
+                    triangles[useLods] += drawn.indexCount / 3;
+               }
+               rasterizer.flush();
+               totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+          }
+          frameMs[useLods] = totalMs / frames;
+     }
+
+     std::cout << "Full detail:   " << triangles[0] / frames << " triangles, " << frameMs[0] << " ms a frame" << std::endl;
+     std::cout << "Detail levels: " << triangles[1] / frames << " triangles, " << frameMs[1] << " ms a frame ("
+          << 100.0 * (1.0 - (double)triangles[1] / std::max(triangles[0], 1LL)) << "% fewer triangles, " << frameMs[0] - frameMs[1] << " ms saved)" << std::endl;
+     return 0;
+}
+
+// Runs the CPU side of the render loop without a window and fails if it still allocates once it's warmed up
+// Covers everything that doesn't need a GL context: animation, the scene graph, the entity sync, picking detail levels, building the draw
+// list and occlusion culling, with the thread pool's parallelFor split across its workers
+int checkSteadyStateAllocations(int frames) {
+     SceneGraph scene;
+     std::vector<SceneGraph::Node> cubeNodes;
+     buildCubeScene(scene, cubeNodes);
+     // The extra cubes go in a grid of layers further back, so some are hidden behind the scene's own and some aren't
+     glm::mat4 pivot = toMat4(SPIN_PIVOT);
+     for (size_t i = cubeNodes.size(); i < ALLOCATION_CHECK_CUBES; i++) {
+          glm::vec3 position((float)(i % 16) - 7.5f, (float)(i / 16 % 16) - 7.5f, -6.0f - 2.0f * (float)(i / 256));
+          SceneGraph::Node placement = scene.addNode(glm::translate(glm::mat4(1.0f), position) * pivot);
+          cubeNodes.push_back(scene.addNode(glm::mat4(1.0f), placement));
+     }
+     AnimationClip spinClip = makeSpinClip();
+     Animator animator;
+     EntityWorld world;
+     unsigned int noTexture = 0;
+     std::vector<float> cubeMeshVertices;
+     std::vector<unsigned int> cubeMeshIndices;
+     buildRoundedCube(CUBE_SUBDIVISIONS, CUBE_ROUNDING, cubeMeshVertices, cubeMeshIndices);
+     MeshLodChain cubeLods;
+     cubeLods.build(cubeMeshVertices.data(), 8, cubeMeshVertices.size() / 8, cubeMeshIndices.data(), cubeMeshIndices.size(), LOD_REDUCTION);
+     const MeshLodLevel& coarsestCube = cubeLods.getLevels()[cubeLods.getLevelCount() - 1];
+     for (size_t i = 0; i < cubeNodes.size(); i++) {
+          animator.addInstance(&spinClip);
+          world.create(Transform{ glm::mat4(1.0f) }, SceneNode{ cubeNodes[i] }, GpuInstance{ (uint32_t)i }, MeshHandle{ 1, 0, cubeLods.getLevels()[0].indexCount },
+               Material{ { &noTexture, &noTexture }, SHADER_TEXTURE | SHADER_TEXTURE_MIX }, Bounds{ glm::vec3(0.0f), 0.87f },
+               Occluder{ cubeMeshVertices.data(), 8, cubeLods.getIndices().data() + coarsestCube.firstIndex, coarsestCube.indexCount },
+               MeshLods{ cubeLods.getLevels(), cubeLods.getLevelCount(), 0 });
+     }
+
+     // Same camera as the window so the occlusion culler has the same work to do
+     glm::mat4 view = toMat4(CAMERA_VIEW);
+     glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+     OcclusionCuller occlusion(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+     FrameArena frameArena(FRAME_ARENA_BYTES);
+     AllocationTracker allocations;
+     uint64_t steadyStateAllocations = 0;
+     uint64_t steadyStateBytes = 0;
+     float checksum = 0.0f;
+     for (int frame = 0; frame < ALLOCATION_WARMUP_FRAMES + frames; frame++) {
+          allocations.beginFrame();
+          frameArena.reset();
+          updateCpuTransforms(animator, frame / 60.0f, scene, cubeNodes, world);
+          selectLods(world, scene, false, view, SCR_HEIGHT, true);
+          size_t drawCount;
+          DrawItem* draws = buildDrawList(world, frameArena, view, true, drawCount);
+          drawCount = cullOccludedDraws(occlusion, world, frameArena, draws, drawCount, view, projection, 0.1f, SCR_HEIGHT);
+          for (size_t i = 0; i < drawCount; i++) {
+               checksum += (*draws[i].model)[3][0];
+          }
+          allocations.endFrame();
+          if (frame >= ALLOCATION_WARMUP_FRAMES) {
+               steadyStateAllocations += allocations.getLastFrame().allocations;
+               steadyStateBytes += allocations.getLastFrame().bytes;
+          }
+     }
+
+     std::cout << frames << " frames after " << ALLOCATION_WARMUP_FRAMES << " warm up: " << steadyStateAllocations << " allocations, "
+          << steadyStateBytes << " bytes, arena peak " << frameArena.getPeak() << " bytes (checksum " << checksum << ")" << std::endl;
+     if (steadyStateAllocations > 0) {
+          std::cout << "FAILED: the steady state loop allocates" << std::endl;
+          return -1;
+     }
+     return 0;
+}
+
+// Builds the built in cubes and the camera the way they were built before they were baked, with glm at runtime and the spin's
+// translation and scale as part of the animation, and fails if the baked matrices and the spin that's left don't give the same
+// model matrices, for `--check-transforms`
+int checkBakedTransforms() {
+     const float TOLERANCE = 1e-5f;
+     const int SAMPLES = 200;
+     AnimationClip spinClip = makeSpinClip();
+     AnimationClip fullSpinClip = makeSpinClip();
+     fullSpinClip.addTranslationKey(0.0f, glm::vec3(-0.25f, -0.25f, 0.25f));
+     fullSpinClip.addScaleKey(0.0f, glm::vec3(0.5f, 0.5f, 0.5f));
+     Animator spin, fullSpin;
+     std::vector<glm::mat4> placements(NUM_CUBES);
+     float placementDifference = 0.0f;
+     for (int i = 0; i < NUM_CUBES; i++) {
+          spin.addInstance(&spinClip);
+          fullSpin.addInstance(&fullSpinClip);
+          glm::vec3 position = glm::vec3(cubePositions[i][0], cubePositions[i][1], cubePositions[i][2]);
+          placements[i] = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(glm::angleAxis(glm::radians(CUBE_TILT_DEGREES * i), glm::vec3(1.0f, 0.0f, 0.0f)));
+          glm::mat4 withPivot = glm::scale(glm::translate(placements[i], glm::vec3(-0.25f, -0.25f, 0.25f)), glm::vec3(0.5f));
+          placementDifference = std::max(placementDifference, maxDifference(DEFAULT_CUBES[i], withPivot));
+     }
+     float viewDifference = maxDifference(CAMERA_VIEW, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f)));
+
+     // The whole chain a frame at a time, over more than one turn of the spin
+     float modelDifference = 0.0f;
+     for (int sample = 0; sample < SAMPLES; sample++) {
+          float seconds = sample * 0.05f;
+          spin.sample(seconds);
+          fullSpin.sample(seconds);
+          for (int i = 0; i < NUM_CUBES; i++) {
+               glm::mat4 runtime = placements[i] * fullSpin.getTransform((Animator::Instance)i);
+               glm::mat4 baked = toMat4(DEFAULT_CUBES[i]) * spin.getTransform((Animator::Instance)i);
+               for (int column = 0; column < 4; column++) {
+                    for (int row = 0; row < 4; row++) {
+                         modelDifference = std::max(modelDifference, std::fabs(baked[column][row] - runtime[column][row]));
+                    }
+               }
+          }
+     }
+
+     std::cout << NUM_CUBES << " cubes, " << SAMPLES << " frames: max difference from runtime glm " << placementDifference << " placements, "
+          << viewDifference << " view, " << modelDifference << " model matrices" << std::endl;
+     if (std::max(std::max(placementDifference, viewDifference), modelDifference) > TOLERANCE) {
+          std::cout << "FAILED: the baked transforms don't match" << std::endl;
+          return -1;
+     }
+     return 0;
+}
@@ -0,0 +1,154 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocationTracker.h"
+
+// Constant initialised so they're ready before any static constructor gets to allocate
+static std::atomic<uint64_t> processAllocations{ 0 };
+static std::atomic<uint64_t> processFrees{ 0 };
+static std::atomic<uint64_t> processBytes{ 0 };
+static thread_local uint64_t threadAllocations = 0;
+static thread_local uint64_t threadFrees = 0;
+static thread_local uint64_t threadBytes = 0;
+
+static void countAllocation(size_t size) {
+     processAllocations.fetch_add(1, std::memory_order_relaxed);
+     processBytes.fetch_add(size, std::memory_order_relaxed);
+     threadAllocations++;
+     threadBytes += size;
+}
+
+static void countFree(void* pointer) {
+     if (pointer) {
+          processFrees.fetch_add(1, std::memory_order_relaxed);
+          threadFrees++;
+     }
+}
+
+static void* trackedAllocate(size_t size) {
+     countAllocation(size);
+     return malloc(size ? size : 1);
+}
+
+static void* trackedAllocateAligned(size_t size, size_t alignment) {
+     countAllocation(size);
+#ifdef _MSC_VER
+     return _aligned_malloc(size ? size : 1, alignment);
+#else
+     return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment); // Has to be a multiple of the alignment
+#endif
+}
+
+static void trackedFreeAligned(void* pointer) {
+     countFree(pointer);
+#ifdef _MSC_VER
+     _aligned_free(pointer);
+#else
+     free(pointer);
+#endif
+}
+
+void* operator new(size_t size) {
+     void* pointer = trackedAllocate(size);
+     if (!pointer) {
+          throw std::bad_alloc();
+     }
+     return pointer;
+}
+
+void* operator new[](size_t size) {
+     return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+     return trackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+     return trackedAllocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+     void* pointer = trackedAllocateAligned(size, (size_t)alignment);
+     if (!pointer) {
+          throw std::bad_alloc();
+     }
+     return pointer;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+     return operator new(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept {
+     countFree(pointer);
+     free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+     operator delete(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+     operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+     operator delete(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+     operator delete(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+     operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+     trackedFreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+     trackedFreeAligned(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+     trackedFreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+     trackedFreeAligned(pointer);
+}
+
+AllocationStats AllocationTracker::processTotals() {
+     AllocationStats stats;
+     stats.allocations = processAllocations.load(std::memory_order_relaxed);
+     stats.frees = processFrees.load(std::memory_order_relaxed);
+     stats.bytes = processBytes.load(std::memory_order_relaxed);
+     return stats;
+}
+
+AllocationStats AllocationTracker::threadTotals() {
+     AllocationStats stats;
+     stats.allocations = threadAllocations;
+     stats.frees = threadFrees;
+     stats.bytes = threadBytes;
+     return stats;
+}
+
+void AllocationTracker::beginFrame() {
+     frameStart = threadTotals();
+}
+
+void AllocationTracker::endFrame() {
+     AllocationStats now = threadTotals();
+     lastFrame.allocations = now.allocations - frameStart.allocations;
+     lastFrame.frees = now.frees - frameStart.frees;
+     lastFrame.bytes = now.bytes - frameStart.bytes;
+     frames++;
+     if (lastFrame.allocations > 0) {
+          framesThatAllocated++;
+     }
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+
+struct AllocationStats {
+     uint64_t allocations = 0;
+     uint64_t frees = 0;
+     uint64_t bytes = 0; // Requested, frees don't take anything off
+};
+
+// Counts every heap allocation by replacing the global operator new and delete
+// The process totals include every thread, the thread ones only what the calling thread did, which is what the render loop
+// checks since the texture streaming and hot reload threads allocate whenever they like
+class AllocationTracker {
+public:
+     static AllocationStats processTotals();
+     static AllocationStats threadTotals();
+
+     // Bracket a frame with these on the render thread, the difference is what that frame allocated
+     void beginFrame();
+     void endFrame();
+
+     const AllocationStats& getLastFrame() const { return lastFrame; }
+     uint64_t getFrames() const { return frames; }
+     uint64_t getFramesThatAllocated() const { return framesThatAllocated; }
+
+private:
+     AllocationStats frameStart;
+     AllocationStats lastFrame;
+     uint64_t frames = 0;
+     uint64_t framesThatAllocated = 0;
+};
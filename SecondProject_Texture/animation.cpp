@@ -0,0 +1,422 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANIMATION_USE_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+#include "animation.h"
+#include "threadPool.h"
+
+namespace {
+
+// Slerp without acos or sin, from Eberly's "A Fast and Accurate Algorithm for Computing SLERP"
+// The weights are a polynomial in the cosine between the two quaternions, with 8 terms they stay within about 2e-5 even
+// for keys half a turn apart and get much closer as the keys do
+const float SLERP_MU = 1.85298109240830f;
+const float SLERP_U[8] = {
+     1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9),
+     1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), SLERP_MU / (8 * 17)
+};
+const float SLERP_V[8] = {
+     1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9,
+     5.0f / 11, 6.0f / 13, 7.0f / 15, SLERP_MU * 8 / 17
+};
+
+// Which of the 3 channels a cursor belongs to
+enum Channel {
+     CHANNEL_TRANSLATION,
+     CHANNEL_ROTATION,
+     CHANNEL_SCALE
+};
+
+float flipSign(float value, float sign) {
+     return sign < 0.0f ? -value : value;
+}
+
+#ifdef ANIMATION_USE_SSE2
+// Just enough operators for the templates below to work on 4 instances at once
+struct Vec4 {
+     __m128 value;
+     Vec4() {}
+     Vec4(__m128 v) : value(v) {}
+     Vec4(float f) : value(_mm_set1_ps(f)) {}
+};
+inline Vec4 operator+(Vec4 a, Vec4 b) { return _mm_add_ps(a.value, b.value); }
+inline Vec4 operator-(Vec4 a, Vec4 b) { return _mm_sub_ps(a.value, b.value); }
+inline Vec4 operator*(Vec4 a, Vec4 b) { return _mm_mul_ps(a.value, b.value); }
+
+inline Vec4 flipSign(Vec4 value, Vec4 sign) {
+     return _mm_xor_ps(value.value, _mm_and_ps(sign.value, _mm_set1_ps(-0.0f)));
+}
+#endif
+
+// T is float for the scalar path or Vec4 for the SSE2 one
+template <typename T>
+void slerp(const T a[4], const T bIn[4], T t, T out[4]) {
+     // Go the short way round
+     T cosine = a[0] * bIn[0] + a[1] * bIn[1] + a[2] * bIn[2] + a[3] * bIn[3];
+     T b[4];
+     for (int i = 0; i < 4; i++) {
+          b[i] = flipSign(bIn[i], cosine);
+     }
+     cosine = flipSign(cosine, cosine);
+
+     T cosineMinusOne = cosine - T(1.0f);
+     T d = T(1.0f) - t;
+     T tSquared = t * t;
+     T dSquared = d * d;
+     T weightT = T(1.0f);
+     T weightD = T(1.0f);
+     for (int i = 7; i >= 0; i--) {
+          weightT = T(1.0f) + (T(SLERP_U[i]) * tSquared - T(SLERP_V[i])) * cosineMinusOne * weightT;
+          weightD = T(1.0f) + (T(SLERP_U[i]) * dSquared - T(SLERP_V[i])) * cosineMinusOne * weightD;
+     }
+     weightT = t * weightT;
+     weightD = d * weightD;
+     for (int i = 0; i < 4; i++) {
+          out[i] = a[i] * weightD + b[i] * weightT;
+     }
+}
+
+template <typename T>
+T lerp(T a, T b, T t) {
+     return a + (b - a) * t;
+}
+
+// translate * rotate * scale as 3 columns of 3 plus the translation
+template <typename T>
+void composeMatrix(const T q[4], const T translation[3], const T scale[3], T columns[4][3]) {
+     T xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+     T xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+     T wx = q[3] * q[0], wy = q[3] * q[1], wz = q[3] * q[2];
+     T one(1.0f), two(2.0f);
+     columns[0][0] = (one - two * (yy + zz)) * scale[0];
+     columns[0][1] = two * (xy + wz) * scale[0];
+     columns[0][2] = two * (xz - wy) * scale[0];
+     columns[1][0] = two * (xy - wz) * scale[1];
+     columns[1][1] = (one - two * (xx + zz)) * scale[1];
+     columns[1][2] = two * (yz + wx) * scale[1];
+     columns[2][0] = two * (xz + wy) * scale[2];
+     columns[2][1] = two * (yz - wx) * scale[2];
+     columns[2][2] = (one - two * (xx + yy)) * scale[2];
+     for (int i = 0; i < 3; i++) {
+          columns[3][i] = translation[i];
+     }
+}
+
+// The key at or before time, starting the search from where it was last frame
+uint32_t findKey(const std::vector<float>& times, float time, uint32_t& cursor) {
+     uint32_t count = (uint32_t)times.size();
+     if (cursor >= count || times[cursor] > time) {
+          cursor = 0;
+     }
+     // A few steps forwards covers normal playback, anything further is a jump so search for it
+     for (int step = 0; step < 4; step++) {
+          if (cursor + 1 >= count || times[cursor + 1] > time) {
+               return cursor;
+          }
+          cursor++;
+     }
+     cursor = (uint32_t)(std::upper_bound(times.begin() + cursor, times.end(), time) - times.begin()) - 1;
+     return cursor;
+}
+
+// Where time falls between the key it's at and the next one
+float keyFraction(const std::vector<float>& times, uint32_t key, float time) {
+     if (key + 1 >= times.size()) {
+          return 0.0f;
+     }
+     float span = times[key + 1] - times[key];
+     return span > 0.0f ? std::min(1.0f, std::max(0.0f, (time - times[key]) / span)) : 0.0f;
+}
+
+}
+
+void AnimationClip::addTranslationKey(float time, const glm::vec3& translation) {
+     translationTimes.push_back(time);
+     translations.push_back(translation);
+     duration = std::max(duration, time);
+}
+
+void AnimationClip::addRotationKey(float time, const glm::quat& rotation) {
+     rotationTimes.push_back(time);
+     rotations.push_back(glm::normalize(rotation));
+     duration = std::max(duration, time);
+}
+
+void AnimationClip::addScaleKey(float time, const glm::vec3& scale) {
+     scaleTimes.push_back(time);
+     scales.push_back(scale);
+     duration = std::max(duration, time);
+}
+
+Animator::Instance Animator::addInstance(const AnimationClip* clip, float speed, float timeOffset, bool loop) {
+     InstanceState state;
+     state.clip = clip;
+     state.speed = speed;
+     state.timeOffset = timeOffset;
+     state.loop = loop;
+     state.cursors[0] = state.cursors[1] = state.cursors[2] = 0;
+     instances.push_back(state);
+
+     // Padding lanes are left as zeros, which blend to harmless numbers that nothing reads
+     size_t padded = (instances.size() + 3) & ~(size_t)3;
+     transforms.resize(padded, glm::mat4(1.0f));
+     for (std::vector<float>& array : staging) {
+          array.resize(padded, 0.0f);
+     }
+     return (Instance)instances.size() - 1;
+}
+
+void Animator::sample(float time, bool allowSimd) {
+     // Groups of 4 so each task can run whole SIMD batches
+     size_t groups = (instances.size() + 3) / 4;
+     ThreadPool::shared().parallelFor(groups, 256, [this, time, allowSimd](size_t begin, size_t end) {
+          size_t first = begin * 4;
+          size_t last = std::min(end * 4, instances.size());
+          for (size_t i = first; i < last; i++) {
+               gather(i, time);
+          }
+#ifdef ANIMATION_USE_SSE2
+          if (allowSimd) {
+               for (size_t i = first; i < last; i += 4) {
+                    blendSimd(i);
+               }
+               return;
+          }
+#endif
+          for (size_t i = first; i < last; i++) {
+               blendScalar(i);
+          }
+     });
+}
+
+void Animator::gather(size_t index, float time) {
+     InstanceState& instance = instances[index];
+     const AnimationClip& clip = *instance.clip;
+     float localTime = time * instance.speed + instance.timeOffset;
+     if (instance.loop && clip.duration > 0.0f) {
+          localTime = std::fmod(localTime, clip.duration);
+          if (localTime < 0.0f) {
+               localTime += clip.duration;
+          }
+     }
+
+     // Each channel puts its two keys and the blend factor into the staging arrays
+     if (clip.rotations.empty()) {
+          float identity[8] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+          for (int i = 0; i < 8; i++) {
+               staging[ROTATION_A_X + i][index] = identity[i];
+          }
+          staging[ROTATION_T][index] = 0.0f;
+     }
+     else {
+          uint32_t key = findKey(clip.rotationTimes, localTime, instance.cursors[CHANNEL_ROTATION]);
+          uint32_t next = std::min(key + 1, (uint32_t)clip.rotations.size() - 1);
+          const glm::quat& a = clip.rotations[key];
+          const glm::quat& b = clip.rotations[next];
+          staging[ROTATION_A_X][index] = a.x;
+          staging[ROTATION_A_Y][index] = a.y;
+          staging[ROTATION_A_Z][index] = a.z;
+          staging[ROTATION_A_W][index] = a.w;
+          staging[ROTATION_B_X][index] = b.x;
+          staging[ROTATION_B_Y][index] = b.y;
+          staging[ROTATION_B_Z][index] = b.z;
+          staging[ROTATION_B_W][index] = b.w;
+          staging[ROTATION_T][index] = keyFraction(clip.rotationTimes, key, localTime);
+     }
+
+     auto gatherVector = [&](const std::vector<float>& times, const std::vector<glm::vec3>& values, Channel channel, int first, const glm::vec3& fallback) {
+          glm::vec3 a = fallback, b = fallback;
+          float t = 0.0f;
+          if (!values.empty()) {
+               uint32_t key = findKey(times, localTime, instance.cursors[channel]);
+               a = values[key];
+               b = values[std::min(key + 1, (uint32_t)values.size() - 1)];
+               t = keyFraction(times, key, localTime);
+          }
+          for (int i = 0; i < 3; i++) {
+               staging[first + i][index] = a[i];
+               staging[first + 3 + i][index] = b[i];
+          }
+          staging[first + 6][index] = t;
+     };
+     gatherVector(clip.translationTimes, clip.translations, CHANNEL_TRANSLATION, TRANSLATION_A_X, glm::vec3(0.0f));
+     gatherVector(clip.scaleTimes, clip.scales, CHANNEL_SCALE, SCALE_A_X, glm::vec3(1.0f));
+}
+
+void Animator::blendScalar(size_t index) {
+     float a[4], b[4], q[4], translation[3], scale[3];
+     for (int i = 0; i < 4; i++) {
+          a[i] = staging[ROTATION_A_X + i][index];
+          b[i] = staging[ROTATION_B_X + i][index];
+     }
+     slerp(a, b, staging[ROTATION_T][index], q);
+     for (int i = 0; i < 3; i++) {
+          translation[i] = lerp(staging[TRANSLATION_A_X + i][index], staging[TRANSLATION_B_X + i][index], staging[TRANSLATION_T][index]);
+          scale[i] = lerp(staging[SCALE_A_X + i][index], staging[SCALE_B_X + i][index], staging[SCALE_T][index]);
+     }
+
+     float columns[4][3];
+     composeMatrix(q, translation, scale, columns);
+     glm::mat4& out = transforms[index];
+     for (int c = 0; c < 4; c++) {
+          out[c] = glm::vec4(columns[c][0], columns[c][1], columns[c][2], c == 3 ? 1.0f : 0.0f);
+     }
+}
+
+void Animator::blendSimd(size_t first) {
+#ifdef ANIMATION_USE_SSE2
+     auto load = [&](int array) { return Vec4(_mm_loadu_ps(staging[array].data() + first)); };
+     Vec4 a[4], b[4], q[4], translation[3], scale[3];
+     for (int i = 0; i < 4; i++) {
+          a[i] = load(ROTATION_A_X + i);
+          b[i] = load(ROTATION_B_X + i);
+     }
+     slerp(a, b, load(ROTATION_T), q);
+     Vec4 translationT = load(TRANSLATION_T);
+     Vec4 scaleT = load(SCALE_T);
+     for (int i = 0; i < 3; i++) {
+          translation[i] = lerp(load(TRANSLATION_A_X + i), load(TRANSLATION_B_X + i), translationT);
+          scale[i] = lerp(load(SCALE_A_X + i), load(SCALE_B_X + i), scaleT);
+     }
+
+     // Each column comes out with one instance per lane, transposing gives each instance's column as a vector
+     Vec4 columns[4][3];
+     composeMatrix(q, translation, scale, columns);
+     for (int c = 0; c < 4; c++) {
+          __m128 x = columns[c][0].value;
+          __m128 y = columns[c][1].value;
+          __m128 z = columns[c][2].value;
+          __m128 w = _mm_set1_ps(c == 3 ? 1.0f : 0.0f);
+          _MM_TRANSPOSE4_PS(x, y, z, w);
+          __m128 perInstance[4] = { x, y, z, w };
+          for (int lane = 0; lane < 4; lane++) {
+               _mm_storeu_ps(&transforms[first + lane][c][0], perInstance[lane]);
+          }
+     }
+#endif
+}
+
+// Benchmark
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+     return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+float randomFloat(float low, float high) {
+     return low + (high - low) * (float)rand() / (float)RAND_MAX;
+}
+
+glm::quat randomRotation() {
+     glm::vec3 axis(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f));
+     if (glm::length(axis) < 0.01f) {
+          axis = glm::vec3(0.0f, 1.0f, 0.0f);
+     }
+     return glm::angleAxis(randomFloat(-3.14159f, 3.14159f), glm::normalize(axis));
+}
+
+// The textbook version with acos and sin, to check the polynomial against
+void referenceSlerp(const float a[4], const float bIn[4], float t, float out[4]) {
+     float cosine = a[0] * bIn[0] + a[1] * bIn[1] + a[2] * bIn[2] + a[3] * bIn[3];
+     float b[4];
+     for (int i = 0; i < 4; i++) {
+          b[i] = cosine < 0.0f ? -bIn[i] : bIn[i];
+     }
+     double angle = std::acos(std::min(1.0, std::fabs((double)cosine)));
+     if (angle < 1e-6) {
+          for (int i = 0; i < 4; i++) {
+               out[i] = a[i] + (b[i] - a[i]) * t;
+          }
+          return;
+     }
+     double weightA = std::sin((1.0 - t) * angle) / std::sin(angle);
+     double weightB = std::sin(t * angle) / std::sin(angle);
+     for (int i = 0; i < 4; i++) {
+          out[i] = (float)(a[i] * weightA + b[i] * weightB);
+     }
+}
+
+}
+
+bool benchmarkAnimation(size_t instanceCount, int frames) {
+     if (instanceCount == 0 || frames <= 0) {
+          std::cout << "Nothing to benchmark" << std::endl;
+          return false;
+     }
+     srand(1);
+
+     // How close the polynomial slerp gets to the real thing
+     float maxError = 0.0f;
+     for (int i = 0; i < 100000; i++) {
+          glm::quat qa = randomRotation(), qb = randomRotation();
+          float a[4] = { qa.x, qa.y, qa.z, qa.w };
+          float b[4] = { qb.x, qb.y, qb.z, qb.w };
+          float t = randomFloat(0.0f, 1.0f);
+          float fast[4], exact[4];
+          slerp(a, b, t, fast);
+          referenceSlerp(a, b, t, exact);
+          for (int j = 0; j < 4; j++) {
+               maxError = std::max(maxError, std::fabs(fast[j] - exact[j]));
+          }
+     }
+
+     // A handful of clips with different key counts, shared between all the instances
+     std::vector<AnimationClip> clips(16);
+     for (AnimationClip& clip : clips) {
+          int keys = 8 + rand() % 24;
+          float time = 0.0f;
+          for (int k = 0; k < keys; k++) {
+               clip.addTranslationKey(time, glm::vec3(randomFloat(-5.0f, 5.0f), randomFloat(-5.0f, 5.0f), randomFloat(-5.0f, 5.0f)));
+               clip.addRotationKey(time, randomRotation());
+               clip.addScaleKey(time, glm::vec3(randomFloat(0.5f, 2.0f)));
+               time += randomFloat(0.05f, 0.5f);
+          }
+     }
+     Animator animator;
+     for (size_t i = 0; i < instanceCount; i++) {
+          animator.addInstance(&clips[i % clips.size()], randomFloat(0.5f, 2.0f), randomFloat(0.0f, 10.0f));
+     }
+
+     double seconds[2];
+     std::vector<glm::mat4> results[2];
+     for (int simd = 0; simd < 2; simd++) {
+          animator.sample(0.0f, simd != 0); // Warm up
+          auto start = std::chrono::steady_clock::now();
+          for (int frame = 0; frame < frames; frame++) {
+               animator.sample(frame / 60.0f, simd != 0);
+          }
+          seconds[simd] = secondsSince(start);
+          for (size_t i = 0; i < instanceCount; i++) {
+               results[simd].push_back(animator.getTransform((Animator::Instance)i));
+          }
+     }
+
+     float maxDifference = 0.0f;
+     for (size_t i = 0; i < instanceCount; i++) {
+          for (int c = 0; c < 4; c++) {
+               for (int r = 0; r < 4; r++) {
+                    maxDifference = std::max(maxDifference, std::fabs(results[0][i][c][r] - results[1][i][c][r]));
+               }
+          }
+     }
+
+     double samples = (double)instanceCount * frames;
+     std::cout << instanceCount << " instances, " << frames << " frames, " << ThreadPool::shared().size() + 1 << " threads" << std::endl;
+     std::cout << "scalar " << samples / seconds[0] / 1e6 << " M samples/s (" << seconds[0] * 1000.0 / frames << " ms a frame)" << std::endl;
+#ifdef ANIMATION_USE_SSE2
+     std::cout << "SSE2   " << samples / seconds[1] / 1e6 << " M samples/s (" << seconds[1] * 1000.0 / frames << " ms a frame), "
+          << seconds[0] / seconds[1] << "x, max difference from scalar " << maxDifference << std::endl;
+#endif
+     std::cout << "Polynomial slerp max error against acos/sin: " << maxError << std::endl;
+     return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Keyframes for one object's translation, rotation and scale, each channel has its own key times
+// Translation and scale are lerped and rotation slerped between keys, outside the keys the end ones hold
+// An empty channel means no translation, no rotation or a scale of 1
+class AnimationClip {
+public:
+     // Keys have to be added in time order
+     void addTranslationKey(float time, const glm::vec3& translation);
+     void addRotationKey(float time, const glm::quat& rotation);
+     void addScaleKey(float time, const glm::vec3& scale);
+
+     // Time of the last key in any channel
+     float getDuration() const { return duration; }
+
+private:
+     friend class Animator;
+     friend class GpuTransformUpdater;
+
+     std::vector<float> translationTimes;
+     std::vector<glm::vec3> translations;
+     std::vector<float> rotationTimes;
+     std::vector<glm::quat> rotations;
+     std::vector<float> scaleTimes;
+     std::vector<glm::vec3> scales;
+     float duration = 0.0f;
+};
+
+// Plays clips on lots of objects at once, giving a translate * rotate * scale matrix for each
+// sample finds every instance's surrounding keys and gathers them into structure-of-arrays form, then does the slerps,
+// lerps and matrix builds 4 instances at a time with SSE2, spread over the thread pool
+class Animator {
+public:
+     typedef uint32_t Instance;
+
+     // The clip has to outlive the animator, the instance's time is time * speed + timeOffset
+     Instance addInstance(const AnimationClip* clip, float speed = 1.0f, float timeOffset = 0.0f, bool loop = true);
+
+     // allowSimd is only there so the benchmark can time the scalar path
+     void sample(float time, bool allowSimd = true);
+
+     const glm::mat4& getTransform(Instance instance) const { return transforms[instance]; }
+     size_t size() const { return instances.size(); }
+
+private:
+     struct InstanceState {
+          const AnimationClip* clip;
+          float speed;
+          float timeOffset;
+          bool loop;
+          uint32_t cursors[3]; // Last key found in each channel, time usually moves forwards so the search starts here
+     };
+
+     // Each one is an array with a float per instance
+     enum Staging {
+          ROTATION_A_X, ROTATION_A_Y, ROTATION_A_Z, ROTATION_A_W,
+          ROTATION_B_X, ROTATION_B_Y, ROTATION_B_Z, ROTATION_B_W,
+          ROTATION_T,
+          TRANSLATION_A_X, TRANSLATION_A_Y, TRANSLATION_A_Z,
+          TRANSLATION_B_X, TRANSLATION_B_Y, TRANSLATION_B_Z,
+          TRANSLATION_T,
+          SCALE_A_X, SCALE_A_Y, SCALE_A_Z,
+          SCALE_B_X, SCALE_B_Y, SCALE_B_Z,
+          SCALE_T,
+          STAGING_COUNT
+     };
+
+     void gather(size_t index, float time);
+     void blendScalar(size_t index);
+     void blendSimd(size_t first);
+
+     std::vector<InstanceState> instances;
+     std::vector<glm::mat4> transforms; // Padded to a multiple of 4 like the staging arrays
+     std::vector<float> staging[STAGING_COUNT];
+};
+
+// Samples instanceCount animated objects for the given number of frames with and without SIMD, printing samples per second
+bool benchmarkAnimation(size_t instanceCount, int frames);
@@ -0,0 +1,275 @@
+#include <iostream>
+
+#include "assetReloader.h"
+#include "textureLoader.h"
+
+AssetReloader::AssetReloader(GLFWwindow* mainWindow) {
+     // An invisible 1x1 window is the only way GLFW hands out a second context, sharing objects with the main one
+     // The context version hints from main are still set so it matches the main context
+     glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+     uploadWindow = glfwCreateWindow(1, 1, "Asset Reloader", NULL, mainWindow);
+     glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+     if (!uploadWindow) {
+          std::cout << "Failed to create shared context: hot reloading disabled" << std::endl;
+     }
+}
+
+AssetReloader::~AssetReloader() {
+     stop();
+}
+
+void AssetReloader::watchProgram(Program& program, const std::string& vertexPath, const std::string& fragmentPath) {
+     programs.push_back({ &program, vertexPath, fragmentPath });
+     programPending.push_back(false);
+     watcher.addFile(vertexPath);
+     watcher.addFile(fragmentPath);
+}
+
+void AssetReloader::watchTexture(unsigned int& texture, const std::string& path, bool flipVertically, GpuResourceRegistry* registry, GpuHandle handle) {
+     textures.push_back({ &texture, path, flipVertically, registry, handle, nullptr });
+     texturePending.push_back(false);
+     watcher.addFile(path);
+}
+
+void AssetReloader::watchStreamedTexture(unsigned int& texture, const std::string& path, bool flipVertically, TextureStreamer& streamer) {
+     textures.push_back({ &texture, path, flipVertically, nullptr, GpuHandle(), &streamer });
+     texturePending.push_back(false);
+     watcher.addFile(path);
+}
+
+void AssetReloader::watchShaderVariants(ShaderVariants& variants) {
+     variantSets.push_back(&variants);
+     variantPending.push_back(false);
+     watcher.addFile(variants.getVertexPath());
+     watcher.addFile(variants.getFragmentPath());
+}
+
+void AssetReloader::start() {
+     if (!uploadWindow || workerThread.joinable()) {
+          return;
+     }
+     stopping = false;
+     workerThread = std::thread(&AssetReloader::workerLoop, this);
+     watcher.start([this](const std::string& path) { onFileChanged(path); });
+}
+
+void AssetReloader::stop() {
+     watcher.stop();
+     {
+          std::lock_guard<std::mutex> lock(jobMutex);
+          stopping = true;
+     }
+     jobReady.notify_one();
+     if (workerThread.joinable()) {
+          workerThread.join();
+     }
+
+     // Anything that finished but never got swapped in
+     for (ReadyAsset& asset : readyAssets) {
+          glDeleteSync(asset.fence);
+          if (asset.kind == ASSET_TEXTURE) {
+               glDeleteTextures(1, &asset.newID);
+          }
+          else if (asset.kind != ASSET_STREAMED_TEXTURE) { // Those only left a rebuilt cache file, which the next run rebuilds anyway
+               glDeleteProgram(asset.newID);
+          }
+     }
+     readyAssets.clear();
+
+     if (uploadWindow) {
+          glfwDestroyWindow(uploadWindow);
+          uploadWindow = nullptr;
+     }
+}
+
+bool AssetReloader::hasReadyAssets() {
+     std::lock_guard<std::mutex> lock(readyMutex);
+     return !readyAssets.empty();
+}
+
+bool AssetReloader::swapReadyAssets() {
+     std::lock_guard<std::mutex> lock(readyMutex);
+
+     bool programSwapped = false;
+     size_t kept = 0;
+     for (size_t i = 0; i < readyAssets.size(); i++) {
+          ReadyAsset& asset = readyAssets[i];
+          // Zero timeout, if the upload hasn't finished it just gets checked again next frame
+          GLenum status = glClientWaitSync(asset.fence, 0, 0);
+          if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+               readyAssets[kept++] = asset;
+               continue;
+          }
+          glDeleteSync(asset.fence);
+
+          if (asset.kind == ASSET_PROGRAM) {
+               Program* program = programs[asset.index].program;
+               glDeleteProgram(program->ID);
+               program->ID = asset.newID;
+               programSwapped = true;
+               std::cout << "Reloaded program: " << programs[asset.index].fragmentPath << std::endl;
+          }
+          else if (asset.kind == ASSET_SHADER_VARIANT) {
+               ShaderVariants* variants = variantSets[asset.index];
+               variants->replace(asset.features, asset.newID);
+               std::cout << "Reloaded shader variant: " << variants->getFragmentPath() << " " << asset.features << std::endl;
+          }
+          else if (asset.kind == ASSET_STREAMED_TEXTURE) {
+               WatchedTexture& watched = textures[asset.index];
+               *watched.texture = watched.streamer->reloadTexture(*watched.texture);
+               std::cout << "Reloaded streamed texture: " << watched.path << std::endl;
+          }
+          else {
+               WatchedTexture& watched = textures[asset.index];
+               if (watched.registry && watched.registry->isAlive(watched.handle)) {
+                    watched.registry->replace(watched.handle, asset.newID);
+               }
+               else {
+                    glDeleteTextures(1, watched.texture);
+               }
+               *watched.texture = asset.newID;
+               std::cout << "Reloaded texture: " << watched.path << std::endl;
+          }
+     }
+     readyAssets.resize(kept);
+
+     return programSwapped;
+}
+
+void AssetReloader::onFileChanged(const std::string& path) {
+     {
+          std::lock_guard<std::mutex> lock(jobMutex);
+          for (size_t i = 0; i < programs.size(); i++) {
+               if (programs[i].vertexPath == path || programs[i].fragmentPath == path) {
+                    programPending[i] = true;
+               }
+          }
+          for (size_t i = 0; i < textures.size(); i++) {
+               if (textures[i].path == path) {
+                    texturePending[i] = true;
+               }
+          }
+          for (size_t i = 0; i < variantSets.size(); i++) {
+               if (variantSets[i]->getVertexPath() == path || variantSets[i]->getFragmentPath() == path) {
+                    variantPending[i] = true;
+               }
+          }
+     }
+     jobReady.notify_one();
+}
+
+void AssetReloader::workerLoop() {
+     glfwMakeContextCurrent(uploadWindow);
+
+     while (true) {
+          // Grab everything that's pending in one go
+          std::vector<size_t> programJobs;
+          std::vector<size_t> textureJobs;
+          std::vector<size_t> variantJobs;
+          {
+               std::unique_lock<std::mutex> lock(jobMutex);
+               jobReady.wait(lock, [this] {
+                    if (stopping) {
+                         return true;
+                    }
+                    for (bool pending : programPending) if (pending) return true;
+                    for (bool pending : texturePending) if (pending) return true;
+                    for (bool pending : variantPending) if (pending) return true;
+                    return false;
+               });
+               if (stopping) {
+                    break;
+               }
+               for (size_t i = 0; i < programPending.size(); i++) {
+                    if (programPending[i]) {
+                         programJobs.push_back(i);
+                         programPending[i] = false;
+                    }
+               }
+               for (size_t i = 0; i < texturePending.size(); i++) {
+                    if (texturePending[i]) {
+                         textureJobs.push_back(i);
+                         texturePending[i] = false;
+                    }
+               }
+               for (size_t i = 0; i < variantPending.size(); i++) {
+                    if (variantPending[i]) {
+                         variantJobs.push_back(i);
+                         variantPending[i] = false;
+                    }
+               }
+          }
+
+          std::vector<ReadyAsset> finished;
+          for (size_t index : programJobs) {
+               unsigned int newID = reloadProgram(programs[index]);
+               if (newID) {
+                    finished.push_back({ ASSET_PROGRAM, index, 0, newID, 0 });
+               }
+          }
+          for (size_t index : textureJobs) {
+               if (textures[index].streamer) {
+                    // Nothing to upload here, the slow part is decoding the image into a new mip cache
+                    if (TextureStreamer::rebuildMipCache(textures[index].path, textures[index].flipVertically)) {
+                         finished.push_back({ ASSET_STREAMED_TEXTURE, index, 0, 0, 0 });
+                    }
+                    continue;
+               }
+               unsigned int newID = reloadTexture(textures[index]);
+               if (newID) {
+                    finished.push_back({ ASSET_TEXTURE, index, 0, newID, 0 });
+               }
+          }
+          for (size_t index : variantJobs) {
+               // A variant that doesn't compile keeps its old program, the rest still get swapped in
+               ShaderVariants* variants = variantSets[index];
+               for (uint32_t features : variants->getBuiltFeatures()) {
+                    unsigned int newID = compileShaderProgram(variants->getVertexPath(), variants->getFragmentPath(), shaderDefines(features));
+                    if (newID) {
+                         finished.push_back({ ASSET_SHADER_VARIANT, index, features, newID, 0 });
+                    }
+               }
+          }
+          if (finished.empty()) {
+               continue;
+          }
+
+          // Fences go in after all of this round's work, each asset gets its own so they can be deleted independently
+          std::lock_guard<std::mutex> lock(readyMutex);
+          for (ReadyAsset& asset : finished) {
+               asset.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+               readyAssets.push_back(asset);
+          }
+          // Flush so the fences actually reach the GPU, otherwise they might never signal
+          glFlush();
+          if (readyCallback) {
+               readyCallback();
+          }
+     }
+
+     glfwMakeContextCurrent(NULL);
+}
+
+unsigned int AssetReloader::reloadProgram(const WatchedProgram& watched) {
+     Program reloaded(watched.vertexPath.c_str(), watched.fragmentPath.c_str());
+
+     // A typo in the shader shouldn't take the scene down, keep using the old program until it compiles again
+     int success;
+     glGetProgramiv(reloaded.ID, GL_LINK_STATUS, &success);
+     if (!success) {
+          std::cout << "Reloaded program failed to link: keeping the old one" << std::endl;
+          glDeleteProgram(reloaded.ID);
+          return 0;
+     }
+     return reloaded.ID;
+}
+
+unsigned int AssetReloader::reloadTexture(const WatchedTexture& watched) {
+     ImageData image;
+     if (!loadImage(watched.path, watched.flipVertically, image)) {
+          return 0; // Likely caught the file half written, the next change event will try again
+     }
+     unsigned int texture = createTexture(image);
+     freeImage(image);
+     return texture;
+}
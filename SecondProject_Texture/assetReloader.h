@@ -0,0 +1,105 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <custom/program.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fileWatcher.h"
+#include "gpuResources.h"
+#include "shaderVariants.h"
+#include "textureStreamer.h"
+
+// Hot reloading for shaders and textures
+// Changed files are recompiled/decoded and uploaded on a worker thread that has its own context shared with the main window,
+// then swapped in by the render thread at the start of a frame once the GPU is done with them, so the render loop never waits
+class AssetReloader {
+public:
+     // Needs to be created on the main thread after the main window's context exists
+     AssetReloader(GLFWwindow* mainWindow);
+     ~AssetReloader();
+     AssetReloader(const AssetReloader&) = delete;
+     AssetReloader& operator=(const AssetReloader&) = delete;
+
+     // The program and texture IDs are swapped in place, so they need to outlive the reloader
+     void watchProgram(Program& program, const std::string& vertexPath, const std::string& fragmentPath);
+     // Textures in a registry are swapped through it, so it keeps counting the new one and frees the old one once the GPU is done
+     void watchTexture(unsigned int& texture, const std::string& path, bool flipVertically, GpuResourceRegistry* registry = nullptr,
+          GpuHandle handle = GpuHandle());
+     // Streamed textures get their mip cache rebuilt on the worker, then the streamer makes the new texture when it's swapped in
+     void watchStreamedTexture(unsigned int& texture, const std::string& path, bool flipVertically, TextureStreamer& streamer);
+     // Every variant that's been built by the time a file changes gets recompiled with its own defines
+     void watchShaderVariants(ShaderVariants& variants);
+
+     void start();
+     // Also destroys the shared context, so it needs calling before glfwTerminate and the reloader can't be restarted after
+     void stop();
+
+     // Call once per frame before drawing anything
+     // Returns true if a watched Program was replaced, since its uniforms will need to be set again (variants look theirs up themselves)
+     bool swapReadyAssets();
+     // True while something's finished but still waiting on its fence, so another frame is needed to swap it in
+     bool hasReadyAssets();
+
+     // Called on the worker thread when something's ready to swap in, for waking a render loop that only draws on demand
+     // Has to be set before start
+     void setReadyCallback(std::function<void()> callback) { readyCallback = std::move(callback); }
+
+private:
+     struct WatchedProgram {
+          Program* program;
+          std::string vertexPath;
+          std::string fragmentPath;
+     };
+     struct WatchedTexture {
+          unsigned int* texture;
+          std::string path;
+          bool flipVertically;
+          GpuResourceRegistry* registry;
+          GpuHandle handle;
+          TextureStreamer* streamer;
+     };
+     enum AssetKind {
+          ASSET_PROGRAM,
+          ASSET_TEXTURE,
+          ASSET_STREAMED_TEXTURE,
+          ASSET_SHADER_VARIANT
+     };
+     // Something the worker has finished, waiting for its fence before it can be swapped in
+     struct ReadyAsset {
+          AssetKind kind;
+          size_t index;
+          uint32_t features; // Which variant, for ASSET_SHADER_VARIANT
+          unsigned int newID;
+          GLsync fence;
+     };
+
+     void onFileChanged(const std::string& path);
+     void workerLoop();
+     unsigned int reloadProgram(const WatchedProgram& watched);
+     unsigned int reloadTexture(const WatchedTexture& watched);
+
+     GLFWwindow* uploadWindow = nullptr;
+     FileWatcher watcher;
+     std::thread workerThread;
+
+     std::vector<WatchedProgram> programs;
+     std::vector<WatchedTexture> textures;
+     std::vector<ShaderVariants*> variantSets;
+
+     // Which assets need reloading, flags rather than a queue so several saves in a row only reload once
+     std::mutex jobMutex;
+     std::condition_variable jobReady;
+     std::vector<bool> programPending;
+     std::vector<bool> texturePending;
+     std::vector<bool> variantPending;
+     bool stopping = false;
+
+     std::mutex readyMutex;
+     std::vector<ReadyAsset> readyAssets;
+     std::function<void()> readyCallback;
+};
@@ -0,0 +1,32 @@
+#include <cstdint>
+
+#include "blockPool.h"
+
+static const size_t BLOCK_ALIGNMENT = 16;
+
+BlockPool::BlockPool(size_t blockSize, size_t blocksPerSlab)
+     : blockSize((blockSize + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT), blocksPerSlab(blocksPerSlab > 0 ? blocksPerSlab : 1) {
+}
+
+void* BlockPool::allocate() {
+     if (freeBlocks.empty()) {
+          // new[] only promises alignof(max_align_t), so leave room to line the first block up
+          slabs.emplace_back(new unsigned char[blockSize * blocksPerSlab + BLOCK_ALIGNMENT]);
+          uintptr_t address = (uintptr_t)slabs.back().get();
+          unsigned char* first = (unsigned char*)((address + BLOCK_ALIGNMENT - 1) & ~(uintptr_t)(BLOCK_ALIGNMENT - 1));
+          freeBlocks.reserve(getBlocksAllocated());
+          // Backwards so the slab gets handed out from the start
+          for (size_t i = blocksPerSlab; i > 0; i--) {
+               freeBlocks.push_back(first + (i - 1) * blockSize);
+          }
+     }
+     unsigned char* block = freeBlocks.back();
+     freeBlocks.pop_back();
+     blocksInUse++;
+     return block;
+}
+
+void BlockPool::release(void* block) {
+     freeBlocks.push_back((unsigned char*)block);
+     blocksInUse--;
+}
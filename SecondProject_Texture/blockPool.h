@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Fixed size blocks for things that stick around, carved out of bigger slabs
+// Released blocks go on a free list and get handed straight back out, so once the pool has grown to its high water mark
+// allocating and releasing never touch the heap, and blocks from the same slab sit next to each other in memory
+// Blocks are 16 byte aligned
+class BlockPool {
+public:
+     BlockPool(size_t blockSize, size_t blocksPerSlab);
+     BlockPool(const BlockPool&) = delete;
+     BlockPool& operator=(const BlockPool&) = delete;
+
+     void* allocate();
+     void release(void* block);
+
+     size_t getBlockSize() const { return blockSize; }
+     size_t getBlocksInUse() const { return blocksInUse; }
+     size_t getBlocksAllocated() const { return slabs.size() * blocksPerSlab; } // In use plus free
+
+private:
+     size_t blockSize;
+     size_t blocksPerSlab;
+     size_t blocksInUse = 0;
+     std::vector<std::unique_ptr<unsigned char[]>> slabs;
+     std::vector<unsigned char*> freeBlocks;
+};
@@ -0,0 +1,154 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+// Matrices that are built by the compiler, for the parts of a transform chain that never change
+// Chains like translate * rotate * scale out of constants can be folded into one ConstMat4 at compile time, so only the parts that
+// really change (usually a rotation from the animation) are left for the frame to do
+// Built the same way glm::translate/rotate/scale build theirs, with the sine and cosine worked out in double, so they come out
+// within float rounding of what glm would give at runtime
+
+// Column major like glm, m[column * 4 + row]
+struct ConstMat4 {
+     float m[16];
+};
+
+// The trig here is only for the compiler, at runtime std::sin and std::cos are quicker and just as accurate
+namespace constTransformDetail {
+
+constexpr double PI = 3.14159265358979323846;
+
+constexpr double absolute(double x) {
+     return x < 0.0 ? -x : x;
+}
+
+// Taylor series, after bringing x into -pi to pi where it converges in a handful of terms
+constexpr double sine(double x) {
+     long long turns = (long long)(x / (2.0 * PI) + (x < 0.0 ? -0.5 : 0.5));
+     x -= turns * 2.0 * PI;
+     double term = x;
+     double sum = x;
+     for (int n = 1; n < 20; n++) {
+          term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+          sum += term;
+     }
+     return sum;
+}
+
+constexpr double cosine(double x) {
+     return sine(x + PI * 0.5);
+}
+
+// Newton's method, only for normalising rotation axes
+constexpr double squareRoot(double x) {
+     if (x <= 0.0) {
+          return 0.0;
+     }
+     double root = x > 1.0 ? x : 1.0;
+     for (int i = 0; i < 64; i++) {
+          root = 0.5 * (root + x / root);
+     }
+     return root;
+}
+
+}
+
+constexpr ConstMat4 constIdentity() {
+     return ConstMat4{ {
+          1.0f, 0.0f, 0.0f, 0.0f,
+          0.0f, 1.0f, 0.0f, 0.0f,
+          0.0f, 0.0f, 1.0f, 0.0f,
+          0.0f, 0.0f, 0.0f, 1.0f
+     } };
+}
+
+constexpr ConstMat4 constTranslate(float x, float y, float z) {
+     ConstMat4 result = constIdentity();
+     result.m[12] = x;
+     result.m[13] = y;
+     result.m[14] = z;
+     return result;
+}
+
+constexpr ConstMat4 constScale(float x, float y, float z) {
+     ConstMat4 result = constIdentity();
+     result.m[0] = x;
+     result.m[5] = y;
+     result.m[10] = z;
+     return result;
+}
+
+// Degrees counter clockwise about the axis, which doesn't need to be normalised
+constexpr ConstMat4 constRotate(float degrees, float axisX, float axisY, float axisZ) {
+     double radians = degrees * (constTransformDetail::PI / 180.0);
+     double c = constTransformDetail::cosine(radians);
+     double s = constTransformDetail::sine(radians);
+     double length = constTransformDetail::squareRoot((double)axisX * axisX + (double)axisY * axisY + (double)axisZ * axisZ);
+     double axis[3] = { axisX / length, axisY / length, axisZ / length };
+     ConstMat4 result = constIdentity();
+     result.m[0] = (float)(c + (1.0 - c) * axis[0] * axis[0]);
+     result.m[1] = (float)((1.0 - c) * axis[0] * axis[1] + s * axis[2]);
+     result.m[2] = (float)((1.0 - c) * axis[0] * axis[2] - s * axis[1]);
+     result.m[4] = (float)((1.0 - c) * axis[1] * axis[0] - s * axis[2]);
+     result.m[5] = (float)(c + (1.0 - c) * axis[1] * axis[1]);
+     result.m[6] = (float)((1.0 - c) * axis[1] * axis[2] + s * axis[0]);
+     result.m[8] = (float)((1.0 - c) * axis[2] * axis[0] + s * axis[1]);
+     result.m[9] = (float)((1.0 - c) * axis[2] * axis[1] - s * axis[0]);
+     result.m[10] = (float)(c + (1.0 - c) * axis[2] * axis[2]);
+     return result;
+}
+
+// a * b, so b's transform happens first like with glm
+constexpr ConstMat4 operator*(const ConstMat4& a, const ConstMat4& b) {
+     ConstMat4 result = {};
+     for (int column = 0; column < 4; column++) {
+          for (int row = 0; row < 4; row++) {
+               float sum = 0.0f;
+               for (int k = 0; k < 4; k++) {
+                    sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+               }
+               result.m[column * 4 + row] = sum;
+          }
+     }
+     return result;
+}
+
+// Largest difference between any two elements, for static_asserts and checking against glm
+constexpr float constMaxDifference(const ConstMat4& a, const ConstMat4& b) {
+     float largest = 0.0f;
+     for (int i = 0; i < 16; i++) {
+          float difference = (float)constTransformDetail::absolute((double)a.m[i] - b.m[i]);
+          largest = difference > largest ? difference : largest;
+     }
+     return largest;
+}
+
+inline glm::mat4 toMat4(const ConstMat4& matrix) {
+     glm::mat4 result;
+     for (int column = 0; column < 4; column++) {
+          result[column] = glm::vec4(matrix.m[column * 4], matrix.m[column * 4 + 1], matrix.m[column * 4 + 2], matrix.m[column * 4 + 3]);
+     }
+     return result;
+}
+
+inline float maxDifference(const ConstMat4& a, const glm::mat4& b) {
+     float largest = 0.0f;
+     for (int column = 0; column < 4; column++) {
+          for (int row = 0; row < 4; row++) {
+               largest = std::max(largest, std::fabs(a.m[column * 4 + row] - b[column][row]));
+          }
+     }
+     return largest;
+}
+
+// A quarter turn about z takes x to y, and a translation after a scale isn't scaled
+static_assert(constMaxDifference(constRotate(90.0f, 0.0f, 0.0f, 1.0f),
+     ConstMat4{ { 0.0f, 1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f } }) < 1e-6f,
+     "constRotate turns the wrong way");
+static_assert(constMaxDifference(constTranslate(1.0f, 2.0f, 3.0f) * constScale(2.0f, 2.0f, 2.0f),
+     ConstMat4{ { 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 2.0f, 0.0f, 0.0f, 0.0f, 0.0f, 2.0f, 0.0f, 1.0f, 2.0f, 3.0f, 1.0f } }) == 0.0f,
+     "ConstMat4 multiplies in the wrong order");
+static_assert(constMaxDifference(constRotate(30.0f, 1.0f, 1.0f, 0.0f) * constRotate(-30.0f, 1.0f, 1.0f, 0.0f), constIdentity()) < 1e-6f,
+     "constRotate isn't undone by its opposite");
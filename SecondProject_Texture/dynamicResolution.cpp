@@ -0,0 +1,186 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "dynamicResolution.h"
+#include "shaderVariants.h"
+
+// Render sizes snap to this many pixels so the scale settling doesn't change the size by a pixel every frame
+static const int SIZE_STEP = 8;
+// Scene times this close to the target leave the scale alone
+static const double DEADBAND = 0.1;
+// How much of the way to the scale the last frame asked for each frame moves, down fast so a slow frame is dealt with
+// quickly and up slowly so it doesn't overshoot and bounce straight back down
+static const float DROP_RATE = 0.5f;
+static const float RAISE_RATE = 0.1f;
+
+bool DynamicResolution::create(const std::string& vertexPath, const std::string& fragmentPath) {
+     program = compileShaderProgram(vertexPath, fragmentPath, "");
+     if (!program) {
+          std::cout << "Dynamic resolution disabled" << std::endl;
+          return false;
+     }
+     sceneLocation = glGetUniformLocation(program, "scene");
+     uvScaleLocation = glGetUniformLocation(program, "uvScale");
+     uvLimitLocation = glGetUniformLocation(program, "uvLimit");
+     sharpnessLocation = glGetUniformLocation(program, "sharpness");
+     glGenVertexArrays(1, &emptyVAO);
+     glGenQueries(TIMER_QUERIES, timerQueries);
+     statsStart = std::chrono::steady_clock::now();
+     return true;
+}
+
+void DynamicResolution::setScaleLimits(float minimum, float maximum) {
+     minScale = std::max(minimum, 0.1f);
+     maxScale = std::max(std::min(maximum, 1.0f), minScale);
+     scale = std::min(std::max(scale, minScale), maxScale);
+}
+
+void DynamicResolution::resizeTarget(int width, int height) {
+     if (!framebuffer) {
+          glGenFramebuffers(1, &framebuffer);
+          glGenTextures(1, &colorTexture);
+          glGenRenderbuffers(1, &depthBuffer);
+     }
+     targetWidth = width;
+     targetHeight = height;
+
+     glBindTexture(GL_TEXTURE_2D, colorTexture);
+     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+     glBindTexture(GL_TEXTURE_2D, 0);
+
+     glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+     glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+          std::cout << "Dynamic resolution target is incomplete at " << width << "x" << height << std::endl;
+     }
+     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DynamicResolution::beginScene(int windowWidth, int windowHeight) {
+     if (!isSupported() || windowWidth <= 0 || windowHeight <= 0) {
+          stats.renderWidth = windowWidth;
+          stats.renderHeight = windowHeight;
+          return;
+     }
+     if (windowWidth != targetWidth || windowHeight != targetHeight) {
+          resizeTarget(windowWidth, windowHeight);
+     }
+     readTimerQueries();
+
+     int width = std::min(windowWidth, std::max(SIZE_STEP, (int)std::lround(windowWidth * scale / SIZE_STEP) * SIZE_STEP));
+     int height = std::min(windowHeight, std::max(SIZE_STEP, (int)std::lround(windowHeight * scale / SIZE_STEP) * SIZE_STEP));
+     stats.scale = scale;
+     stats.renderWidth = width;
+     stats.renderHeight = height;
+
+     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+     glViewport(0, 0, width, height);
+
+     timing = !queryPending[nextQuery];
+     if (timing) {
+          glBeginQuery(GL_TIME_ELAPSED, timerQueries[nextQuery]);
+     }
+     sceneStarted = true;
+}
+
+void DynamicResolution::endScene() {
+     if (!sceneStarted) {
+          return;
+     }
+     sceneStarted = false;
+     if (timing) {
+          glEndQuery(GL_TIME_ELAPSED);
+          queryPending[nextQuery] = true;
+          nextQuery = (nextQuery + 1) % TIMER_QUERIES;
+     }
+
+     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+     glViewport(0, 0, targetWidth, targetHeight);
+     glDisable(GL_DEPTH_TEST);
+     glUseProgram(program);
+     glActiveTexture(GL_TEXTURE0);
+     glBindTexture(GL_TEXTURE_2D, colorTexture);
+     glUniform1i(sceneLocation, 0);
+     // Only the corner that got rendered into gets stretched, and nothing samples past its edge into whatever a bigger frame left there
+     float uScale = (float)stats.renderWidth / targetWidth;
+     float vScale = (float)stats.renderHeight / targetHeight;
+     glUniform2f(uvScaleLocation, uScale, vScale);
+     glUniform2f(uvLimitLocation, uScale - 0.5f / targetWidth, vScale - 0.5f / targetHeight);
+     glUniform1f(sharpnessLocation, stats.renderWidth < targetWidth ? sharpness : 0.0f);
+     glBindVertexArray(emptyVAO);
+     glDrawArrays(GL_TRIANGLES, 0, 3);
+     glBindVertexArray(0);
+     glBindTexture(GL_TEXTURE_2D, 0);
+     glEnable(GL_DEPTH_TEST);
+}
+
+void DynamicResolution::readTimerQueries() {
+     for (int i = 0; i < TIMER_QUERIES; i++) {
+          if (!queryPending[i]) {
+               continue;
+          }
+          GLuint available = 0;
+          glGetQueryObjectuiv(timerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+          if (available) {
+               GLuint64 nanoseconds = 0;
+               glGetQueryObjectui64v(timerQueries[i], GL_QUERY_RESULT, &nanoseconds);
+               double gpuMs = nanoseconds / 1e6;
+               gpuMsTotal += gpuMs;
+               gpuMsSamples++;
+               queryPending[i] = false;
+               adjustScale(gpuMs);
+          }
+     }
+
+     auto now = std::chrono::steady_clock::now();
+     if (now - statsStart >= std::chrono::seconds(1)) {
+          stats.sceneGpuMs = gpuMsSamples > 0 ? gpuMsTotal / gpuMsSamples : 0.0;
+          gpuMsTotal = 0.0;
+          gpuMsSamples = 0;
+          statsStart = now;
+     }
+}
+
+void DynamicResolution::adjustScale(double gpuMs) {
+     if (gpuMs <= 0.0) {
+          return;
+     }
+     double ratio = targetGpuMs / gpuMs;
+     if (std::fabs(ratio - 1.0) < DEADBAND) {
+          return;
+     }
+     // The scene's cost goes roughly with the pixel count, so the scale that would have hit the target is the square root away
+     float wanted = std::min(std::max(scale * (float)std::sqrt(ratio), minScale), maxScale);
+     scale += (wanted - scale) * (wanted < scale ? DROP_RATE : RAISE_RATE);
+}
+
+void DynamicResolution::deleteResources() {
+     if (!program) {
+          return;
+     }
+     glDeleteProgram(program);
+     glDeleteVertexArrays(1, &emptyVAO);
+     glDeleteQueries(TIMER_QUERIES, timerQueries);
+     if (framebuffer) {
+          glDeleteFramebuffers(1, &framebuffer);
+          glDeleteTextures(1, &colorTexture);
+          glDeleteRenderbuffers(1, &depthBuffer);
+     }
+     program = 0;
+     emptyVAO = 0;
+     framebuffer = 0;
+     colorTexture = 0;
+     depthBuffer = 0;
+     targetWidth = targetHeight = 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <string>
+
+struct DynamicResolutionStats {
+     float scale = 1.0f; // Of the window's width and height, so the pixel count goes with its square
+     int renderWidth = 0;
+     int renderHeight = 0;
+     double sceneGpuMs = 0.0; // Averaged over the last second, from timer queries
+};
+
+// Renders the scene into an offscreen target smaller than the window when the GPU can't keep up, then stretches it over the window
+// The scene pass is timed with GL timer queries, read back a few frames later so it never stalls, and the scale follows the time
+// towards the target, dropping quickly when a frame runs long and creeping back up once there's room again
+// The target is allocated at the window's size and rendered into a corner of it, so changing the scale never reallocates anything
+class DynamicResolution {
+public:
+     DynamicResolution() = default;
+     DynamicResolution(const DynamicResolution&) = delete;
+     DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+     // Compiles the upscale shader, false if it didn't compile
+     bool create(const std::string& vertexPath, const std::string& fragmentPath);
+     bool isSupported() const { return program != 0; }
+
+     // GPU time the scene pass should take, and how far the scale can go
+     void setTargetMs(double targetMs) { targetGpuMs = targetMs; }
+     void setScaleLimits(float minScale, float maxScale);
+     // 0 is plain bilinear, higher sharpens to win back some of the detail lost to stretching
+     void setSharpness(float amount) { sharpness = amount; }
+
+     // Binds the offscreen target at this frame's size, sets the viewport to it and starts timing
+     // Anything that works in pixels (detail levels, mip selection) should use getRenderWidth/Height from here on
+     void beginScene(int windowWidth, int windowHeight);
+     // Stops timing, binds the window's framebuffer and draws the scene over all of it
+     void endScene();
+
+     int getRenderWidth() const { return stats.renderWidth; }
+     int getRenderHeight() const { return stats.renderHeight; }
+     const DynamicResolutionStats& getStats() const { return stats; }
+
+     // Like Program::deleteProgram, needs calling before glfwTerminate
+     void deleteResources();
+
+private:
+     void resizeTarget(int width, int height);
+     void readTimerQueries();
+     void adjustScale(double gpuMs);
+
+     unsigned int program = 0;
+     int sceneLocation = -1;
+     int uvScaleLocation = -1;
+     int uvLimitLocation = -1;
+     int sharpnessLocation = -1;
+     unsigned int emptyVAO = 0; // Core profile won't draw without one, the vertex shader makes its own positions
+     unsigned int framebuffer = 0;
+     unsigned int colorTexture = 0;
+     unsigned int depthBuffer = 0;
+     int targetWidth = 0;
+     int targetHeight = 0;
+
+     double targetGpuMs = 8.0;
+     float minScale = 0.5f;
+     float maxScale = 1.0f;
+     float scale = 1.0f;
+     float sharpness = 0.25f;
+     bool sceneStarted = false;
+
+     static const int TIMER_QUERIES = 4;
+     unsigned int timerQueries[TIMER_QUERIES] = {};
+     bool queryPending[TIMER_QUERIES] = {};
+     int nextQuery = 0;
+     bool timing = false;
+
+     DynamicResolutionStats stats;
+     double gpuMsTotal = 0.0;
+     int gpuMsSamples = 0;
+     std::chrono::steady_clock::time_point statsStart;
+};
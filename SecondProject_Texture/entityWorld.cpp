@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+
+#include "entityWorld.h"
+
+namespace {
+
+struct ComponentInfo {
+     size_t size;
+     size_t alignment;
+};
+
+// Ids are handed out the first time each component type is used, by any world
+std::mutex registryMutex;
+std::vector<ComponentInfo>& componentRegistry() {
+     static std::vector<ComponentInfo> registry;
+     return registry;
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+     return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+uint32_t EntityWorld::registerComponent(size_t size, size_t alignment) {
+     std::lock_guard<std::mutex> lock(registryMutex);
+     std::vector<ComponentInfo>& registry = componentRegistry();
+     if (registry.size() >= MAX_COMPONENTS) {
+          std::cout << "Too many component types, the limit is " << MAX_COMPONENTS << std::endl;
+          abort();
+     }
+     registry.push_back({ size, alignment });
+     return (uint32_t)registry.size() - 1;
+}
+
+Entity EntityWorld::createEntity(uint32_t mask) {
+     uint32_t index;
+     if (!freeIndices.empty()) {
+          index = freeIndices.back();
+          freeIndices.pop_back();
+     }
+     else {
+          index = (uint32_t)records.size();
+          records.push_back({ 0, NO_ARCHETYPE, 0, 0 });
+     }
+     allocateRow(findArchetype(mask), index);
+     aliveCount++;
+     return { index, records[index].generation };
+}
+
+void EntityWorld::destroy(Entity entity) {
+     if (!isAlive(entity)) {
+          return;
+     }
+     EntityRecord& record = records[entity.index];
+     freeRow(record.archetype, record.chunk, record.row);
+     record.archetype = NO_ARCHETYPE;
+     record.generation++;
+     freeIndices.push_back(entity.index);
+     aliveCount--;
+}
+
+bool EntityWorld::isAlive(Entity entity) const {
+     return entity.index < records.size() && records[entity.index].generation == entity.generation && records[entity.index].archetype != NO_ARCHETYPE;
+}
+
+void* EntityWorld::componentPointer(Entity entity, uint32_t id) {
+     if (!isAlive(entity)) {
+          return nullptr;
+     }
+     const EntityRecord& record = records[entity.index];
+     Archetype& archetype = archetypes[record.archetype];
+     if (!(archetype.mask & (1u << id))) {
+          return nullptr;
+     }
+     return archetype.chunks[record.chunk].data + archetype.columnOffsets[id] + record.row * archetype.columnSizes[id];
+}
+
+bool EntityWorld::changeArchetype(Entity entity, uint32_t id, bool adding) {
+     if (!isAlive(entity)) {
+          return false;
+     }
+     uint32_t oldArchetype = records[entity.index].archetype;
+     uint32_t oldMask = archetypes[oldArchetype].mask;
+     uint32_t newMask = adding ? oldMask | (1u << id) : oldMask & ~(1u << id);
+     if (newMask == oldMask) {
+          return true;
+     }
+
+     // Copy over every component both archetypes have, then fill the hole left behind
+     uint32_t newArchetype = findArchetype(newMask);
+     uint32_t oldChunk = records[entity.index].chunk;
+     uint32_t oldRow = records[entity.index].row;
+     allocateRow(newArchetype, entity.index);
+     const Archetype& from = archetypes[oldArchetype];
+     const Archetype& to = archetypes[newArchetype];
+     const EntityRecord& record = records[entity.index];
+     uint32_t shared = oldMask & newMask;
+     for (uint32_t component = 0; component < MAX_COMPONENTS; component++) {
+          if (shared & (1u << component)) {
+               size_t size = to.columnSizes[component];
+               memcpy(to.chunks[record.chunk].data + to.columnOffsets[component] + record.row * size,
+                    from.chunks[oldChunk].data + from.columnOffsets[component] + oldRow * size, size);
+          }
+     }
+     freeRow(oldArchetype, oldChunk, oldRow);
+     return true;
+}
+
+uint32_t EntityWorld::findArchetype(uint32_t mask) {
+     // There are only ever a handful so a linear search is fine
+     for (uint32_t i = 0; i < archetypes.size(); i++) {
+          if (archetypes[i].mask == mask) {
+               return i;
+          }
+     }
+
+     // Work out how many rows fit in a chunk, then lay the columns out one after another
+     Archetype archetype;
+     archetype.mask = mask;
+     size_t alignments[MAX_COMPONENTS];
+     size_t rowBytes = sizeof(uint32_t);
+     {
+          std::lock_guard<std::mutex> lock(registryMutex);
+          for (uint32_t component = 0; component < MAX_COMPONENTS; component++) {
+               bool present = (mask & (1u << component)) != 0;
+               archetype.columnSizes[component] = present ? componentRegistry()[component].size : 0;
+               alignments[component] = present ? std::min(componentRegistry()[component].alignment, (size_t)16) : 1; // Chunks are only 16 byte aligned
+               rowBytes += archetype.columnSizes[component];
+          }
+     }
+     archetype.capacity = (uint32_t)(CHUNK_BYTES / rowBytes) + 1;
+     size_t end;
+     do {
+          archetype.capacity--;
+          end = sizeof(uint32_t) * archetype.capacity;
+          for (uint32_t component = 0; component < MAX_COMPONENTS; component++) {
+               archetype.columnOffsets[component] = alignUp(end, alignments[component]);
+               end = archetype.columnOffsets[component] + archetype.columnSizes[component] * archetype.capacity;
+          }
+     } while (end > CHUNK_BYTES && archetype.capacity > 1);
+     archetypes.push_back(std::move(archetype));
+     return (uint32_t)archetypes.size() - 1;
+}
+
+void EntityWorld::allocateRow(uint32_t archetypeIndex, uint32_t entityIndex) {
+     Archetype& archetype = archetypes[archetypeIndex];
+     if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity) {
+          archetype.chunks.push_back({ (unsigned char*)chunkPool.allocate(), 0 });
+     }
+     Chunk& chunk = archetype.chunks.back();
+     uint32_t row = chunk.count++;
+     ((uint32_t*)chunk.data)[row] = entityIndex;
+
+     EntityRecord& record = records[entityIndex];
+     record.archetype = archetypeIndex;
+     record.chunk = (uint32_t)archetype.chunks.size() - 1;
+     record.row = row;
+}
+
+void EntityWorld::freeRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row) {
+     Archetype& archetype = archetypes[archetypeIndex];
+     Chunk& last = archetype.chunks.back();
+     uint32_t lastChunkIndex = (uint32_t)archetype.chunks.size() - 1;
+     uint32_t lastRow = last.count - 1;
+
+     // Move the very last row into the hole so the chunks stay packed
+     if (chunkIndex != lastChunkIndex || row != lastRow) {
+          Chunk& chunk = archetype.chunks[chunkIndex];
+          uint32_t movedEntity = ((uint32_t*)last.data)[lastRow];
+          ((uint32_t*)chunk.data)[row] = movedEntity;
+          for (uint32_t component = 0; component < MAX_COMPONENTS; component++) {
+               if (archetype.mask & (1u << component)) {
+                    size_t size = archetype.columnSizes[component];
+                    size_t offset = archetype.columnOffsets[component];
+                    memcpy(chunk.data + offset + row * size, last.data + offset + lastRow * size, size);
+               }
+          }
+          records[movedEntity].chunk = chunkIndex;
+          records[movedEntity].row = row;
+     }
+
+     if (--last.count == 0) {
+          chunkPool.release(last.data);
+          archetype.chunks.pop_back();
+     }
+}
+
+EntityWorldStats EntityWorld::getStats() const {
+     EntityWorldStats stats;
+     stats.entities = aliveCount;
+     stats.archetypes = archetypes.size();
+     stats.chunksAllocated = chunkPool.getBlocksAllocated();
+     stats.chunksInUse = chunkPool.getBlocksInUse();
+     return stats;
+}
+
+// Benchmark
+
+namespace {
+
+struct BenchPosition {
+     float x, y, z;
+};
+
+struct BenchVelocity {
+     float x, y, z;
+};
+
+struct BenchTag {
+     uint32_t value;
+};
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+     return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+bool benchmarkEntityWorld(size_t count) {
+     if (count == 0) {
+          std::cout << "Nothing to benchmark" << std::endl;
+          return false;
+     }
+     EntityWorld world;
+     std::vector<Entity> entities(count);
+
+     // Two archetypes, a quarter of them have a tag as well
+     auto start = std::chrono::steady_clock::now();
+     for (size_t i = 0; i < count; i++) {
+          BenchPosition position = { (float)i, 0.0f, 0.0f };
+          BenchVelocity velocity = { 1.0f, 2.0f, 3.0f };
+          entities[i] = i % 4 == 0 ? world.create(position, velocity, BenchTag{ (uint32_t)i }) : world.create(position, velocity);
+     }
+     double createMs = millisecondsSince(start);
+
+     start = std::chrono::steady_clock::now();
+     world.forEachChunk<BenchPosition, BenchVelocity>([](size_t rows, BenchPosition* positions, BenchVelocity* velocities) {
+          for (size_t i = 0; i < rows; i++) {
+               positions[i].x += velocities[i].x * 0.016f;
+               positions[i].y += velocities[i].y * 0.016f;
+               positions[i].z += velocities[i].z * 0.016f;
+          }
+     });
+     double iterateMs = millisecondsSince(start);
+
+     // Punch holes everywhere, then fill them back up, none of this should need new chunks
+     size_t chunksBefore = world.getStats().chunksAllocated;
+     start = std::chrono::steady_clock::now();
+     for (size_t i = 0; i < count; i += 2) {
+          world.destroy(entities[i]);
+     }
+     double destroyMs = millisecondsSince(start);
+
+     start = std::chrono::steady_clock::now();
+     for (size_t i = 0; i < count; i += 2) {
+          entities[i] = world.create(BenchPosition{ 0.0f, 0.0f, 0.0f }, BenchVelocity{ 1.0f, 1.0f, 1.0f });
+     }
+     double recreateMs = millisecondsSince(start);
+
+     // Adding a component moves the entity between archetypes
+     start = std::chrono::steady_clock::now();
+     for (size_t i = 1; i < count; i += 8) {
+          world.add(entities[i], BenchTag{ 1 });
+     }
+     double addMs = millisecondsSince(start);
+
+     float checksum = 0.0f;
+     world.forEach<BenchPosition>([&](BenchPosition& position) {
+          checksum += position.x;
+     });
+
+     EntityWorldStats stats = world.getStats();
+     std::cout << count << " entities, " << stats.archetypes << " archetypes, " << stats.chunksInUse << " chunks of " << EntityWorld::CHUNK_BYTES / 1024 << " KB" << std::endl;
+     std::cout << "create   " << createMs << " ms (" << createMs * 1e6 / count << " ns each)" << std::endl;
+     std::cout << "iterate  " << iterateMs << " ms (" << iterateMs * 1e6 / count << " ns each)" << std::endl;
+     std::cout << "destroy  " << destroyMs << " ms for half of them" << std::endl;
+     std::cout << "recreate " << recreateMs << " ms, " << stats.chunksAllocated - chunksBefore << " new chunks allocated" << std::endl;
+     std::cout << "add      " << addMs << " ms for an eighth of them" << std::endl;
+     std::cout << "(checksum " << checksum << ")" << std::endl;
+     return world.size() == count;
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "blockPool.h"
+
+// Handle to an entity, the generation goes up whenever an index is reused so stale handles stop working
+struct Entity {
+     uint32_t index;
+     uint32_t generation;
+};
+
+struct EntityWorldStats {
+     size_t entities = 0;
+     size_t archetypes = 0;
+     size_t chunksInUse = 0;
+     size_t chunksAllocated = 0; // Including the pooled ones, this only goes up when the world grows past its high water mark
+};
+
+// Archetype based entity/component storage
+// Entities with the same set of components share an archetype, which keeps them in fixed size chunks with one contiguous column
+// per component, so walking a set of components is a linear pass through memory
+// Rows stay packed by moving the archetype's last row into any hole, and emptied chunks go back to a pool, so once the world has
+// grown to its high water mark creating, destroying and changing entities doesn't allocate
+// Components have to be trivially copyable because rows get moved around with memcpy
+class EntityWorld {
+public:
+     static const int MAX_COMPONENTS = 32;
+     static const size_t CHUNK_BYTES = 16 * 1024;
+     static const size_t CHUNKS_PER_SLAB = 16;
+
+     EntityWorld() = default;
+     EntityWorld(const EntityWorld&) = delete;
+     EntityWorld& operator=(const EntityWorld&) = delete;
+
+     template<typename... Components>
+     Entity create(const Components&... components) {
+          static_assert(sizeof...(Components) > 0, "Entities need at least one component");
+          Entity entity = createEntity(componentMask<Components...>());
+          (setComponent(entity, components), ...);
+          return entity;
+     }
+
+     void destroy(Entity entity);
+     bool isAlive(Entity entity) const;
+
+     // nullptr if the entity is dead or doesn't have one, only valid until the next create, destroy, add or remove
+     template<typename T>
+     T* get(Entity entity) {
+          return (T*)componentPointer(entity, componentId<T>());
+     }
+
+     // Moves the entity to the archetype with the extra component, or just overwrites it if it's already there
+     template<typename T>
+     void add(Entity entity, const T& component) {
+          if (changeArchetype(entity, componentId<T>(), true)) {
+               setComponent(entity, component);
+          }
+     }
+
+     template<typename T>
+     void remove(Entity entity) {
+          changeArchetype(entity, componentId<T>(), false);
+     }
+
+     // Calls body(count, Components*... columns) for every chunk of every archetype that has all of the components
+     // The body can change the components but mustn't create or destroy entities
+     template<typename... Components, typename Body>
+     void forEachChunk(Body body) {
+          uint32_t mask = componentMask<Components...>();
+          for (Archetype& archetype : archetypes) {
+               if ((archetype.mask & mask) != mask) {
+                    continue;
+               }
+               for (Chunk& chunk : archetype.chunks) {
+                    body((size_t)chunk.count, (Components*)(chunk.data + archetype.columnOffsets[componentId<Components>()])...);
+               }
+          }
+     }
+
+     // Per entity version of forEachChunk, body(Components&...)
+     template<typename... Components, typename Body>
+     void forEach(Body body) {
+          forEachChunk<Components...>([&](size_t count, Components*... columns) {
+               for (size_t i = 0; i < count; i++) {
+                    body(columns[i]...);
+               }
+          });
+     }
+
+     size_t size() const { return aliveCount; }
+     EntityWorldStats getStats() const;
+
+private:
+     struct Chunk {
+          unsigned char* data;
+          uint32_t count;
+     };
+
+     struct Archetype {
+          uint32_t mask;
+          uint32_t capacity; // Rows per chunk
+          size_t columnOffsets[MAX_COMPONENTS]; // By component id, the entity index column is always at the start
+          size_t columnSizes[MAX_COMPONENTS]; // 0 for components the archetype doesn't have
+          std::vector<Chunk> chunks; // Every chunk is full apart from the last one
+     };
+
+     struct EntityRecord {
+          uint32_t generation;
+          uint32_t archetype; // NO_ARCHETYPE while the index is free
+          uint32_t chunk;
+          uint32_t row;
+     };
+
+     static const uint32_t NO_ARCHETYPE = 0xFFFFFFFF;
+
+     static uint32_t registerComponent(size_t size, size_t alignment);
+
+     template<typename T>
+     static uint32_t componentId() {
+          static_assert(std::is_trivially_copyable<T>::value, "Components get moved with memcpy");
+          static const uint32_t id = registerComponent(sizeof(T), alignof(T));
+          return id;
+     }
+
+     template<typename... Components>
+     static uint32_t componentMask() {
+          return (0u | ... | (1u << componentId<Components>()));
+     }
+
+     template<typename T>
+     void setComponent(Entity entity, const T& component) {
+          memcpy(componentPointer(entity, componentId<T>()), &component, sizeof(T));
+     }
+
+     Entity createEntity(uint32_t mask);
+     void* componentPointer(Entity entity, uint32_t id);
+     bool changeArchetype(Entity entity, uint32_t id, bool adding);
+     uint32_t findArchetype(uint32_t mask);
+     void allocateRow(uint32_t archetypeIndex, uint32_t entityIndex);
+     void freeRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row);
+
+     std::vector<Archetype> archetypes;
+     std::vector<EntityRecord> records;
+     std::vector<uint32_t> freeIndices;
+     BlockPool chunkPool{ CHUNK_BYTES, CHUNKS_PER_SLAB }; // Owns every chunk, in use or free
+     size_t aliveCount = 0;
+};
+
+// Creates, walks, destroys and recreates count entities, printing how long each step takes
+bool benchmarkEntityWorld(size_t count);
@@ -0,0 +1,122 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <map>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "fileWatcher.h"
+
+namespace fs = std::filesystem;
+
+// How long the watcher thread sleeps between checks, also bounds how long stop() waits
+static const int WATCH_INTERVAL_MS = 200;
+
+FileWatcher::~FileWatcher() {
+     stop();
+}
+
+void FileWatcher::addFile(const std::string& path) {
+     files.push_back(path);
+}
+
+void FileWatcher::start(ChangedCallback onChanged) {
+     if (running) {
+          return;
+     }
+     callback = onChanged;
+     running = true;
+     watcherThread = std::thread(&FileWatcher::watchLoop, this);
+}
+
+void FileWatcher::stop() {
+     running = false;
+     if (watcherThread.joinable()) {
+          watcherThread.join();
+     }
+}
+
+#ifdef __linux__
+
+void FileWatcher::watchLoop() {
+     int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+     if (fd < 0) {
+          std::cout << "Failed to initialize inotify: file watching disabled" << std::endl;
+          return;
+     }
+
+     // Watch the directories rather than the files, editors often save by writing a new file and renaming it over the old one
+     // which would leave a watch on the file itself pointing at a deleted inode
+     std::map<int, fs::path> watchedDirs;
+     for (const std::string& file : files) {
+          fs::path dir = fs::path(file).parent_path();
+          if (dir.empty()) {
+               dir = ".";
+          }
+          int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+          if (wd < 0) {
+               std::cout << "Failed to watch directory: " << dir << std::endl;
+               continue;
+          }
+          watchedDirs[wd] = dir;
+     }
+
+     alignas(inotify_event) char buffer[4096];
+     while (running) {
+          pollfd pfd = { fd, POLLIN, 0 };
+          if (poll(&pfd, 1, WATCH_INTERVAL_MS) <= 0) {
+               continue;
+          }
+
+          ssize_t length;
+          while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+               for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + ((inotify_event*)ptr)->len) {
+                    const inotify_event* event = (const inotify_event*)ptr;
+                    if (event->len == 0 || watchedDirs.count(event->wd) == 0) {
+                         continue;
+                    }
+                    fs::path changed = watchedDirs[event->wd] / event->name;
+                    std::error_code ec;
+                    for (const std::string& file : files) {
+                         if (fs::equivalent(changed, file, ec)) {
+                              callback(file);
+                         }
+                    }
+               }
+          }
+     }
+
+     close(fd);
+}
+
+#else
+
+void FileWatcher::watchLoop() {
+     // No inotify, so remember each file's modification time and compare against it
+     std::vector<fs::file_time_type> lastWriteTimes;
+     for (const std::string& file : files) {
+          std::error_code ec;
+          lastWriteTimes.push_back(fs::last_write_time(file, ec));
+     }
+
+     while (running) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+          for (size_t i = 0; i < files.size(); i++) {
+               std::error_code ec;
+               fs::file_time_type writeTime = fs::last_write_time(files[i], ec);
+               if (ec) {
+                    continue; // Probably mid save, try again next time round
+               }
+               if (writeTime != lastWriteTimes[i]) {
+                    lastWriteTimes[i] = writeTime;
+                    callback(files[i]);
+               }
+          }
+     }
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Watches a set of files on a background thread and calls back when one of them is rewritten
+// On Linux this sits on inotify, everywhere else it falls back to polling the modification times
+class FileWatcher {
+public:
+     using ChangedCallback = std::function<void(const std::string& path)>;
+
+     FileWatcher() = default;
+     ~FileWatcher();
+     FileWatcher(const FileWatcher&) = delete;
+     FileWatcher& operator=(const FileWatcher&) = delete;
+
+     // Files need to be added before start() is called
+     void addFile(const std::string& path);
+
+     // The callback runs on the watcher thread with the path exactly as it was added
+     void start(ChangedCallback onChanged);
+     void stop();
+
+private:
+     void watchLoop();
+
+     std::vector<std::string> files;
+     ChangedCallback callback;
+     std::thread watcherThread;
+     std::atomic<bool> running{ false };
+};
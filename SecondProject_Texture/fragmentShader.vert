@@ -1,4 +1,4 @@
-#version 460 core
+#version 450 core
 in vec3 ourColor;
 in vec2 texCoord;
 
@@ -7,8 +7,27 @@ out vec4 fragColor;
 uniform sampler2D ourTexture;
 uniform sampler2D ourTexture2;
 
+#ifdef COUNT_FRAGMENTS
+// Depth test first, otherwise writing the counter would stop the GPU throwing hidden fragments away before shading them
+layout(early_fragment_tests) in;
+layout(binding = 0, offset = 0) uniform atomic_uint shadedFragments;
+#endif
+
+// TEXTURE, TEXTURE_MIX and VERTEX_COLOR get defined per material by ShaderVariants, so each variant only has the code it uses
 void main() {
-    // fragColor = vec4(ourColor, 1.0);
-    // fragColor = texture(ourTexture, texCoord) * vec4(ourColor, 1.0);
+#if defined(DEPTH_ONLY)
+    // Only the depth gets written, colour writes are masked off for the pre-pass anyway
+#elif defined(TEXTURE) && defined(TEXTURE_MIX)
     fragColor = mix(texture(ourTexture, texCoord), texture(ourTexture2, texCoord), 0.2f);
+#elif defined(TEXTURE)
+    fragColor = texture(ourTexture, texCoord);
+#else
+    fragColor = vec4(1.0);
+#endif
+#if defined(VERTEX_COLOR) && !defined(DEPTH_ONLY)
+    fragColor *= vec4(ourColor, 1.0);
+#endif
+#ifdef COUNT_FRAGMENTS
+    atomicCounterIncrement(shadedFragments);
+#endif
 }
\ No newline at end of file
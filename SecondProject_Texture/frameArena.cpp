@@ -0,0 +1,39 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "frameArena.h"
+
+static unsigned char* alignPointer(unsigned char* pointer, size_t alignment) {
+     uintptr_t address = (uintptr_t)pointer;
+     return (unsigned char*)((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+FrameArena::FrameArena(size_t capacity) : block(new unsigned char[capacity]), capacity(capacity) {
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+     unsigned char* start = block.get() + used;
+     unsigned char* aligned = alignPointer(start, alignment);
+     size_t needed = (size_t)(aligned - start) + bytes;
+     if (used + needed <= capacity) {
+          used += needed;
+          peak = std::max(peak, getUsed());
+          return aligned;
+     }
+
+     // Out of room, this frame gets a heap block and the next one a bigger arena
+     overflowBlocks.emplace_back(new unsigned char[bytes + alignment]);
+     overflowBytes += bytes + alignment;
+     peak = std::max(peak, getUsed());
+     return alignPointer(overflowBlocks.back().get(), alignment);
+}
+
+void FrameArena::reset() {
+     if (!overflowBlocks.empty()) {
+          overflowBlocks.clear();
+          capacity = std::max(capacity * 2, peak);
+          block.reset(new unsigned char[capacity]);
+     }
+     used = 0;
+     overflowBytes = 0;
+}
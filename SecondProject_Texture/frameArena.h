@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for data that only lives for one frame, reset at the start of every frame
+// Allocating is a pointer bump and nothing is ever freed on its own, so only trivially destructible things can go in
+// If a frame needs more than the capacity the extra comes from the heap, then the next reset grows the block to fit so the
+// steady state never touches the heap
+class FrameArena {
+public:
+     explicit FrameArena(size_t capacity);
+     FrameArena(const FrameArena&) = delete;
+     FrameArena& operator=(const FrameArena&) = delete;
+
+     void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+     // Uninitialised, like malloc
+     template<typename T>
+     T* allocateArray(size_t count) {
+          static_assert(std::is_trivially_destructible<T>::value, "Nothing in the arena gets destructed");
+          return (T*)allocate(sizeof(T) * count, alignof(T));
+     }
+
+     // Everything allocated since the last reset is gone after this
+     void reset();
+
+     size_t getCapacity() const { return capacity; }
+     size_t getUsed() const { return used + overflowBytes; }
+     size_t getPeak() const { return peak; } // Most used in any one frame so far
+
+private:
+     std::unique_ptr<unsigned char[]> block;
+     size_t capacity;
+     size_t used = 0;
+     size_t overflowBytes = 0;
+     size_t peak = 0;
+     std::vector<std::unique_ptr<unsigned char[]>> overflowBlocks;
+};
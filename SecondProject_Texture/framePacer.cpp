@@ -0,0 +1,296 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#else
+#include <time.h>
+#endif
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#include "framePacer.h"
+
+// Extra time left in low latency mode on top of the predicted frame time, in case a frame takes a bit longer than expected
+static const double LOW_LATENCY_SLACK = 0.001;
+
+static double toSeconds(std::chrono::steady_clock::duration duration) {
+     return std::chrono::duration<double>(duration).count();
+}
+
+static std::chrono::steady_clock::duration fromSeconds(double seconds) {
+     return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+// CPU time used by every thread in the process so far
+static double processCpuSeconds() {
+#ifdef _WIN32
+     FILETIME creation, exit, kernel, user;
+     if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+          return 0.0;
+     }
+     ULARGE_INTEGER kernelTime, userTime;
+     kernelTime.LowPart = kernel.dwLowDateTime;
+     kernelTime.HighPart = kernel.dwHighDateTime;
+     userTime.LowPart = user.dwLowDateTime;
+     userTime.HighPart = user.dwHighDateTime;
+     return (kernelTime.QuadPart + userTime.QuadPart) / 1e7; // 100ns ticks
+#else
+     struct timespec time;
+     clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+     return time.tv_sec + time.tv_nsec / 1e9;
+#endif
+}
+
+FramePacer::FramePacer(GLFWwindow* window, const FramePacingSettings& settings) : window(window), settings(settings) {
+#ifdef _WIN32
+     // Windows sleeps in ~15.6ms steps by default which is useless for a frame limiter
+     timeBeginPeriod(1);
+#endif
+
+     const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+     refreshRate = (mode && mode->refreshRate > 0) ? mode->refreshRate : 60;
+
+     setSwapInterval(settings.swapInterval);
+
+     glfwSetWindowUserPointer(window, this);
+     previousKey = glfwSetKeyCallback(window, onKey);
+     previousMouseButton = glfwSetMouseButtonCallback(window, onMouseButton);
+     previousCursorPos = glfwSetCursorPosCallback(window, onCursorPos);
+     previousScroll = glfwSetScrollCallback(window, onScroll);
+     previousFramebufferSize = glfwSetFramebufferSizeCallback(window, onFramebufferSize);
+     previousRefresh = glfwSetWindowRefreshCallback(window, onRefresh);
+
+     nextDeadline = Clock::now();
+     lastFrameEnd = nextDeadline;
+     statsWindowStart = nextDeadline;
+     cpuSecondsAtWindowStart = processCpuSeconds();
+}
+
+FramePacer::~FramePacer() {
+#ifdef _WIN32
+     timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::setSwapInterval(int interval) {
+     // Negative intervals need the swap_control_tear extension, without it fall back to regular vsync
+     if (interval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+          std::cout << "Adaptive vsync isn't supported: using a swap interval of 1" << std::endl;
+          interval = 1;
+     }
+     settings.swapInterval = interval;
+     glfwSwapInterval(interval); // Needs the window's context to be current
+}
+
+void FramePacer::setTargetFps(double fps) {
+     settings.targetFps = fps;
+     nextDeadline = Clock::now();
+}
+
+void FramePacer::setLowLatency(bool enabled) {
+     settings.lowLatency = enabled;
+}
+
+void FramePacer::setOnDemand(bool enabled) {
+     settings.onDemand = enabled;
+     requestRedraw();
+}
+
+void FramePacer::requestRedraw() {
+     redrawRequested = true;
+     // Only worth an event if the loop is asleep, waitForRedraw sets waiting before it checks the flag so one of the two always sees the other
+     if (waiting) {
+          glfwPostEmptyEvent();
+     }
+}
+
+// Anything the user does to the window is a reason to draw, then it goes on to whatever callback was there before
+void FramePacer::onKey(GLFWwindow* window, int key, int scancode, int action, int mods) {
+     FramePacer* pacer = (FramePacer*)glfwGetWindowUserPointer(window);
+     pacer->requestRedraw();
+     if (pacer->previousKey) {
+          pacer->previousKey(window, key, scancode, action, mods);
+     }
+}
+
+void FramePacer::onMouseButton(GLFWwindow* window, int button, int action, int mods) {
+     FramePacer* pacer = (FramePacer*)glfwGetWindowUserPointer(window);
+     pacer->requestRedraw();
+     if (pacer->previousMouseButton) {
+          pacer->previousMouseButton(window, button, action, mods);
+     }
+}
+
+void FramePacer::onCursorPos(GLFWwindow* window, double x, double y) {
+     FramePacer* pacer = (FramePacer*)glfwGetWindowUserPointer(window);
+     pacer->requestRedraw();
+     if (pacer->previousCursorPos) {
+          pacer->previousCursorPos(window, x, y);
+     }
+}
+
+void FramePacer::onScroll(GLFWwindow* window, double x, double y) {
+     FramePacer* pacer = (FramePacer*)glfwGetWindowUserPointer(window);
+     pacer->requestRedraw();
+     if (pacer->previousScroll) {
+          pacer->previousScroll(window, x, y);
+     }
+}
+
+void FramePacer::onFramebufferSize(GLFWwindow* window, int width, int height) {
+     FramePacer* pacer = (FramePacer*)glfwGetWindowUserPointer(window);
+     pacer->requestRedraw();
+     if (pacer->previousFramebufferSize) {
+          pacer->previousFramebufferSize(window, width, height);
+     }
+}
+
+// The window got uncovered or the compositor lost its contents, so the last frame needs drawing again
+void FramePacer::onRefresh(GLFWwindow* window) {
+     FramePacer* pacer = (FramePacer*)glfwGetWindowUserPointer(window);
+     pacer->requestRedraw();
+     if (pacer->previousRefresh) {
+          pacer->previousRefresh(window);
+     }
+}
+
+double FramePacer::framePeriodSeconds() const {
+     if (settings.targetFps > 0.0) {
+          return 1.0 / settings.targetFps;
+     }
+     if (settings.swapInterval != 0) {
+          return std::abs(settings.swapInterval) / (double)refreshRate;
+     }
+     return 0.0; // Uncapped, nothing to pace against
+}
+
+void FramePacer::beginFrame() {
+     if (settings.onDemand) {
+          waitForRedraw();
+     }
+     else if (settings.lowLatency) {
+          // Wake up just in time to sample input, render and make the next deadline, rather than sampling right away and then waiting
+          double period = framePeriodSeconds();
+          if (period > 0.0) {
+               double wait = period - predictedWorkSeconds - LOW_LATENCY_SLACK;
+               if (wait > 0.0) {
+                    sleepUntil(lastFrameEnd + fromSeconds(wait));
+               }
+          }
+     }
+
+     // Poll events
+     glfwPollEvents();
+     inputSampled = Clock::now();
+}
+
+void FramePacer::waitForRedraw() {
+     // Still a frame a second with nothing going on, so the stats (and the idle CPU use in them) keep coming
+     Clock::time_point statsDeadline = statsWindowStart + fromSeconds(1.0);
+     waiting = true;
+     while (!redrawRequested.exchange(false) && !glfwWindowShouldClose(window)) {
+          double remaining = toSeconds(statsDeadline - Clock::now());
+          if (remaining <= 0.0) {
+               break;
+          }
+          // Callbacks run in here, and any of them (or requestRedraw from another thread) ends the wait
+          glfwWaitEventsTimeout(remaining);
+     }
+     waiting = false;
+}
+
+void FramePacer::endFrame() {
+     // Swap buffers
+     glfwSwapBuffers(window);
+     if (settings.lowLatency) {
+          // Stop the driver queueing frames ahead, every queued frame is another frame of input latency
+          // This also makes the latency below include the GPU's work rather than just the submission
+          glFinish();
+     }
+     Clock::time_point swapped = Clock::now();
+
+     double workSeconds = toSeconds(swapped - inputSampled);
+     // Jump straight up to a slow frame but only creep back down, a missed deadline is worse than a little extra latency
+     predictedWorkSeconds = std::max(workSeconds, predictedWorkSeconds * 0.95 + workSeconds * 0.05);
+
+     if (!settings.lowLatency && settings.targetFps > 0.0) {
+          nextDeadline += fromSeconds(1.0 / settings.targetFps);
+          if (nextDeadline < swapped) {
+               nextDeadline = swapped; // Fell behind, don't try to catch up with a burst of short frames
+          }
+          sleepUntil(nextDeadline);
+     }
+
+     Clock::time_point frameEnd = Clock::now();
+     double frameSeconds = toSeconds(frameEnd - lastFrameEnd);
+     lastFrameEnd = frameEnd;
+     recordFrame(frameSeconds, workSeconds);
+}
+
+void FramePacer::sleepUntil(Clock::time_point deadline) {
+     // Sleep in 1ms chunks while there's comfortably more time left than a sleep usually takes, then spin for the rest
+     while (true) {
+          double remaining = toSeconds(deadline - Clock::now());
+          if (remaining <= sleepEstimate) {
+               break;
+          }
+
+          Clock::time_point start = Clock::now();
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          double observed = toSeconds(Clock::now() - start);
+
+          // Welford's running mean and variance, the estimate is mean plus one standard deviation
+          sleepCount++;
+          double delta = observed - sleepMean;
+          sleepMean += delta / sleepCount;
+          sleepM2 += delta * (observed - sleepMean);
+          sleepEstimate = sleepMean + std::sqrt(sleepM2 / (sleepCount - 1));
+     }
+
+     while (Clock::now() < deadline) {
+          std::this_thread::yield();
+     }
+}
+
+void FramePacer::recordFrame(double frameSeconds, double latencySeconds) {
+     frameTimes.push_back(frameSeconds * 1000.0);
+     latencies.push_back(latencySeconds * 1000.0);
+
+     newStats = false;
+     if (toSeconds(lastFrameEnd - statsWindowStart) < 1.0) {
+          return;
+     }
+
+     FrameStats result;
+     result.frames = (int)frameTimes.size();
+     for (size_t i = 0; i < frameTimes.size(); i++) {
+          result.averageFrameMs += frameTimes[i];
+          result.maxFrameMs = std::max(result.maxFrameMs, frameTimes[i]);
+          result.averageLatencyMs += latencies[i];
+          result.maxLatencyMs = std::max(result.maxLatencyMs, latencies[i]);
+     }
+     result.averageFrameMs /= result.frames;
+     result.averageLatencyMs /= result.frames;
+
+     double variance = 0.0;
+     for (double frameTime : frameTimes) {
+          variance += (frameTime - result.averageFrameMs) * (frameTime - result.averageFrameMs);
+     }
+     result.jitterMs = std::sqrt(variance / result.frames);
+
+     double cpuSeconds = processCpuSeconds();
+     result.cpuPercent = (cpuSeconds - cpuSecondsAtWindowStart) / toSeconds(lastFrameEnd - statsWindowStart) * 100.0;
+     cpuSecondsAtWindowStart = cpuSeconds;
+
+     stats = result;
+     newStats = true;
+     frameTimes.clear();
+     latencies.clear();
+     statsWindowStart = lastFrameEnd;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+struct FramePacingSettings {
+     // 0 is off, 1 waits for every vblank, 2 every other one, -1 is adaptive (tears instead of waiting when a frame is late)
+     int swapInterval = 1;
+     // Caps the frame rate with a sleep, 0 means no cap beyond whatever the swap interval does
+     double targetFps = 0.0;
+     // Sleeps before sampling input instead of after swapping, so input is as fresh as possible when the frame is drawn
+     bool lowLatency = false;
+     // Only draws a frame when something asks for one (input, a resize, requestRedraw), sleeping in glfwWaitEvents in between
+     bool onDemand = false;
+};
+
+// Rolling timings over the last second of frames
+struct FrameStats {
+     int frames = 0;
+     double averageFrameMs = 0.0;
+     double maxFrameMs = 0.0;
+     double jitterMs = 0.0; // Standard deviation of the frame times
+     double averageLatencyMs = 0.0; // Input sampled to buffers swapped
+     double maxLatencyMs = 0.0;
+     double cpuPercent = 0.0; // Whole process CPU time over wall time, 100 is one core flat out
+};
+
+// Owns the poll/swap part of the render loop so it can control when input gets sampled and how long frames take
+//   pacer.beginFrame();  // Polls events
+//   processInput(window);
+//   ...draw...
+//   pacer.endFrame();    // Swaps buffers
+// It chains itself in front of the window's input and resize callbacks to know when on demand mode needs a frame, so it takes over
+// the window's user pointer and has to outlive the window
+class FramePacer {
+public:
+     FramePacer(GLFWwindow* window, const FramePacingSettings& settings);
+     ~FramePacer();
+     FramePacer(const FramePacer&) = delete;
+     FramePacer& operator=(const FramePacer&) = delete;
+
+     void setSwapInterval(int interval);
+     void setTargetFps(double fps);
+     void setLowLatency(bool enabled);
+     void setOnDemand(bool enabled);
+
+     // In on demand mode the next beginFrame draws instead of waiting for input, call it every frame while something's animating
+     // Safe from any thread, it wakes the render loop up if it's waiting, so background loaders can call it when they finish
+     void requestRedraw();
+
+     void beginFrame();
+     void endFrame();
+
+     // Updated once a second, true when new stats are ready
+     bool statsUpdated() const { return newStats; }
+     const FrameStats& getStats() const { return stats; }
+
+private:
+     using Clock = std::chrono::steady_clock;
+
+     double framePeriodSeconds() const;
+     void sleepUntil(Clock::time_point deadline);
+     void waitForRedraw();
+     void recordFrame(double frameSeconds, double latencySeconds);
+
+     static void onKey(GLFWwindow* window, int key, int scancode, int action, int mods);
+     static void onMouseButton(GLFWwindow* window, int button, int action, int mods);
+     static void onCursorPos(GLFWwindow* window, double x, double y);
+     static void onScroll(GLFWwindow* window, double x, double y);
+     static void onFramebufferSize(GLFWwindow* window, int width, int height);
+     static void onRefresh(GLFWwindow* window);
+
+     GLFWwindow* window;
+     FramePacingSettings settings;
+     int refreshRate;
+
+     // Whatever was installed before, still called after the pacer has seen the event
+     GLFWkeyfun previousKey = nullptr;
+     GLFWmousebuttonfun previousMouseButton = nullptr;
+     GLFWcursorposfun previousCursorPos = nullptr;
+     GLFWscrollfun previousScroll = nullptr;
+     GLFWframebuffersizefun previousFramebufferSize = nullptr;
+     GLFWwindowrefreshfun previousRefresh = nullptr;
+     std::atomic<bool> redrawRequested{ true };
+     std::atomic<bool> waiting{ false };
+
+     Clock::time_point nextDeadline;
+     Clock::time_point lastFrameEnd;
+     Clock::time_point inputSampled;
+     double predictedWorkSeconds = 0.0;
+
+     // Running estimate of how far sleep_for overshoots, so we know when to stop sleeping and start spinning
+     double sleepEstimate = 0.005;
+     double sleepMean = 0.005;
+     double sleepM2 = 0.0;
+     long long sleepCount = 1;
+
+     std::vector<double> frameTimes;
+     std::vector<double> latencies;
+     Clock::time_point statsWindowStart;
+     double cpuSecondsAtWindowStart = 0.0;
+     FrameStats stats;
+     bool newStats = false;
+};
@@ -0,0 +1,796 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "glCapture.h"
+#include "glCaptureFormat.h"
+
+static const char CAPTURE_MAGIC[4] = { 'G', 'L', 'C', 'P' };
+
+// The driver's functions, glad's pointers point at the wrappers below while a capture is running
+#define GL_CAPTURE_REAL(name) static decltype(glad_gl##name) real##name = nullptr;
+GL_CAPTURED_FUNCTIONS(GL_CAPTURE_REAL)
+#undef GL_CAPTURE_REAL
+
+// Everything below is guarded by this, every wrapper holds it across the real call as well so the file has calls from both
+// threads in the order the driver saw them
+static std::mutex captureMutex;
+static bool capturing = false;
+static std::ofstream captureFile;
+static std::string capturePath;
+static std::vector<uint8_t> callBytes; // Recorded since the last frame was written out
+static int framesWanted = 0;
+static int framesRecorded = 0;
+static uint64_t callsRecorded = 0;
+static uint64_t bytesWritten = 0;
+
+// Buffers currently mapped for writing, unmapping writes out whatever the app put in them
+struct Mapping {
+     std::thread::id thread; // Each thread has its own context, so its own bindings
+     GLenum target;
+     const void* pointer;
+     uint64_t length;
+};
+static std::vector<Mapping> mappings;
+
+// Appends one call to callBytes, the byte count in front of the arguments gets filled in once they're all there
+// Does nothing if there's no capture running, so the wrappers don't have to check
+class CallRecord {
+public:
+     explicit CallRecord(GlCall call) : active(capturing) {
+          if (active) {
+               start = callBytes.size();
+               put((uint16_t)call).put((uint32_t)0);
+          }
+     }
+     ~CallRecord() {
+          if (active) {
+               uint32_t bytes = (uint32_t)(callBytes.size() - start - sizeof(uint16_t) - sizeof(uint32_t));
+               memcpy(&callBytes[start + sizeof(uint16_t)], &bytes, sizeof(bytes));
+               callsRecorded++;
+          }
+     }
+     CallRecord(const CallRecord&) = delete;
+     CallRecord& operator=(const CallRecord&) = delete;
+
+     bool isActive() const { return active; }
+
+     template <typename T>
+     CallRecord& put(T value) {
+          return raw(&value, sizeof(value));
+     }
+     // Offsets that GL takes as pointers
+     CallRecord& offset(const void* pointer) {
+          return put((uint64_t)(uintptr_t)pointer);
+     }
+     CallRecord& raw(const void* data, size_t bytes) {
+          if (active && bytes > 0) {
+               const uint8_t* begin = (const uint8_t*)data;
+               callBytes.insert(callBytes.end(), begin, begin + bytes);
+          }
+          return *this;
+     }
+     // Byte count then the bytes
+     CallRecord& blob(const void* data, uint64_t bytes) {
+          return put(bytes).raw(data, (size_t)bytes);
+     }
+
+private:
+     bool active;
+     size_t start = 0;
+};
+
+// Bytes GL reads for a width x height upload from client memory with the unpack state as it is now, 0 for formats this doesn't know
+static uint64_t uploadBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+     int channels = 0;
+     switch (format) {
+     case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: case GL_DEPTH_STENCIL: channels = 1; break;
+     case GL_RG: case GL_RG_INTEGER: channels = 2; break;
+     case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: channels = 3; break;
+     case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER: channels = 4; break;
+     default: break;
+     }
+     int pixelBytes = 0;
+     switch (type) {
+     case GL_UNSIGNED_BYTE: case GL_BYTE: pixelBytes = channels; break;
+     case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: pixelBytes = channels * 2; break;
+     case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: pixelBytes = channels * 4; break;
+     // Packed types are one value per pixel whatever the format
+     case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1: pixelBytes = 2; break;
+     case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV: case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_24_8: pixelBytes = 4; break;
+     default: break;
+     }
+     if (channels == 0 || pixelBytes == 0 || width <= 0 || height <= 0) {
+          return 0;
+     }
+     GLint alignment = 4, rowLength = 0;
+     realGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+     realGetIntegerv(GL_UNPACK_ROW_LENGTH, &rowLength);
+     uint64_t rowBytes = (uint64_t)(rowLength > 0 ? rowLength : width) * pixelBytes;
+     rowBytes = (rowBytes + alignment - 1) / alignment * alignment;
+     return rowBytes * (height - 1) + (uint64_t)width * pixelBytes;
+}
+
+// The pixels argument of TexImage2D/TexSubImage2D/TexImage3D, either an offset into a PBO or the bytes themselves
+static void putPixels(CallRecord& record, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+     if (!record.isActive()) {
+          return;
+     }
+     GLint unpackBuffer = 0;
+     realGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+     if (unpackBuffer != 0) {
+          record.put((uint8_t)PIXELS_BUFFER_OFFSET).offset(pixels);
+          return;
+     }
+     uint64_t bytes = pixels ? uploadBytes(width, height, format, type) : 0;
+     if (pixels && bytes == 0) {
+          std::cout << "GL capture can't size an upload of format 0x" << std::hex << format << " type 0x" << type << std::dec << ", the replay gets an empty texture" << std::endl;
+     }
+     if (bytes == 0) {
+          record.put((uint8_t)PIXELS_NONE);
+          return;
+     }
+     record.put((uint8_t)PIXELS_BYTES).blob(pixels, bytes);
+}
+
+static void putNames(CallRecord& record, GLsizei n, const GLuint* names) {
+     record.put(n);
+     if (n > 0) {
+          record.raw(names, sizeof(GLuint) * n);
+     }
+}
+
+static void APIENTRY captureActiveTexture(GLenum texture) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realActiveTexture(texture);
+     CallRecord(CALL_ActiveTexture).put(texture);
+}
+
+static void APIENTRY captureAttachShader(GLuint program, GLuint shader) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realAttachShader(program, shader);
+     CallRecord(CALL_AttachShader).put(program).put(shader);
+}
+
+static void APIENTRY captureBeginQuery(GLenum target, GLuint id) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBeginQuery(target, id);
+     CallRecord(CALL_BeginQuery).put(target).put(id);
+}
+
+static void APIENTRY captureBindBuffer(GLenum target, GLuint buffer) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBindBuffer(target, buffer);
+     CallRecord(CALL_BindBuffer).put(target).put(buffer);
+}
+
+static void APIENTRY captureBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBindBufferBase(target, index, buffer);
+     CallRecord(CALL_BindBufferBase).put(target).put(index).put(buffer);
+}
+
+static void APIENTRY captureBindFramebuffer(GLenum target, GLuint framebuffer) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBindFramebuffer(target, framebuffer);
+     CallRecord(CALL_BindFramebuffer).put(target).put(framebuffer);
+}
+
+static void APIENTRY captureBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBindRenderbuffer(target, renderbuffer);
+     CallRecord(CALL_BindRenderbuffer).put(target).put(renderbuffer);
+}
+
+static void APIENTRY captureBindTexture(GLenum target, GLuint texture) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBindTexture(target, texture);
+     CallRecord(CALL_BindTexture).put(target).put(texture);
+}
+
+static void APIENTRY captureBindVertexArray(GLuint array) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBindVertexArray(array);
+     CallRecord(CALL_BindVertexArray).put(array);
+}
+
+static void APIENTRY captureBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBufferData(target, size, data, usage);
+     CallRecord record(CALL_BufferData);
+     record.put(target).put((int64_t)size).put(usage).put((uint8_t)(data ? 1 : 0));
+     if (data) {
+          record.raw(data, (size_t)size);
+     }
+}
+
+static void APIENTRY captureBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBufferSubData(target, offset, size, data);
+     CallRecord(CALL_BufferSubData).put(target).put((int64_t)offset).put((int64_t)size).raw(data, (size_t)size);
+}
+
+static GLenum APIENTRY captureCheckFramebufferStatus(GLenum target) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     GLenum status = realCheckFramebufferStatus(target);
+     CallRecord(CALL_CheckFramebufferStatus).put(target);
+     return status;
+}
+
+static void APIENTRY captureClear(GLbitfield mask) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realClear(mask);
+     CallRecord(CALL_Clear).put(mask);
+}
+
+static void APIENTRY captureClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realClearColor(red, green, blue, alpha);
+     CallRecord(CALL_ClearColor).put(red).put(green).put(blue).put(alpha);
+}
+
+static GLenum APIENTRY captureClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     GLenum status = realClientWaitSync(sync, flags, timeout);
+     CallRecord(CALL_ClientWaitSync).put((uint64_t)(uintptr_t)sync).put(flags).put((uint64_t)timeout);
+     return status;
+}
+
+static void APIENTRY captureColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realColorMask(red, green, blue, alpha);
+     CallRecord(CALL_ColorMask).put(red).put(green).put(blue).put(alpha);
+}
+
+static void APIENTRY captureCompileShader(GLuint shader) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realCompileShader(shader);
+     CallRecord(CALL_CompileShader).put(shader);
+}
+
+static GLuint APIENTRY captureCreateProgram() {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     GLuint program = realCreateProgram();
+     CallRecord(CALL_CreateProgram).put(program);
+     return program;
+}
+
+static GLuint APIENTRY captureCreateShader(GLenum type) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     GLuint shader = realCreateShader(type);
+     CallRecord(CALL_CreateShader).put(type).put(shader);
+     return shader;
+}
+
+static void APIENTRY captureDeleteBuffers(GLsizei n, const GLuint* buffers) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDeleteBuffers(n, buffers);
+     CallRecord record(CALL_DeleteBuffers);
+     putNames(record, n, buffers);
+}
+
+static void APIENTRY captureDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDeleteFramebuffers(n, framebuffers);
+     CallRecord record(CALL_DeleteFramebuffers);
+     putNames(record, n, framebuffers);
+}
+
+static void APIENTRY captureDeleteProgram(GLuint program) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDeleteProgram(program);
+     CallRecord(CALL_DeleteProgram).put(program);
+}
+
+static void APIENTRY captureDeleteQueries(GLsizei n, const GLuint* ids) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDeleteQueries(n, ids);
+     CallRecord record(CALL_DeleteQueries);
+     putNames(record, n, ids);
+}
+
+static void APIENTRY captureDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDeleteRenderbuffers(n, renderbuffers);
+     CallRecord record(CALL_DeleteRenderbuffers);
+     putNames(record, n, renderbuffers);
+}
+
+static void APIENTRY captureDeleteShader(GLuint shader) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDeleteShader(shader);
+     CallRecord(CALL_DeleteShader).put(shader);
+}
+
+static void APIENTRY captureDeleteSync(GLsync sync) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDeleteSync(sync);
+     CallRecord(CALL_DeleteSync).put((uint64_t)(uintptr_t)sync);
+}
+
+static void APIENTRY captureDeleteTextures(GLsizei n, const GLuint* textures) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDeleteTextures(n, textures);
+     CallRecord record(CALL_DeleteTextures);
+     putNames(record, n, textures);
+}
+
+static void APIENTRY captureDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDeleteVertexArrays(n, arrays);
+     CallRecord record(CALL_DeleteVertexArrays);
+     putNames(record, n, arrays);
+}
+
+static void APIENTRY captureDepthFunc(GLenum func) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDepthFunc(func);
+     CallRecord(CALL_DepthFunc).put(func);
+}
+
+static void APIENTRY captureDepthMask(GLboolean flag) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDepthMask(flag);
+     CallRecord(CALL_DepthMask).put(flag);
+}
+
+static void APIENTRY captureDisable(GLenum cap) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDisable(cap);
+     CallRecord(CALL_Disable).put(cap);
+}
+
+static void APIENTRY captureDrawArrays(GLenum mode, GLint first, GLsizei count) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDrawArrays(mode, first, count);
+     CallRecord(CALL_DrawArrays).put(mode).put(first).put(count);
+}
+
+static void APIENTRY captureDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDrawElements(mode, count, type, indices);
+     CallRecord(CALL_DrawElements).put(mode).put(count).put(type).offset(indices);
+}
+
+static void APIENTRY captureEnable(GLenum cap) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realEnable(cap);
+     CallRecord(CALL_Enable).put(cap);
+}
+
+static void APIENTRY captureEnableVertexAttribArray(GLuint index) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realEnableVertexAttribArray(index);
+     CallRecord(CALL_EnableVertexAttribArray).put(index);
+}
+
+static void APIENTRY captureEndQuery(GLenum target) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realEndQuery(target);
+     CallRecord(CALL_EndQuery).put(target);
+}
+
+static GLsync APIENTRY captureFenceSync(GLenum condition, GLbitfield flags) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     GLsync sync = realFenceSync(condition, flags);
+     CallRecord(CALL_FenceSync).put(condition).put(flags).put((uint64_t)(uintptr_t)sync);
+     return sync;
+}
+
+static void APIENTRY captureFinish() {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realFinish();
+     CallRecord record(CALL_Finish);
+}
+
+static void APIENTRY captureFlush() {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realFlush();
+     CallRecord record(CALL_Flush);
+}
+
+static void APIENTRY captureFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+     CallRecord(CALL_FramebufferRenderbuffer).put(target).put(attachment).put(renderbuffertarget).put(renderbuffer);
+}
+
+static void APIENTRY captureFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realFramebufferTexture2D(target, attachment, textarget, texture, level);
+     CallRecord(CALL_FramebufferTexture2D).put(target).put(attachment).put(textarget).put(texture).put(level);
+}
+
+static void APIENTRY captureGenBuffers(GLsizei n, GLuint* buffers) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGenBuffers(n, buffers);
+     CallRecord record(CALL_GenBuffers);
+     putNames(record, n, buffers);
+}
+
+static void APIENTRY captureGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGenFramebuffers(n, framebuffers);
+     CallRecord record(CALL_GenFramebuffers);
+     putNames(record, n, framebuffers);
+}
+
+static void APIENTRY captureGenQueries(GLsizei n, GLuint* ids) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGenQueries(n, ids);
+     CallRecord record(CALL_GenQueries);
+     putNames(record, n, ids);
+}
+
+static void APIENTRY captureGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGenRenderbuffers(n, renderbuffers);
+     CallRecord record(CALL_GenRenderbuffers);
+     putNames(record, n, renderbuffers);
+}
+
+static void APIENTRY captureGenTextures(GLsizei n, GLuint* textures) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGenTextures(n, textures);
+     CallRecord record(CALL_GenTextures);
+     putNames(record, n, textures);
+}
+
+static void APIENTRY captureGenVertexArrays(GLsizei n, GLuint* arrays) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGenVertexArrays(n, arrays);
+     CallRecord record(CALL_GenVertexArrays);
+     putNames(record, n, arrays);
+}
+
+static void APIENTRY captureGenerateMipmap(GLenum target) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGenerateMipmap(target);
+     CallRecord(CALL_GenerateMipmap).put(target);
+}
+
+// Queries only record what was asked, the replay asks again so it pays for any stall the app did
+static void APIENTRY captureGetBufferParameteri64v(GLenum target, GLenum pname, GLint64* params) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetBufferParameteri64v(target, pname, params);
+     CallRecord(CALL_GetBufferParameteri64v).put(target).put(pname);
+}
+
+static void APIENTRY captureGetBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void* data) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetBufferSubData(target, offset, size, data);
+     CallRecord(CALL_GetBufferSubData).put(target).put((int64_t)offset).put((int64_t)size);
+}
+
+static void APIENTRY captureGetIntegerv(GLenum pname, GLint* data) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetIntegerv(pname, data);
+     CallRecord(CALL_GetIntegerv).put(pname);
+}
+
+static void APIENTRY captureGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetProgramInfoLog(program, bufSize, length, infoLog);
+     CallRecord(CALL_GetProgramInfoLog).put(program).put(bufSize);
+}
+
+static void APIENTRY captureGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetProgramiv(program, pname, params);
+     CallRecord(CALL_GetProgramiv).put(program).put(pname);
+}
+
+static void APIENTRY captureGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetQueryObjectui64v(id, pname, params);
+     CallRecord(CALL_GetQueryObjectui64v).put(id).put(pname);
+}
+
+static void APIENTRY captureGetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetQueryObjectuiv(id, pname, params);
+     CallRecord(CALL_GetQueryObjectuiv).put(id).put(pname);
+}
+
+static void APIENTRY captureGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetShaderInfoLog(shader, bufSize, length, infoLog);
+     CallRecord(CALL_GetShaderInfoLog).put(shader).put(bufSize);
+}
+
+static void APIENTRY captureGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetShaderiv(shader, pname, params);
+     CallRecord(CALL_GetShaderiv).put(shader).put(pname);
+}
+
+static void APIENTRY captureGetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint* params) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realGetTexLevelParameteriv(target, level, pname, params);
+     CallRecord(CALL_GetTexLevelParameteriv).put(target).put(level).put(pname);
+}
+
+// The location the app got back goes in too, the replay's can differ and uniform calls get mapped across
+static GLint APIENTRY captureGetUniformLocation(GLuint program, const GLchar* name) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     GLint location = realGetUniformLocation(program, name);
+     CallRecord(CALL_GetUniformLocation).put(program).blob(name, strlen(name)).put(location);
+     return location;
+}
+
+static void APIENTRY captureLinkProgram(GLuint program) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realLinkProgram(program);
+     CallRecord(CALL_LinkProgram).put(program);
+}
+
+static void* APIENTRY captureMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     void* pointer = realMapBufferRange(target, offset, length, access);
+     CallRecord(CALL_MapBufferRange).put(target).put((int64_t)offset).put((int64_t)length).put(access);
+     if (capturing && pointer && (access & GL_MAP_WRITE_BIT)) {
+          mappings.push_back({ std::this_thread::get_id(), target, pointer, (uint64_t)length });
+     }
+     return pointer;
+}
+
+static void APIENTRY capturePixelStorei(GLenum pname, GLint param) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realPixelStorei(pname, param);
+     CallRecord(CALL_PixelStorei).put(pname).put(param);
+}
+
+static void APIENTRY captureRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realRenderbufferStorage(target, internalformat, width, height);
+     CallRecord(CALL_RenderbufferStorage).put(target).put(internalformat).put(width).put(height);
+}
+
+// All the strings joined into one, which is how the compiler sees them anyway
+static void APIENTRY captureShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realShaderSource(shader, count, string, length);
+     CallRecord record(CALL_ShaderSource);
+     if (record.isActive()) {
+          std::string source;
+          for (GLsizei i = 0; i < count; i++) {
+               if (length && length[i] >= 0) {
+                    source.append(string[i], length[i]);
+               }
+               else {
+                    source.append(string[i]);
+               }
+          }
+          record.put(shader).blob(source.data(), source.size());
+     }
+}
+
+static void APIENTRY captureTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format,
+     GLenum type, const void* pixels) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+     CallRecord record(CALL_TexImage2D);
+     record.put(target).put(level).put(internalformat).put(width).put(height).put(border).put(format).put(type);
+     putPixels(record, width, height, format, type, pixels);
+}
+
+static void APIENTRY captureTexParameteri(GLenum target, GLenum pname, GLint param) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realTexParameteri(target, pname, param);
+     CallRecord(CALL_TexParameteri).put(target).put(pname).put(param);
+}
+
+static void APIENTRY captureTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format,
+     GLenum type, const void* pixels) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+     CallRecord record(CALL_TexSubImage2D);
+     record.put(target).put(level).put(xoffset).put(yoffset).put(width).put(height).put(format).put(type);
+     putPixels(record, width, height, format, type, pixels);
+}
+
+static void APIENTRY captureUniform1f(GLint location, GLfloat v0) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realUniform1f(location, v0);
+     CallRecord(CALL_Uniform1f).put(location).put(v0);
+}
+
+static void APIENTRY captureUniform1i(GLint location, GLint v0) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realUniform1i(location, v0);
+     CallRecord(CALL_Uniform1i).put(location).put(v0);
+}
+
+static void APIENTRY captureUniform1ui(GLint location, GLuint v0) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realUniform1ui(location, v0);
+     CallRecord(CALL_Uniform1ui).put(location).put(v0);
+}
+
+static void APIENTRY captureUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realUniform2f(location, v0, v1);
+     CallRecord(CALL_Uniform2f).put(location).put(v0).put(v1);
+}
+
+static void APIENTRY captureUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realUniformMatrix4fv(location, count, transpose, value);
+     CallRecord record(CALL_UniformMatrix4fv);
+     record.put(location).put(count).put(transpose);
+     if (count > 0) {
+          record.raw(value, sizeof(GLfloat) * 16 * count);
+     }
+}
+
+// Written before the real unmap, once it's gone the pointer's no good
+static GLboolean APIENTRY captureUnmapBuffer(GLenum target) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     CallRecord record(CALL_UnmapBuffer);
+     record.put(target);
+     std::thread::id thread = std::this_thread::get_id();
+     bool written = false;
+     for (size_t i = 0; i < mappings.size(); i++) {
+          if (mappings[i].thread == thread && mappings[i].target == target) {
+               record.blob(mappings[i].pointer, mappings[i].length);
+               mappings.erase(mappings.begin() + i);
+               written = true;
+               break;
+          }
+     }
+     if (!written) {
+          record.put((uint64_t)0);
+     }
+     return realUnmapBuffer(target);
+}
+
+static void APIENTRY captureUseProgram(GLuint program) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realUseProgram(program);
+     CallRecord(CALL_UseProgram).put(program);
+}
+
+static void APIENTRY captureVertexAttribDivisor(GLuint index, GLuint divisor) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realVertexAttribDivisor(index, divisor);
+     CallRecord(CALL_VertexAttribDivisor).put(index).put(divisor);
+}
+
+static void APIENTRY captureVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realVertexAttribPointer(index, size, type, normalized, stride, pointer);
+     CallRecord(CALL_VertexAttribPointer).put(index).put(size).put(type).put(normalized).put(stride).offset(pointer);
+}
+
+static void APIENTRY captureViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realViewport(x, y, width, height);
+     CallRecord(CALL_Viewport).put(x).put(y).put(width).put(height);
+}
+
+static void APIENTRY captureDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint baseVertex) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDrawElementsBaseVertex(mode, count, type, indices, baseVertex);
+     CallRecord(CALL_DrawElementsBaseVertex).put(mode).put(count).put(type).offset(indices).put(baseVertex);
+}
+
+static void APIENTRY captureBlendFunc(GLenum sfactor, GLenum dfactor) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realBlendFunc(sfactor, dfactor);
+     CallRecord(CALL_BlendFunc).put(sfactor).put(dfactor);
+}
+
+static void APIENTRY captureDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realDrawElementsInstanced(mode, count, type, indices, instancecount);
+     CallRecord(CALL_DrawElementsInstanced).put(mode).put(count).put(type).offset(indices).put(instancecount);
+}
+
+// Layers are sized as one tall image, which is right as long as GL_UNPACK_IMAGE_HEIGHT is left at 0
+static void APIENTRY captureTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border,
+     GLenum format, GLenum type, const void* pixels) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     realTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+     CallRecord record(CALL_TexImage3D);
+     record.put(target).put(level).put(internalformat).put(width).put(height).put(depth).put(border).put(format).put(type);
+     putPixels(record, width, height * depth, format, type, pixels);
+}
+
+// Called with the mutex held
+static void writeCalls() {
+     captureFile.write((const char*)callBytes.data(), callBytes.size());
+     bytesWritten += callBytes.size();
+     callBytes.clear();
+}
+
+// Called with the mutex held
+static void finishCapture() {
+#define GL_CAPTURE_RESTORE(name) glad_gl##name = real##name;
+     GL_CAPTURED_FUNCTIONS(GL_CAPTURE_RESTORE)
+#undef GL_CAPTURE_RESTORE
+     capturing = false;
+     writeCalls();
+     bool written = (bool)captureFile;
+     captureFile.close();
+     mappings.clear();
+     if (!written) {
+          std::cout << "Failed to write GL capture: " << capturePath << std::endl;
+          return;
+     }
+     std::cout << "Captured " << framesRecorded << " frames, " << callsRecorded << " GL calls and " << bytesWritten / 1024 << " KB to " << capturePath << std::endl;
+}
+
+bool startGlCapture(const std::string& path, int width, int height, int warmupFrames, int frames) {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     if (capturing) {
+          std::cout << "Already capturing GL calls to " << capturePath << std::endl;
+          return false;
+     }
+     if (!glad_glBindBuffer) {
+          std::cout << "GL capture needs glad loaded first" << std::endl;
+          return false;
+     }
+     if (frames <= 0) {
+          std::cout << "Nothing to capture" << std::endl;
+          return false;
+     }
+     captureFile.open(path, std::ios::binary | std::ios::trunc);
+     if (!captureFile) {
+          std::cout << "Failed to create GL capture: " << path << std::endl;
+          return false;
+     }
+
+     GlCaptureHeader header = {};
+     memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+     header.version = GL_CAPTURE_VERSION;
+     header.width = width;
+     header.height = height;
+     header.warmupFrames = (uint32_t)std::max(warmupFrames, 0);
+     header.frames = (uint32_t)frames;
+     const GLubyte* renderer = glGetString(GL_RENDERER);
+     if (renderer) {
+          strncpy(header.renderer, (const char*)renderer, sizeof(header.renderer) - 1);
+     }
+     captureFile.write((const char*)&header, sizeof(header));
+
+     capturePath = path;
+     framesWanted = (int)(header.warmupFrames + header.frames);
+     framesRecorded = 0;
+     callsRecorded = 0;
+     bytesWritten = sizeof(header);
+     callBytes.clear();
+#define GL_CAPTURE_INSTALL(name) real##name = glad_gl##name; glad_gl##name = capture##name;
+     GL_CAPTURED_FUNCTIONS(GL_CAPTURE_INSTALL)
+#undef GL_CAPTURE_INSTALL
+     capturing = true;
+     std::cout << "Capturing " << header.warmupFrames << " warm up frames and " << header.frames << " measured frames of GL calls to " << path << std::endl;
+     return true;
+}
+
+void endGlCaptureFrame() {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     if (!capturing) {
+          return;
+     }
+     {
+          CallRecord record(CALL_END_FRAME);
+     }
+     framesRecorded++;
+     writeCalls();
+     if (framesRecorded >= framesWanted || !captureFile) {
+          finishCapture();
+     }
+}
+
+void stopGlCapture() {
+     std::lock_guard<std::mutex> lock(captureMutex);
+     if (capturing) {
+          finishCapture();
+     }
+}
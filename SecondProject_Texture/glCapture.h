@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+
+// Records every GL call the app makes for a number of frames into a file that --replay plays back without the app, so a slow
+// frame from somewhere else can be profiled on its own
+// It swaps the function pointers glad loaded for wrappers that write each call out and then pass it on, so it has to start
+// straight after gladLoadGLLoader, before anything's been created, since the replay rebuilds everything from the calls
+// Warm up frames are recorded the same way and replayed first to get back to the same state, they're just not measured
+// Only one context is recorded, records don't say which context made them and the replay plays them all on one, so hot reload
+// (which uploads on a shared context) has to stay off while capturing
+// The compute paths (GPU transforms, the overdraw counter) load their own function pointers and aren't recorded, so they have to
+// stay off too, main does both when it's given --capture
+bool startGlCapture(const std::string& path, int width, int height, int warmupFrames, int frames);
+
+// Call after each swap, closes the file and puts glad's pointers back once all the frames are in
+void endGlCaptureFrame();
+
+// Closes the file early with however many frames made it, for when the window closes first
+void stopGlCapture();
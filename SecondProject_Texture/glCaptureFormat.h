@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+// What glCapture writes and glReplay reads
+// A header, then one record per call: a uint16 call, a uint32 byte count and the arguments, each written as its own
+// little endian value in the order the function takes them
+// Names (buffers, textures, programs, syncs...) are written as the app saw them, the replayer maps them to its own as it goes
+// Pointers into buffers (vertex attribute offsets, index offsets, PBO uploads) are written as uint64 offsets, anything that
+// points at client memory has the bytes written out instead
+const uint32_t GL_CAPTURE_VERSION = 1;
+
+// Every glad function that gets recorded, anything not in here goes straight to the driver and never makes it into the file
+// Add to the end rather than the middle so older captures keep their call numbers
+#define GL_CAPTURED_FUNCTIONS(X) \
+     X(ActiveTexture) X(AttachShader) X(BeginQuery) X(BindBuffer) X(BindBufferBase) X(BindFramebuffer) X(BindRenderbuffer) \
+     X(BindTexture) X(BindVertexArray) X(BufferData) X(BufferSubData) X(CheckFramebufferStatus) X(Clear) X(ClearColor) \
+     X(ClientWaitSync) X(ColorMask) X(CompileShader) X(CreateProgram) X(CreateShader) X(DeleteBuffers) X(DeleteFramebuffers) \
+     X(DeleteProgram) X(DeleteQueries) X(DeleteRenderbuffers) X(DeleteShader) X(DeleteSync) X(DeleteTextures) \
+     X(DeleteVertexArrays) X(DepthFunc) X(DepthMask) X(Disable) X(DrawArrays) X(DrawElements) X(Enable) \
+     X(EnableVertexAttribArray) X(EndQuery) X(FenceSync) X(Finish) X(Flush) X(FramebufferRenderbuffer) X(FramebufferTexture2D) \
+     X(GenBuffers) X(GenFramebuffers) X(GenQueries) X(GenRenderbuffers) X(GenTextures) X(GenVertexArrays) X(GenerateMipmap) \
+     X(GetBufferParameteri64v) X(GetBufferSubData) X(GetIntegerv) X(GetProgramInfoLog) X(GetProgramiv) X(GetQueryObjectui64v) \
+     X(GetQueryObjectuiv) X(GetShaderInfoLog) X(GetShaderiv) X(GetTexLevelParameteriv) X(GetUniformLocation) X(LinkProgram) \
+     X(MapBufferRange) X(PixelStorei) X(RenderbufferStorage) X(ShaderSource) X(TexImage2D) X(TexParameteri) X(TexSubImage2D) \
+     X(Uniform1f) X(Uniform1i) X(Uniform1ui) X(Uniform2f) X(UniformMatrix4fv) X(UnmapBuffer) X(UseProgram) \
+     X(VertexAttribDivisor) X(VertexAttribPointer) X(Viewport) X(DrawElementsBaseVertex) \
+     X(BlendFunc) X(DrawElementsInstanced) X(TexImage3D)
+
+enum GlCall : uint16_t {
+     CALL_END_FRAME = 0, // Not a GL call, marks where the app swapped buffers
+#define GL_CAPTURE_CALL_ENUM(name) CALL_##name,
+     GL_CAPTURED_FUNCTIONS(GL_CAPTURE_CALL_ENUM)
+#undef GL_CAPTURE_CALL_ENUM
+     CALL_COUNT
+};
+
+// Pixel data in a TexImage2D/TexSubImage2D/TexImage3D record, after the arguments
+enum GlCapturePixels : uint8_t {
+     PIXELS_NONE = 0, // NULL, the texture's only being allocated
+     PIXELS_BYTES = 1, // uint64 byte count then every byte GL read, laid out for the unpack alignment and row length of the time
+     PIXELS_BUFFER_OFFSET = 2 // uint64 offset into the bound GL_PIXEL_UNPACK_BUFFER
+};
+
+struct GlCaptureHeader {
+     char magic[4]; // "GLCP"
+     uint32_t version;
+     int32_t width; // Of the window's framebuffer when the capture started
+     int32_t height;
+     uint32_t warmupFrames; // Recorded so the replay starts in the same state, but not part of what's being measured
+     uint32_t frames; // Measured ones after that
+     char renderer[64]; // GL_RENDERER on the machine that made it, to compare against the one replaying it
+};
@@ -0,0 +1,976 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glCaptureFormat.h"
+#include "glReplay.h"
+
+static const char CAPTURE_MAGIC[4] = { 'G', 'L', 'C', 'P' };
+// How many of the slowest draws get listed
+static const size_t SLOWEST_DRAWS = 10;
+
+static const char* const CALL_NAMES[CALL_COUNT] = {
+     "end of frame",
+#define GL_CAPTURE_CALL_NAME(name) "gl" #name,
+     GL_CAPTURED_FUNCTIONS(GL_CAPTURE_CALL_NAME)
+#undef GL_CAPTURE_CALL_NAME
+};
+
+// Reads one record's arguments back in the order they were written, running off the end sets failed rather than reading past it
+class CallReader {
+public:
+     CallReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+     template <typename T>
+     T get() {
+          T value = T();
+          if (failed || size - offset < sizeof(T)) {
+               failed = true;
+               return value;
+          }
+          memcpy(&value, data + offset, sizeof(T));
+          offset += sizeof(T);
+          return value;
+     }
+     const void* pointer() {
+          return (const void*)(uintptr_t)get<uint64_t>();
+     }
+     // Points into the record, nullptr if there aren't that many bytes left
+     const uint8_t* bytes(uint64_t count) {
+          if (failed || size - offset < count) {
+               failed = true;
+               return nullptr;
+          }
+          const uint8_t* start = data + offset;
+          offset += (size_t)count;
+          return start;
+     }
+     const uint8_t* blob(uint64_t& count) {
+          count = get<uint64_t>();
+          return bytes(count);
+     }
+
+     bool failed = false;
+
+private:
+     const uint8_t* data;
+     size_t size;
+     size_t offset = 0;
+};
+
+// The capture's names for things mapped to the ones this context made for them
+struct ReplayState {
+     std::unordered_map<GLuint, GLuint> buffers, textures, vertexArrays, queries, framebuffers, renderbuffers, programs, shaders;
+     std::unordered_map<uint64_t, GLsync> syncs;
+     // Keyed by the captured program and location together, uniform calls go to whichever program the capture had bound
+     std::unordered_map<uint64_t, GLint> locations;
+     GLuint currentProgram = 0; // The captured name
+     struct Mapped {
+          GLenum target;
+          void* pointer;
+          uint64_t length;
+     };
+     std::vector<Mapped> mapped;
+     std::vector<uint8_t> scratch; // Where queries write their answers
+};
+
+// Names the capture never made (0, or anything from before the capture started) go through as they are
+static GLuint mapName(const std::unordered_map<GLuint, GLuint>& names, GLuint name) {
+     auto found = names.find(name);
+     return found != names.end() ? found->second : name;
+}
+
+static uint64_t locationKey(GLuint program, GLint location) {
+     return ((uint64_t)program << 32) | (uint32_t)location;
+}
+
+static GLint mapLocation(const ReplayState& state, GLint location) {
+     if (location < 0) {
+          return location;
+     }
+     auto found = state.locations.find(locationKey(state.currentProgram, location));
+     return found != state.locations.end() ? found->second : location;
+}
+
+// Reads n names and makes new objects for them
+static bool generateNames(CallReader& args, std::unordered_map<GLuint, GLuint>& names, void (APIENTRYP generate)(GLsizei, GLuint*)) {
+     GLsizei n = args.get<GLsizei>();
+     const uint8_t* captured = args.bytes(sizeof(GLuint) * (uint64_t)std::max(n, 0));
+     if (!captured || n <= 0) {
+          return !args.failed;
+     }
+     std::vector<GLuint> made(n);
+     generate(n, made.data());
+     for (GLsizei i = 0; i < n; i++) {
+          GLuint name;
+          memcpy(&name, captured + sizeof(GLuint) * i, sizeof(name));
+          names[name] = made[i];
+     }
+     return true;
+}
+
+static bool deleteNames(CallReader& args, std::unordered_map<GLuint, GLuint>& names, void (APIENTRYP remove)(GLsizei, const GLuint*)) {
+     GLsizei n = args.get<GLsizei>();
+     const uint8_t* captured = args.bytes(sizeof(GLuint) * (uint64_t)std::max(n, 0));
+     if (!captured || n <= 0) {
+          return !args.failed;
+     }
+     std::vector<GLuint> mapped(n);
+     for (GLsizei i = 0; i < n; i++) {
+          GLuint name;
+          memcpy(&name, captured + sizeof(GLuint) * i, sizeof(name));
+          mapped[i] = mapName(names, name);
+          names.erase(name);
+     }
+     remove(n, mapped.data());
+     return true;
+}
+
+// The pixels argument of TexImage2D/TexSubImage2D/TexImage3D, an offset into the bound PBO or a pointer into the record
+static bool readPixels(CallReader& args, const void*& pixels) {
+     uint8_t kind = args.get<uint8_t>();
+     pixels = nullptr;
+     if (kind == PIXELS_BUFFER_OFFSET) {
+          pixels = args.pointer();
+     }
+     else if (kind == PIXELS_BYTES) {
+          uint64_t bytes;
+          pixels = args.blob(bytes);
+     }
+     return !args.failed;
+}
+
+// Runs one recorded call, false if its record was cut short or didn't make sense
+static bool executeCall(GlCall call, CallReader& args, ReplayState& state) {
+     switch (call) {
+     case CALL_ActiveTexture: {
+          GLenum texture = args.get<GLenum>();
+          glActiveTexture(texture);
+          break;
+     }
+     case CALL_AttachShader: {
+          GLuint program = args.get<GLuint>();
+          GLuint shader = args.get<GLuint>();
+          glAttachShader(mapName(state.programs, program), mapName(state.shaders, shader));
+          break;
+     }
+     case CALL_BeginQuery: {
+          GLenum target = args.get<GLenum>();
+          GLuint id = args.get<GLuint>();
+          glBeginQuery(target, mapName(state.queries, id));
+          break;
+     }
+     case CALL_BindBuffer: {
+          GLenum target = args.get<GLenum>();
+          GLuint buffer = args.get<GLuint>();
+          glBindBuffer(target, mapName(state.buffers, buffer));
+          break;
+     }
+     case CALL_BindBufferBase: {
+          GLenum target = args.get<GLenum>();
+          GLuint index = args.get<GLuint>();
+          GLuint buffer = args.get<GLuint>();
+          glBindBufferBase(target, index, mapName(state.buffers, buffer));
+          break;
+     }
+     case CALL_BindFramebuffer: {
+          GLenum target = args.get<GLenum>();
+          GLuint framebuffer = args.get<GLuint>();
+          glBindFramebuffer(target, mapName(state.framebuffers, framebuffer));
+          break;
+     }
+     case CALL_BindRenderbuffer: {
+          GLenum target = args.get<GLenum>();
+          GLuint renderbuffer = args.get<GLuint>();
+          glBindRenderbuffer(target, mapName(state.renderbuffers, renderbuffer));
+          break;
+     }
+     case CALL_BindTexture: {
+          GLenum target = args.get<GLenum>();
+          GLuint texture = args.get<GLuint>();
+          glBindTexture(target, mapName(state.textures, texture));
+          break;
+     }
+     case CALL_BindVertexArray: {
+          GLuint array = args.get<GLuint>();
+          glBindVertexArray(mapName(state.vertexArrays, array));
+          break;
+     }
+     case CALL_BufferData: {
+          GLenum target = args.get<GLenum>();
+          int64_t size = args.get<int64_t>();
+          GLenum usage = args.get<GLenum>();
+          uint8_t hasData = args.get<uint8_t>();
+          const uint8_t* data = hasData ? args.bytes((uint64_t)std::max(size, (int64_t)0)) : nullptr;
+          if (args.failed) {
+               return false;
+          }
+          glBufferData(target, (GLsizeiptr)size, data, usage);
+          break;
+     }
+     case CALL_BufferSubData: {
+          GLenum target = args.get<GLenum>();
+          int64_t offset = args.get<int64_t>();
+          int64_t size = args.get<int64_t>();
+          const uint8_t* data = args.bytes((uint64_t)std::max(size, (int64_t)0));
+          if (!data) {
+               return false;
+          }
+          glBufferSubData(target, (GLintptr)offset, (GLsizeiptr)size, data);
+          break;
+     }
+     case CALL_CheckFramebufferStatus: {
+          GLenum target = args.get<GLenum>();
+          glCheckFramebufferStatus(target);
+          break;
+     }
+     case CALL_Clear: {
+          GLbitfield mask = args.get<GLbitfield>();
+          glClear(mask);
+          break;
+     }
+     case CALL_ClearColor: {
+          GLfloat red = args.get<GLfloat>();
+          GLfloat green = args.get<GLfloat>();
+          GLfloat blue = args.get<GLfloat>();
+          GLfloat alpha = args.get<GLfloat>();
+          glClearColor(red, green, blue, alpha);
+          break;
+     }
+     case CALL_ClientWaitSync: {
+          uint64_t sync = args.get<uint64_t>();
+          GLbitfield flags = args.get<GLbitfield>();
+          uint64_t timeout = args.get<uint64_t>();
+          auto found = state.syncs.find(sync);
+          if (found != state.syncs.end()) {
+               glClientWaitSync(found->second, flags, timeout);
+          }
+          break;
+     }
+     case CALL_ColorMask: {
+          GLboolean red = args.get<GLboolean>();
+          GLboolean green = args.get<GLboolean>();
+          GLboolean blue = args.get<GLboolean>();
+          GLboolean alpha = args.get<GLboolean>();
+          glColorMask(red, green, blue, alpha);
+          break;
+     }
+     case CALL_CompileShader: {
+          GLuint shader = args.get<GLuint>();
+          glCompileShader(mapName(state.shaders, shader));
+          break;
+     }
+     case CALL_CreateProgram: {
+          GLuint program = args.get<GLuint>();
+          if (args.failed) {
+               return false;
+          }
+          state.programs[program] = glCreateProgram();
+          break;
+     }
+     case CALL_CreateShader: {
+          GLenum type = args.get<GLenum>();
+          GLuint shader = args.get<GLuint>();
+          if (args.failed) {
+               return false;
+          }
+          state.shaders[shader] = glCreateShader(type);
+          break;
+     }
+     case CALL_DeleteBuffers: return deleteNames(args, state.buffers, glDeleteBuffers);
+     case CALL_DeleteFramebuffers: return deleteNames(args, state.framebuffers, glDeleteFramebuffers);
+     case CALL_DeleteProgram: {
+          GLuint program = args.get<GLuint>();
+          glDeleteProgram(mapName(state.programs, program));
+          state.programs.erase(program);
+          break;
+     }
+     case CALL_DeleteQueries: return deleteNames(args, state.queries, glDeleteQueries);
+     case CALL_DeleteRenderbuffers: return deleteNames(args, state.renderbuffers, glDeleteRenderbuffers);
+     case CALL_DeleteShader: {
+          GLuint shader = args.get<GLuint>();
+          glDeleteShader(mapName(state.shaders, shader));
+          state.shaders.erase(shader);
+          break;
+     }
+     case CALL_DeleteSync: {
+          uint64_t sync = args.get<uint64_t>();
+          auto found = state.syncs.find(sync);
+          if (found != state.syncs.end()) {
+               glDeleteSync(found->second);
+               state.syncs.erase(found);
+          }
+          break;
+     }
+     case CALL_DeleteTextures: return deleteNames(args, state.textures, glDeleteTextures);
+     case CALL_DeleteVertexArrays: return deleteNames(args, state.vertexArrays, glDeleteVertexArrays);
+     case CALL_DepthFunc: {
+          GLenum func = args.get<GLenum>();
+          glDepthFunc(func);
+          break;
+     }
+     case CALL_DepthMask: {
+          GLboolean flag = args.get<GLboolean>();
+          glDepthMask(flag);
+          break;
+     }
+     case CALL_Disable: {
+          GLenum cap = args.get<GLenum>();
+          glDisable(cap);
+          break;
+     }
+     case CALL_DrawArrays: {
+          GLenum mode = args.get<GLenum>();
+          GLint first = args.get<GLint>();
+          GLsizei count = args.get<GLsizei>();
+          glDrawArrays(mode, first, count);
+          break;
+     }
+     case CALL_DrawElements: {
+          GLenum mode = args.get<GLenum>();
+          GLsizei count = args.get<GLsizei>();
+          GLenum type = args.get<GLenum>();
+          const void* indices = args.pointer();
+          glDrawElements(mode, count, type, indices);
+          break;
+     }
+     case CALL_Enable: {
+          GLenum cap = args.get<GLenum>();
+          glEnable(cap);
+          break;
+     }
+     case CALL_EnableVertexAttribArray: {
+          GLuint index = args.get<GLuint>();
+          glEnableVertexAttribArray(index);
+          break;
+     }
+     case CALL_EndQuery: {
+          GLenum target = args.get<GLenum>();
+          glEndQuery(target);
+          break;
+     }
+     case CALL_FenceSync: {
+          GLenum condition = args.get<GLenum>();
+          GLbitfield flags = args.get<GLbitfield>();
+          uint64_t sync = args.get<uint64_t>();
+          if (args.failed) {
+               return false;
+          }
+          state.syncs[sync] = glFenceSync(condition, flags);
+          break;
+     }
+     case CALL_Finish: glFinish(); break;
+     case CALL_Flush: glFlush(); break;
+     case CALL_FramebufferRenderbuffer: {
+          GLenum target = args.get<GLenum>();
+          GLenum attachment = args.get<GLenum>();
+          GLenum renderbufferTarget = args.get<GLenum>();
+          GLuint renderbuffer = args.get<GLuint>();
+          glFramebufferRenderbuffer(target, attachment, renderbufferTarget, mapName(state.renderbuffers, renderbuffer));
+          break;
+     }
+     case CALL_FramebufferTexture2D: {
+          GLenum target = args.get<GLenum>();
+          GLenum attachment = args.get<GLenum>();
+          GLenum textureTarget = args.get<GLenum>();
+          GLuint texture = args.get<GLuint>();
+          GLint level = args.get<GLint>();
+          glFramebufferTexture2D(target, attachment, textureTarget, mapName(state.textures, texture), level);
+          break;
+     }
+     case CALL_GenBuffers: return generateNames(args, state.buffers, glGenBuffers);
+     case CALL_GenFramebuffers: return generateNames(args, state.framebuffers, glGenFramebuffers);
+     case CALL_GenQueries: return generateNames(args, state.queries, glGenQueries);
+     case CALL_GenRenderbuffers: return generateNames(args, state.renderbuffers, glGenRenderbuffers);
+     case CALL_GenTextures: return generateNames(args, state.textures, glGenTextures);
+     case CALL_GenVertexArrays: return generateNames(args, state.vertexArrays, glGenVertexArrays);
+     case CALL_GenerateMipmap: {
+          GLenum target = args.get<GLenum>();
+          glGenerateMipmap(target);
+          break;
+     }
+     // Queries get asked again so the replay pays for the same round trips, the answers go nowhere
+     case CALL_GetBufferParameteri64v: {
+          GLenum target = args.get<GLenum>();
+          GLenum pname = args.get<GLenum>();
+          GLint64 value = 0;
+          glGetBufferParameteri64v(target, pname, &value);
+          break;
+     }
+     case CALL_GetBufferSubData: {
+          GLenum target = args.get<GLenum>();
+          int64_t offset = args.get<int64_t>();
+          int64_t size = args.get<int64_t>();
+          if (args.failed || size < 0) {
+               return false;
+          }
+          state.scratch.resize((size_t)size);
+          glGetBufferSubData(target, (GLintptr)offset, (GLsizeiptr)size, state.scratch.data());
+          break;
+     }
+     case CALL_GetIntegerv: {
+          GLenum pname = args.get<GLenum>();
+          GLint values[16] = {}; // Enough for anything that answers with more than one
+          glGetIntegerv(pname, values);
+          break;
+     }
+     case CALL_GetProgramInfoLog: {
+          GLuint program = args.get<GLuint>();
+          GLsizei bufSize = args.get<GLsizei>();
+          state.scratch.resize((size_t)std::max(bufSize, 1));
+          glGetProgramInfoLog(mapName(state.programs, program), std::max(bufSize, 0), NULL, (GLchar*)state.scratch.data());
+          break;
+     }
+     case CALL_GetProgramiv: {
+          GLuint program = args.get<GLuint>();
+          GLenum pname = args.get<GLenum>();
+          GLint value = 0;
+          glGetProgramiv(mapName(state.programs, program), pname, &value);
+          break;
+     }
+     case CALL_GetQueryObjectui64v: {
+          GLuint id = args.get<GLuint>();
+          GLenum pname = args.get<GLenum>();
+          GLuint64 value = 0;
+          glGetQueryObjectui64v(mapName(state.queries, id), pname, &value);
+          break;
+     }
+     case CALL_GetQueryObjectuiv: {
+          GLuint id = args.get<GLuint>();
+          GLenum pname = args.get<GLenum>();
+          GLuint value = 0;
+          glGetQueryObjectuiv(mapName(state.queries, id), pname, &value);
+          break;
+     }
+     case CALL_GetShaderInfoLog: {
+          GLuint shader = args.get<GLuint>();
+          GLsizei bufSize = args.get<GLsizei>();
+          state.scratch.resize((size_t)std::max(bufSize, 1));
+          glGetShaderInfoLog(mapName(state.shaders, shader), std::max(bufSize, 0), NULL, (GLchar*)state.scratch.data());
+          break;
+     }
+     case CALL_GetShaderiv: {
+          GLuint shader = args.get<GLuint>();
+          GLenum pname = args.get<GLenum>();
+          GLint value = 0;
+          glGetShaderiv(mapName(state.shaders, shader), pname, &value);
+          break;
+     }
+     case CALL_GetTexLevelParameteriv: {
+          GLenum target = args.get<GLenum>();
+          GLint level = args.get<GLint>();
+          GLenum pname = args.get<GLenum>();
+          GLint value = 0;
+          glGetTexLevelParameteriv(target, level, pname, &value);
+          break;
+     }
+     case CALL_GetUniformLocation: {
+          GLuint program = args.get<GLuint>();
+          uint64_t length;
+          const uint8_t* name = args.blob(length);
+          GLint captured = args.get<GLint>();
+          if (args.failed) {
+               return false;
+          }
+          std::string uniform((const char*)name, (size_t)length);
+          GLint location = glGetUniformLocation(mapName(state.programs, program), uniform.c_str());
+          if (captured >= 0) {
+               state.locations[locationKey(program, captured)] = location;
+          }
+          break;
+     }
+     case CALL_LinkProgram: {
+          GLuint program = args.get<GLuint>();
+          glLinkProgram(mapName(state.programs, program));
+          break;
+     }
+     case CALL_MapBufferRange: {
+          GLenum target = args.get<GLenum>();
+          int64_t offset = args.get<int64_t>();
+          int64_t length = args.get<int64_t>();
+          GLbitfield access = args.get<GLbitfield>();
+          if (args.failed) {
+               return false;
+          }
+          void* pointer = glMapBufferRange(target, (GLintptr)offset, (GLsizeiptr)length, access);
+          if (pointer) {
+               state.mapped.push_back({ target, pointer, (uint64_t)length });
+          }
+          break;
+     }
+     case CALL_PixelStorei: {
+          GLenum pname = args.get<GLenum>();
+          GLint param = args.get<GLint>();
+          glPixelStorei(pname, param);
+          break;
+     }
+     case CALL_RenderbufferStorage: {
+          GLenum target = args.get<GLenum>();
+          GLenum internalFormat = args.get<GLenum>();
+          GLsizei width = args.get<GLsizei>();
+          GLsizei height = args.get<GLsizei>();
+          glRenderbufferStorage(target, internalFormat, width, height);
+          break;
+     }
+     case CALL_ShaderSource: {
+          GLuint shader = args.get<GLuint>();
+          uint64_t length;
+          const uint8_t* source = args.blob(length);
+          if (!source) {
+               return false;
+          }
+          const GLchar* text = (const GLchar*)source;
+          GLint textLength = (GLint)length;
+          glShaderSource(mapName(state.shaders, shader), 1, &text, &textLength);
+          break;
+     }
+     case CALL_TexImage2D: {
+          GLenum target = args.get<GLenum>();
+          GLint level = args.get<GLint>();
+          GLint internalFormat = args.get<GLint>();
+          GLsizei width = args.get<GLsizei>();
+          GLsizei height = args.get<GLsizei>();
+          GLint border = args.get<GLint>();
+          GLenum format = args.get<GLenum>();
+          GLenum type = args.get<GLenum>();
+          const void* pixels;
+          if (!readPixels(args, pixels)) {
+               return false;
+          }
+          glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+          break;
+     }
+     case CALL_TexParameteri: {
+          GLenum target = args.get<GLenum>();
+          GLenum pname = args.get<GLenum>();
+          GLint param = args.get<GLint>();
+          glTexParameteri(target, pname, param);
+          break;
+     }
+     case CALL_TexSubImage2D: {
+          GLenum target = args.get<GLenum>();
+          GLint level = args.get<GLint>();
+          GLint x = args.get<GLint>();
+          GLint y = args.get<GLint>();
+          GLsizei width = args.get<GLsizei>();
+          GLsizei height = args.get<GLsizei>();
+          GLenum format = args.get<GLenum>();
+          GLenum type = args.get<GLenum>();
+          const void* pixels;
+          if (!readPixels(args, pixels)) {
+               return false;
+          }
+          glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+          break;
+     }
+     case CALL_Uniform1f: {
+          GLint location = args.get<GLint>();
+          GLfloat v0 = args.get<GLfloat>();
+          glUniform1f(mapLocation(state, location), v0);
+          break;
+     }
+     case CALL_Uniform1i: {
+          GLint location = args.get<GLint>();
+          GLint v0 = args.get<GLint>();
+          glUniform1i(mapLocation(state, location), v0);
+          break;
+     }
+     case CALL_Uniform1ui: {
+          GLint location = args.get<GLint>();
+          GLuint v0 = args.get<GLuint>();
+          glUniform1ui(mapLocation(state, location), v0);
+          break;
+     }
+     case CALL_Uniform2f: {
+          GLint location = args.get<GLint>();
+          GLfloat v0 = args.get<GLfloat>();
+          GLfloat v1 = args.get<GLfloat>();
+          glUniform2f(mapLocation(state, location), v0, v1);
+          break;
+     }
+     case CALL_UniformMatrix4fv: {
+          GLint location = args.get<GLint>();
+          GLsizei count = args.get<GLsizei>();
+          GLboolean transpose = args.get<GLboolean>();
+          const uint8_t* values = args.bytes(sizeof(GLfloat) * 16 * (uint64_t)std::max(count, 0));
+          if (!values) {
+               return false;
+          }
+          // Not necessarily aligned for floats in the record
+          state.scratch.assign(values, values + sizeof(GLfloat) * 16 * std::max(count, 0));
+          glUniformMatrix4fv(mapLocation(state, location), count, transpose, (const GLfloat*)state.scratch.data());
+          break;
+     }
+     case CALL_UnmapBuffer: {
+          GLenum target = args.get<GLenum>();
+          uint64_t length;
+          const uint8_t* written = args.blob(length);
+          if (args.failed) {
+               return false;
+          }
+          for (size_t i = 0; i < state.mapped.size(); i++) {
+               if (state.mapped[i].target == target) {
+                    memcpy(state.mapped[i].pointer, written, (size_t)std::min(length, state.mapped[i].length));
+                    state.mapped.erase(state.mapped.begin() + i);
+                    break;
+               }
+          }
+          glUnmapBuffer(target);
+          break;
+     }
+     case CALL_UseProgram: {
+          GLuint program = args.get<GLuint>();
+          state.currentProgram = program;
+          glUseProgram(mapName(state.programs, program));
+          break;
+     }
+     case CALL_VertexAttribDivisor: {
+          GLuint index = args.get<GLuint>();
+          GLuint divisor = args.get<GLuint>();
+          glVertexAttribDivisor(index, divisor);
+          break;
+     }
+     case CALL_VertexAttribPointer: {
+          GLuint index = args.get<GLuint>();
+          GLint size = args.get<GLint>();
+          GLenum type = args.get<GLenum>();
+          GLboolean normalized = args.get<GLboolean>();
+          GLsizei stride = args.get<GLsizei>();
+          const void* offset = args.pointer();
+          glVertexAttribPointer(index, size, type, normalized, stride, offset);
+          break;
+     }
+     case CALL_Viewport: {
+          GLint x = args.get<GLint>();
+          GLint y = args.get<GLint>();
+          GLsizei width = args.get<GLsizei>();
+          GLsizei height = args.get<GLsizei>();
+          glViewport(x, y, width, height);
+          break;
+     }
+     case CALL_DrawElementsBaseVertex: {
+          GLenum mode = args.get<GLenum>();
+          GLsizei count = args.get<GLsizei>();
+          GLenum type = args.get<GLenum>();
+          const void* indices = args.pointer();
+          GLint baseVertex = args.get<GLint>();
+          glDrawElementsBaseVertex(mode, count, type, indices, baseVertex);
+          break;
+     }
+     case CALL_BlendFunc: {
+          GLenum sfactor = args.get<GLenum>();
+          GLenum dfactor = args.get<GLenum>();
+          glBlendFunc(sfactor, dfactor);
+          break;
+     }
+     case CALL_DrawElementsInstanced: {
+          GLenum mode = args.get<GLenum>();
+          GLsizei count = args.get<GLsizei>();
+          GLenum type = args.get<GLenum>();
+          const void* indices = args.pointer();
+          GLsizei instancecount = args.get<GLsizei>();
+          glDrawElementsInstanced(mode, count, type, indices, instancecount);
+          break;
+     }
+     case CALL_TexImage3D: {
+          GLenum target = args.get<GLenum>();
+          GLint level = args.get<GLint>();
+          GLint internalFormat = args.get<GLint>();
+          GLsizei width = args.get<GLsizei>();
+          GLsizei height = args.get<GLsizei>();
+          GLsizei depth = args.get<GLsizei>();
+          GLint border = args.get<GLint>();
+          GLenum format = args.get<GLenum>();
+          GLenum type = args.get<GLenum>();
+          const void* pixels;
+          if (!readPixels(args, pixels)) {
+               return false;
+          }
+          glTexImage3D(target, level, internalFormat, width, height, depth, border, format, type, pixels);
+          break;
+     }
+     default:
+          // A newer capture than this build knows about
+          return false;
+     }
+     return !args.failed;
+}
+
+static bool isDraw(GlCall call) {
+     return call == CALL_DrawArrays || call == CALL_DrawElements || call == CALL_DrawElementsBaseVertex || call == CALL_DrawElementsInstanced
+          || call == CALL_Clear;
+}
+
+struct CallTiming {
+     uint64_t calls = 0;
+     double cpuMs = 0.0;
+     double maxCpuMs = 0.0;
+     double gpuMs = 0.0; // Draws and clears only
+};
+
+struct DrawTiming {
+     GlCall call;
+     int frame;
+     int index; // Of the call within the frame
+     double gpuMs;
+};
+
+struct FrameTiming {
+     double cpuMs = 0.0; // Time spent inside GL calls
+     double gpuMs = 0.0; // First call to last on the GPU's clock
+     int calls = 0;
+     int draws = 0;
+};
+
+struct ReplayTimings {
+     std::vector<CallTiming> calls = std::vector<CallTiming>(CALL_COUNT);
+     std::vector<FrameTiming> frames;
+     std::vector<DrawTiming> draws;
+     std::vector<GLuint> queries; // Timestamp queries, reused every frame and added to when a frame needs more
+};
+
+enum FrameResult {
+     FRAME_DONE,
+     FRAME_END_OF_FILE,
+     FRAME_FAILED
+};
+
+// A new query for the next timestamp, making more if the frame has used them all
+static GLuint nextTimestamp(ReplayTimings& timings, size_t& used) {
+     if (used == timings.queries.size()) {
+          size_t more = std::max(timings.queries.size(), (size_t)64);
+          timings.queries.resize(timings.queries.size() + more);
+          glGenQueries((GLsizei)more, timings.queries.data() + used);
+     }
+     return timings.queries[used++];
+}
+
+static double timestampMs(GLuint query) {
+     GLuint64 nanoseconds = 0;
+     glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+     return nanoseconds / 1e6;
+}
+
+// Plays calls up to and including the next end of frame, timing them if timings isn't null
+static FrameResult playFrame(const std::vector<uint8_t>& file, size_t& cursor, ReplayState& state, ReplayTimings* timings) {
+     FrameTiming frame;
+     size_t queriesUsed = 0;
+     struct PendingDraw {
+          GlCall call;
+          int index;
+          size_t query; // This and the one after it
+     };
+     std::vector<PendingDraw> pendingDraws;
+     if (timings) {
+          glQueryCounter(nextTimestamp(*timings, queriesUsed), GL_TIMESTAMP);
+     }
+
+     while (cursor < file.size()) {
+          const size_t recordHeader = sizeof(uint16_t) + sizeof(uint32_t);
+          if (file.size() - cursor < recordHeader) {
+               std::cout << "Capture ends part way through a call" << std::endl;
+               return FRAME_FAILED;
+          }
+          uint16_t id;
+          uint32_t bytes;
+          memcpy(&id, &file[cursor], sizeof(id));
+          memcpy(&bytes, &file[cursor + sizeof(id)], sizeof(bytes));
+          cursor += recordHeader;
+          if (file.size() - cursor < bytes) {
+               std::cout << "Capture ends part way through a call" << std::endl;
+               return FRAME_FAILED;
+          }
+          const uint8_t* data = file.data() + cursor;
+          cursor += bytes;
+
+          GlCall call = (GlCall)id;
+          if (call == CALL_END_FRAME) {
+               if (timings) {
+                    size_t endQuery = queriesUsed;
+                    glQueryCounter(nextTimestamp(*timings, queriesUsed), GL_TIMESTAMP);
+                    // Each frame finishes before the next starts so their GPU times don't overlap, the wait isn't counted
+                    glFinish();
+                    frame.gpuMs = timestampMs(timings->queries[endQuery]) - timestampMs(timings->queries[0]);
+                    for (const PendingDraw& draw : pendingDraws) {
+                         double gpuMs = timestampMs(timings->queries[draw.query + 1]) - timestampMs(timings->queries[draw.query]);
+                         timings->calls[draw.call].gpuMs += gpuMs;
+                         timings->draws.push_back({ draw.call, (int)timings->frames.size(), draw.index, gpuMs });
+                    }
+                    timings->frames.push_back(frame);
+               }
+               return FRAME_DONE;
+          }
+          if (id >= CALL_COUNT) {
+               std::cout << "Capture has call " << id << " which this replayer doesn't know" << std::endl;
+               return FRAME_FAILED;
+          }
+
+          CallReader args(data, bytes);
+          bool ok;
+          if (timings) {
+               size_t query = queriesUsed;
+               bool draw = isDraw(call);
+               if (draw) {
+                    glQueryCounter(nextTimestamp(*timings, queriesUsed), GL_TIMESTAMP);
+               }
+               auto start = std::chrono::steady_clock::now();
+               ok = executeCall(call, args, state);
+               double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+               if (draw) {
+                    glQueryCounter(nextTimestamp(*timings, queriesUsed), GL_TIMESTAMP);
+                    pendingDraws.push_back({ call, frame.calls, query });
+                    frame.draws++;
+               }
+               CallTiming& timing = timings->calls[call];
+               timing.calls++;
+               timing.cpuMs += cpuMs;
+               timing.maxCpuMs = std::max(timing.maxCpuMs, cpuMs);
+               frame.cpuMs += cpuMs;
+               frame.calls++;
+          }
+          else {
+               ok = executeCall(call, args, state);
+          }
+          if (!ok) {
+               std::cout << "Bad " << CALL_NAMES[call] << " call in the capture" << std::endl;
+               return FRAME_FAILED;
+          }
+     }
+     return FRAME_END_OF_FILE;
+}
+
+static void printTimings(const ReplayTimings& timings) {
+     char line[160];
+     size_t frameCount = timings.frames.size();
+     double cpuTotal = 0.0, gpuTotal = 0.0, cpuMax = 0.0, gpuMax = 0.0;
+     long long calls = 0, draws = 0;
+     for (const FrameTiming& frame : timings.frames) {
+          cpuTotal += frame.cpuMs;
+          gpuTotal += frame.gpuMs;
+          cpuMax = std::max(cpuMax, frame.cpuMs);
+          gpuMax = std::max(gpuMax, frame.gpuMs);
+          calls += frame.calls;
+          draws += frame.draws;
+     }
+     snprintf(line, sizeof(line), "%zu frames, %.0f calls and %.0f draws a frame", frameCount, (double)calls / frameCount, (double)draws / frameCount);
+     std::cout << line << std::endl;
+     snprintf(line, sizeof(line), "  CPU in GL calls: %.3f ms a frame, %.3f worst", cpuTotal / frameCount, cpuMax);
+     std::cout << line << std::endl;
+     snprintf(line, sizeof(line), "  GPU:             %.3f ms a frame, %.3f worst", gpuTotal / frameCount, gpuMax);
+     std::cout << line << std::endl;
+
+     std::vector<int> order;
+     for (int call = 0; call < CALL_COUNT; call++) {
+          if (timings.calls[call].calls > 0) {
+               order.push_back(call);
+          }
+     }
+     std::sort(order.begin(), order.end(), [&](int a, int b) { return timings.calls[a].cpuMs > timings.calls[b].cpuMs; });
+     std::cout << "Per function, by CPU time:" << std::endl;
+     snprintf(line, sizeof(line), "  %-28s %10s %12s %10s %10s %12s", "", "calls", "CPU ms", "avg us", "max us", "GPU ms");
+     std::cout << line << std::endl;
+     for (int call : order) {
+          const CallTiming& timing = timings.calls[call];
+          snprintf(line, sizeof(line), "  %-28s %10llu %12.3f %10.2f %10.2f %12.3f", CALL_NAMES[call], (unsigned long long)timing.calls, timing.cpuMs,
+               timing.cpuMs * 1000.0 / timing.calls, timing.maxCpuMs * 1000.0, timing.gpuMs);
+          std::cout << line << std::endl;
+     }
+
+     std::vector<DrawTiming> slowest = timings.draws;
+     size_t shown = std::min(slowest.size(), SLOWEST_DRAWS);
+     std::partial_sort(slowest.begin(), slowest.begin() + shown, slowest.end(), [](const DrawTiming& a, const DrawTiming& b) { return a.gpuMs > b.gpuMs; });
+     if (shown > 0) {
+          std::cout << "Slowest draws on the GPU:" << std::endl;
+     }
+     for (size_t i = 0; i < shown; i++) {
+          snprintf(line, sizeof(line), "  frame %d call %d, %s: %.3f ms", slowest[i].frame, slowest[i].index, CALL_NAMES[slowest[i].call], slowest[i].gpuMs);
+          std::cout << line << std::endl;
+     }
+}
+
+int replayGlCapture(const char* path, int loops) {
+     std::ifstream in(path, std::ios::binary | std::ios::ate);
+     if (!in) {
+          std::cout << "Failed to open GL capture: " << path << std::endl;
+          return -1;
+     }
+     std::vector<uint8_t> file((size_t)in.tellg());
+     in.seekg(0);
+     in.read((char*)file.data(), file.size());
+     GlCaptureHeader header;
+     if (!in || file.size() < sizeof(header)) {
+          std::cout << "Failed to read GL capture: " << path << std::endl;
+          return -1;
+     }
+     memcpy(&header, file.data(), sizeof(header));
+     if (memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) != 0 || header.version != GL_CAPTURE_VERSION) {
+          std::cout << "Not a GL capture this build can read: " << path << std::endl;
+          return -1;
+     }
+     header.renderer[sizeof(header.renderer) - 1] = '\0';
+
+     // Same context as the app asks for, in a window that's never shown
+     glfwInit();
+     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+     glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+     GLFWwindow* window = glfwCreateWindow(std::max(header.width, 1), std::max(header.height, 1), "Replay", NULL, NULL);
+     if (!window) {
+          std::cout << "Failed to create GLFW window" << std::endl;
+          glfwTerminate();
+          return -1;
+     }
+     glfwMakeContextCurrent(window);
+     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+          std::cout << "Failed to initialize GLAD" << std::endl;
+          glfwTerminate();
+          return -1;
+     }
+     std::cout << "Captured on " << header.renderer << ", replaying on " << glGetString(GL_RENDERER) << std::endl;
+
+     ReplayState state;
+     size_t cursor = sizeof(header);
+     FrameResult result = FRAME_DONE;
+     for (uint32_t frame = 0; frame < header.warmupFrames && result == FRAME_DONE; frame++) {
+          result = playFrame(file, cursor, state, nullptr);
+     }
+     if (result != FRAME_DONE) {
+          std::cout << "Capture ended before its warm up frames did" << std::endl;
+          glfwTerminate();
+          return -1;
+     }
+     glFinish();
+
+     // Looping replays the same frames on top of the state the last pass left, close enough for timing even if what's drawn drifts
+     ReplayTimings timings;
+     size_t measuredStart = cursor;
+     for (int loop = 0; loop < std::max(loops, 1) && result != FRAME_FAILED; loop++) {
+          cursor = measuredStart;
+          result = FRAME_DONE;
+          while (result == FRAME_DONE) {
+               result = playFrame(file, cursor, state, &timings);
+          }
+     }
+     if (timings.frames.empty()) {
+          std::cout << "No measured frames in " << path << std::endl;
+     }
+     else {
+          printTimings(timings);
+     }
+
+     if (!timings.queries.empty()) {
+          glDeleteQueries((GLsizei)timings.queries.size(), timings.queries.data());
+     }
+     glfwTerminate();
+     return result == FRAME_FAILED ? -1 : 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Plays a file from startGlCapture back in a hidden window with none of the app around it, for --replay
+// Warm up frames run first to get back to the captured state, then the measured frames run loops times with every call timed on
+// the CPU and every draw and clear timed on the GPU with timestamp queries, finishing after each frame so frames don't overlap
+// Prints per frame totals, time per GL function and the slowest draws, returns main's exit code
+int replayGlCapture(const char* path, int loops);
@@ -0,0 +1,268 @@
+#include <iostream>
+#include <utility>
+
+#include "gpuResources.h"
+
+GpuResource::GpuResource(GpuResource&& other) noexcept : registry(other.registry), handle(other.handle) {
+     other.registry = nullptr;
+     other.handle = GpuHandle();
+}
+
+GpuResource& GpuResource::operator=(GpuResource&& other) noexcept {
+     if (this != &other) {
+          reset();
+          registry = other.registry;
+          handle = other.handle;
+          other.registry = nullptr;
+          other.handle = GpuHandle();
+     }
+     return *this;
+}
+
+unsigned int GpuResource::get() const {
+     return registry ? registry->get(handle) : 0;
+}
+
+void GpuResource::reset() {
+     if (registry) {
+          registry->release(handle);
+     }
+     registry = nullptr;
+     handle = GpuHandle();
+}
+
+GpuResourceRegistry::GpuResourceRegistry(size_t budgetBytes) {
+     stats.budgetBytes = budgetBytes;
+}
+
+GpuResource GpuResourceRegistry::create(GpuResourceKind kind, const char* label) {
+     unsigned int name = 0;
+     switch (kind) {
+     case GPU_BUFFER: glGenBuffers(1, &name); break;
+     case GPU_TEXTURE: glGenTextures(1, &name); break;
+     case GPU_VERTEX_ARRAY: glGenVertexArrays(1, &name); break;
+     default: break;
+     }
+     return adopt(kind, name, label);
+}
+
+GpuResource GpuResourceRegistry::adopt(GpuResourceKind kind, unsigned int name, const char* label) {
+     if (name == 0) {
+          return GpuResource();
+     }
+     uint32_t index;
+     if (!freeSlots.empty()) {
+          index = freeSlots.back();
+          freeSlots.pop_back();
+     }
+     else {
+          index = (uint32_t)slots.size();
+          slots.push_back(Slot());
+     }
+     Slot& slot = slots[index];
+     slot.name = name;
+     slot.kind = kind;
+     slot.label = label;
+     stats.live[kind]++;
+
+     GpuHandle handle = { index, slot.generation };
+     measure(handle);
+     return GpuResource(this, handle);
+}
+
+const GpuResourceRegistry::Slot* GpuResourceRegistry::find(GpuHandle handle) const {
+     if (handle.index >= slots.size()) {
+          return nullptr;
+     }
+     const Slot& slot = slots[handle.index];
+     return slot.generation == handle.generation && slot.name != 0 ? &slot : nullptr;
+}
+
+unsigned int GpuResourceRegistry::get(GpuHandle handle) const {
+     const Slot* slot = find(handle);
+     return slot ? slot->name : 0;
+}
+
+const char* GpuResourceRegistry::getLabel(GpuHandle handle) const {
+     const Slot* slot = find(handle);
+     return slot ? slot->label : "";
+}
+
+void GpuResourceRegistry::measure(GpuHandle handle) {
+     const Slot* found = find(handle);
+     if (!found) {
+          return;
+     }
+     Slot& slot = slots[handle.index];
+     size_t bytes[GPU_MEMORY_CATEGORIES] = {};
+
+     if (slot.kind == GPU_BUFFER) {
+          // The copy read binding isn't part of any VAO, so borrowing it doesn't disturb anything
+          GLint previous = 0;
+          glGetIntegerv(GL_COPY_READ_BUFFER, &previous); // The binding query, GL_COPY_READ_BUFFER_BINDING is only its 4.3 alias
+          glBindBuffer(GL_COPY_READ_BUFFER, slot.name);
+          GLint64 size = 0;
+          glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+          glBindBuffer(GL_COPY_READ_BUFFER, (GLuint)previous);
+          bytes[GPU_MEMORY_BUFFERS] = (size_t)size;
+     }
+     else if (slot.kind == GPU_TEXTURE) {
+          // Whatever the driver says it stored, which for RGB can be less than it really uses if it pads to four channels
+          GLint previous = 0;
+          glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+          glBindTexture(GL_TEXTURE_2D, slot.name);
+          for (int level = 0; level < 32; level++) {
+               GLint width = 0, height = 0, compressed = 0;
+               glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+               glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+               if (width == 0 || height == 0) {
+                    break;
+               }
+               size_t levelBytes;
+               glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+               if (compressed) {
+                    GLint compressedSize = 0;
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressedSize);
+                    levelBytes = (size_t)compressedSize;
+               }
+               else {
+                    GLint bits = 0;
+                    const GLenum sizes[] = { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE };
+                    for (GLenum size : sizes) {
+                         GLint channelBits = 0;
+                         glGetTexLevelParameteriv(GL_TEXTURE_2D, level, size, &channelBits);
+                         bits += channelBits;
+                    }
+                    levelBytes = (size_t)width * height * ((bits + 7) / 8);
+               }
+               bytes[level == 0 ? GPU_MEMORY_TEXTURES : GPU_MEMORY_MIPS] += levelBytes;
+          }
+          glBindTexture(GL_TEXTURE_2D, (GLuint)previous);
+     }
+     setBytes(slot, bytes);
+}
+
+void GpuResourceRegistry::setBytes(Slot& slot, const size_t (&bytes)[GPU_MEMORY_CATEGORIES]) {
+     for (int category = 0; category < GPU_MEMORY_CATEGORIES; category++) {
+          stats.bytes[category] -= slot.bytes[category];
+          stats.bytes[category] += bytes[category];
+          slot.bytes[category] = bytes[category];
+     }
+     updateTotals();
+}
+
+void GpuResourceRegistry::updateTotals() {
+     stats.totalBytes = stats.retiringBytes;
+     for (int category = 0; category < GPU_MEMORY_CATEGORIES; category++) {
+          stats.totalBytes += stats.bytes[category];
+     }
+     stats.overBudget = stats.budgetBytes > 0 && stats.totalBytes > stats.budgetBytes;
+     // Once per time it goes over, rather than every frame it stays there
+     if (stats.overBudget && !warnedOverBudget) {
+          std::cout << "GPU memory over budget: " << stats.totalBytes / (1024 * 1024) << " MB of " << stats.budgetBytes / (1024 * 1024) << " MB" << std::endl;
+     }
+     warnedOverBudget = stats.overBudget;
+}
+
+// Moves the slot's object onto this frame's retired list and frees the slot, the handle goes stale straight away
+void GpuResourceRegistry::retire(Slot& slot) {
+     size_t bytes = 0;
+     for (int category = 0; category < GPU_MEMORY_CATEGORIES; category++) {
+          bytes += slot.bytes[category];
+     }
+     retiredThisFrame.push_back({ slot.kind, slot.name, bytes });
+     stats.retiring++;
+     stats.retiringBytes += bytes;
+     const size_t none[GPU_MEMORY_CATEGORIES] = {};
+     setBytes(slot, none);
+}
+
+void GpuResourceRegistry::replace(GpuHandle handle, unsigned int newName) {
+     if (!find(handle) || newName == 0) {
+          return;
+     }
+     Slot& slot = slots[handle.index];
+     retire(slot);
+     slot.name = newName;
+     measure(handle);
+}
+
+void GpuResourceRegistry::release(GpuHandle handle) {
+     if (!find(handle)) {
+          return;
+     }
+     Slot& slot = slots[handle.index];
+     retire(slot);
+     stats.live[slot.kind]--;
+     slot.name = 0;
+     slot.label = "";
+     slot.generation++;
+     if (slot.generation == 0) {
+          slot.generation = 1; // Wrapped, 0 is the null handle
+     }
+     freeSlots.push_back(handle.index);
+}
+
+void GpuResourceRegistry::deleteObject(GpuResourceKind kind, unsigned int name) {
+     switch (kind) {
+     case GPU_BUFFER: glDeleteBuffers(1, &name); break;
+     case GPU_TEXTURE: glDeleteTextures(1, &name); break;
+     case GPU_VERTEX_ARRAY: glDeleteVertexArrays(1, &name); break;
+     default: break;
+     }
+}
+
+void GpuResourceRegistry::endFrame() {
+     if (!retiredThisFrame.empty()) {
+          RetiredFrame frame;
+          frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+          frame.resources.swap(retiredThisFrame);
+          retiredFrames.push_back(std::move(frame));
+     }
+
+     // Fences signal in order, so stop at the first one that hasn't
+     while (!retiredFrames.empty()) {
+          RetiredFrame& frame = retiredFrames.front();
+          // Zero timeout, if the frame hasn't finished it just gets checked again next time
+          GLenum status = glClientWaitSync(frame.fence, 0, 0);
+          if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+               break;
+          }
+          glDeleteSync(frame.fence);
+          for (const Retired& retired : frame.resources) {
+               deleteObject(retired.kind, retired.name);
+               stats.retiring--;
+               stats.retiringBytes -= retired.bytes;
+          }
+          retiredFrames.pop_front();
+     }
+     updateTotals();
+}
+
+void GpuResourceRegistry::deleteResources() {
+     for (uint32_t index = 0; index < slots.size(); index++) {
+          if (slots[index].name != 0) {
+               release(GpuHandle{ index, slots[index].generation });
+          }
+     }
+     // No waiting at shutdown, GL keeps anything the GPU is still using alive on its own until it's done with it
+     for (RetiredFrame& frame : retiredFrames) {
+          glDeleteSync(frame.fence);
+          for (const Retired& retired : frame.resources) {
+               deleteObject(retired.kind, retired.name);
+          }
+     }
+     for (const Retired& retired : retiredThisFrame) {
+          deleteObject(retired.kind, retired.name);
+     }
+     retiredFrames.clear();
+     retiredThisFrame.clear();
+     stats.retiring = 0;
+     stats.retiringBytes = 0;
+     updateTotals();
+}
+
+void GpuResourceRegistry::setBudget(size_t budgetBytes) {
+     stats.budgetBytes = budgetBytes;
+     updateTotals();
+}
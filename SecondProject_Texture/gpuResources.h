@@ -0,0 +1,138 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+enum GpuResourceKind {
+     GPU_BUFFER,
+     GPU_TEXTURE, // 2D textures, which is all this draws with
+     GPU_VERTEX_ARRAY,
+     GPU_RESOURCE_KINDS
+};
+
+enum GpuMemoryCategory {
+     GPU_MEMORY_BUFFERS,
+     GPU_MEMORY_TEXTURES, // Level 0 of every texture
+     GPU_MEMORY_MIPS, // Every level under that
+     GPU_MEMORY_CATEGORIES
+};
+
+// Names a registered object, the generation goes up every time a slot is freed so a handle to something that's been released
+// just stops resolving instead of pointing at whatever reused the slot
+// Generation 0 is never handed out, so a default handle is null
+struct GpuHandle {
+     uint32_t index = 0;
+     uint32_t generation = 0;
+
+     bool isNull() const { return generation == 0; }
+};
+
+struct GpuMemoryStats {
+     size_t bytes[GPU_MEMORY_CATEGORIES] = {};
+     size_t retiringBytes = 0; // Released but still waiting on the GPU, it's all still resident until then
+     size_t totalBytes = 0; // Everything above
+     size_t budgetBytes = 0; // 0 for no budget
+     int live[GPU_RESOURCE_KINDS] = {};
+     int retiring = 0;
+     bool overBudget = false;
+};
+
+class GpuResourceRegistry;
+
+// Owns one registered object and releases it when it goes out of scope, move only
+// The registry has to outlive it, which in main just means declaring the registry first
+class GpuResource {
+public:
+     GpuResource() = default;
+     GpuResource(GpuResourceRegistry* registry, GpuHandle handle) : registry(registry), handle(handle) {}
+     ~GpuResource() { reset(); }
+     GpuResource(const GpuResource&) = delete;
+     GpuResource& operator=(const GpuResource&) = delete;
+     GpuResource(GpuResource&& other) noexcept;
+     GpuResource& operator=(GpuResource&& other) noexcept;
+
+     // The GL name, 0 once it's been released
+     unsigned int get() const;
+     GpuHandle getHandle() const { return handle; }
+     // Releases it now rather than at the end of the scope
+     void reset();
+
+private:
+     GpuResourceRegistry* registry = nullptr;
+     GpuHandle handle;
+};
+
+// Every GL buffer, texture and VAO the app makes directly goes through here, so there's one place that knows what's alive, how much
+// memory it all takes and when it's safe to delete
+// Releasing only queues the object, each frame's releases share a fence and get deleted once the GPU has finished the frames that
+// might still be using them
+// Objects that other classes manage themselves (streamed textures, the sequence texture, the compute buffers) aren't in here, they
+// clean up after themselves and the streamer keeps its own budget
+// Render thread only
+class GpuResourceRegistry {
+public:
+     explicit GpuResourceRegistry(size_t budgetBytes = 0);
+     // Doesn't touch GL, the context is usually gone by now, deleteResources is what frees things
+     ~GpuResourceRegistry() = default;
+     GpuResourceRegistry(const GpuResourceRegistry&) = delete;
+     GpuResourceRegistry& operator=(const GpuResourceRegistry&) = delete;
+
+     // Makes a new empty object, measure it once it's been given its data
+     GpuResource create(GpuResourceKind kind, const char* label);
+     // Takes over an object made somewhere else and measures it, a null resource if name is 0
+     GpuResource adopt(GpuResourceKind kind, unsigned int name, const char* label);
+
+     // O(1), 0 if the handle's been released
+     unsigned int get(GpuHandle handle) const;
+     bool isAlive(GpuHandle handle) const { return get(handle) != 0; }
+     const char* getLabel(GpuHandle handle) const;
+
+     // Asks GL how big the object is now, buffers by their size and textures level by level
+     void measure(GpuHandle handle);
+     // Points the handle at a new object of the same kind and retires the old one, for hot reloading
+     void replace(GpuHandle handle, unsigned int newName);
+     void release(GpuHandle handle);
+
+     // Call once per frame after the swap, fences this frame's releases and deletes anything the GPU has finished with
+     void endFrame();
+
+     // Deletes everything straight away, needs calling before glfwTerminate
+     void deleteResources();
+
+     void setBudget(size_t budgetBytes);
+     const GpuMemoryStats& getStats() const { return stats; }
+
+private:
+     struct Slot {
+          unsigned int name = 0;
+          uint32_t generation = 1;
+          GpuResourceKind kind = GPU_BUFFER;
+          const char* label = "";
+          size_t bytes[GPU_MEMORY_CATEGORIES] = {};
+     };
+     struct Retired {
+          GpuResourceKind kind;
+          unsigned int name;
+          size_t bytes;
+     };
+     // Everything released in one frame, deleted together once its fence has passed
+     struct RetiredFrame {
+          GLsync fence;
+          std::vector<Retired> resources;
+     };
+
+     const Slot* find(GpuHandle handle) const;
+     void retire(Slot& slot);
+     void setBytes(Slot& slot, const size_t (&bytes)[GPU_MEMORY_CATEGORIES]);
+     void updateTotals();
+     static void deleteObject(GpuResourceKind kind, unsigned int name);
+
+     std::vector<Slot> slots;
+     std::vector<uint32_t> freeSlots;
+     std::vector<Retired> retiredThisFrame;
+     std::deque<RetiredFrame> retiredFrames;
+     GpuMemoryStats stats;
+     bool warnedOverBudget = false;
+};
@@ -0,0 +1,270 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "gpuTransforms.h"
+
+// GL 4.2/4.3 bits glad's 3.3 header doesn't have
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+
+typedef void (APIENTRYP DispatchComputeProc)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+typedef void (APIENTRYP DrawElementsInstancedBaseInstanceProc)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount, GLuint baseInstance);
+
+static DispatchComputeProc dispatchCompute = nullptr;
+static MemoryBarrierProc memoryBarrier = nullptr;
+static DrawElementsInstancedBaseInstanceProc drawElementsInstancedBaseInstance = nullptr;
+
+// Has to match local_size_x in the compute shader
+static const unsigned int WORKGROUP_SIZE = 64;
+
+// Storage buffer binding points, also matching the shader
+enum StorageBinding {
+     BINDING_OBJECTS = 0,
+     BINDING_CLIPS = 1,
+     BINDING_KEY_TIMES = 2,
+     BINDING_KEY_VALUES = 3,
+     BINDING_MODELS = 4
+};
+
+static bool loadComputeFunctions() {
+     GLint major = 0, minor = 0;
+     glGetIntegerv(GL_MAJOR_VERSION, &major);
+     glGetIntegerv(GL_MINOR_VERSION, &minor);
+     if (major < 4 || (major == 4 && minor < 3)) {
+          std::cout << "Compute shaders need GL 4.3, this context is " << major << "." << minor << ": Using CPU transforms" << std::endl;
+          return false;
+     }
+     dispatchCompute = (DispatchComputeProc)glfwGetProcAddress("glDispatchCompute");
+     memoryBarrier = (MemoryBarrierProc)glfwGetProcAddress("glMemoryBarrier");
+     drawElementsInstancedBaseInstance = (DrawElementsInstancedBaseInstanceProc)glfwGetProcAddress("glDrawElementsInstancedBaseInstance");
+     if (!dispatchCompute || !memoryBarrier || !drawElementsInstancedBaseInstance) {
+          std::cout << "Failed to load compute shader functions: Using CPU transforms" << std::endl;
+          return false;
+     }
+     return true;
+}
+
+static unsigned int compileComputeProgram(const std::string& path) {
+     std::ifstream file(path);
+     if (!file) {
+          std::cout << "Failed to open compute shader: " << path << std::endl;
+          return 0;
+     }
+     std::stringstream source;
+     source << file.rdbuf();
+     std::string sourceString = source.str();
+     const char* sourcePointer = sourceString.c_str();
+
+     char infoLog[1024];
+     int success;
+     unsigned int shader = glCreateShader(GL_COMPUTE_SHADER);
+     glShaderSource(shader, 1, &sourcePointer, NULL);
+     glCompileShader(shader);
+     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+     if (!success) {
+          glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+          std::cout << "Failed to compile compute shader: " << path << "\n" << infoLog << std::endl;
+          glDeleteShader(shader);
+          return 0;
+     }
+
+     unsigned int program = glCreateProgram();
+     glAttachShader(program, shader);
+     glLinkProgram(program);
+     glDeleteShader(shader);
+     glGetProgramiv(program, GL_LINK_STATUS, &success);
+     if (!success) {
+          glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+          std::cout << "Failed to link compute shader: " << path << "\n" << infoLog << std::endl;
+          glDeleteProgram(program);
+          return 0;
+     }
+     return program;
+}
+
+bool GpuTransformUpdater::create(const std::string& computePath) {
+     if (!loadComputeFunctions()) {
+          return false;
+     }
+     program = compileComputeProgram(computePath);
+     if (!program) {
+          return false;
+     }
+     timeLocation = glGetUniformLocation(program, "time");
+     objectCountLocation = glGetUniformLocation(program, "objectCount");
+     glGenBuffers(1, &objectBuffer);
+     glGenBuffers(1, &clipBuffer);
+     glGenBuffers(1, &keyTimeBuffer);
+     glGenBuffers(1, &keyValueBuffer);
+     glGenBuffers(1, &instanceBuffer);
+     glGenQueries(TIMER_QUERIES, timerQueries);
+     statsStart = std::chrono::steady_clock::now();
+     return true;
+}
+
+uint32_t GpuTransformUpdater::addObject(const AnimationClip* clip, const glm::mat4& parentTransform, float speed, float timeOffset, bool loop) {
+     GpuObject object;
+     object.parent = parentTransform;
+     object.clip = addClip(clip);
+     object.speed = speed;
+     object.timeOffset = timeOffset;
+     object.loop = loop ? 1 : 0;
+     objects.push_back(object);
+     objectsDirty = true;
+     stats.objects = objects.size();
+     return (uint32_t)objects.size() - 1;
+}
+
+void GpuTransformUpdater::setParentTransform(uint32_t object, const glm::mat4& parentTransform) {
+     objects[object].parent = parentTransform;
+     objectsDirty = true;
+}
+
+uint32_t GpuTransformUpdater::addClip(const AnimationClip* clip) {
+     for (uint32_t i = 0; i < clipSources.size(); i++) {
+          if (clipSources[i] == clip) {
+               return i;
+          }
+     }
+
+     // Every channel's keys go on the end of the shared key arrays
+     GpuClip gpuClip;
+     auto appendKeys = [&](const std::vector<float>& times, auto getValue, uint32_t& first, uint32_t& count) {
+          first = (uint32_t)keyTimes.size();
+          count = (uint32_t)times.size();
+          for (size_t i = 0; i < times.size(); i++) {
+               keyTimes.push_back(times[i]);
+               keyValues.push_back(getValue(i));
+          }
+     };
+     appendKeys(clip->translationTimes, [&](size_t i) { return glm::vec4(clip->translations[i], 0.0f); }, gpuClip.translationFirst, gpuClip.translationCount);
+     appendKeys(clip->rotationTimes, [&](size_t i) {
+          const glm::quat& q = clip->rotations[i];
+          return glm::vec4(q.x, q.y, q.z, q.w);
+     }, gpuClip.rotationFirst, gpuClip.rotationCount);
+     appendKeys(clip->scaleTimes, [&](size_t i) { return glm::vec4(clip->scales[i], 0.0f); }, gpuClip.scaleFirst, gpuClip.scaleCount);
+     gpuClip.duration = clip->getDuration();
+     gpuClip.padding = 0.0f;
+
+     clipSources.push_back(clip);
+     clips.push_back(gpuClip);
+     clipsDirty = true;
+     return (uint32_t)clips.size() - 1;
+}
+
+void GpuTransformUpdater::uploadBuffer(unsigned int buffer, const void* data, size_t bytes) {
+     glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+     glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, data, GL_STATIC_DRAW);
+}
+
+void GpuTransformUpdater::attachInstanceBuffer(unsigned int vao, unsigned int firstLocation) const {
+     glBindVertexArray(vao);
+     glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+     // A mat4 attribute takes 4 locations, one column each
+     for (unsigned int column = 0; column < 4; column++) {
+          glVertexAttribPointer(firstLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+          glEnableVertexAttribArray(firstLocation + column);
+          glVertexAttribDivisor(firstLocation + column, 1);
+     }
+     glBindBuffer(GL_ARRAY_BUFFER, 0);
+     glBindVertexArray(0);
+}
+
+void GpuTransformUpdater::update(float time) {
+     if (!program || objects.empty()) {
+          return;
+     }
+
+     // Only the parameters are uploaded, never the matrices
+     if (objectsDirty) {
+          uploadBuffer(objectBuffer, objects.data(), objects.size() * sizeof(GpuObject));
+          if (instanceCapacity < objects.size()) {
+               glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+               glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+               instanceCapacity = objects.size();
+          }
+          objectsDirty = false;
+     }
+     if (clipsDirty) {
+          uploadBuffer(clipBuffer, clips.data(), clips.size() * sizeof(GpuClip));
+          uploadBuffer(keyTimeBuffer, keyTimes.data(), keyTimes.size() * sizeof(float));
+          uploadBuffer(keyValueBuffer, keyValues.data(), keyValues.size() * sizeof(glm::vec4));
+          clipsDirty = false;
+     }
+     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+     readTimerQueries();
+     bool timing = !queryPending[nextQuery];
+     if (timing) {
+          glBeginQuery(GL_TIME_ELAPSED, timerQueries[nextQuery]);
+     }
+
+     glUseProgram(program);
+     glUniform1f(timeLocation, time);
+     glUniform1ui(objectCountLocation, (GLuint)objects.size());
+     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_OBJECTS, objectBuffer);
+     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_CLIPS, clipBuffer);
+     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_KEY_TIMES, keyTimeBuffer);
+     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_KEY_VALUES, keyValueBuffer);
+     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING_MODELS, instanceBuffer);
+     dispatchCompute(((GLuint)objects.size() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+     // The matrices get read as vertex attributes next
+     memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+     if (timing) {
+          glEndQuery(GL_TIME_ELAPSED);
+          queryPending[nextQuery] = true;
+          nextQuery = (nextQuery + 1) % TIMER_QUERIES;
+     }
+}
+
+void GpuTransformUpdater::readTimerQueries() {
+     for (int i = 0; i < TIMER_QUERIES; i++) {
+          if (!queryPending[i]) {
+               continue;
+          }
+          GLuint available = 0;
+          glGetQueryObjectuiv(timerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+          if (available) {
+               GLuint64 nanoseconds = 0;
+               glGetQueryObjectui64v(timerQueries[i], GL_QUERY_RESULT, &nanoseconds);
+               gpuMsTotal += nanoseconds / 1e6;
+               gpuMsSamples++;
+               queryPending[i] = false;
+          }
+     }
+
+     auto now = std::chrono::steady_clock::now();
+     if (now - statsStart >= std::chrono::seconds(1)) {
+          stats.gpuMs = gpuMsSamples > 0 ? gpuMsTotal / gpuMsSamples : 0.0;
+          gpuMsTotal = 0.0;
+          gpuMsSamples = 0;
+          statsStart = now;
+     }
+}
+
+void GpuTransformUpdater::draw(int firstIndex, int indexCount, uint32_t firstObject, uint32_t objectCount) const {
+     drawElementsInstancedBaseInstance(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(unsigned int)), (GLsizei)objectCount, firstObject);
+}
+
+void GpuTransformUpdater::deleteResources() {
+     if (!program) {
+          return;
+     }
+     glDeleteProgram(program);
+     unsigned int buffers[] = { objectBuffer, clipBuffer, keyTimeBuffer, keyValueBuffer, instanceBuffer };
+     glDeleteBuffers(5, buffers);
+     glDeleteQueries(TIMER_QUERIES, timerQueries);
+     program = 0;
+}
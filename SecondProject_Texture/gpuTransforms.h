@@ -0,0 +1,100 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "animation.h"
+
+struct GpuTransformStats {
+     size_t objects = 0;
+     double gpuMs = 0.0; // Compute dispatch time averaged over the last second, from timer queries
+};
+
+// Builds every object's model matrix on the GPU instead of the CPU
+// Each object's parent matrix and animation settings live in one shader storage buffer, the clips' keys in others, and a compute
+// shader samples the clips and writes parent * translate * rotate * scale straight into an instance buffer the vertex shader reads
+// Needs GL 4.3 for compute shaders, which glad's 3.3 loader doesn't cover, so those few functions are loaded here
+// Works under Mesa's llvmpipe (LIBGL_ALWAYS_SOFTWARE=1) too, which is handy for testing
+class GpuTransformUpdater {
+public:
+     GpuTransformUpdater() = default;
+     GpuTransformUpdater(const GpuTransformUpdater&) = delete;
+     GpuTransformUpdater& operator=(const GpuTransformUpdater&) = delete;
+
+     // False if the context is older than 4.3 or the shader didn't compile, the CPU path has to be used instead
+     bool create(const std::string& computePath);
+     bool isSupported() const { return program != 0; }
+
+     // Clips get uploaded the first time an object uses them and have to outlive the updater
+     // Returns the object's instance index, which is its row in the instance buffer
+     uint32_t addObject(const AnimationClip* clip, const glm::mat4& parentTransform, float speed = 1.0f, float timeOffset = 0.0f, bool loop = true);
+     void setParentTransform(uint32_t object, const glm::mat4& parentTransform);
+
+     // Sets up attribute locations firstLocation to firstLocation + 3 of the VAO to read one model matrix per instance
+     void attachInstanceBuffer(unsigned int vao, unsigned int firstLocation) const;
+
+     // Uploads anything that changed and runs the compute shader for the given time, call before drawing
+     void update(float time);
+
+     // Instanced draw of the bound VAO's indices from firstIndex on, instance i uses object firstObject + i's matrix
+     void draw(int firstIndex, int indexCount, uint32_t firstObject, uint32_t objectCount) const;
+
+     // Like Program::deleteProgram, needs calling before glfwTerminate
+     void deleteResources();
+
+     const GpuTransformStats& getStats() const { return stats; }
+
+private:
+     // Both match the std430 layouts in the compute shader
+     struct GpuObject {
+          glm::mat4 parent;
+          uint32_t clip;
+          float speed;
+          float timeOffset;
+          uint32_t loop;
+     };
+     struct GpuClip {
+          uint32_t translationFirst;
+          uint32_t translationCount;
+          uint32_t rotationFirst;
+          uint32_t rotationCount;
+          uint32_t scaleFirst;
+          uint32_t scaleCount;
+          float duration;
+          float padding;
+     };
+
+     uint32_t addClip(const AnimationClip* clip);
+     void uploadBuffer(unsigned int buffer, const void* data, size_t bytes);
+     void readTimerQueries();
+
+     unsigned int program = 0;
+     int timeLocation = -1;
+     int objectCountLocation = -1;
+     unsigned int objectBuffer = 0;
+     unsigned int clipBuffer = 0;
+     unsigned int keyTimeBuffer = 0;
+     unsigned int keyValueBuffer = 0;
+     unsigned int instanceBuffer = 0; // One mat4 per object, written by the compute shader
+     std::vector<GpuObject> objects;
+     std::vector<const AnimationClip*> clipSources;
+     std::vector<GpuClip> clips;
+     std::vector<float> keyTimes;
+     std::vector<glm::vec4> keyValues; // Quaternions as xyzw, translations and scales in xyz
+     bool objectsDirty = false;
+     bool clipsDirty = false;
+     size_t instanceCapacity = 0;
+
+     // A few frames' worth of timer queries so reading them back never stalls
+     static const int TIMER_QUERIES = 4;
+     unsigned int timerQueries[TIMER_QUERIES] = {};
+     bool queryPending[TIMER_QUERIES] = {};
+     int nextQuery = 0;
+     double gpuMsTotal = 0.0;
+     int gpuMsSamples = 0;
+     std::chrono::steady_clock::time_point statsStart;
+     GpuTransformStats stats;
+};
@@ -0,0 +1,129 @@
+#include <stb/stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "imageDecoder.h"
+#include "jpegDecoder.h"
+#include "pngDecoder.h"
+
+bool StbImageDecoder::canDecode(const unsigned char* data, size_t size) const {
+     int width, height, channels;
+     return stbi_info_from_memory(data, (int)size, &width, &height, &channels) != 0;
+}
+
+bool StbImageDecoder::decode(const unsigned char* data, size_t size, ImageData& image) {
+     image.pixels = stbi_load_from_memory(data, (int)size, &image.width, &image.height, &image.channels, 0);
+     if (!image.pixels || image.channels != 2) {
+          return image.pixels != nullptr;
+     }
+
+     // stbi_info can't say beforehand, a grey PNG only turns into grey + alpha once its tRNS chunk has been read
+     size_t pixelCount = (size_t)image.width * image.height;
+     unsigned char* expanded = (unsigned char*)malloc(pixelCount * 4);
+     if (!expanded) {
+          stbi_image_free(image.pixels);
+          image.pixels = nullptr;
+          return false;
+     }
+     for (size_t i = 0; i < pixelCount; i++) {
+          expanded[i * 4] = expanded[i * 4 + 1] = expanded[i * 4 + 2] = image.pixels[i * 2];
+          expanded[i * 4 + 3] = image.pixels[i * 2 + 1];
+     }
+     stbi_image_free(image.pixels);
+     image.pixels = expanded;
+     image.channels = 4;
+     return true;
+}
+
+static std::vector<std::unique_ptr<ImageDecoder>>& decoders() {
+     static std::vector<std::unique_ptr<ImageDecoder>> list = [] {
+          std::vector<std::unique_ptr<ImageDecoder>> defaults;
+          defaults.push_back(std::make_unique<JpegDecoder>());
+          defaults.push_back(std::make_unique<PngDecoder>());
+          return defaults;
+     }();
+     return list;
+}
+
+void registerImageDecoder(std::unique_ptr<ImageDecoder> decoder) {
+     decoders().insert(decoders().begin(), std::move(decoder));
+}
+
+bool decodeImage(const unsigned char* data, size_t size, ImageData& image) {
+     for (std::unique_ptr<ImageDecoder>& decoder : decoders()) {
+          if (decoder->canDecode(data, size) && decoder->decode(data, size, image)) {
+               return true;
+          }
+     }
+     StbImageDecoder stb;
+     return stb.decode(data, size, image);
+}
+
+bool benchmarkImageDecoders(const std::string& path, int iterations) {
+     std::ifstream file(path, std::ios::binary);
+     if (!file) {
+          std::cout << "Failed to open: " << path << std::endl;
+          return false;
+     }
+     std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+     // Runs one decoder over the file, returns megapixels per second or 0 if it can't decode it
+     auto timeDecoder = [&](ImageDecoder& decoder, ImageData& result) {
+          if (!decoder.canDecode(data.data(), data.size()) || !decoder.decode(data.data(), data.size(), result)) {
+               return 0.0;
+          }
+          std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+          for (int i = 0; i < iterations; i++) {
+               ImageData image;
+               decoder.decode(data.data(), data.size(), image);
+               freeImage(image);
+          }
+          double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+          return (double)result.width * result.height * iterations / seconds / 1e6;
+     };
+
+     StbImageDecoder stb;
+     ImageData reference;
+     double stbRate = timeDecoder(stb, reference);
+     if (stbRate == 0.0) {
+          std::cout << "stb_image can't decode: " << path << std::endl;
+          return false;
+     }
+     std::cout << path << ": " << reference.width << "x" << reference.height << ", " << reference.channels << " channels, "
+          << data.size() / 1024 << " KB, " << iterations << " iterations" << std::endl;
+     std::cout << "  stb_image: " << stbRate << " MP/s" << std::endl;
+
+     for (std::unique_ptr<ImageDecoder>& decoder : decoders()) {
+          ImageData image;
+          double rate = timeDecoder(*decoder, image);
+          if (rate == 0.0) {
+               continue;
+          }
+
+          // Small differences are expected from rounding and chroma upsampling, anything large means something's broken
+          int maxDifference = -1;
+          if (image.width == reference.width && image.height == reference.height && image.channels == reference.channels) {
+               maxDifference = 0;
+               size_t bytes = (size_t)image.width * image.height * image.channels;
+               for (size_t i = 0; i < bytes; i++) {
+                    maxDifference = std::max(maxDifference, std::abs(image.pixels[i] - reference.pixels[i]));
+               }
+          }
+          std::cout << "  " << decoder->name() << ": " << rate << " MP/s (" << rate / stbRate << "x stb), max difference from stb: ";
+          if (maxDifference < 0) {
+               std::cout << "size mismatch" << std::endl;
+          }
+          else {
+               std::cout << maxDifference << std::endl;
+          }
+          freeImage(image);
+     }
+
+     freeImage(reference);
+     return true;
+}
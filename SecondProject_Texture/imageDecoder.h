@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "textureLoader.h"
+
+// One way of turning an encoded image file into pixels
+// Pixels have to be allocated with malloc, freeImage hands them to stbi_image_free which is just free() underneath
+class ImageDecoder {
+public:
+     virtual ~ImageDecoder() = default;
+     virtual const char* name() const = 0;
+     // Cheap check of the file's signature, decode can still fail if it uses a feature the decoder doesn't handle
+     virtual bool canDecode(const unsigned char* data, size_t size) const = 0;
+     // Same output as stbi_load with 0 requested channels, rows top to bottom, except that grey + alpha (including grey with a
+     // transparent colour) comes out as RGBA since textures can't be made from 2 channels
+     virtual bool decode(const unsigned char* data, size_t size, ImageData& image) = 0;
+};
+
+// stb_image, handles every format we care about and is what everything else falls back on
+class StbImageDecoder : public ImageDecoder {
+public:
+     const char* name() const override { return "stb_image"; }
+     bool canDecode(const unsigned char* data, size_t size) const override;
+     bool decode(const unsigned char* data, size_t size, ImageData& image) override;
+};
+
+// Decoders get tried newest first, then the built in JPEG and PNG ones, then stb
+// Register everything at startup, decodeImage gets called from several threads and the list isn't locked
+void registerImageDecoder(std::unique_ptr<ImageDecoder> decoder);
+bool decodeImage(const unsigned char* data, size_t size, ImageData& image);
+
+// Times every decoder that can handle the file against stb and checks they agree, for `--benchmark-decode <image>`
+bool benchmarkImageDecoders(const std::string& path, int iterations);
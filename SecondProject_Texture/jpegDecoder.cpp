@@ -0,0 +1,677 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JPEG_USE_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+#include "jpegDecoder.h"
+#include "threadPool.h"
+
+namespace {
+
+// Where the nth coefficient in the file goes in the 8x8 block
+const int ZIGZAG[64] = {
+      0,  1,  8, 16,  9,  2,  3, 10,
+     17, 24, 32, 25, 18, 11,  4,  5,
+     12, 19, 26, 33, 40, 48, 41, 34,
+     27, 20, 13,  6,  7, 14, 21, 28,
+     35, 42, 49, 56, 57, 50, 43, 36,
+     29, 22, 15, 23, 30, 37, 44, 51,
+     58, 59, 52, 45, 38, 31, 39, 46,
+     53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// Codes up to 9 bits long are found with a single lookup, longer ones walk the canonical code lengths
+const int FAST_BITS = 9;
+
+struct HuffmanTable {
+     bool present = false;
+     uint8_t fastLength[1 << FAST_BITS]; // 0 means the code is longer than FAST_BITS
+     uint8_t fastSymbol[1 << FAST_BITS];
+     int maxCode[17]; // One past the last code of each length
+     int valueOffset[17]; // Added to a code of each length to get its index in symbols
+     uint8_t symbols[256];
+};
+
+struct Component {
+     int id = 0;
+     int h = 1;
+     int v = 1;
+     int quantTable = 0;
+     int dcTable = 0;
+     int acTable = 0;
+     int stride = 0; // Plane width, always a whole number of blocks
+     std::vector<uint8_t> plane;
+};
+
+struct Frame {
+     int width = 0;
+     int height = 0;
+     int componentCount = 0;
+     Component components[3];
+     int hMax = 1;
+     int vMax = 1;
+     int mcusX = 0;
+     int mcusY = 0;
+     int restartInterval = 0;
+     uint16_t quant[4][64] = {}; // Zigzag order, same as the file
+     float dequant[4][64]; // Built from quant once the headers are read, see buildDequantTable
+     HuffmanTable dc[4];
+     HuffmanTable ac[4];
+     const uint8_t* scanStart = nullptr;
+     const uint8_t* scanEnd = nullptr;
+};
+
+bool buildHuffmanTable(HuffmanTable& table, const uint8_t* counts, const uint8_t* symbols) {
+     int total = 0;
+     for (int i = 0; i < 16; i++) {
+          total += counts[i];
+     }
+     if (total > 256) {
+          return false;
+     }
+     memcpy(table.symbols, symbols, total);
+     memset(table.fastLength, 0, sizeof(table.fastLength));
+
+     int code = 0;
+     int index = 0;
+     for (int length = 1; length <= 16; length++) {
+          table.valueOffset[length] = index - code;
+          for (int i = 0; i < counts[length - 1]; i++, code++, index++) {
+               if (length <= FAST_BITS) {
+                    // Every FAST_BITS pattern starting with this code maps to it
+                    int first = code << (FAST_BITS - length);
+                    int fill = 1 << (FAST_BITS - length);
+                    for (int j = 0; j < fill; j++) {
+                         table.fastLength[first + j] = (uint8_t)length;
+                         table.fastSymbol[first + j] = table.symbols[index];
+                    }
+               }
+          }
+          table.maxCode[length] = code;
+          code <<= 1;
+     }
+     table.present = true;
+     return true;
+}
+
+// Reads the entropy coded data of one restart interval, which never contains markers so 0xFF is always followed by a stuffed 0x00
+struct BitReader {
+     const uint8_t* pos;
+     const uint8_t* end;
+     uint64_t bits = 0;
+     int count = 0;
+
+     BitReader(const uint8_t* start, const uint8_t* end) : pos(start), end(end) {}
+
+     void ensure(int needed) {
+          while (count < needed) {
+               uint64_t byte = 0; // Past the end it pads with zeros, a corrupt file just decodes garbage rather than reading out of bounds
+               if (pos < end) {
+                    byte = *pos++;
+                    if (byte == 0xFF && pos < end && *pos == 0x00) {
+                         pos++;
+                    }
+               }
+               bits |= byte << (56 - count);
+               count += 8;
+          }
+     }
+
+     unsigned int peek(int n) const {
+          return (unsigned int)(bits >> (64 - n));
+     }
+
+     void consume(int n) {
+          bits <<= n;
+          count -= n;
+     }
+
+     int decode(const HuffmanTable& table) {
+          ensure(16);
+          unsigned int look = peek(FAST_BITS);
+          int length = table.fastLength[look];
+          if (length) {
+               consume(length);
+               return table.fastSymbol[look];
+          }
+          for (length = FAST_BITS + 1; length <= 16; length++) {
+               int code = (int)peek(length);
+               if (code < table.maxCode[length]) {
+                    consume(length);
+                    return table.symbols[code + table.valueOffset[length]];
+               }
+          }
+          return -1;
+     }
+
+     // Reads an s bit value and sign extends it the JPEG way, where a leading 0 bit means negative
+     int receiveExtend(int s) {
+          if (s == 0) {
+               return 0;
+          }
+          ensure(s);
+          int value = (int)peek(s);
+          consume(s);
+          return value < (1 << (s - 1)) ? value - (1 << s) + 1 : value;
+     }
+};
+
+// Float AAN inverse DCT, the same butterfly as libjpeg's jidctflt.c
+// Its per coefficient scale factors (and the final 1/8) get folded into the dequantisation table so the butterfly itself is just adds and 5 multiplies
+const float AAN_SCALE[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f };
+
+// Dequantisation table in zigzag order, with the AAN scaling already applied
+void buildDequantTable(const uint16_t* quant, float* dequant) {
+     for (int k = 0; k < 64; k++) {
+          int natural = ZIGZAG[k];
+          dequant[k] = quant[k] * AAN_SCALE[natural / 8] * AAN_SCALE[natural % 8] * 0.125f;
+     }
+}
+
+// One 8 point pass, T is float for the scalar path or a vector of 4 floats for the SSE2 one
+template <typename T, typename Multiply>
+void aanButterfly(T* v, Multiply multiply) {
+     // Even part
+     T tmp10 = v[0] + v[4];
+     T tmp11 = v[0] - v[4];
+     T tmp13 = v[2] + v[6];
+     T tmp12 = multiply(v[2] - v[6], 1.414213562f) - tmp13;
+     T tmp0 = tmp10 + tmp13;
+     T tmp3 = tmp10 - tmp13;
+     T tmp1 = tmp11 + tmp12;
+     T tmp2 = tmp11 - tmp12;
+
+     // Odd part
+     T z13 = v[5] + v[3];
+     T z10 = v[5] - v[3];
+     T z11 = v[1] + v[7];
+     T z12 = v[1] - v[7];
+     T tmp7 = z11 + z13;
+     tmp11 = multiply(z11 - z13, 1.414213562f);
+     T z5 = multiply(z10 + z12, 1.847759065f);
+     tmp10 = z5 - multiply(z12, 1.082392200f);
+     tmp12 = z5 - multiply(z10, 2.613125930f);
+     T tmp6 = tmp12 - tmp7;
+     T tmp5 = tmp11 - tmp6;
+     T tmp4 = tmp10 - tmp5;
+
+     v[0] = tmp0 + tmp7;
+     v[7] = tmp0 - tmp7;
+     v[1] = tmp1 + tmp6;
+     v[6] = tmp1 - tmp6;
+     v[2] = tmp2 + tmp5;
+     v[5] = tmp2 - tmp5;
+     v[3] = tmp3 + tmp4;
+     v[4] = tmp3 - tmp4;
+}
+
+#ifdef JPEG_USE_SSE2
+// Just enough operators for aanButterfly to work on 4 columns at once
+struct Vec4 {
+     __m128 value;
+};
+inline Vec4 operator+(Vec4 a, Vec4 b) { return { _mm_add_ps(a.value, b.value) }; }
+inline Vec4 operator-(Vec4 a, Vec4 b) { return { _mm_sub_ps(a.value, b.value) }; }
+
+// Transposes the 8x8 block held as 8 rows of two halves
+void transpose8x8(Vec4 rows[8][2]) {
+     for (int half = 0; half < 2; half++) {
+          _MM_TRANSPOSE4_PS(rows[half * 4 + 0][0].value, rows[half * 4 + 1][0].value, rows[half * 4 + 2][0].value, rows[half * 4 + 3][0].value);
+          _MM_TRANSPOSE4_PS(rows[half * 4 + 0][1].value, rows[half * 4 + 1][1].value, rows[half * 4 + 2][1].value, rows[half * 4 + 3][1].value);
+     }
+     // The off diagonal 4x4 blocks swap places
+     for (int i = 0; i < 4; i++) {
+          std::swap(rows[i][1], rows[i + 4][0]);
+     }
+}
+#endif
+
+// Turns dequantised coefficients (natural order) into pixels, columns first then rows
+void inverseDct(const float* coefficients, uint8_t* out, int stride) {
+#ifdef JPEG_USE_SSE2
+     auto multiply = [](Vec4 a, float b) { return Vec4{ _mm_mul_ps(a.value, _mm_set1_ps(b)) }; };
+
+     // Each vector holds 4 columns of one row, so one butterfly does 4 columns at once
+     Vec4 rows[8][2];
+     for (int half = 0; half < 2; half++) {
+          Vec4 column[8];
+          for (int v = 0; v < 8; v++) {
+               column[v].value = _mm_loadu_ps(coefficients + v * 8 + half * 4);
+          }
+          aanButterfly(column, multiply);
+          for (int y = 0; y < 8; y++) {
+               rows[y][half] = column[y];
+          }
+     }
+
+     // Flip it over so the same trick works along the rows
+     transpose8x8(rows);
+     for (int half = 0; half < 2; half++) {
+          Vec4 row[8];
+          for (int x = 0; x < 8; x++) {
+               row[x] = rows[x][half];
+          }
+          aanButterfly(row, multiply);
+          for (int x = 0; x < 8; x++) {
+               rows[x][half] = row[x];
+          }
+     }
+     transpose8x8(rows);
+
+     const __m128 bias = _mm_set1_ps(128.0f);
+     for (int y = 0; y < 8; y++) {
+          // Round, then saturate down to 16 and then 8 bits which also does the 0-255 clamp
+          __m128i words = _mm_packs_epi32(_mm_cvtps_epi32(_mm_add_ps(rows[y][0].value, bias)), _mm_cvtps_epi32(_mm_add_ps(rows[y][1].value, bias)));
+          _mm_storel_epi64((__m128i*)(out + y * stride), _mm_packus_epi16(words, words));
+     }
+#else
+     auto multiply = [](float a, float b) { return a * b; };
+     float block[64];
+     for (int x = 0; x < 8; x++) {
+          float column[8];
+          for (int v = 0; v < 8; v++) {
+               column[v] = coefficients[v * 8 + x];
+          }
+          aanButterfly(column, multiply);
+          for (int y = 0; y < 8; y++) {
+               block[y * 8 + x] = column[y];
+          }
+     }
+     for (int y = 0; y < 8; y++) {
+          aanButterfly(block + y * 8, multiply);
+          for (int x = 0; x < 8; x++) {
+               int value = (int)std::lround(block[y * 8 + x] + 128.0f);
+               out[y * stride + x] = (uint8_t)std::min(255, std::max(0, value));
+          }
+     }
+#endif
+}
+
+// Blocks with nothing but a DC term are flat, which is common enough in smooth areas to be worth skipping the IDCT for
+void fillFlatBlock(float dc, uint8_t* out, int stride) {
+     int value = (int)std::lround(dc + 128.0f);
+     uint8_t pixel = (uint8_t)std::min(255, std::max(0, value));
+     for (int y = 0; y < 8; y++) {
+          memset(out + y * stride, pixel, 8);
+     }
+}
+
+// Returns false on corrupt data, flat is set when every AC coefficient is zero
+bool decodeBlock(BitReader& reader, const HuffmanTable& dc, const HuffmanTable& ac, const float* dequant, int& dcPrediction, float* coefficients, bool& flat) {
+     memset(coefficients, 0, 64 * sizeof(float));
+
+     int t = reader.decode(dc);
+     if (t < 0) {
+          return false;
+     }
+     dcPrediction += reader.receiveExtend(t);
+     coefficients[0] = dcPrediction * dequant[0];
+     flat = true;
+
+     for (int k = 1; k < 64;) {
+          int rs = reader.decode(ac);
+          if (rs < 0) {
+               return false;
+          }
+          int run = rs >> 4;
+          int size = rs & 15;
+          if (size == 0) {
+               if (run != 15) {
+                    break; // End of block
+               }
+               k += 16;
+               continue;
+          }
+          k += run;
+          if (k > 63) {
+               return false;
+          }
+          coefficients[ZIGZAG[k]] = reader.receiveExtend(size) * dequant[k];
+          flat = false;
+          k++;
+     }
+     return true;
+}
+
+// Decodes MCUs [first, last) from one restart interval straight into the component planes
+bool decodeInterval(Frame& frame, const uint8_t* start, const uint8_t* end, int first, int last) {
+     BitReader reader(start, end);
+     int dcPrediction[3] = { 0, 0, 0 };
+     alignas(16) float coefficients[64];
+
+     for (int mcu = first; mcu < last; mcu++) {
+          int mcuX = mcu % frame.mcusX;
+          int mcuY = mcu / frame.mcusX;
+          for (int c = 0; c < frame.componentCount; c++) {
+               Component& component = frame.components[c];
+               for (int by = 0; by < component.v; by++) {
+                    for (int bx = 0; bx < component.h; bx++) {
+                         bool flat;
+                         if (!decodeBlock(reader, frame.dc[component.dcTable], frame.ac[component.acTable], frame.dequant[component.quantTable], dcPrediction[c], coefficients, flat)) {
+                              return false;
+                         }
+                         int x = (mcuX * component.h + bx) * 8;
+                         int y = (mcuY * component.v + by) * 8;
+                         uint8_t* out = component.plane.data() + (size_t)y * component.stride + x;
+                         if (flat) {
+                              fillFlatBlock(coefficients[0], out, component.stride);
+                         }
+                         else {
+                              inverseDct(coefficients, out, component.stride);
+                         }
+                    }
+               }
+          }
+     }
+     return true;
+}
+
+// Converts one row of full resolution Y, Cb and Cr into interleaved RGB
+void convertRow(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out, int width) {
+     int x = 0;
+#ifdef JPEG_USE_SSE2
+     const __m128 half = _mm_set1_ps(128.0f);
+     const __m128 crToR = _mm_set1_ps(1.402f);
+     const __m128 cbToG = _mm_set1_ps(-0.344136f);
+     const __m128 crToG = _mm_set1_ps(-0.714136f);
+     const __m128 cbToB = _mm_set1_ps(1.772f);
+     const __m128i zero = _mm_setzero_si128();
+     // 4 pixels at a time, widened from bytes to floats
+     auto load4 = [&](const uint8_t* p) {
+          int packed;
+          memcpy(&packed, p, 4);
+          __m128i bytes = _mm_cvtsi32_si128(packed);
+          return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+     };
+     for (; x + 4 <= width; x += 4) {
+          __m128 luma = load4(y + x);
+          __m128 blue = _mm_sub_ps(load4(cb + x), half);
+          __m128 red = _mm_sub_ps(load4(cr + x), half);
+          __m128i r = _mm_cvtps_epi32(_mm_add_ps(luma, _mm_mul_ps(crToR, red)));
+          __m128i g = _mm_cvtps_epi32(_mm_add_ps(luma, _mm_add_ps(_mm_mul_ps(cbToG, blue), _mm_mul_ps(crToG, red))));
+          __m128i b = _mm_cvtps_epi32(_mm_add_ps(luma, _mm_mul_ps(cbToB, blue)));
+          // Saturating packs clamp to 0-255, leaving r0-r3 g0-g3 b0-b3 in the low 12 bytes
+          alignas(16) uint8_t packed[16];
+          _mm_store_si128((__m128i*)packed, _mm_packus_epi16(_mm_packs_epi32(r, g), _mm_packs_epi32(b, zero)));
+          for (int i = 0; i < 4; i++) {
+               out[(x + i) * 3 + 0] = packed[i];
+               out[(x + i) * 3 + 1] = packed[4 + i];
+               out[(x + i) * 3 + 2] = packed[8 + i];
+          }
+     }
+#endif
+     for (; x < width; x++) {
+          float luma = y[x];
+          float blue = cb[x] - 128.0f;
+          float red = cr[x] - 128.0f;
+          float rgb[3] = { luma + 1.402f * red, luma - 0.344136f * blue - 0.714136f * red, luma + 1.772f * blue };
+          for (int i = 0; i < 3; i++) {
+               out[x * 3 + i] = (uint8_t)std::min(255, std::max(0, (int)std::lround(rgb[i])));
+          }
+     }
+}
+
+int readWord(const uint8_t* p) {
+     return (p[0] << 8) | p[1];
+}
+
+// Reads every marker segment up to the start of scan, false for anything this decoder doesn't handle
+bool parseHeaders(const uint8_t* data, size_t size, Frame& frame) {
+     const uint8_t* p = data + 2;
+     const uint8_t* end = data + size;
+     bool haveFrame = false;
+
+     while (p + 4 <= end) {
+          if (p[0] != 0xFF) {
+               return false;
+          }
+          int marker = p[1];
+          p += 2;
+          if (marker == 0xFF) {
+               p--; // Fill byte, the marker is the next one along
+               continue;
+          }
+          if (marker == 0xD9) {
+               return false; // End of image before any scan
+          }
+
+          int length = readWord(p);
+          const uint8_t* segment = p + 2;
+          const uint8_t* segmentEnd = p + length;
+          if (length < 2 || segmentEnd > end) {
+               return false;
+          }
+
+          switch (marker) {
+          case 0xDB: // Quantisation tables
+               while (segment < segmentEnd) {
+                    int precision = segment[0] >> 4;
+                    int id = segment[0] & 15;
+                    segment++;
+                    if (id > 3 || segment + (precision ? 128 : 64) > segmentEnd) {
+                         return false;
+                    }
+                    for (int k = 0; k < 64; k++) {
+                         frame.quant[id][k] = precision ? (uint16_t)readWord(segment + k * 2) : segment[k];
+                    }
+                    segment += precision ? 128 : 64;
+               }
+               break;
+
+          case 0xC0: // Baseline
+          case 0xC1: // Extended sequential, same thing as long as it's 8 bit with Huffman coding
+          {
+               if (length < 8 || segment[0] != 8) {
+                    return false;
+               }
+               frame.height = readWord(segment + 1);
+               frame.width = readWord(segment + 3);
+               frame.componentCount = segment[5];
+               if (frame.width == 0 || frame.height == 0 || (frame.componentCount != 1 && frame.componentCount != 3) || length < 8 + frame.componentCount * 3) {
+                    return false;
+               }
+               for (int c = 0; c < frame.componentCount; c++) {
+                    const uint8_t* info = segment + 6 + c * 3;
+                    Component& component = frame.components[c];
+                    component.id = info[0];
+                    component.h = info[1] >> 4;
+                    component.v = info[1] & 15;
+                    component.quantTable = info[2] & 3;
+                    if (component.h < 1 || component.h > 2 || component.v < 1 || component.v > 2) {
+                         return false;
+                    }
+               }
+               // A single component scan isn't interleaved, each MCU is one block whatever the sampling factors say
+               if (frame.componentCount == 1) {
+                    frame.components[0].h = 1;
+                    frame.components[0].v = 1;
+               }
+               haveFrame = true;
+               break;
+          }
+
+          case 0xC4: // Huffman tables
+               while (segment + 17 <= segmentEnd) {
+                    int tableClass = segment[0] >> 4;
+                    int id = segment[0] & 15;
+                    const uint8_t* counts = segment + 1;
+                    int total = 0;
+                    for (int i = 0; i < 16; i++) {
+                         total += counts[i];
+                    }
+                    if (tableClass > 1 || id > 3 || segment + 17 + total > segmentEnd) {
+                         return false;
+                    }
+                    if (!buildHuffmanTable(tableClass == 0 ? frame.dc[id] : frame.ac[id], counts, segment + 17)) {
+                         return false;
+                    }
+                    segment += 17 + total;
+               }
+               break;
+
+          case 0xDD: // Restart interval
+               if (length < 4) {
+                    return false;
+               }
+               frame.restartInterval = readWord(segment);
+               break;
+
+          case 0xDA: // Start of scan
+          {
+               int count = segment[0];
+               // Only a single scan with every component interleaved, which is what baseline files almost always are
+               if (!haveFrame || count != frame.componentCount || length < 6 + count * 2) {
+                    return false;
+               }
+               for (int i = 0; i < count; i++) {
+                    int id = segment[1 + i * 2];
+                    int tables = segment[2 + i * 2];
+                    Component* component = nullptr;
+                    for (int c = 0; c < frame.componentCount; c++) {
+                         if (frame.components[c].id == id) {
+                              component = &frame.components[c];
+                         }
+                    }
+                    if (!component || (tables >> 4) > 3 || (tables & 15) > 3) {
+                         return false;
+                    }
+                    component->dcTable = tables >> 4;
+                    component->acTable = tables & 15;
+                    if (!frame.dc[component->dcTable].present || !frame.ac[component->acTable].present) {
+                         return false;
+                    }
+               }
+
+               // The scan runs until the first marker that isn't a restart
+               frame.scanStart = segmentEnd;
+               const uint8_t* scan = segmentEnd;
+               while (scan + 1 < end && !(scan[0] == 0xFF && scan[1] != 0x00 && (scan[1] < 0xD0 || scan[1] > 0xD7))) {
+                    scan++;
+               }
+               frame.scanEnd = scan;
+               return true;
+          }
+
+          default:
+               // Progressive, lossless, hierarchical and arithmetic coded frames
+               if (marker >= 0xC2 && marker <= 0xCF) {
+                    return false;
+               }
+               break; // APPn, comments etc.
+          }
+          p = segmentEnd;
+     }
+     return false;
+}
+
+}
+
+bool JpegDecoder::canDecode(const unsigned char* data, size_t size) const {
+     return size > 4 && data[0] == 0xFF && data[1] == 0xD8;
+}
+
+bool JpegDecoder::decode(const unsigned char* data, size_t size, ImageData& image) {
+     Frame frame;
+     if (!parseHeaders(data, size, frame)) {
+          return false;
+     }
+
+     for (int t = 0; t < 4; t++) {
+          buildDequantTable(frame.quant[t], frame.dequant[t]);
+     }
+     for (int c = 0; c < frame.componentCount; c++) {
+          frame.hMax = std::max(frame.hMax, frame.components[c].h);
+          frame.vMax = std::max(frame.vMax, frame.components[c].v);
+     }
+     frame.mcusX = (frame.width + frame.hMax * 8 - 1) / (frame.hMax * 8);
+     frame.mcusY = (frame.height + frame.vMax * 8 - 1) / (frame.vMax * 8);
+     for (int c = 0; c < frame.componentCount; c++) {
+          Component& component = frame.components[c];
+          component.stride = frame.mcusX * component.h * 8;
+          component.plane.resize((size_t)component.stride * frame.mcusY * component.v * 8);
+     }
+
+     // Split the scan at its restart markers, each piece can be decoded on its own
+     std::vector<const uint8_t*> starts;
+     std::vector<const uint8_t*> ends;
+     starts.push_back(frame.scanStart);
+     for (const uint8_t* p = frame.scanStart; p + 1 < frame.scanEnd; p++) {
+          if (p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7) {
+               ends.push_back(p);
+               starts.push_back(p + 2);
+               p++;
+          }
+     }
+     ends.push_back(frame.scanEnd);
+
+     int totalMcus = frame.mcusX * frame.mcusY;
+     int interval = frame.restartInterval > 0 ? frame.restartInterval : totalMcus;
+     size_t expectedIntervals = (size_t)((totalMcus + interval - 1) / interval);
+     if (starts.size() != expectedIntervals) {
+          return false; // Missing or extra restart markers, let stb deal with it
+     }
+
+     std::atomic<bool> failed{ false };
+     ThreadPool::shared().parallelFor(starts.size(), 1, [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) {
+               int first = (int)i * interval;
+               int last = std::min(totalMcus, first + interval);
+               if (!decodeInterval(frame, starts[i], ends[i], first, last)) {
+                    failed = true;
+               }
+          }
+     });
+     if (failed) {
+          return false;
+     }
+
+     int channels = frame.componentCount;
+     unsigned char* pixels = (unsigned char*)malloc((size_t)frame.width * frame.height * channels);
+     if (!pixels) {
+          return false;
+     }
+
+     ThreadPool::shared().parallelFor(frame.height, 16, [&](size_t begin, size_t end) {
+          // Chroma rows get stretched out to full width here, nearest neighbour rather than stb's smoother filter
+          std::vector<uint8_t> upsampled[3];
+          for (size_t row = begin; row < end; row++) {
+               const uint8_t* rows[3];
+               for (int c = 0; c < channels; c++) {
+                    const Component& component = frame.components[c];
+                    const uint8_t* source = component.plane.data() + (row * component.v / frame.vMax) * component.stride;
+                    if (component.h == frame.hMax) {
+                         rows[c] = source;
+                         continue;
+                    }
+                    upsampled[c].resize(frame.width);
+                    for (int x = 0; x < frame.width; x++) {
+                         upsampled[c][x] = source[x * component.h / frame.hMax];
+                    }
+                    rows[c] = upsampled[c].data();
+               }
+
+               unsigned char* out = pixels + row * frame.width * channels;
+               if (channels == 1) {
+                    memcpy(out, rows[0], frame.width);
+               }
+               else {
+                    convertRow(rows[0], rows[1], rows[2], out, frame.width);
+               }
+          }
+     });
+
+     image.width = frame.width;
+     image.height = frame.height;
+     image.channels = channels;
+     image.pixels = pixels;
+     return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "imageDecoder.h"
+
+// Baseline JPEG decoder, 8 bit greyscale or YCbCr with any mix of 1x/2x subsampling
+// Restart intervals are decoded in parallel since each one starts from a clean state, then the SIMD colour conversion is split over rows
+// Progressive, arithmetic coded and CMYK files fail so they fall through to stb
+class JpegDecoder : public ImageDecoder {
+public:
+     const char* name() const override { return "jpeg (parallel SIMD)"; }
+     bool canDecode(const unsigned char* data, size_t size) const override;
+     bool decode(const unsigned char* data, size_t size, ImageData& image) override;
+};
@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "meshLod.h"
+
+// Sum of squared distances to a set of planes, as a symmetric 4x4 matrix
+struct Quadric {
+     double a00, a01, a02, a11, a12, a22;
+     double b0, b1, b2;
+     double c;
+};
+
+// What a vertex is allowed to do, decided once from the starting mesh
+enum VertexKind : uint8_t {
+     VERTEX_MANIFOLD, // Surrounded by triangles that all use it, can collapse onto any neighbour
+     VERTEX_BORDER, // On an open edge of the mesh, can only slide along that edge
+     VERTEX_SEAM, // Two vertices at one position (a uv seam), both slide along the seam together
+     VERTEX_LOCKED // Anything more complicated, never moves
+};
+
+// Triangles around each position, rebuilt every pass from the current index list
+struct Adjacency {
+     std::vector<unsigned int> offsets;
+     std::vector<unsigned int> triangles;
+};
+
+struct Collapse {
+     unsigned int from;
+     unsigned int to;
+     double error;
+};
+
+// normal has to be unit length, the plane is dot(normal, p) + distance = 0
+static void addPlane(Quadric& quadric, const glm::vec3& normal, float distance) {
+     quadric.a00 += normal.x * normal.x;
+     quadric.a01 += normal.x * normal.y;
+     quadric.a02 += normal.x * normal.z;
+     quadric.a11 += normal.y * normal.y;
+     quadric.a12 += normal.y * normal.z;
+     quadric.a22 += normal.z * normal.z;
+     quadric.b0 += normal.x * distance;
+     quadric.b1 += normal.y * distance;
+     quadric.b2 += normal.z * distance;
+     quadric.c += distance * distance;
+}
+
+static void addQuadric(Quadric& quadric, const Quadric& other) {
+     quadric.a00 += other.a00;
+     quadric.a01 += other.a01;
+     quadric.a02 += other.a02;
+     quadric.a11 += other.a11;
+     quadric.a12 += other.a12;
+     quadric.a22 += other.a22;
+     quadric.b0 += other.b0;
+     quadric.b1 += other.b1;
+     quadric.b2 += other.b2;
+     quadric.c += other.c;
+}
+
+static double quadricError(const Quadric& a, const Quadric& b, const glm::vec3& p) {
+     Quadric q = a;
+     addQuadric(q, b);
+     double x = p.x, y = p.y, z = p.z;
+     double error = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+          + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+     return std::max(error, 0.0); // Rounding can take it just under
+}
+
+static void buildAdjacency(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& remap, Adjacency& adjacency) {
+     adjacency.offsets.assign(remap.size() + 1, 0);
+     for (unsigned int index : indices) {
+          adjacency.offsets[remap[index] + 1]++;
+     }
+     for (size_t i = 1; i < adjacency.offsets.size(); i++) {
+          adjacency.offsets[i] += adjacency.offsets[i - 1];
+     }
+     adjacency.triangles.resize(indices.size());
+     std::vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+     for (size_t i = 0; i < indices.size(); i++) {
+          adjacency.triangles[fill[remap[indices[i]]]++] = (unsigned int)(i / 3);
+     }
+}
+
+// Whether some triangle has the directed edge a -> b, by vertex or, with byPosition, by where the vertices are
+static bool hasEdge(const Adjacency& adjacency, const std::vector<unsigned int>& indices, const std::vector<unsigned int>& remap,
+     unsigned int a, unsigned int b, bool byPosition) {
+     unsigned int position = remap[a];
+     for (unsigned int k = adjacency.offsets[position]; k < adjacency.offsets[position + 1]; k++) {
+          const unsigned int* triangle = &indices[(size_t)adjacency.triangles[k] * 3];
+          for (int e = 0; e < 3; e++) {
+               unsigned int from = triangle[e], to = triangle[(e + 1) % 3];
+               if (byPosition ? (remap[from] == remap[a] && remap[to] == remap[b]) : (from == a && to == b)) {
+                    return true;
+               }
+          }
+     }
+     return false;
+}
+
+static glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+     return glm::cross(b - a, c - a);
+}
+
+float simplifyMesh(const float* vertices, int floatsPerVertex, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+     size_t targetIndexCount, float maxError, std::vector<unsigned int>& result) {
+     result.assign(indices, indices + indexCount - indexCount % 3);
+     if (vertexCount == 0 || result.size() <= targetIndexCount) {
+          return 0.0f;
+     }
+
+     std::vector<glm::vec3> positions(vertexCount);
+     for (size_t i = 0; i < vertexCount; i++) {
+          const float* vertex = vertices + i * floatsPerVertex;
+          positions[i] = glm::vec3(vertex[0], vertex[1], vertex[2]);
+     }
+
+     // Vertices at exactly the same position get welded, remap points each at the first one and wedge links them in a ring
+     std::vector<unsigned int> order(vertexCount);
+     for (size_t i = 0; i < vertexCount; i++) {
+          order[i] = (unsigned int)i;
+     }
+     std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+          const glm::vec3& pa = positions[a];
+          const glm::vec3& pb = positions[b];
+          if (pa.x != pb.x) {
+               return pa.x < pb.x;
+          }
+          if (pa.y != pb.y) {
+               return pa.y < pb.y;
+          }
+          if (pa.z != pb.z) {
+               return pa.z < pb.z;
+          }
+          return a < b;
+     });
+     std::vector<unsigned int> remap(vertexCount), wedge(vertexCount);
+     for (size_t start = 0; start < vertexCount;) {
+          size_t end = start + 1;
+          while (end < vertexCount && positions[order[end]] == positions[order[start]]) {
+               end++;
+          }
+          for (size_t i = start; i < end; i++) {
+               remap[order[i]] = order[start];
+               wedge[order[i]] = order[i + 1 < end ? i + 1 : start];
+          }
+          start = end;
+     }
+
+     Adjacency adjacency;
+     buildAdjacency(result, remap, adjacency);
+
+     // Open edges by vertex are borders and seams, open edges by position are only the borders
+     std::vector<uint8_t> openOut(vertexCount, 0), openIn(vertexCount, 0), positionOpen(vertexCount, 0);
+     std::vector<Quadric> quadrics(vertexCount, Quadric{});
+     for (size_t t = 0; t < result.size(); t += 3) {
+          const unsigned int* triangle = &result[t];
+          glm::vec3 normal = triangleNormal(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]);
+          float area = glm::length(normal);
+          if (area <= 0.0f) {
+               continue;
+          }
+          normal = normal / area;
+          for (int e = 0; e < 3; e++) {
+               addPlane(quadrics[remap[triangle[e]]], normal, -glm::dot(normal, positions[triangle[0]]));
+          }
+          for (int e = 0; e < 3; e++) {
+               unsigned int a = triangle[e], b = triangle[(e + 1) % 3];
+               if (!hasEdge(adjacency, result, remap, b, a, true)) {
+                    positionOpen[remap[a]] = positionOpen[remap[b]] = 1;
+               }
+               if (hasEdge(adjacency, result, remap, b, a, false)) {
+                    continue;
+               }
+               openOut[a]++;
+               openIn[b]++;
+               // A plane standing up along the open edge, so moving off the border or seam costs something
+               glm::vec3 edge = positions[b] - positions[a];
+               if (glm::length(edge) > 0.0f) {
+                    glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+                    float distance = -glm::dot(edgeNormal, positions[a]);
+                    addPlane(quadrics[remap[a]], edgeNormal, distance);
+                    addPlane(quadrics[remap[b]], edgeNormal, distance);
+               }
+          }
+     }
+
+     std::vector<uint8_t> kinds(vertexCount, VERTEX_LOCKED);
+     for (size_t i = 0; i < vertexCount; i++) {
+          unsigned int twin = wedge[i];
+          bool simpleOpen = openOut[i] == 1 && openIn[i] == 1;
+          if (twin == i) {
+               if (!positionOpen[remap[i]] && openOut[i] == 0 && openIn[i] == 0) {
+                    kinds[i] = VERTEX_MANIFOLD;
+               }
+               else if (positionOpen[remap[i]] && simpleOpen) {
+                    kinds[i] = VERTEX_BORDER;
+               }
+          }
+          else if (wedge[twin] == i && !positionOpen[remap[i]] && simpleOpen && openOut[twin] == 1 && openIn[twin] == 1) {
+               kinds[i] = VERTEX_SEAM;
+          }
+     }
+
+     std::vector<unsigned int> collapseTo(vertexCount);
+     std::vector<uint8_t> touched(vertexCount);
+     std::vector<Collapse> candidates;
+     double maxErrorSquared = (double)maxError * maxError;
+     double reached = 0.0;
+     size_t targetTriangles = targetIndexCount / 3;
+     while (result.size() / 3 > targetTriangles) {
+          buildAdjacency(result, remap, adjacency);
+
+          // Both directions of every edge, each costed by where the surviving vertex already is
+          candidates.clear();
+          for (size_t t = 0; t < result.size(); t += 3) {
+               for (int e = 0; e < 3; e++) {
+                    unsigned int ends[2] = { result[t + e], result[t + (e + 1) % 3] };
+                    for (int direction = 0; direction < 2; direction++) {
+                         unsigned int from = ends[direction], to = ends[1 - direction];
+                         uint8_t fromKind = kinds[from], toKind = kinds[to];
+                         bool allowed = fromKind == VERTEX_MANIFOLD
+                              || (fromKind == VERTEX_BORDER && (toKind == VERTEX_BORDER || toKind == VERTEX_LOCKED))
+                              || (fromKind == VERTEX_SEAM && (toKind == VERTEX_SEAM || toKind == VERTEX_LOCKED));
+                         if (allowed) {
+                              candidates.push_back({ from, to, quadricError(quadrics[remap[from]], quadrics[remap[to]], positions[to]) });
+                         }
+                    }
+               }
+          }
+          std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) {
+               return a.error < b.error;
+          });
+
+          if (candidates.empty()) {
+               break;
+          }
+
+          // Collapses in one pass can't share any triangles, so each one can be checked against the mesh as it was at the start
+          // That locks out most of the cheap ones, so the pass stops at about the cost of the collapses it needs rather than
+          // spending what's left on expensive ones when the cheap ones would still be there next pass
+          // Every edge shows up about four times, once each way from both of its triangles, and most collapses take two triangles
+          size_t triangles = result.size() / 3;
+          size_t wanted = (triangles - targetTriangles) / 2 * 4;
+          double passLimit = std::min(candidates[std::min(wanted, candidates.size() - 1)].error * 1.5, maxErrorSquared);
+          for (size_t i = 0; i < vertexCount; i++) {
+               collapseTo[i] = (unsigned int)i;
+          }
+          std::fill(touched.begin(), touched.end(), 0);
+          size_t removed = 0;
+          bool collapsed = false;
+          for (const Collapse& candidate : candidates) {
+               if (candidate.error > passLimit || triangles - removed <= targetTriangles) {
+                    break;
+               }
+               unsigned int from = candidate.from, to = candidate.to;
+               unsigned int fromPosition = remap[from], toPosition = remap[to];
+               if (touched[fromPosition] || touched[toPosition]) {
+                    continue;
+               }
+
+               // Borders and seams only slide along themselves, and a seam takes the vertex on its other side along too
+               unsigned int twinFrom = from, twinTo = to;
+               if (kinds[from] == VERTEX_BORDER) {
+                    if (hasEdge(adjacency, result, remap, from, to, true) == hasEdge(adjacency, result, remap, to, from, true)) {
+                         continue;
+                    }
+               }
+               else if (kinds[from] == VERTEX_SEAM) {
+                    if (hasEdge(adjacency, result, remap, from, to, false) == hasEdge(adjacency, result, remap, to, from, false)) {
+                         continue;
+                    }
+                    twinFrom = wedge[from];
+                    twinTo = from;
+                    for (unsigned int w = wedge[to]; w != to; w = wedge[w]) {
+                         if (hasEdge(adjacency, result, remap, twinFrom, w, false) || hasEdge(adjacency, result, remap, w, twinFrom, false)) {
+                              twinTo = w;
+                              break;
+                         }
+                    }
+                    if (twinTo == from) {
+                         continue;
+                    }
+               }
+
+               // Moving the vertex mustn't turn any of its triangles over, the ones along the edge just disappear
+               size_t disappearing = 0;
+               bool flips = false;
+               for (unsigned int k = adjacency.offsets[fromPosition]; k < adjacency.offsets[fromPosition + 1] && !flips; k++) {
+                    const unsigned int* triangle = &result[(size_t)adjacency.triangles[k] * 3];
+                    glm::vec3 before[3], after[3];
+                    bool alongEdge = false;
+                    for (int e = 0; e < 3; e++) {
+                         before[e] = after[e] = positions[triangle[e]];
+                         if (remap[triangle[e]] == fromPosition) {
+                              after[e] = positions[to];
+                         }
+                         alongEdge |= remap[triangle[e]] == toPosition;
+                    }
+                    if (alongEdge) {
+                         disappearing++;
+                         continue;
+                    }
+                    glm::vec3 normalBefore = triangleNormal(before[0], before[1], before[2]);
+                    glm::vec3 normalAfter = triangleNormal(after[0], after[1], after[2]);
+                    flips = glm::dot(normalBefore, normalAfter) <= 1e-2f * glm::length(normalBefore) * glm::length(normalAfter);
+               }
+               if (flips) {
+                    continue;
+               }
+
+               collapseTo[from] = to;
+               collapseTo[twinFrom] = twinTo;
+               addQuadric(quadrics[toPosition], quadrics[fromPosition]);
+               for (unsigned int k = adjacency.offsets[fromPosition]; k < adjacency.offsets[fromPosition + 1]; k++) {
+                    const unsigned int* triangle = &result[(size_t)adjacency.triangles[k] * 3];
+                    touched[remap[triangle[0]]] = touched[remap[triangle[1]]] = touched[remap[triangle[2]]] = 1;
+               }
+               removed += disappearing;
+               reached = std::max(reached, candidate.error);
+               collapsed = true;
+          }
+          if (!collapsed) {
+               break;
+          }
+
+          // Point everything at where it collapsed to and drop the triangles that got squashed flat
+          size_t kept = 0;
+          for (size_t t = 0; t < result.size(); t += 3) {
+               unsigned int a = collapseTo[result[t]], b = collapseTo[result[t + 1]], c = collapseTo[result[t + 2]];
+               if (remap[a] != remap[b] && remap[b] != remap[c] && remap[a] != remap[c]) {
+                    result[kept++] = a;
+                    result[kept++] = b;
+                    result[kept++] = c;
+               }
+          }
+          result.resize(kept);
+     }
+     return (float)std::sqrt(reached);
+}
+
+void MeshLodChain::build(const float* vertices, int floatsPerVertex, size_t vertexCount, const unsigned int* sourceIndices, size_t indexCount,
+     float reduction, float maxError) {
+     auto start = std::chrono::steady_clock::now();
+     indexCount -= indexCount % 3;
+     indices.assign(sourceIndices, sourceIndices + indexCount);
+     levels.clear();
+     levels.push_back({ 0, (int)indexCount, 0.0f });
+
+     std::vector<unsigned int> simplified;
+     size_t target = indexCount;
+     while ((int)levels.size() < MAX_LEVELS) {
+          target = (size_t)(target * reduction) / 3 * 3;
+          if (target < 3) {
+               break;
+          }
+          // Always from full detail, simplifying the last level would pile each level's error on top of the one before
+          float error = simplifyMesh(vertices, floatsPerVertex, vertexCount, sourceIndices, indexCount, target, maxError, simplified);
+          const MeshLodLevel previous = levels.back();
+          if (simplified.empty() || simplified.size() > previous.indexCount * 0.9) {
+               break; // Hit maxError or the locked vertices, another level wouldn't save anything
+          }
+          levels.push_back({ (int)indices.size(), (int)simplified.size(), std::max(error, previous.error) });
+          indices.insert(indices.end(), simplified.begin(), simplified.end());
+          target = simplified.size();
+     }
+     buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int selectLodLevel(const MeshLodLevel* levels, int levelCount, int current, float pixelsPerUnit, float maxPixelError, float hysteresis) {
+     if (levelCount <= 0) {
+          return 0;
+     }
+     int level = std::min(std::max(current, 0), levelCount - 1);
+     while (level > 0 && levels[level].error * pixelsPerUnit > maxPixelError) {
+          level--;
+     }
+     while (level + 1 < levelCount && levels[level + 1].error * pixelsPerUnit <= maxPixelError * (1.0f - hysteresis)) {
+          level++;
+     }
+     return level;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// One detail level, a range of the chain's index array
+struct MeshLodLevel {
+     int firstIndex;
+     int indexCount;
+     float error; // Roughly how far the surface moved from full detail, in mesh units
+};
+
+// Simplifies a triangle mesh by collapsing edges in order of quadric error (Garland & Heckbert) until it's down to
+// targetIndexCount indices or the next collapse would move the surface more than maxError
+// Only the index list changes, every collapse moves a vertex onto one of its neighbours, so the result still indexes the
+// original vertices and can share their buffer
+// Vertices at the same position with different attributes (uv seams, hard edges) only collapse along the seam and take their
+// twin on the other side with them, so the mesh never tears open, and corners where more than two meet never move
+// Returns the error reached, in the same units as the positions
+float simplifyMesh(const float* vertices, int floatsPerVertex, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+     size_t targetIndexCount, float maxError, std::vector<unsigned int>& result);
+
+// Full detail plus a level for each time the mesh can be cut down by reduction, all in one index array so one EBO holds the
+// whole chain, stops once a level stops getting meaningfully smaller
+class MeshLodChain {
+public:
+     static const int MAX_LEVELS = 6;
+
+     void build(const float* vertices, int floatsPerVertex, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+          float reduction = 0.5f, float maxError = 1e30f);
+
+     const std::vector<unsigned int>& getIndices() const { return indices; }
+     const MeshLodLevel* getLevels() const { return levels.data(); }
+     int getLevelCount() const { return (int)levels.size(); }
+     double getBuildMs() const { return buildMs; }
+
+private:
+     std::vector<unsigned int> indices;
+     std::vector<MeshLodLevel> levels;
+     double buildMs = 0.0;
+};
+
+// Picks the coarsest level whose error covers no more than maxPixelError pixels, pixelsPerUnit being how many pixels one mesh
+// unit covers on screen right now
+// Going finer happens as soon as the current level is too coarse, but going coarser waits until the coarser level's error is a
+// hysteresis fraction under the limit, so something sat right on a threshold doesn't flicker between two levels
+int selectLodLevel(const MeshLodLevel* levels, int levelCount, int current, float pixelsPerUnit, float maxPixelError, float hysteresis);
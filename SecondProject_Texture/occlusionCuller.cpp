@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_USE_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+#include "occlusionCuller.h"
+#include "threadPool.h"
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+     return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+     : width((std::max(width, 4) + 3) / 4 * 4), height(std::max(height, 1)) { // Rows a whole number of SIMD groups wide
+     // Every level down to a single texel, each one half the size of the last rounded up
+     int levelWidth = this->width, levelHeight = this->height;
+     while (true) {
+          levels.push_back({ levelWidth, levelHeight, std::vector<float>((size_t)levelWidth * levelHeight, 1.0f) });
+          if (levelWidth == 1 && levelHeight == 1) {
+               break;
+          }
+          levelWidth = (levelWidth + 1) / 2;
+          levelHeight = (levelHeight + 1) / 2;
+     }
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& view, const glm::mat4& projection, float nearPlane) {
+     this->view = view;
+     this->projection = projection;
+     this->nearPlane = nearPlane;
+     viewProjection = projection * view;
+     std::fill(levels[0].depths.begin(), levels[0].depths.end(), 1.0f);
+     stats = OcclusionStats();
+}
+
+void OcclusionCuller::addOccluder(const float* vertices, int floatsPerVertex, const unsigned int* indices, int indexCount, const glm::mat4& model) {
+     auto start = std::chrono::steady_clock::now();
+     glm::mat4 mvp = viewProjection * model;
+     for (int i = 0; i + 2 < indexCount; i += 3) {
+          glm::vec4 corners[3];
+          bool nearClipped = false;
+          for (int k = 0; k < 3; k++) {
+               const float* position = vertices + (size_t)indices[i + k] * floatsPerVertex;
+               corners[k] = mvp * glm::vec4(position[0], position[1], position[2], 1.0f);
+               nearClipped |= corners[k].w <= nearPlane;
+          }
+          // Clipping would only matter for occluders right up against the camera, leaving the triangle out is always safe
+          if (nearClipped) {
+               continue;
+          }
+          rasterizeTriangle(corners[0], corners[1], corners[2]);
+          stats.occluderTriangles++;
+     }
+     stats.occluders++;
+     stats.rasterMs += millisecondsSince(start);
+}
+
+void OcclusionCuller::rasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+     // To pixels, with depth 0 at the near plane and 1 at the far one
+     glm::vec3 screen[3];
+     const glm::vec4* clip[3] = { &a, &b, &c };
+     for (int k = 0; k < 3; k++) {
+          float inverseW = 1.0f / clip[k]->w;
+          screen[k] = glm::vec3((clip[k]->x * inverseW * 0.5f + 0.5f) * width, (clip[k]->y * inverseW * 0.5f + 0.5f) * height,
+               std::min(clip[k]->z * inverseW * 0.5f + 0.5f, 1.0f));
+     }
+     float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+     if (std::fabs(area) < 1e-6f) {
+          return;
+     }
+     // Back faces count too, they're behind the front ones anyway so the min just ignores them
+     if (area < 0.0f) {
+          std::swap(screen[1], screen[2]);
+          area = -area;
+     }
+
+     int minX = std::max((int)std::floor(std::min({ screen[0].x, screen[1].x, screen[2].x })), 0);
+     int maxX = std::min((int)std::ceil(std::max({ screen[0].x, screen[1].x, screen[2].x })), width - 1);
+     int minY = std::max((int)std::floor(std::min({ screen[0].y, screen[1].y, screen[2].y })), 0);
+     int maxY = std::min((int)std::ceil(std::max({ screen[0].y, screen[1].y, screen[2].y })), height - 1);
+     if (minX > maxX || minY > maxY) {
+          return;
+     }
+
+     // edge = A * x + B * y + C, positive inside, tested at pixel centres
+     // Requiring the whole pixel to be inside would leave a gap along every shared edge, and a one pixel crack
+     // through the middle of a wall is enough to make it useless once the pyramid takes the farthest depth
+     float edgeA[3], edgeB[3], edgeC[3];
+     for (int k = 0; k < 3; k++) {
+          const glm::vec3& from = screen[k];
+          const glm::vec3& to = screen[(k + 1) % 3];
+          edgeA[k] = from.y - to.y;
+          edgeB[k] = to.x - from.x;
+          edgeC[k] = -(edgeA[k] * from.x + edgeB[k] * from.y);
+     }
+     // Depth is still kept on the safe side, the farthest it gets anywhere in the pixel
+     float dzdx = ((screen[1].z - screen[0].z) * (screen[2].y - screen[0].y) - (screen[2].z - screen[0].z) * (screen[1].y - screen[0].y)) / area;
+     float dzdy = ((screen[2].z - screen[0].z) * (screen[1].x - screen[0].x) - (screen[1].z - screen[0].z) * (screen[2].x - screen[0].x)) / area;
+     float depthC = screen[0].z - dzdx * screen[0].x - dzdy * screen[0].y + 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+
+     std::vector<float>& depths = levels[0].depths;
+     int firstX = minX & ~3;
+     for (int y = minY; y <= maxY; y++) {
+          float pixelY = y + 0.5f;
+          float* depthRow = depths.data() + (size_t)y * width;
+#ifdef OCCLUSION_USE_SSE2
+          __m128 rowEdge[3], stepEdge[3];
+          for (int k = 0; k < 3; k++) {
+               rowEdge[k] = _mm_set1_ps(edgeB[k] * pixelY + edgeC[k]);
+               stepEdge[k] = _mm_set1_ps(edgeA[k]);
+          }
+          const __m128 rowDepth = _mm_set1_ps(dzdy * pixelY + depthC);
+          const __m128 stepDepth = _mm_set1_ps(dzdx);
+          const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+          const __m128 zero = _mm_setzero_ps();
+          for (int x = firstX; x <= maxX; x += 4) {
+               __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+               __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdge[0], pixelX), rowEdge[0]), zero);
+               inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdge[1], pixelX), rowEdge[1]), zero));
+               inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdge[2], pixelX), rowEdge[2]), zero));
+               if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+               }
+               __m128 depth = _mm_add_ps(_mm_mul_ps(stepDepth, pixelX), rowDepth);
+               __m128 stored = _mm_loadu_ps(depthRow + x);
+               __m128 nearer = _mm_min_ps(depth, stored);
+               _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+          }
+#else
+          for (int x = minX; x <= maxX; x++) {
+               float pixelX = x + 0.5f;
+               bool inside = true;
+               for (int k = 0; k < 3; k++) {
+                    inside = inside && edgeA[k] * pixelX + edgeB[k] * pixelY + edgeC[k] >= 0.0f;
+               }
+               if (inside) {
+                    depthRow[x] = std::min(depthRow[x], dzdx * pixelX + dzdy * pixelY + depthC);
+               }
+          }
+#endif
+     }
+}
+
+// Each texel takes the farthest of the (up to) four under it, so it's a safe stand in for all of them
+void OcclusionCuller::buildPyramid() {
+     for (size_t i = 1; i < levels.size(); i++) {
+          const Level& below = levels[i - 1];
+          Level& level = levels[i];
+          for (int y = 0; y < level.height; y++) {
+               const float* row0 = below.depths.data() + (size_t)(2 * y) * below.width;
+               const float* row1 = 2 * y + 1 < below.height ? row0 + below.width : row0;
+               float* out = level.depths.data() + (size_t)y * level.width;
+               int x = 0;
+#ifdef OCCLUSION_USE_SSE2
+               // Four output texels from eight below in each row
+               for (; 2 * x + 7 < below.width; x += 4) {
+                    __m128 left = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x), _mm_loadu_ps(row1 + 2 * x));
+                    __m128 right = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x + 4), _mm_loadu_ps(row1 + 2 * x + 4));
+                    __m128 evens = _mm_shuffle_ps(left, right, _MM_SHUFFLE(2, 0, 2, 0));
+                    __m128 odds = _mm_shuffle_ps(left, right, _MM_SHUFFLE(3, 1, 3, 1));
+                    _mm_storeu_ps(out + x, _mm_max_ps(evens, odds));
+               }
+#endif
+               for (; x < level.width; x++) {
+                    int left = 2 * x;
+                    int right = std::min(left + 1, below.width - 1);
+                    out[x] = std::max(std::max(row0[left], row0[right]), std::max(row1[left], row1[right]));
+               }
+          }
+     }
+}
+
+bool OcclusionCuller::isSphereVisible(const glm::vec4& sphere) const {
+     glm::vec3 viewCenter = glm::vec3(view * glm::vec4(glm::vec3(sphere), 1.0f));
+     float radius = sphere.w;
+     // The camera looks down -z, anything reaching the near plane could be right in front of it
+     if (-viewCenter.z - radius <= nearPlane) {
+          return true;
+     }
+
+     // Screen rectangle from the corners of the box around the sphere
+     float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+     for (int corner = 0; corner < 8; corner++) {
+          glm::vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+          glm::vec4 clip = projection * glm::vec4(viewCenter + offset, 1.0f);
+          float x = (clip.x / clip.w * 0.5f + 0.5f) * width;
+          float y = (clip.y / clip.w * 0.5f + 0.5f) * height;
+          minX = std::min(minX, x);
+          maxX = std::max(maxX, x);
+          minY = std::min(minY, y);
+          maxY = std::max(maxY, y);
+     }
+     // Off screen entirely is the frustum's business, not this
+     if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) {
+          return true;
+     }
+     minX = std::max(minX, 0.0f);
+     minY = std::max(minY, 0.0f);
+     maxX = std::min(maxX, width - 1.0f);
+     maxY = std::min(maxY, height - 1.0f);
+
+     glm::vec4 nearestClip = projection * glm::vec4(0.0f, 0.0f, viewCenter.z + radius, 1.0f);
+     float nearestDepth = nearestClip.z / nearestClip.w * 0.5f + 0.5f;
+
+     // The level where the rectangle is about a texel across, so only a 2x2 block or so needs reading
+     float extent = std::max(std::max(maxX - minX, maxY - minY), 1.0f);
+     int levelIndex = std::min((int)std::ceil(std::log2(extent)), (int)levels.size() - 1);
+     const Level& level = levels[levelIndex];
+     float scale = 1.0f / (float)(1 << levelIndex);
+     int x0 = (int)(minX * scale), x1 = std::min((int)(maxX * scale), level.width - 1);
+     int y0 = (int)(minY * scale), y1 = std::min((int)(maxY * scale), level.height - 1);
+     for (int y = y0; y <= y1; y++) {
+          for (int x = x0; x <= x1; x++) {
+               if (nearestDepth <= level.depths[(size_t)y * level.width + x]) {
+                    return true;
+               }
+          }
+     }
+     return false;
+}
+
+void OcclusionCuller::testSpheres(const glm::vec4* spheres, size_t count, uint8_t* visible) {
+     auto start = std::chrono::steady_clock::now();
+     buildPyramid();
+     stats.pyramidMs = millisecondsSince(start);
+
+     start = std::chrono::steady_clock::now();
+     testedSpheres = spheres;
+     testedVisible = visible;
+     ThreadPool::shared().parallelFor(count, 64, [this](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) {
+               testedVisible[i] = isSphereVisible(testedSpheres[i]) ? 1 : 0;
+          }
+     });
+     stats.tested = (int)count;
+     stats.occluded = 0;
+     for (size_t i = 0; i < count; i++) {
+          stats.occluded += visible[i] ? 0 : 1;
+     }
+     stats.testMs = millisecondsSince(start);
+}
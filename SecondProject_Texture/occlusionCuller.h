@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct OcclusionStats {
+     int occluders = 0;
+     int occluderTriangles = 0; // That made it past the near plane
+     int tested = 0;
+     int occluded = 0;
+     double rasterMs = 0.0;
+     double pyramidMs = 0.0;
+     double testMs = 0.0;
+};
+
+// Skips drawing things that are hidden behind nearer objects, worked out on the CPU before anything is submitted
+// A few big occluders are rasterized into a small depth buffer, which gets reduced into a pyramid where each texel holds the
+// farthest depth of the four under it, so a bounding sphere's screen rectangle can be checked against a handful of texels
+// Everything errs towards visible: occluders write the farthest depth they reach across each pixel they cover, and anything
+// touching the near plane is never culled
+class OcclusionCuller {
+public:
+     // The depth buffer size, small on purpose, a few pixels of error only makes culling less aggressive
+     OcclusionCuller(int width, int height);
+     OcclusionCuller(const OcclusionCuller&) = delete;
+     OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+     // Clears the depth buffer, near is the projection's near plane distance
+     void beginFrame(const glm::mat4& view, const glm::mat4& projection, float nearPlane);
+
+     // Same vertex layout as the VAOs, floatsPerVertex apart with the position first
+     void addOccluder(const float* vertices, int floatsPerVertex, const unsigned int* indices, int indexCount, const glm::mat4& model);
+
+     // Builds the pyramid and tests world space bounding spheres (xyz centre, w radius) against it on the thread pool
+     // visible[i] is set to 1 or 0 for each sphere
+     void testSpheres(const glm::vec4* spheres, size_t count, uint8_t* visible);
+
+     int getWidth() const { return width; }
+     int getHeight() const { return height; }
+     float getDepth(int level, int x, int y) const { return levels[level].depths[(size_t)y * levels[level].width + x]; } // 0 near, 1 far
+     const OcclusionStats& getStats() const { return stats; }
+
+private:
+     struct Level {
+          int width;
+          int height;
+          std::vector<float> depths; // Bottom row first, like the GL framebuffer
+     };
+
+     void rasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+     void buildPyramid();
+     bool isSphereVisible(const glm::vec4& sphere) const;
+
+     int width;
+     int height;
+     std::vector<Level> levels;
+     glm::mat4 view = glm::mat4(1.0f);
+     glm::mat4 projection = glm::mat4(1.0f);
+     glm::mat4 viewProjection = glm::mat4(1.0f);
+     float nearPlane = 0.1f;
+
+     // What testSpheres is working on, kept here so the parallelFor lambda only has to capture this
+     const glm::vec4* testedSpheres = nullptr;
+     uint8_t* testedVisible = nullptr;
+
+     OcclusionStats stats;
+};
@@ -0,0 +1,123 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+#include "overdrawCounter.h"
+
+// GL 4.2 bits glad's 3.3 header doesn't have
+#ifndef GL_ATOMIC_COUNTER_BUFFER
+#define GL_ATOMIC_COUNTER_BUFFER 0x92C0
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+
+typedef void (APIENTRYP MemoryBarrierProc)(GLbitfield barriers);
+
+static MemoryBarrierProc memoryBarrier = nullptr;
+
+// Has to match the binding in fragmentShader.vert
+static const unsigned int COUNTER_BINDING = 0;
+
+bool OverdrawCounter::create() {
+     GLint major = 0, minor = 0;
+     glGetIntegerv(GL_MAJOR_VERSION, &major);
+     glGetIntegerv(GL_MINOR_VERSION, &minor);
+     if (major < 4 || (major == 4 && minor < 2)) {
+          std::cout << "Atomic counters need GL 4.2, this context is " << major << "." << minor << ": Overdraw counting disabled" << std::endl;
+          return false;
+     }
+     memoryBarrier = (MemoryBarrierProc)glfwGetProcAddress("glMemoryBarrier");
+     if (!memoryBarrier) {
+          std::cout << "Failed to load glMemoryBarrier: Overdraw counting disabled" << std::endl;
+          return false;
+     }
+
+     glGenBuffers(COUNTER_BUFFERS, buffers);
+     GLuint zero = 0;
+     for (int i = 0; i < COUNTER_BUFFERS; i++) {
+          glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, buffers[i]);
+          glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_READ);
+     }
+     glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+     statsStart = std::chrono::steady_clock::now();
+     return true;
+}
+
+bool OverdrawCounter::beginPass() {
+     if (!isSupported()) {
+          return false;
+     }
+     readCounters();
+     // Every buffer still waiting on the GPU means this frame just doesn't get counted
+     if (fences[nextBuffer]) {
+          return false;
+     }
+
+     GLuint zero = 0;
+     glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, buffers[nextBuffer]);
+     glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zero);
+     glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, COUNTER_BINDING, buffers[nextBuffer]);
+     passStarted = true;
+     return true;
+}
+
+void OverdrawCounter::endPass(int framebufferWidth, int framebufferHeight) {
+     if (!passStarted) {
+          return;
+     }
+     // The shader's increments have to land before glGetBufferSubData reads the buffer
+     memoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+     fences[nextBuffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+     pixels[nextBuffer] = (uint64_t)framebufferWidth * framebufferHeight;
+     glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, COUNTER_BINDING, 0);
+     nextBuffer = (nextBuffer + 1) % COUNTER_BUFFERS;
+     passStarted = false;
+}
+
+void OverdrawCounter::readCounters() {
+     for (int i = 0; i < COUNTER_BUFFERS; i++) {
+          if (!fences[i]) {
+               continue;
+          }
+          // Zero timeout, if the frame hasn't finished it just gets checked again next time
+          GLenum status = glClientWaitSync(fences[i], 0, 0);
+          if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+               continue;
+          }
+          glDeleteSync(fences[i]);
+          fences[i] = 0;
+
+          GLuint fragments = 0;
+          glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, buffers[i]);
+          glGetBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &fragments);
+          fragmentsTotal += fragments;
+          pixelsTotal += (double)pixels[i];
+          samples++;
+     }
+     glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+     auto now = std::chrono::steady_clock::now();
+     if (now - statsStart >= std::chrono::seconds(1)) {
+          stats.shadedFragments = samples > 0 ? fragmentsTotal / samples : 0.0;
+          stats.fragmentsPerPixel = pixelsTotal > 0.0 ? fragmentsTotal / pixelsTotal : 0.0;
+          stats.active = samples > 0;
+          fragmentsTotal = 0.0;
+          pixelsTotal = 0.0;
+          samples = 0;
+          statsStart = now;
+     }
+}
+
+void OverdrawCounter::deleteResources() {
+     for (int i = 0; i < COUNTER_BUFFERS; i++) {
+          if (fences[i]) {
+               glDeleteSync(fences[i]);
+               fences[i] = 0;
+          }
+     }
+     glDeleteBuffers(COUNTER_BUFFERS, buffers);
+     for (int i = 0; i < COUNTER_BUFFERS; i++) {
+          buffers[i] = 0;
+     }
+}
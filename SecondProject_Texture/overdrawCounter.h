@@ -0,0 +1,54 @@
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+
+struct OverdrawStats {
+     // Averaged over the last second
+     double shadedFragments = 0.0;
+     double fragmentsPerPixel = 0.0; // Over the whole framebuffer, so 1.0 is as much shading as covering the screen exactly once
+     bool active = false;
+};
+
+// Counts how many fragments the colour pass actually shades, for seeing what the depth pre-pass and draw order save
+// The shader variants built with SHADER_COUNT_FRAGMENTS bump an atomic counter after the depth test, so hidden fragments that the
+// depth test throws away aren't counted and ones that get shaded and then covered by something nearer are
+// Each frame gets its own counter buffer out of a small ring, read back a few frames later once its fence has passed, so it never stalls
+// Atomic counters need GL 4.2
+class OverdrawCounter {
+public:
+     OverdrawCounter() = default;
+     OverdrawCounter(const OverdrawCounter&) = delete;
+     OverdrawCounter& operator=(const OverdrawCounter&) = delete;
+
+     // False if the context is older than 4.2
+     bool create();
+     bool isSupported() const { return buffers[0] != 0; }
+
+     // Around the colour pass, binds this frame's counter to atomic counter binding 0
+     // False when every counter is still waiting to be read, nothing's bound then so the pass has to use the variants that don't count
+     bool beginPass();
+     void endPass(int framebufferWidth, int framebufferHeight);
+
+     const OverdrawStats& getStats() const { return stats; }
+
+     // Needs calling before glfwTerminate
+     void deleteResources();
+
+private:
+     static const int COUNTER_BUFFERS = 4;
+
+     void readCounters();
+
+     unsigned int buffers[COUNTER_BUFFERS] = {};
+     GLsync fences[COUNTER_BUFFERS] = {}; // Null when the buffer isn't waiting to be read
+     uint64_t pixels[COUNTER_BUFFERS] = {};
+     int nextBuffer = 0;
+     bool passStarted = false;
+
+     double fragmentsTotal = 0.0;
+     double pixelsTotal = 0.0;
+     int samples = 0;
+     std::chrono::steady_clock::time_point statsStart;
+     OverdrawStats stats;
+};
@@ -0,0 +1,12 @@
+#version 450 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+in vec4 particleColor;
+
+// A soft round dot across the quad, blended additively
+void main()
+{
+   float fade = 1.0 - smoothstep(0.2, 0.5, length(texCoord - vec2(0.5)));
+   FragColor = vec4(particleColor.rgb, particleColor.a * fade);
+}
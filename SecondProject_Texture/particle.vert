@@ -0,0 +1,26 @@
+#version 450 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoord;
+// One of each per particle, every field comes from its own array in the instance buffer
+layout (location = 3) in float aCenterX;
+layout (location = 4) in float aCenterY;
+layout (location = 5) in float aCenterZ;
+layout (location = 6) in float aLife;
+layout (location = 7) in float aSize;
+layout (location = 8) in vec4 aColor;
+
+out vec2 texCoord;
+out vec4 particleColor;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// The quad's corners are pushed out in view space so every particle faces the camera, shrinking and fading as it dies
+void main()
+{
+   vec4 center = view * vec4(aCenterX, aCenterY, aCenterZ, 1.0);
+   float size = aSize * (0.5 + 0.5 * aLife);
+   gl_Position = projection * (center + vec4(aPos.xy * size, 0.0, 0.0));
+   texCoord = aTexCoord;
+   particleColor = vec4(aColor.rgb, aColor.a * aLife);
+}
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLE_USE_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "particleSystem.h"
+#include "shaderVariants.h"
+#include "threadPool.h"
+
+namespace {
+
+// Attribute locations 0 to 2 are the quad's own
+const unsigned int FIRST_INSTANCE_LOCATION = 3;
+// A long hitch shouldn't throw everything through the floor in one step
+const float MAX_STEP_SECONDS = 0.1f;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+     return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// xorshift, each emitter has its own so they can run in parallel and still come out the same every time
+uint32_t nextRandom(uint32_t& state) {
+     state ^= state << 13;
+     state ^= state >> 17;
+     state ^= state << 5;
+     return state;
+}
+
+// [0, 1)
+float randomUnit(uint32_t& state) {
+     return (nextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+float randomSigned(uint32_t& state) {
+     return randomUnit(state) * 2.0f - 1.0f;
+}
+
+}
+
+ParticleSystem::ParticleSystem(const ParticleSettings& settings) : settings(settings) {
+     capacity = settings.maxParticles;
+     size_t padded = (capacity + 3) & ~(size_t)3;
+     for (std::vector<float>* array : { &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ, &life, &lifeRate, &size }) {
+          array->resize(padded, 0.0f);
+     }
+     color.resize(padded, 0);
+     // Whole SIMD batches in every block but the last
+     grain = std::max<size_t>(settings.simulateGrain & ~(size_t)3, 4);
+     blockAlive.resize((capacity + grain - 1) / grain);
+     stats.capacity = capacity;
+}
+
+ParticleSystem::~ParticleSystem() {
+     if (simulation.joinable()) {
+          {
+               std::lock_guard<std::mutex> lock(stepMutex);
+               stopping = true;
+          }
+          stepRequested.notify_all();
+          simulation.join();
+     }
+}
+
+size_t ParticleSystem::addEmitter(const ParticleEmitter& emitter) {
+     EmitterState state;
+     state.emitter = emitter;
+     state.random = (uint32_t)(emitters.size() + 1) * 2654435761u; // Never 0, which xorshift would get stuck on
+     emitters.push_back(state);
+     return emitters.size() - 1;
+}
+
+bool ParticleSystem::create(const std::string& vertexPath, const std::string& fragmentPath, unsigned int quadVertexArray, int quadIndexCount) {
+     program = compileShaderProgram(vertexPath, fragmentPath, "");
+     if (!program) {
+          return false;
+     }
+     viewLocation = glGetUniformLocation(program, "view");
+     projectionLocation = glGetUniformLocation(program, "projection");
+     this->quadVertexArray = quadVertexArray;
+     this->quadIndexCount = quadIndexCount;
+
+     // Every field gets a range of capacity entries, so the attribute offsets never change however many are alive
+     glGenBuffers(1, &instanceBuffer);
+     glBindVertexArray(quadVertexArray);
+     glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+     glBufferData(GL_ARRAY_BUFFER, capacity * STREAM_COUNT * sizeof(float), NULL, GL_STREAM_DRAW);
+     for (int stream = 0; stream < STREAM_COUNT; stream++) {
+          unsigned int location = FIRST_INSTANCE_LOCATION + stream;
+          void* offset = (void*)(stream * capacity * sizeof(float));
+          if (stream == STREAM_COLOR) {
+               glVertexAttribPointer(location, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(uint32_t), offset);
+          }
+          else {
+               glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, sizeof(float), offset);
+          }
+          glEnableVertexAttribArray(location);
+          glVertexAttribDivisor(location, 1);
+     }
+     glBindVertexArray(0);
+     glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+     statsStart = std::chrono::steady_clock::now();
+     simulation = std::thread(&ParticleSystem::simulationLoop, this);
+     return true;
+}
+
+const void* ParticleSystem::streamData(int stream) const {
+     switch (stream) {
+     case STREAM_POSITION_X: return positionX.data();
+     case STREAM_POSITION_Y: return positionY.data();
+     case STREAM_POSITION_Z: return positionZ.data();
+     case STREAM_LIFE: return life.data();
+     case STREAM_SIZE: return size.data();
+     default: return color.data();
+     }
+}
+
+void ParticleSystem::update(float deltaSeconds) {
+     if (!isSupported()) {
+          return;
+     }
+     auto waitStart = std::chrono::steady_clock::now();
+     {
+          std::unique_lock<std::mutex> lock(stepMutex);
+          stepFinished.wait(lock, [this] { return !stepPending; });
+     }
+     windowWaitMs += millisecondsSince(waitStart);
+     windowSteps.emitted += lastStep.emitted;
+     windowSteps.died += lastStep.died;
+     windowSteps.simulateMs += lastStep.simulateMs;
+     windowSteps.compactMs += lastStep.compactMs;
+     windowSteps.emitMs += lastStep.emitMs;
+
+     // Orphaning first means the driver hands over fresh memory rather than waiting for last frame's draw to finish with it
+     auto uploadStart = std::chrono::steady_clock::now();
+     glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+     glBufferData(GL_ARRAY_BUFFER, capacity * STREAM_COUNT * sizeof(float), NULL, GL_STREAM_DRAW);
+     if (count > 0) {
+          for (int stream = 0; stream < STREAM_COUNT; stream++) {
+               glBufferSubData(GL_ARRAY_BUFFER, stream * capacity * sizeof(float), count * sizeof(float), streamData(stream));
+          }
+     }
+     glBindBuffer(GL_ARRAY_BUFFER, 0);
+     drawCount = count;
+     windowUploadMs += millisecondsSince(uploadStart);
+     windowUploadBytes += count * STREAM_COUNT * sizeof(float);
+     stats.alive = count;
+
+     {
+          std::lock_guard<std::mutex> lock(stepMutex);
+          stepSeconds = std::min(deltaSeconds, MAX_STEP_SECONDS);
+          stepPending = true;
+     }
+     stepRequested.notify_one();
+
+     windowFrames++;
+     double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+     if (seconds >= 1.0) {
+          stats.emittedPerSecond = windowSteps.emitted / seconds;
+          stats.simulateMs = windowSteps.simulateMs / windowFrames;
+          stats.compactMs = windowSteps.compactMs / windowFrames;
+          stats.emitMs = windowSteps.emitMs / windowFrames;
+          stats.waitMs = windowWaitMs / windowFrames;
+          stats.uploadMs = windowUploadMs / windowFrames;
+          stats.uploadMB = windowUploadBytes / (1024.0 * 1024.0) / windowFrames;
+          windowSteps = ParticleStepStats();
+          windowWaitMs = 0.0;
+          windowUploadMs = 0.0;
+          windowUploadBytes = 0;
+          windowFrames = 0;
+          statsStart = std::chrono::steady_clock::now();
+     }
+}
+
+void ParticleSystem::draw(const glm::mat4& view, const glm::mat4& projection) const {
+     if (!isSupported() || drawCount == 0) {
+          return;
+     }
+     glUseProgram(program);
+     glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view));
+     glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+     // Additive, so the order they're drawn in doesn't matter and nothing needs sorting
+     glEnable(GL_BLEND);
+     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+     glDepthMask(GL_FALSE);
+     glBindVertexArray(quadVertexArray);
+     glDrawElementsInstanced(GL_TRIANGLES, quadIndexCount, GL_UNSIGNED_INT, 0, (GLsizei)drawCount);
+     glBindVertexArray(0);
+     glDisable(GL_BLEND);
+}
+
+void ParticleSystem::simulationLoop() {
+     std::unique_lock<std::mutex> lock(stepMutex);
+     while (true) {
+          stepRequested.wait(lock, [this] { return stepPending || stopping; });
+          if (stopping) {
+               return;
+          }
+          float seconds = stepSeconds;
+          lock.unlock();
+          step(seconds);
+          lock.lock();
+          stepPending = false;
+          stepFinished.notify_one();
+     }
+}
+
+void ParticleSystem::step(float deltaSeconds, bool allowSimd) {
+     lastStep = ParticleStepStats();
+
+     auto start = std::chrono::steady_clock::now();
+     size_t blocks = (count + grain - 1) / grain;
+     size_t simulated = count;
+     float damping = std::pow(1.0f - settings.drag, deltaSeconds);
+     ThreadPool::shared().parallelFor(blocks, 1, [this, simulated, deltaSeconds, damping, allowSimd](size_t begin, size_t end) {
+          for (size_t block = begin; block < end; block++) {
+               size_t first = block * grain;
+               size_t last = std::min(simulated, first + grain);
+               simulateRange(first, last, deltaSeconds, damping, allowSimd);
+               blockAlive[block] = compactRange(first, last);
+          }
+     });
+     lastStep.simulateMs = millisecondsSince(start);
+
+     start = std::chrono::steady_clock::now();
+     size_t before = count;
+     fillGaps(blocks);
+     lastStep.died = before - count;
+     lastStep.compactMs = millisecondsSince(start);
+
+     start = std::chrono::steady_clock::now();
+     emit(deltaSeconds);
+     lastStep.emitMs = millisecondsSince(start);
+}
+
+void ParticleSystem::simulateRange(size_t begin, size_t end, float deltaSeconds, float damping, bool allowSimd) {
+     float* px = positionX.data();
+     float* py = positionY.data();
+     float* pz = positionZ.data();
+     float* vx = velocityX.data();
+     float* vy = velocityY.data();
+     float* vz = velocityZ.data();
+     float* remaining = life.data();
+     const float* rate = lifeRate.data();
+     float gravityX = settings.gravity.x * deltaSeconds;
+     float gravityY = settings.gravity.y * deltaSeconds;
+     float gravityZ = settings.gravity.z * deltaSeconds;
+
+     // Both paths do the same operations in the same order, so they give the same answer
+     size_t i = begin;
+#ifdef PARTICLE_USE_SSE2
+     if (allowSimd) {
+          __m128 seconds4 = _mm_set1_ps(deltaSeconds);
+          __m128 damping4 = _mm_set1_ps(damping);
+          __m128 gravityX4 = _mm_set1_ps(gravityX);
+          __m128 gravityY4 = _mm_set1_ps(gravityY);
+          __m128 gravityZ4 = _mm_set1_ps(gravityZ);
+          for (; i + 4 <= end; i += 4) {
+               __m128 velocity = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vx + i), gravityX4), damping4);
+               _mm_storeu_ps(vx + i, velocity);
+               _mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(velocity, seconds4)));
+               velocity = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vy + i), gravityY4), damping4);
+               _mm_storeu_ps(vy + i, velocity);
+               _mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(velocity, seconds4)));
+               velocity = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(vz + i), gravityZ4), damping4);
+               _mm_storeu_ps(vz + i, velocity);
+               _mm_storeu_ps(pz + i, _mm_add_ps(_mm_loadu_ps(pz + i), _mm_mul_ps(velocity, seconds4)));
+               _mm_storeu_ps(remaining + i, _mm_sub_ps(_mm_loadu_ps(remaining + i), _mm_mul_ps(_mm_loadu_ps(rate + i), seconds4)));
+          }
+     }
+#else
+     (void)allowSimd;
+#endif
+     for (; i < end; i++) {
+          vx[i] = (vx[i] + gravityX) * damping;
+          px[i] = px[i] + vx[i] * deltaSeconds;
+          vy[i] = (vy[i] + gravityY) * damping;
+          py[i] = py[i] + vy[i] * deltaSeconds;
+          vz[i] = (vz[i] + gravityZ) * damping;
+          pz[i] = pz[i] + vz[i] * deltaSeconds;
+          remaining[i] = remaining[i] - rate[i] * deltaSeconds;
+     }
+}
+
+void ParticleSystem::moveParticle(size_t from, size_t to) {
+     positionX[to] = positionX[from];
+     positionY[to] = positionY[from];
+     positionZ[to] = positionZ[from];
+     velocityX[to] = velocityX[from];
+     velocityY[to] = velocityY[from];
+     velocityZ[to] = velocityZ[from];
+     life[to] = life[from];
+     lifeRate[to] = lifeRate[from];
+     size[to] = size[from];
+     color[to] = color[from];
+}
+
+size_t ParticleSystem::compactRange(size_t begin, size_t end) {
+     // Each dead particle gets the range's last live one moved over it, the order doesn't matter with additive blending
+     // The SIMD check skips 4 live particles at a time, which is nearly all of them
+     size_t i = begin;
+     while (i < end) {
+#ifdef PARTICLE_USE_SSE2
+          if (i + 4 <= end && _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(life.data() + i), _mm_setzero_ps())) == 0) {
+               i += 4;
+               continue;
+          }
+#endif
+          if (life[i] > 0.0f) {
+               i++;
+               continue;
+          }
+          end--;
+          if (i != end) {
+               moveParticle(end, i);
+          }
+     }
+     return end - begin;
+}
+
+void ParticleSystem::fillGaps(size_t blocks) {
+     size_t alive = 0;
+     for (size_t block = 0; block < blocks; block++) {
+          alive += blockAlive[block];
+     }
+     // Every gap below alive gets one of the live particles at or above it, there are exactly as many of each
+     size_t sourceBlock = alive / grain;
+     size_t source = alive;
+     for (size_t block = 0; block < blocks && block * grain < alive; block++) {
+          size_t gapEnd = std::min(alive, (block + 1) * grain);
+          for (size_t gap = block * grain + blockAlive[block]; gap < gapEnd; gap++) {
+               while (sourceBlock < blocks && source >= sourceBlock * grain + blockAlive[sourceBlock]) {
+                    sourceBlock++;
+                    source = sourceBlock * grain;
+               }
+               moveParticle(source++, gap);
+          }
+     }
+     count = alive;
+}
+
+void ParticleSystem::emit(float deltaSeconds) {
+     // Handing out the ranges is quick and has to be in order, filling them is the slow part
+     size_t next = count;
+     for (EmitterState& state : emitters) {
+          float wanted = state.carry + state.emitter.rate * deltaSeconds;
+          size_t spawn = (size_t)wanted;
+          state.carry = wanted - (float)spawn;
+          state.first = next;
+          state.spawn = std::min(spawn, capacity - next);
+          next += state.spawn;
+     }
+     lastStep.emitted = next - count;
+
+     ThreadPool::shared().parallelFor(emitters.size(), 1, [this](size_t begin, size_t end) {
+          for (size_t e = begin; e < end; e++) {
+               EmitterState& state = emitters[e];
+               const ParticleEmitter& emitter = state.emitter;
+               float spread = emitter.speed * emitter.spread;
+               for (size_t i = state.first; i < state.first + state.spawn; i++) {
+                    positionX[i] = emitter.position.x;
+                    positionY[i] = emitter.position.y;
+                    positionZ[i] = emitter.position.z;
+                    velocityX[i] = emitter.direction.x * emitter.speed + randomSigned(state.random) * spread;
+                    velocityY[i] = emitter.direction.y * emitter.speed + randomSigned(state.random) * spread;
+                    velocityZ[i] = emitter.direction.z * emitter.speed + randomSigned(state.random) * spread;
+                    life[i] = 1.0f;
+                    lifeRate[i] = 1.0f / (emitter.minLifeSeconds + (emitter.maxLifeSeconds - emitter.minLifeSeconds) * randomUnit(state.random));
+                    size[i] = emitter.size;
+                    color[i] = emitter.color;
+               }
+          }
+     });
+     count = next;
+}
+
+void ParticleSystem::deleteResources() {
+     if (program) {
+          glDeleteProgram(program);
+          program = 0;
+     }
+     if (instanceBuffer) {
+          glDeleteBuffers(1, &instanceBuffer);
+          instanceBuffer = 0;
+     }
+}
+
+bool benchmarkParticles(size_t count, int frames) {
+     if (count == 0 || frames <= 0) {
+          std::cout << "Nothing to benchmark" << std::endl;
+          return false;
+     }
+     const int EMITTERS = 8;
+     const float STEP_SECONDS = 1.0f / 60.0f;
+     ParticleSettings settings;
+     settings.maxParticles = count;
+     ParticleSystem scalar(settings), simd(settings);
+     ParticleSystem* systems[2] = { &scalar, &simd };
+     for (ParticleSystem* system : systems) {
+          for (int e = 0; e < EMITTERS; e++) {
+               float angle = e * 2.0f * 3.14159265f / EMITTERS;
+               ParticleEmitter emitter;
+               emitter.position = glm::vec3(std::cos(angle) * 5.0f, 0.0f, std::sin(angle) * 5.0f);
+               // Twice as many as fit, so it stays full and every step has particles to compact away and emit
+               emitter.rate = 2.0f * count / ((emitter.minLifeSeconds + emitter.maxLifeSeconds) * 0.5f) / EMITTERS;
+               system->addEmitter(emitter);
+          }
+     }
+
+     ParticleStepStats totals[2];
+     double milliseconds[2] = { 0.0, 0.0 };
+     for (int path = 0; path < 2; path++) {
+          ParticleSystem& system = *systems[path];
+          // Fill it up first
+          for (int frame = 0; frame < 240; frame++) {
+               system.step(STEP_SECONDS, path == 1);
+          }
+          auto start = std::chrono::steady_clock::now();
+          for (int frame = 0; frame < frames; frame++) {
+               system.step(STEP_SECONDS, path == 1);
+               const ParticleStepStats& step = system.getLastStep();
+               totals[path].emitted += step.emitted;
+               totals[path].died += step.died;
+               totals[path].simulateMs += step.simulateMs;
+               totals[path].compactMs += step.compactMs;
+               totals[path].emitMs += step.emitMs;
+          }
+          milliseconds[path] = millisecondsSince(start);
+     }
+
+     float maxDifference = 0.0f;
+     size_t compared = std::min(scalar.getAliveCount(), simd.getAliveCount());
+     for (size_t i = 0; i < compared; i++) {
+          glm::vec3 difference = scalar.getPosition(i) - simd.getPosition(i);
+          maxDifference = std::max(maxDifference, std::max(std::fabs(difference.x), std::max(std::fabs(difference.y), std::fabs(difference.z))));
+     }
+
+     std::cout << scalar.getAliveCount() << " particles alive of " << count << ", " << frames << " steps, " << ThreadPool::shared().size() + 1 << " threads" << std::endl;
+     const char* names[2] = { "scalar", "SSE2  " };
+     for (int path = 0; path < 2; path++) {
+#ifndef PARTICLE_USE_SSE2
+          if (path == 1) {
+               std::cout << "No SSE2 in this build" << std::endl;
+               break;
+          }
+#endif
+          const ParticleStepStats& total = totals[path];
+          std::cout << names[path] << " " << milliseconds[path] / frames << " ms a step (simulate " << total.simulateMs / frames << ", compact "
+               << total.compactMs / frames << ", emit " << total.emitMs / frames << "), " << (double)count * frames / total.simulateMs / 1e3
+               << " M particles/s simulated, " << total.died / frames << " died and " << total.emitted / frames << " emitted a step" << std::endl;
+     }
+#ifdef PARTICLE_USE_SSE2
+     std::cout << "SSE2 simulate " << totals[0].simulateMs / totals[1].simulateMs << "x, max difference from scalar " << maxDifference << std::endl;
+#endif
+     return true;
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// A fountain of particles, they start at position heading along direction with some random spread
+struct ParticleEmitter {
+     glm::vec3 position = glm::vec3(0.0f);
+     glm::vec3 direction = glm::vec3(0.0f, 1.0f, 0.0f);
+     float speed = 5.0f;
+     float spread = 0.3f; // Random velocity added in every axis, as a fraction of speed
+     float rate = 1000.0f; // Particles a second
+     float minLifeSeconds = 2.0f;
+     float maxLifeSeconds = 4.0f;
+     float size = 0.05f; // Across, in world units
+     uint32_t color = 0xffffffff; // RGBA8, red in the low byte
+};
+
+struct ParticleSettings {
+     size_t maxParticles = 1 << 20; // Everything's allocated for this many up front, emitters stop once it's full
+     glm::vec3 gravity = glm::vec3(0.0f, -9.8f, 0.0f);
+     float drag = 0.3f; // Velocity lost a second, as a fraction
+     size_t simulateGrain = 16384; // Particles per thread pool task, a multiple of 4
+};
+
+// What one step did, the times are on the simulation thread
+struct ParticleStepStats {
+     size_t emitted = 0;
+     size_t died = 0;
+     double simulateMs = 0.0;
+     double compactMs = 0.0; // Filling the gaps between blocks, packing each block is part of the simulate time
+     double emitMs = 0.0;
+};
+
+struct ParticleStats {
+     size_t alive = 0;
+     size_t capacity = 0;
+     // Averaged over the last second
+     double emittedPerSecond = 0.0;
+     double simulateMs = 0.0;
+     double compactMs = 0.0;
+     double emitMs = 0.0;
+     double waitMs = 0.0; // Render thread time spent waiting for the step to finish, 0 when it overlaps the frame completely
+     double uploadMs = 0.0;
+     double uploadMB = 0.0; // A frame
+};
+
+// Lots of short lived particles drawn as camera facing quads, one instanced draw of an existing quad VAO for all of them
+// They're kept as structure of arrays, one array per field, so the update runs 4 at a time with SSE2 across the thread pool and
+// uploads each array straight into its own range of the instance buffer, the vertex shader reads each field as its own attribute
+// Dead particles are compacted without moving the live ones around much, each task packs its own block while it's still in cache
+// and then the gaps left at the ends of the blocks are filled from the far end, nothing is allocated after create
+// Stepping runs on a thread of its own, started by update and waited for by the next update, so it overlaps the rest of the frame
+class ParticleSystem {
+public:
+     explicit ParticleSystem(const ParticleSettings& settings = ParticleSettings());
+     // Waits for the simulation thread, doesn't touch GL
+     ~ParticleSystem();
+     ParticleSystem(const ParticleSystem&) = delete;
+     ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+     // Only before create, or when stepping by hand
+     size_t addEmitter(const ParticleEmitter& emitter);
+
+     // Compiles the billboard shader, makes the instance buffer and points attribute locations 3 to 8 of the quad's VAO at it,
+     // then starts the simulation thread, false if the shader didn't compile
+     bool create(const std::string& vertexPath, const std::string& fragmentPath, unsigned int quadVertexArray, int quadIndexCount);
+     bool isSupported() const { return program != 0; }
+
+     // Once a frame on the render thread, waits for the last step, uploads its particles and starts the next one
+     void update(float deltaSeconds);
+     // Draws what the last update uploaded with additive blending and no depth writes, the depth mask's left off
+     void draw(const glm::mat4& view, const glm::mat4& projection) const;
+
+     // Runs one step on the calling thread, for the benchmark, don't mix it with update
+     void step(float deltaSeconds, bool allowSimd = true);
+     const ParticleStepStats& getLastStep() const { return lastStep; }
+     size_t getAliveCount() const { return count; }
+     glm::vec3 getPosition(size_t index) const { return glm::vec3(positionX[index], positionY[index], positionZ[index]); }
+
+     const ParticleStats& getStats() const { return stats; }
+
+     // Needs calling before glfwTerminate
+     void deleteResources();
+
+private:
+     // What the shader reads, in the order they sit in the instance buffer
+     enum Stream {
+          STREAM_POSITION_X,
+          STREAM_POSITION_Y,
+          STREAM_POSITION_Z,
+          STREAM_LIFE,
+          STREAM_SIZE,
+          STREAM_COLOR,
+          STREAM_COUNT
+     };
+     struct EmitterState {
+          ParticleEmitter emitter;
+          float carry = 0.0f; // Part of a particle left over from the last step
+          uint32_t random = 1;
+          // Where this step's particles go, worked out before the emitters run in parallel
+          size_t first = 0;
+          size_t spawn = 0;
+     };
+
+     void simulateRange(size_t begin, size_t end, float deltaSeconds, float damping, bool allowSimd);
+     // Returns how many are left alive, packed at the start of the range
+     size_t compactRange(size_t begin, size_t end);
+     void fillGaps(size_t blocks);
+     void moveParticle(size_t from, size_t to);
+     void emit(float deltaSeconds);
+     void simulationLoop();
+     const void* streamData(int stream) const;
+
+     ParticleSettings settings;
+     size_t capacity = 0;
+     size_t count = 0;
+     size_t grain = 0;
+     std::vector<size_t> blockAlive; // Per block of grain particles, from the last step's compaction
+     // One entry per particle in each, padded to a multiple of 4
+     std::vector<float> positionX, positionY, positionZ;
+     std::vector<float> velocityX, velocityY, velocityZ;
+     std::vector<float> life; // Counts down from 1 to 0
+     std::vector<float> lifeRate; // 1 / lifetime in seconds
+     std::vector<float> size;
+     std::vector<uint32_t> color;
+     std::vector<EmitterState> emitters;
+     ParticleStepStats lastStep;
+
+     unsigned int program = 0;
+     int viewLocation = -1;
+     int projectionLocation = -1;
+     unsigned int instanceBuffer = 0;
+     unsigned int quadVertexArray = 0;
+     int quadIndexCount = 0;
+     size_t drawCount = 0;
+
+     // The particle arrays belong to the simulation thread while stepPending is set and to the render thread otherwise
+     std::thread simulation;
+     std::mutex stepMutex;
+     std::condition_variable stepRequested;
+     std::condition_variable stepFinished;
+     bool stepPending = false;
+     bool stopping = false;
+     float stepSeconds = 0.0f;
+
+     ParticleStats stats;
+     std::chrono::steady_clock::time_point statsStart;
+     // Totals since statsStart
+     ParticleStepStats windowSteps;
+     double windowWaitMs = 0.0;
+     double windowUploadMs = 0.0;
+     size_t windowUploadBytes = 0;
+     int windowFrames = 0;
+};
+
+// Fills a system with count particles and steps it with the scalar and SSE2 updates, for `--benchmark-particles [count] [frames]`
+bool benchmarkParticles(size_t count, int frames);
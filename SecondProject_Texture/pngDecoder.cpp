@@ -0,0 +1,259 @@
+#include <stb/stb_image.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PNG_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "pngDecoder.h"
+#include "threadPool.h"
+
+namespace {
+
+const unsigned char PNG_SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+enum PngFilter {
+     FILTER_NONE = 0,
+     FILTER_SUB = 1,
+     FILTER_UP = 2,
+     FILTER_AVERAGE = 3,
+     FILTER_PAETH = 4
+};
+
+uint32_t readUint32(const unsigned char* p) {
+     return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+int paethPredictor(int left, int up, int upLeft) {
+     int estimate = left + up - upLeft;
+     int distanceLeft = abs(estimate - left);
+     int distanceUp = abs(estimate - up);
+     int distanceUpLeft = abs(estimate - upLeft);
+     if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft) {
+          return left;
+     }
+     return distanceUp <= distanceUpLeft ? up : upLeft;
+}
+
+// Undoes one row's filter, previous is the already unfiltered row above (all zeros for the first row)
+void unfilterRow(int filter, const unsigned char* raw, const unsigned char* previous, unsigned char* out, size_t stride, int bpp) {
+     switch (filter) {
+     case FILTER_NONE:
+          memcpy(out, raw, stride);
+          break;
+
+     case FILTER_SUB:
+          for (size_t i = 0; i < stride; i++) {
+               out[i] = raw[i] + (i >= (size_t)bpp ? out[i - bpp] : 0);
+          }
+          break;
+
+     case FILTER_UP:
+     {
+          // No dependency along the row, so this one vectorises properly
+          size_t i = 0;
+#ifdef PNG_USE_SSE2
+          for (; i + 16 <= stride; i += 16) {
+               __m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(raw + i)), _mm_loadu_si128((const __m128i*)(previous + i)));
+               _mm_storeu_si128((__m128i*)(out + i), sum);
+          }
+#endif
+          for (; i < stride; i++) {
+               out[i] = raw[i] + previous[i];
+          }
+          break;
+     }
+
+     case FILTER_AVERAGE:
+          for (size_t i = 0; i < stride; i++) {
+               int left = i >= (size_t)bpp ? out[i - bpp] : 0;
+               out[i] = raw[i] + (unsigned char)((left + previous[i]) >> 1);
+          }
+          break;
+
+     case FILTER_PAETH:
+          for (size_t i = 0; i < stride; i++) {
+               int left = i >= (size_t)bpp ? out[i - bpp] : 0;
+               int upLeft = i >= (size_t)bpp ? previous[i - bpp] : 0;
+               out[i] = raw[i] + (unsigned char)paethPredictor(left, previous[i], upLeft);
+          }
+          break;
+     }
+}
+
+}
+
+bool PngDecoder::canDecode(const unsigned char* data, size_t size) const {
+     return size > 8 && memcmp(data, PNG_SIGNATURE, 8) == 0;
+}
+
+bool PngDecoder::decode(const unsigned char* data, size_t size, ImageData& image) {
+     uint32_t width = 0, height = 0;
+     int colourType = -1;
+     int channels = 0; // Bytes per pixel in the file
+     std::vector<unsigned char> compressed;
+     // Palette entries as RGBA, opaque black past the end of the palette like stb
+     unsigned char palette[256][4];
+     for (auto& entry : palette) {
+          entry[0] = entry[1] = entry[2] = 0;
+          entry[3] = 255;
+     }
+     bool hasPalette = false;
+     // tRNS gives a palette its alpha, or grey and RGB images one colour that's see through
+     bool hasTransparency = false;
+     unsigned char transparentColour[3] = { 0, 0, 0 };
+
+     const unsigned char* p = data + 8;
+     const unsigned char* end = data + size;
+     while (p + 12 <= end) {
+          uint32_t length = readUint32(p);
+          const unsigned char* type = p + 4;
+          const unsigned char* chunk = p + 8;
+          if (length > (size_t)(end - chunk) - 4) {
+               return false;
+          }
+
+          if (memcmp(type, "IHDR", 4) == 0) {
+               if (length < 13) {
+                    return false;
+               }
+               width = readUint32(chunk);
+               height = readUint32(chunk + 4);
+               int bitDepth = chunk[8];
+               colourType = chunk[9];
+               int interlace = chunk[12];
+               if (bitDepth != 8 || interlace != 0) {
+                    return false;
+               }
+               switch (colourType) {
+               case 0: channels = 1; break; // Grey
+               case 2: channels = 3; break; // RGB
+               case 3: channels = 1; break; // Palette
+               case 4: channels = 2; break; // Grey + alpha
+               case 6: channels = 4; break; // RGBA
+               default: return false;
+               }
+          }
+          else if (memcmp(type, "PLTE", 4) == 0) {
+               for (uint32_t i = 0; i < length / 3 && i < 256; i++) {
+                    memcpy(palette[i], chunk + i * 3, 3);
+               }
+               hasPalette = true;
+          }
+          else if (memcmp(type, "tRNS", 4) == 0) {
+               if (colourType == 3) {
+                    for (uint32_t i = 0; i < length && i < 256; i++) {
+                         palette[i][3] = chunk[i];
+                    }
+               }
+               else if ((colourType == 0 && length >= 2) || (colourType == 2 && length >= 6)) {
+                    // 16 bit samples, only the low byte matters at 8 bits
+                    for (int c = 0; c < channels; c++) {
+                         transparentColour[c] = chunk[c * 2 + 1];
+                    }
+               }
+               else {
+                    return false;
+               }
+               hasTransparency = true;
+          }
+          else if (memcmp(type, "IDAT", 4) == 0) {
+               compressed.insert(compressed.end(), chunk, chunk + length);
+          }
+          else if (memcmp(type, "IEND", 4) == 0) {
+               break;
+          }
+          p = chunk + length + 4; // Skip the CRC too
+     }
+     if (width == 0 || height == 0 || channels == 0 || compressed.empty() || (colourType == 3 && !hasPalette)) {
+          return false;
+     }
+
+     int inflatedSize;
+     unsigned char* inflated = (unsigned char*)stbi_zlib_decode_malloc((const char*)compressed.data(), (int)compressed.size(), &inflatedSize);
+     size_t stride = (size_t)width * channels;
+     if (!inflated || (size_t)inflatedSize < (stride + 1) * height) {
+          stbi_image_free(inflated);
+          return false;
+     }
+
+     // Each row starts with its filter byte, None and Sub rows don't look at the row above
+     // so every one of them starts a run of rows that can be unfiltered without waiting on the rest of the image
+     std::vector<uint32_t> runStarts;
+     for (uint32_t row = 0; row < height; row++) {
+          int filter = inflated[row * (stride + 1)];
+          if (filter > FILTER_PAETH) {
+               stbi_image_free(inflated);
+               return false;
+          }
+          if (row == 0 || filter == FILTER_NONE || filter == FILTER_SUB) {
+               runStarts.push_back(row);
+          }
+     }
+     runStarts.push_back(height);
+
+     unsigned char* pixels = (unsigned char*)malloc(stride * height);
+     if (!pixels) {
+          stbi_image_free(inflated);
+          return false;
+     }
+     std::vector<unsigned char> zeroRow(stride, 0);
+
+     ThreadPool::shared().parallelFor(runStarts.size() - 1, 1, [&](size_t begin, size_t end) {
+          for (size_t run = begin; run < end; run++) {
+               for (uint32_t row = runStarts[run]; row < runStarts[run + 1]; row++) {
+                    const unsigned char* raw = inflated + row * (stride + 1);
+                    const unsigned char* previous = row == 0 ? zeroRow.data() : pixels + (row - 1) * stride;
+                    unfilterRow(raw[0], raw + 1, previous, pixels + row * stride, stride, channels);
+               }
+          }
+     });
+     stbi_image_free(inflated);
+
+     // Nothing uploads 2 channel or palette images, so grey + alpha, palettes and anything with a tRNS colour come out as RGB or RGBA
+     int outputChannels = channels;
+     if (colourType == 3) {
+          outputChannels = hasTransparency ? 4 : 3;
+     }
+     else if (colourType == 4 || hasTransparency) {
+          outputChannels = 4;
+     }
+     if (outputChannels != channels || colourType == 3) {
+          unsigned char* expanded = (unsigned char*)malloc((size_t)width * height * outputChannels);
+          if (!expanded) {
+               free(pixels);
+               return false;
+          }
+          ThreadPool::shared().parallelFor(height, 64, [&](size_t begin, size_t end) {
+               for (size_t row = begin; row < end; row++) {
+                    const unsigned char* source = pixels + row * stride;
+                    unsigned char* destination = expanded + row * width * outputChannels;
+                    for (uint32_t x = 0; x < width; x++, source += channels, destination += outputChannels) {
+                         if (colourType == 3) {
+                              memcpy(destination, palette[source[0]], outputChannels);
+                         }
+                         else if (channels <= 2) {
+                              destination[0] = destination[1] = destination[2] = source[0];
+                              destination[3] = channels == 2 ? source[1] : (hasTransparency && source[0] == transparentColour[0] ? 0 : 255);
+                         }
+                         else {
+                              memcpy(destination, source, 3);
+                              destination[3] = memcmp(source, transparentColour, 3) == 0 ? 0 : 255;
+                         }
+                    }
+               }
+          });
+          free(pixels);
+          pixels = expanded;
+     }
+
+     image.width = (int)width;
+     image.height = (int)height;
+     image.channels = outputChannels;
+     image.pixels = pixels;
+     return true;
+}
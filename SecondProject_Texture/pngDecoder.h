@@ -0,0 +1,13 @@
+#pragma once
+#include "imageDecoder.h"
+
+// Non-interlaced 8 bit greyscale, RGB, palette and RGBA PNGs
+// Inflating goes through stb's zlib, the row unfiltering is split up between threads wherever a row doesn't depend on the one above it
+// Grey + alpha and anything with transparency from a tRNS chunk come out as RGBA, palettes as RGB or RGBA
+// 16 bit, palettes under 8 bits and interlaced files fail so they fall through to stb
+class PngDecoder : public ImageDecoder {
+public:
+     const char* name() const override { return "png (parallel unfilter)"; }
+     bool canDecode(const unsigned char* data, size_t size) const override;
+     bool decode(const unsigned char* data, size_t size, ImageData& image) override;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include "meshLod.h"
+#include "sceneGraph.h"
+
+// Components for the things the render loop draws, they all live in an EntityWorld
+
+// World matrix, copied out of the scene graph whenever the node moves
+struct Transform {
+     glm::mat4 world;
+};
+
+// The scene graph node that drives the transform
+struct SceneNode {
+     SceneGraph::Node node;
+};
+
+// Row in GpuTransformUpdater's instance buffer, for when the model matrix is built by the compute shader
+struct GpuInstance {
+     uint32_t index;
+};
+
+// firstIndex is where in the EBO the triangles start, so the detail levels of a mesh can share one buffer
+struct MeshHandle {
+     unsigned int vao;
+     int firstIndex;
+     int indexCount;
+};
+
+// A mesh's detail levels, the MeshHandle gets pointed at whichever one is picked each frame
+// The chain has to outlive the entity, current is kept from frame to frame for the hysteresis
+struct MeshLods {
+     const MeshLodLevel* levels;
+     int levelCount;
+     int current;
+};
+
+// Points at the texture names instead of copying them so hot reloaded textures still get picked up
+// shaderFeatures picks the shader variant (ShaderFeature flags), SHADER_INSTANCED gets added by the GPU transform path
+struct Material {
+     const unsigned int* textures[2];
+     uint32_t shaderFeatures;
+};
+
+// Bounding sphere in mesh space
+struct Bounds {
+     glm::vec3 center;
+     float radius;
+};
+
+// CPU copy of a mesh for the occlusion culler to rasterize, only on things big and solid enough to hide others behind them
+// Same vertex layout as the VAOs, the arrays have to outlive the entity
+struct Occluder {
+     const float* vertices;
+     int floatsPerVertex;
+     const unsigned int* indices;
+     int indexCount;
+};
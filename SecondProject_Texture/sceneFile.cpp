@@ -0,0 +1,287 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "sceneFile.h"
+
+static_assert(sizeof(SceneFileHeader) == 24, "The header is read straight out of the file");
+static_assert(sizeof(SceneFileSection) == 24, "Sections are read straight out of the file");
+static_assert(sizeof(glm::vec3) == 12 && sizeof(glm::vec4) == 16, "Columns are used straight out of the file");
+
+static const char SCENE_MAGIC[4] = { 'S', 'C', 'N', 'B' };
+
+glm::mat4 placementMatrix(const ScenePlacements& placements, size_t index) {
+     const glm::vec4& rotation = placements.rotations[index];
+     glm::mat4 model = glm::translate(glm::mat4(1.0f), placements.positions[index]);
+     model = model * glm::mat4_cast(glm::quat(rotation.w, rotation.x, rotation.y, rotation.z));
+     return glm::scale(model, placements.scales[index]);
+}
+
+void SceneColumns::add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+     positions.push_back(position);
+     rotations.push_back(glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
+     scales.push_back(scale);
+}
+
+ScenePlacements SceneColumns::getPlacements() const {
+     ScenePlacements placements;
+     placements.count = positions.size();
+     placements.positions = positions.data();
+     placements.rotations = rotations.data();
+     placements.scales = scales.data();
+     return placements;
+}
+
+SceneFile::~SceneFile() {
+     close();
+}
+
+bool SceneFile::open(const std::string& path) {
+     close();
+     if (!map(path)) {
+          return false;
+     }
+
+     SceneFileHeader header;
+     if (size < sizeof(header)) {
+          std::cout << "Scene file is too small to have a header: " << path << std::endl;
+          close();
+          return false;
+     }
+     memcpy(&header, data, sizeof(header));
+     if (memcmp(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0) {
+          std::cout << "Not a binary scene file: " << path << std::endl;
+          close();
+          return false;
+     }
+     if (header.version != SCENE_FILE_VERSION) {
+          std::cout << "Scene file " << path << " is version " << header.version << ", this reads version " << SCENE_FILE_VERSION << std::endl;
+          close();
+          return false;
+     }
+     if (header.headerBytes != sizeof(SceneFileHeader) + (uint64_t)header.sectionCount * sizeof(SceneFileSection) || header.headerBytes > size) {
+          std::cout << "Scene file's section table is cut short: " << path << std::endl;
+          close();
+          return false;
+     }
+
+     placements = ScenePlacements();
+     placements.count = (size_t)header.objectCount;
+     for (uint32_t i = 0; i < header.sectionCount; i++) {
+          SceneFileSection section;
+          memcpy(&section, data + sizeof(SceneFileHeader) + i * sizeof(SceneFileSection), sizeof(section));
+          if (section.id != SCENE_POSITIONS && section.id != SCENE_ROTATIONS && section.id != SCENE_SCALES) {
+               continue; // Something a later version added
+          }
+          // Written so none of it can overflow with a corrupt offset or size
+          bool inside = section.offset <= size && section.bytes <= size - section.offset;
+          bool aligned = section.offset % SCENE_FILE_ALIGNMENT == 0;
+          bool complete = section.elementBytes > 0 && header.objectCount <= section.bytes / section.elementBytes
+               && section.bytes == header.objectCount * section.elementBytes;
+          if (!inside || !aligned || !complete) {
+               std::cout << "Scene file section " << section.id << " is damaged: " << path << std::endl;
+               close();
+               return false;
+          }
+
+          const unsigned char* column = data + section.offset;
+          switch (section.id) {
+          case SCENE_POSITIONS:
+               placements.positions = section.elementBytes == sizeof(glm::vec3) ? (const glm::vec3*)column : nullptr;
+               break;
+          case SCENE_ROTATIONS:
+               placements.rotations = section.elementBytes == sizeof(glm::vec4) ? (const glm::vec4*)column : nullptr;
+               break;
+          case SCENE_SCALES:
+               placements.scales = section.elementBytes == sizeof(glm::vec3) ? (const glm::vec3*)column : nullptr;
+               break;
+          }
+     }
+     if (placements.count > 0 && (!placements.positions || !placements.rotations || !placements.scales)) {
+          std::cout << "Scene file is missing positions, rotations or scales: " << path << std::endl;
+          close();
+          return false;
+     }
+     return true;
+}
+
+void SceneFile::close() {
+     unmap();
+     placements = ScenePlacements();
+}
+
+#ifdef _WIN32
+
+bool SceneFile::map(const std::string& path) {
+     HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+     if (file == INVALID_HANDLE_VALUE) {
+          std::cout << "Failed to open scene file: " << path << std::endl;
+          return false;
+     }
+     LARGE_INTEGER fileSize;
+     if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+          std::cout << "Scene file is empty: " << path << std::endl;
+          CloseHandle(file);
+          return false;
+     }
+     HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+     void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+     if (!view) {
+          std::cout << "Failed to map scene file: " << path << std::endl;
+          if (mapping) {
+               CloseHandle(mapping);
+          }
+          CloseHandle(file);
+          return false;
+     }
+     fileHandle = file;
+     mappingHandle = mapping;
+     data = (const unsigned char*)view;
+     size = (size_t)fileSize.QuadPart;
+     return true;
+}
+
+void SceneFile::unmap() {
+     if (data) {
+          UnmapViewOfFile(data);
+          CloseHandle((HANDLE)mappingHandle);
+          CloseHandle((HANDLE)fileHandle);
+     }
+     data = nullptr;
+     size = 0;
+     fileHandle = mappingHandle = nullptr;
+}
+
+#else
+
+bool SceneFile::map(const std::string& path) {
+     int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+     if (fd < 0) {
+          std::cout << "Failed to open scene file: " << path << std::endl;
+          return false;
+     }
+     struct stat status;
+     if (fstat(fd, &status) != 0 || status.st_size == 0) {
+          std::cout << "Scene file is empty: " << path << std::endl;
+          ::close(fd);
+          return false;
+     }
+     void* view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+     ::close(fd); // The mapping keeps the file alive on its own
+     if (view == MAP_FAILED) {
+          std::cout << "Failed to map scene file: " << path << std::endl;
+          return false;
+     }
+     // Everything gets read front to back while the scene is built, so start reading ahead now
+     madvise(view, (size_t)status.st_size, MADV_WILLNEED);
+     data = (const unsigned char*)view;
+     size = (size_t)status.st_size;
+     return true;
+}
+
+void SceneFile::unmap() {
+     if (data) {
+          munmap((void*)data, size);
+     }
+     data = nullptr;
+     size = 0;
+}
+
+#endif
+
+static void writePadding(std::ofstream& file, uint64_t& written) {
+     static const char zeros[SCENE_FILE_ALIGNMENT] = {};
+     uint64_t padding = (SCENE_FILE_ALIGNMENT - written % SCENE_FILE_ALIGNMENT) % SCENE_FILE_ALIGNMENT;
+     file.write(zeros, (std::streamsize)padding);
+     written += padding;
+}
+
+bool writeSceneFile(const std::string& path, const ScenePlacements& placements) {
+     const void* columns[3] = { placements.positions, placements.rotations, placements.scales };
+     const uint32_t ids[3] = { SCENE_POSITIONS, SCENE_ROTATIONS, SCENE_SCALES };
+     const uint32_t elementBytes[3] = { sizeof(glm::vec3), sizeof(glm::vec4), sizeof(glm::vec3) };
+
+     SceneFileHeader header;
+     memcpy(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+     header.version = SCENE_FILE_VERSION;
+     header.objectCount = placements.count;
+     header.sectionCount = 3;
+     header.headerBytes = sizeof(SceneFileHeader) + 3 * sizeof(SceneFileSection);
+
+     SceneFileSection sections[3];
+     uint64_t offset = header.headerBytes;
+     for (int i = 0; i < 3; i++) {
+          offset = (offset + SCENE_FILE_ALIGNMENT - 1) / SCENE_FILE_ALIGNMENT * SCENE_FILE_ALIGNMENT;
+          sections[i] = { ids[i], elementBytes[i], offset, (uint64_t)placements.count * elementBytes[i] };
+          offset += sections[i].bytes;
+     }
+
+     std::ofstream file(path, std::ios::binary);
+     if (!file) {
+          std::cout << "Failed to create scene file: " << path << std::endl;
+          return false;
+     }
+     file.write((const char*)&header, sizeof(header));
+     file.write((const char*)sections, sizeof(sections));
+     uint64_t written = header.headerBytes;
+     for (int i = 0; i < 3; i++) {
+          writePadding(file, written);
+          file.write((const char*)columns[i], (std::streamsize)sections[i].bytes);
+          written += sections[i].bytes;
+     }
+     if (!file) {
+          std::cout << "Failed to write scene file: " << path << std::endl;
+          return false;
+     }
+     return true;
+}
+
+bool convertSceneText(const std::string& textPath, const std::string& binaryPath) {
+     std::ifstream text(textPath);
+     if (!text) {
+          std::cout << "Failed to open scene text: " << textPath << std::endl;
+          return false;
+     }
+     auto start = std::chrono::steady_clock::now();
+     SceneColumns columns;
+     std::string line;
+     int lineNumber = 0;
+     while (std::getline(text, line)) {
+          lineNumber++;
+          size_t first = line.find_first_not_of(" \t\r");
+          if (first == std::string::npos || line[first] == '#') {
+               continue;
+          }
+          glm::vec3 position, axis, scale(1.0f);
+          float angle;
+          int fields = sscanf(line.c_str(), "%f %f %f %f %f %f %f %f %f %f", &position.x, &position.y, &position.z, &axis.x, &axis.y, &axis.z, &angle,
+               &scale.x, &scale.y, &scale.z);
+          if ((fields != 7 && fields != 10) || glm::length(axis) == 0.0f) {
+               std::cout << textPath << ":" << lineNumber << ": expected position, rotation axis, angle and an optional scale" << std::endl;
+               return false;
+          }
+          columns.add(position, glm::angleAxis(glm::radians(angle), glm::normalize(axis)), scale);
+     }
+     ScenePlacements placements = columns.getPlacements();
+     if (!writeSceneFile(binaryPath, placements)) {
+          return false;
+     }
+     double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+     std::cout << "Converted " << placements.count << " objects from " << textPath << " to " << binaryPath << " in " << ms << " ms" << std::endl;
+     return true;
+}
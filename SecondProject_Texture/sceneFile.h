@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Binary scene files are a header, a table of sections and then one section per component column, each column being the
+// array exactly as it sits in memory, so loading is mapping the file and pointing at it
+// Little endian, which is everything this runs on, a big endian machine would just see the wrong version and refuse it
+const uint32_t SCENE_FILE_VERSION = 1;
+const uint64_t SCENE_FILE_ALIGNMENT = 64; // Every section starts on a multiple of this from the start of the file
+
+enum SceneSection : uint32_t {
+     SCENE_POSITIONS = 1, // glm::vec3
+     SCENE_ROTATIONS = 2, // Quaternions as glm::vec4 xyzw, glm::quat's member order depends on how glm was configured
+     SCENE_SCALES = 3 // glm::vec3
+};
+
+struct SceneFileHeader {
+     char magic[4]; // "SCNB"
+     uint32_t version;
+     uint64_t objectCount;
+     uint32_t sectionCount;
+     uint32_t headerBytes; // This plus the section table
+};
+
+struct SceneFileSection {
+     uint32_t id; // SceneSection, ones a reader doesn't know about are skipped
+     uint32_t elementBytes;
+     uint64_t offset;
+     uint64_t bytes;
+};
+
+// One column per component, object i is index i of each
+struct ScenePlacements {
+     size_t count = 0;
+     const glm::vec3* positions = nullptr;
+     const glm::vec4* rotations = nullptr;
+     const glm::vec3* scales = nullptr;
+};
+
+// translate * rotate * scale for one object
+glm::mat4 placementMatrix(const ScenePlacements& placements, size_t index);
+
+// Scene columns built up in memory, for the built in scene and for the converter to write out
+class SceneColumns {
+public:
+     void add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+     ScenePlacements getPlacements() const;
+
+private:
+     std::vector<glm::vec3> positions;
+     std::vector<glm::vec4> rotations;
+     std::vector<glm::vec3> scales;
+};
+
+// A binary scene file mapped read only, the placements point straight into the mapping so they're only valid while it's open
+class SceneFile {
+public:
+     SceneFile() = default;
+     ~SceneFile();
+     SceneFile(const SceneFile&) = delete;
+     SceneFile& operator=(const SceneFile&) = delete;
+
+     // Checks the header and that every section lies inside the file, but doesn't touch the data itself
+     bool open(const std::string& path);
+     void close();
+
+     bool isOpen() const { return data != nullptr; }
+     const ScenePlacements& getPlacements() const { return placements; }
+
+private:
+     bool map(const std::string& path);
+     void unmap();
+
+     const unsigned char* data = nullptr;
+     size_t size = 0;
+#ifdef _WIN32
+     void* fileHandle = nullptr;
+     void* mappingHandle = nullptr;
+#endif
+     ScenePlacements placements;
+};
+
+bool writeSceneFile(const std::string& path, const ScenePlacements& placements);
+
+// Text scenes have one object a line, position x y z, rotation axis x y z, angle in degrees and then an optional scale x y z
+// Blank lines and lines starting with # are skipped, for `--convert-scene <input.txt> <output.bin>`
+bool convertSceneText(const std::string& textPath, const std::string& binaryPath);
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <iostream>
+
+#include "sceneGraph.h"
+
+SceneGraph::Node SceneGraph::addNode(const glm::mat4& localTransform, Node parent) {
+     uint32_t parentIndex = NO_PARENT;
+     uint32_t depth = 0;
+     if (parent != NO_PARENT) {
+          if (parent >= indices.size()) {
+               std::cout << "Scene graph parent " << parent << " doesn't exist: Adding as a root instead" << std::endl;
+          }
+          else {
+               parentIndex = indices[parent];
+               depth = depths[parentIndex] + 1;
+          }
+     }
+
+     // Appending keeps the arrays in depth order as long as nothing shallower has been added yet, otherwise they get sorted on the next update
+     if (!depths.empty() && depth < depths.back()) {
+          needsSort = true;
+     }
+
+     Node node = (Node)nodes.size();
+     uint32_t index = (uint32_t)parents.size();
+     parents.push_back(parentIndex);
+     depths.push_back(depth);
+     localTransforms.push_back(localTransform);
+     worldTransforms.push_back(localTransform);
+     dirty.push_back(1);
+     moved.push_back(0);
+     nodes.push_back(node);
+     indices.push_back(index);
+     if (!needsSort) {
+          // The parent's level exists already, so this is either the end of the last level or the first node of a new one
+          if (depth < levelEnds.size()) {
+               levelEnds[depth] = index + 1;
+          }
+          else {
+               levelEnds.push_back(index + 1);
+          }
+     }
+     markDirty(index);
+     return node;
+}
+
+void SceneGraph::setLocalTransform(Node node, const glm::mat4& localTransform) {
+     uint32_t index = indices[node];
+     localTransforms[index] = localTransform;
+     markDirty(index);
+}
+
+void SceneGraph::markDirty(uint32_t index) {
+     dirty[index] = 1;
+     firstDirty = std::min(firstDirty, (size_t)index);
+     lastDirty = std::max(lastDirty, (size_t)index);
+}
+
+SceneGraph::Node SceneGraph::getParent(Node node) const {
+     uint32_t parentIndex = parents[indices[node]];
+     return parentIndex == NO_PARENT ? NO_PARENT : nodes[parentIndex];
+}
+
+void SceneGraph::update() {
+     if (needsSort) {
+          sortByDepth();
+     }
+
+     // One pass over everything that's dirty or was flagged as moved last time (which still needs clearing), parents before
+     // children
+     // Nothing before the start can change, and a node that moves only pushes the end out to the end of the level its children
+     // are in, so a node's whole subtree is always covered
+     size_t begin = std::min(firstDirty, firstMoved);
+     size_t end = std::max(lastDirty, lastMoved) + 1;
+     firstMoved = SIZE_MAX;
+     lastMoved = 0;
+     lastUpdateCount = 0;
+     for (size_t i = begin; i < end; i++) {
+          uint32_t parent = parents[i];
+          bool parentMoved = parent != NO_PARENT && moved[parent];
+          moved[i] = dirty[i] | parentMoved;
+          dirty[i] = 0;
+          if (!moved[i]) {
+               continue;
+          }
+          worldTransforms[i] = parent == NO_PARENT ? localTransforms[i] : worldTransforms[parent] * localTransforms[i];
+          firstMoved = std::min(firstMoved, i);
+          lastMoved = i;
+          lastUpdateCount++;
+          if (depths[i] + 1 < levelEnds.size()) {
+               end = std::max(end, (size_t)levelEnds[depths[i] + 1]);
+          }
+     }
+     firstDirty = SIZE_MAX;
+     lastDirty = 0;
+}
+
+void SceneGraph::sortByDepth() {
+     // Counting sort, it's stable so siblings keep the order they were added in
+     size_t count = parents.size();
+     uint32_t maxDepth = 0;
+     for (uint32_t depth : depths) {
+          maxDepth = std::max(maxDepth, depth);
+     }
+     std::vector<uint32_t> depthStarts(maxDepth + 2, 0);
+     for (uint32_t depth : depths) {
+          depthStarts[depth + 1]++;
+     }
+     for (uint32_t depth = 1; depth < depthStarts.size(); depth++) {
+          depthStarts[depth] += depthStarts[depth - 1];
+     }
+     std::vector<uint32_t> newIndices(count);
+     for (size_t i = 0; i < count; i++) {
+          newIndices[i] = depthStarts[depths[i]]++;
+     }
+     // Each level's start has been counted up to its end
+     levelEnds.assign(depthStarts.begin(), depthStarts.begin() + maxDepth + 1);
+
+     std::vector<uint32_t> sortedParents(count);
+     std::vector<uint32_t> sortedDepths(count);
+     std::vector<glm::mat4> sortedLocals(count);
+     std::vector<glm::mat4> sortedWorlds(count);
+     std::vector<uint8_t> sortedDirty(count);
+     std::vector<uint8_t> sortedMoved(count);
+     std::vector<Node> sortedNodes(count);
+     for (size_t i = 0; i < count; i++) {
+          uint32_t to = newIndices[i];
+          sortedParents[to] = parents[i] == NO_PARENT ? NO_PARENT : newIndices[parents[i]];
+          sortedDepths[to] = depths[i];
+          sortedLocals[to] = localTransforms[i];
+          sortedWorlds[to] = worldTransforms[i];
+          sortedDirty[to] = dirty[i];
+          sortedMoved[to] = moved[i];
+          sortedNodes[to] = nodes[i];
+          indices[nodes[i]] = to;
+     }
+     parents.swap(sortedParents);
+     depths.swap(sortedDepths);
+     localTransforms.swap(sortedLocals);
+     worldTransforms.swap(sortedWorlds);
+     dirty.swap(sortedDirty);
+     moved.swap(sortedMoved);
+     nodes.swap(sortedNodes);
+
+     // Everything's been shuffled, so both ranges are found again from the flags
+     firstDirty = firstMoved = SIZE_MAX;
+     lastDirty = lastMoved = 0;
+     for (size_t i = 0; i < count; i++) {
+          if (dirty[i]) {
+               markDirty((uint32_t)i);
+          }
+          if (moved[i]) {
+               firstMoved = std::min(firstMoved, i);
+               lastMoved = i;
+          }
+     }
+     needsSort = false;
+}
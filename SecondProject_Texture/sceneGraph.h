@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Parent/child transform hierarchy, world = parent's world * local
+// Nodes are kept structure-of-arrays and sorted by depth so every parent comes before its children, which means update
+// can bring the world matrices up to date in one pass over the stretch between the first and last dirty node
+// That stretch only grows past the last dirty node to take in the depth levels under nodes that moved, so dirty nodes that sit
+// together (an animated level, or one subtree added in one go) cost about what moved, and the rest of the graph isn't looked at
+class SceneGraph {
+public:
+     typedef uint32_t Node;
+     static const Node NO_PARENT = 0xFFFFFFFF;
+
+     // The parent has to exist already, nodes can't be moved to a new parent after they're added
+     Node addNode(const glm::mat4& localTransform, Node parent = NO_PARENT);
+
+     void setLocalTransform(Node node, const glm::mat4& localTransform);
+     const glm::mat4& getLocalTransform(Node node) const { return localTransforms[indices[node]]; }
+
+     // Only up to date after update
+     const glm::mat4& getWorldTransform(Node node) const { return worldTransforms[indices[node]]; }
+     bool worldChanged(Node node) const { return moved[indices[node]] != 0; } // In the last update
+
+     Node getParent(Node node) const;
+     size_t size() const { return nodes.size(); }
+
+     // Recomputes the world matrix of every dirty node and all their descendants
+     void update();
+
+     // How many world matrices the last update had to recompute
+     size_t getLastUpdateCount() const { return lastUpdateCount; }
+
+private:
+     void markDirty(uint32_t index);
+     void sortByDepth();
+
+     // All in depth order, parents always at a lower index than their children
+     std::vector<uint32_t> parents; // Index into these arrays, or NO_PARENT
+     std::vector<uint32_t> depths;
+     std::vector<glm::mat4> localTransforms;
+     std::vector<glm::mat4> worldTransforms;
+     std::vector<uint8_t> dirty; // Local transform set since the last update
+     std::vector<uint8_t> moved; // World transform recomputed in the last update
+     std::vector<Node> nodes; // Which node is at each index
+
+     std::vector<uint32_t> indices; // Where each node currently is in the arrays
+     std::vector<uint32_t> levelEnds; // One past the last index at each depth
+
+     // The first and last index with the dirty flag set, and with the moved flag from the last update, first is SIZE_MAX when none are
+     size_t firstDirty = SIZE_MAX;
+     size_t lastDirty = 0;
+     size_t firstMoved = SIZE_MAX;
+     size_t lastMoved = 0;
+     bool needsSort = false;
+     size_t lastUpdateCount = 0;
+};
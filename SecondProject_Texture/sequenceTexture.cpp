@@ -0,0 +1,253 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "sequenceTexture.h"
+#include "textureLoader.h"
+
+namespace fs = std::filesystem;
+
+// Stops a typo'd pattern that happens to match everything from counting forever
+static const int MAX_SEQUENCE_FRAMES = 100000;
+
+// Every frame is stored as RGBA so they all upload the same way, whatever the files were
+static void toRGBA(const ImageData& image, unsigned char* out) {
+     size_t pixelCount = (size_t)image.width * image.height;
+     for (size_t i = 0; i < pixelCount; i++) {
+          for (int c = 0; c < 4; c++) {
+               if (c < image.channels) {
+                    out[i * 4 + c] = image.pixels[i * image.channels + c];
+               }
+               else {
+                    out[i * 4 + c] = (c == 3) ? 255 : image.pixels[i * image.channels]; // Grey images fill in all three colours
+               }
+          }
+     }
+}
+
+SequenceTexture::~SequenceTexture() {
+     // The GL objects have to go with deleteResources while there's still a context, but the thread can't be left running
+     {
+          std::lock_guard<std::mutex> lock(slotMutex);
+          stopping = true;
+     }
+     decodeReady.notify_all();
+     if (decoderThread.joinable()) {
+          decoderThread.join();
+     }
+}
+
+unsigned int SequenceTexture::create(const std::string& pathPattern, int firstNumber, double framesPerSecond, bool flipVertically, bool loop) {
+     char path[1024];
+     for (int number = firstNumber; number < firstNumber + MAX_SEQUENCE_FRAMES; number++) {
+          snprintf(path, sizeof(path), pathPattern.c_str(), number);
+          std::error_code ec;
+          if (!fs::exists(path, ec)) {
+               break;
+          }
+          paths.push_back(path);
+     }
+     if (paths.empty()) {
+          std::cout << "No image sequence found at: " << pathPattern << std::endl;
+          return 0;
+     }
+
+     // The first frame sets the size and is shown straight away
+     ImageData first;
+     if (!loadImage(paths[0], flipVertically, first)) {
+          paths.clear();
+          return 0;
+     }
+     width = first.width;
+     height = first.height;
+     this->framesPerSecond = framesPerSecond;
+     flip = flipVertically;
+     looping = loop;
+     std::vector<unsigned char> pixels((size_t)width * height * 4);
+     toRGBA(first, pixels.data());
+     freeImage(first);
+
+     // No mipmaps, rebuilding them for every frame would cost more than the upload itself
+     glGenTextures(1, &texture);
+     glBindTexture(GL_TEXTURE_2D, texture);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+     glBindTexture(GL_TEXTURE_2D, 0);
+
+     glGenBuffers(PBO_COUNT, pixelBuffers);
+     for (int i = 0; i < PBO_COUNT; i++) {
+          glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[i]);
+          glBufferData(GL_PIXEL_UNPACK_BUFFER, pixels.size(), NULL, GL_STREAM_DRAW);
+     }
+     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+     shownPosition = 0;
+     stats.framesShown = 1;
+     secondStart = std::chrono::steady_clock::now();
+     decoderThread = std::thread(&SequenceTexture::decoderLoop, this);
+     queueDecodes(1);
+     return texture;
+}
+
+void SequenceTexture::update(double playbackSeconds) {
+     if (!texture) {
+          return;
+     }
+
+     int64_t target = (int64_t)std::floor(std::max(playbackSeconds, 0.0) * framesPerSecond);
+     if (!looping) {
+          target = std::min<int64_t>(target, (int64_t)paths.size() - 1);
+     }
+
+     // Show the newest decoded frame that's due, anything older than it never gets a turn
+     Slot* newest = nullptr;
+     {
+          std::lock_guard<std::mutex> lock(slotMutex);
+          for (Slot& slot : slots) {
+               bool due = slot.position > shownPosition && slot.position <= target;
+               if (due && slot.state == SLOT_READY && (!newest || slot.position > newest->position)) {
+                    newest = &slot;
+               }
+          }
+          for (Slot& slot : slots) {
+               bool passed = slot.position <= target && (slot.state == SLOT_READY || slot.state == SLOT_FAILED);
+               if (passed && &slot != newest) {
+                    slot.state = SLOT_EMPTY;
+               }
+          }
+          stats.framesDecoded = framesDecoded;
+     }
+     if (newest) {
+          // The slot stays READY until it's uploaded so the decoder leaves it alone
+          uploadSlot(*newest);
+          stats.framesShown++;
+          stats.framesDropped += newest->position - shownPosition - 1;
+          shownPosition = newest->position;
+          std::lock_guard<std::mutex> lock(slotMutex);
+          newest->state = SLOT_EMPTY;
+     }
+
+     // If playback has got ahead of decoding there's no point decoding frames that are already late
+     queueDecodes(std::max(shownPosition + 1, target));
+
+     std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+     double elapsed = std::chrono::duration<double>(now - secondStart).count();
+     if (elapsed >= 1.0) {
+          stats.uploadMBps = bytesUploadedThisSecond / (1024.0 * 1024.0) / elapsed;
+          bytesUploadedThisSecond = 0;
+          secondStart = now;
+     }
+}
+
+void SequenceTexture::queueDecodes(int64_t fromPosition) {
+     bool queued = false;
+     {
+          std::lock_guard<std::mutex> lock(slotMutex);
+          for (int64_t position = fromPosition; position < fromPosition + LOOKAHEAD; position++) {
+               if (!looping && position >= (int64_t)paths.size()) {
+                    break;
+               }
+               Slot& slot = slots[position % LOOKAHEAD];
+               if (slot.position == position && slot.state != SLOT_EMPTY) {
+                    continue; // Already on its way
+               }
+               if (slot.state == SLOT_DECODING || (slot.state == SLOT_READY && slot.position >= fromPosition)) {
+                    continue; // Still busy, it'll get picked up on a later frame
+               }
+               // Anything else in the slot is either empty or too late to be worth showing
+               slot.position = position;
+               slot.state = SLOT_QUEUED;
+               queued = true;
+          }
+     }
+     if (queued) {
+          decodeReady.notify_one();
+     }
+}
+
+void SequenceTexture::decoderLoop() {
+     while (true) {
+          Slot* slot = nullptr;
+          int64_t position;
+          {
+               std::unique_lock<std::mutex> lock(slotMutex);
+               // Earliest queued frame first, it's the one that'll be needed soonest
+               decodeReady.wait(lock, [&] {
+                    if (stopping) {
+                         return true;
+                    }
+                    for (Slot& candidate : slots) {
+                         if (candidate.state == SLOT_QUEUED && (!slot || candidate.position < slot->position)) {
+                              slot = &candidate;
+                         }
+                    }
+                    return slot != nullptr;
+               });
+               if (stopping) {
+                    return;
+               }
+               slot->state = SLOT_DECODING;
+               position = slot->position;
+          }
+
+          // The decoders spread big images over the thread pool themselves
+          ImageData image;
+          bool decoded = loadImage(paths[position % paths.size()], flip, image);
+          if (decoded && (image.width != width || image.height != height)) {
+               std::cout << "Image sequence frame is a different size to the first: " << paths[position % paths.size()] << std::endl;
+               decoded = false;
+          }
+          if (decoded) {
+               slot->pixels.resize((size_t)width * height * 4);
+               toRGBA(image, slot->pixels.data());
+          }
+          freeImage(image);
+
+          std::lock_guard<std::mutex> lock(slotMutex);
+          slot->state = decoded ? SLOT_READY : SLOT_FAILED;
+          framesDecoded++;
+     }
+}
+
+void SequenceTexture::uploadSlot(Slot& slot) {
+     // Invalidating lets the driver hand back fresh memory instead of waiting on the last upload from this buffer
+     size_t bytes = slot.pixels.size();
+     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[nextPixelBuffer]);
+     void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+     if (mapped) {
+          memcpy(mapped, slot.pixels.data(), bytes);
+          glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+          // With a buffer bound the last argument is an offset into it, and the copy into the texture happens on the GPU's time
+          glBindTexture(GL_TEXTURE_2D, texture);
+          glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+          glBindTexture(GL_TEXTURE_2D, 0);
+          stats.bytesUploaded += bytes;
+          bytesUploadedThisSecond += bytes;
+     }
+     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+     nextPixelBuffer = (nextPixelBuffer + 1) % PBO_COUNT;
+}
+
+void SequenceTexture::deleteResources() {
+     {
+          std::lock_guard<std::mutex> lock(slotMutex);
+          stopping = true;
+     }
+     decodeReady.notify_all();
+     if (decoderThread.joinable()) {
+          decoderThread.join();
+     }
+     if (texture) {
+          glDeleteTextures(1, &texture);
+          glDeleteBuffers(PBO_COUNT, pixelBuffers);
+          texture = 0;
+     }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SequenceTextureStats {
+     uint64_t framesShown = 0;
+     uint64_t framesDropped = 0; // Their time came and went before they were decoded
+     uint64_t framesDecoded = 0;
+     uint64_t bytesUploaded = 0;
+     // Over the last second
+     double uploadMBps = 0.0;
+};
+
+// A texture that plays a numbered image sequence (frame_0000.png, frame_0001.png...) like a video
+// Upcoming frames get decoded on a thread of its own a few ahead of the playhead, and update uploads whichever one is due through two
+// pixel buffer objects used turn about, so writing the next frame never has to wait for the GPU to finish reading the last one
+// The texture ID never changes, so materials can point at it like any other texture
+class SequenceTexture {
+public:
+     SequenceTexture() = default;
+     ~SequenceTexture();
+     SequenceTexture(const SequenceTexture&) = delete;
+     SequenceTexture& operator=(const SequenceTexture&) = delete;
+
+     // pathPattern is printf style with one integer, e.g. "frames/frame_%04d.png", numbered from firstNumber
+     // Frames are counted until a file is missing, every frame has to be the same size as the first
+     // Returns the texture ID, or 0 if the first frame couldn't be loaded
+     unsigned int create(const std::string& pathPattern, int firstNumber, double framesPerSecond, bool flipVertically, bool loop = true);
+
+     // Call once per frame on the render thread with the playback time, uploads the frame that should be showing if it's ready
+     void update(double playbackSeconds);
+
+     // Stops the decoder thread and deletes the GL objects, needs calling before glfwTerminate
+     void deleteResources();
+
+     unsigned int getTexture() const { return texture; }
+     int getFrameCount() const { return (int)paths.size(); }
+     const SequenceTextureStats& getStats() const { return stats; }
+
+private:
+     // Decoded frames waiting to be shown, indexed by position % LOOKAHEAD
+     // A position counts up forever so looping playback never confuses an old frame for a new one
+     enum SlotState {
+          SLOT_EMPTY,
+          SLOT_QUEUED,
+          SLOT_DECODING,
+          SLOT_READY,
+          SLOT_FAILED
+     };
+     struct Slot {
+          int64_t position = -1;
+          SlotState state = SLOT_EMPTY;
+          std::vector<unsigned char> pixels; // RGBA8, only touched by the decoder thread while SLOT_DECODING
+     };
+
+     static const int LOOKAHEAD = 4;
+     static const int PBO_COUNT = 2;
+
+     void queueDecodes(int64_t fromPosition);
+     void decoderLoop();
+     void uploadSlot(Slot& slot);
+
+     std::vector<std::string> paths;
+     int width = 0;
+     int height = 0;
+     double framesPerSecond = 0.0;
+     bool flip = false;
+     bool looping = true;
+
+     unsigned int texture = 0;
+     unsigned int pixelBuffers[PBO_COUNT] = {};
+     int nextPixelBuffer = 0;
+     int64_t shownPosition = -1;
+
+     Slot slots[LOOKAHEAD];
+     std::mutex slotMutex;
+     std::condition_variable decodeReady;
+     std::thread decoderThread;
+     uint64_t framesDecoded = 0; // Written by the decoder thread, copied into stats under the lock
+     bool stopping = false;
+
+     SequenceTextureStats stats;
+     uint64_t bytesUploadedThisSecond = 0;
+     std::chrono::steady_clock::time_point secondStart;
+};
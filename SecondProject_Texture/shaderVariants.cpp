@@ -0,0 +1,177 @@
+#include <glad/glad.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "shaderVariants.h"
+
+static const struct {
+     ShaderFeature feature;
+     const char* define;
+} FEATURE_DEFINES[] = {
+     { SHADER_INSTANCED, "INSTANCED" },
+     { SHADER_VERTEX_COLOR, "VERTEX_COLOR" },
+     { SHADER_TEXTURE, "TEXTURE" },
+     { SHADER_TEXTURE_MIX, "TEXTURE_MIX" },
+     { SHADER_DEPTH_ONLY, "DEPTH_ONLY" },
+     { SHADER_COUNT_FRAGMENTS, "COUNT_FRAGMENTS" }
+};
+
+std::string shaderDefines(uint32_t features) {
+     std::string defines;
+     for (const auto& entry : FEATURE_DEFINES) {
+          if (features & entry.feature) {
+               defines += "#define ";
+               defines += entry.define;
+               defines += "\n";
+          }
+     }
+     return defines;
+}
+
+// #version has to be the first thing in the source, so the defines go after it
+// The #line puts the numbering back so compile errors still point at the right line of the file
+static bool readShaderSource(const std::string& path, const std::string& defines, std::string& source) {
+     std::ifstream file(path);
+     if (!file) {
+          std::cout << "Failed to open shader: " << path << std::endl;
+          return false;
+     }
+     std::stringstream contents;
+     contents << file.rdbuf();
+     source = contents.str();
+
+     size_t versionLine = source.find("#version");
+     if (versionLine == std::string::npos) {
+          source = defines + "#line 1\n" + source;
+          return true;
+     }
+     size_t afterVersion = source.find('\n', versionLine);
+     if (afterVersion == std::string::npos) {
+          source += "\n";
+          afterVersion = source.size() - 1;
+     }
+     int nextLine = 2;
+     for (size_t i = 0; i < versionLine; i++) {
+          if (source[i] == '\n') {
+               nextLine++;
+          }
+     }
+     source.insert(afterVersion + 1, defines + "#line " + std::to_string(nextLine) + "\n");
+     return true;
+}
+
+static unsigned int compileStage(GLenum type, const std::string& path, const std::string& defines) {
+     std::string source;
+     if (!readShaderSource(path, defines, source)) {
+          return 0;
+     }
+     const char* sourcePointer = source.c_str();
+
+     char infoLog[1024];
+     int success;
+     unsigned int shader = glCreateShader(type);
+     glShaderSource(shader, 1, &sourcePointer, NULL);
+     glCompileShader(shader);
+     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+     if (!success) {
+          glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+          std::cout << "Failed to compile shader: " << path << "\n" << defines << infoLog << std::endl;
+          glDeleteShader(shader);
+          return 0;
+     }
+     return shader;
+}
+
+unsigned int compileShaderProgram(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines) {
+     unsigned int vertex = compileStage(GL_VERTEX_SHADER, vertexPath, defines);
+     unsigned int fragment = compileStage(GL_FRAGMENT_SHADER, fragmentPath, defines);
+     if (!vertex || !fragment) {
+          glDeleteShader(vertex); // Deleting 0 is silently ignored
+          glDeleteShader(fragment);
+          return 0;
+     }
+
+     char infoLog[1024];
+     int success;
+     unsigned int program = glCreateProgram();
+     glAttachShader(program, vertex);
+     glAttachShader(program, fragment);
+     glLinkProgram(program);
+     glDeleteShader(vertex);
+     glDeleteShader(fragment);
+     glGetProgramiv(program, GL_LINK_STATUS, &success);
+     if (!success) {
+          glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+          std::cout << "Failed to link shaders: " << vertexPath << ", " << fragmentPath << "\n" << defines << infoLog << std::endl;
+          glDeleteProgram(program);
+          return 0;
+     }
+     return program;
+}
+
+ShaderVariants::ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath)
+     : vertexPath(vertexPath), fragmentPath(fragmentPath) {
+}
+
+ShaderVariant ShaderVariants::get(uint32_t features) {
+     // Only a handful of variants ever get used, a linear search beats hashing
+     for (const ShaderVariant& variant : variants) {
+          if (variant.features == features) {
+               return variant;
+          }
+     }
+
+     // Failures get cached too, so a broken variant only prints its log once
+     ShaderVariant variant;
+     variant.features = features;
+     variant.program = compileShaderProgram(vertexPath, fragmentPath, shaderDefines(features));
+     setupVariant(variant);
+     std::lock_guard<std::mutex> lock(variantMutex);
+     variants.push_back(variant);
+     return variant;
+}
+
+void ShaderVariants::replace(uint32_t features, unsigned int program) {
+     for (ShaderVariant& variant : variants) {
+          if (variant.features == features) {
+               glDeleteProgram(variant.program);
+               variant.program = program;
+               setupVariant(variant);
+               return;
+          }
+     }
+     glDeleteProgram(program); // Not one of ours
+}
+
+std::vector<uint32_t> ShaderVariants::getBuiltFeatures() const {
+     std::lock_guard<std::mutex> lock(variantMutex);
+     std::vector<uint32_t> features;
+     for (const ShaderVariant& variant : variants) {
+          features.push_back(variant.features);
+     }
+     return features;
+}
+
+void ShaderVariants::deleteResources() {
+     std::lock_guard<std::mutex> lock(variantMutex);
+     for (ShaderVariant& variant : variants) {
+          glDeleteProgram(variant.program);
+     }
+     variants.clear();
+}
+
+// Sets the sampler units and grabs the uniform locations, uniforms a variant compiled out just come back as -1
+void ShaderVariants::setupVariant(ShaderVariant& variant) {
+     if (!variant.program) {
+          variant.model = variant.view = variant.projection = variant.transform = -1;
+          return;
+     }
+     glUseProgram(variant.program);
+     glUniform1i(glGetUniformLocation(variant.program, "ourTexture"), 0);
+     glUniform1i(glGetUniformLocation(variant.program, "ourTexture2"), 1);
+     variant.model = glGetUniformLocation(variant.program, "model");
+     variant.view = glGetUniformLocation(variant.program, "view");
+     variant.projection = glGetUniformLocation(variant.program, "projection");
+     variant.transform = glGetUniformLocation(variant.program, "transform");
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Feature flags for the cube shaders, each one turns into a #define at the top of both stages
+enum ShaderFeature : uint32_t {
+     SHADER_INSTANCED = 1 << 0, // INSTANCED, the model matrix comes per instance from the transform compute shader instead of a uniform
+     SHADER_VERTEX_COLOR = 1 << 1, // VERTEX_COLOR, multiplies in the vertex colours
+     SHADER_TEXTURE = 1 << 2, // TEXTURE, samples ourTexture
+     SHADER_TEXTURE_MIX = 1 << 3, // TEXTURE_MIX, mixes ourTexture2 in over it
+     SHADER_DEPTH_ONLY = 1 << 4, // DEPTH_ONLY, no colour at all, for the depth pre-pass
+     SHADER_COUNT_FRAGMENTS = 1 << 5 // COUNT_FRAGMENTS, counts shaded fragments for OverdrawCounter, needs GL 4.2
+};
+
+// One compiled permutation and where its uniforms are, -1 for any the variant compiled out
+struct ShaderVariant {
+     uint32_t features = 0;
+     unsigned int program = 0; // 0 if it failed to compile
+     int model = -1;
+     int view = -1;
+     int projection = -1;
+     int transform = -1;
+};
+
+// The #define lines for a set of features
+std::string shaderDefines(uint32_t features);
+
+// Compiles and links a vertex/fragment pair with the defines put straight after each #version line
+// Returns the program ID, or 0 (after printing the log) if either stage fails
+unsigned int compileShaderProgram(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines);
+
+// Every permutation of one vertex/fragment shader pair, compiled the first time something asks for it and cached by its features
+// Each material gets a program with only the code it needs instead of one shader branching on uniforms
+class ShaderVariants {
+public:
+     ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath);
+     ShaderVariants(const ShaderVariants&) = delete;
+     ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+     // Compiles the variant if it hasn't been asked for before, so call it for known materials at startup to avoid a hitch later
+     ShaderVariant get(uint32_t features);
+
+     // Swaps a recompiled program in for a variant, deleting the old one and looking its uniforms up again
+     void replace(uint32_t features, unsigned int program);
+
+     // Every variant built so far, safe to call from the asset reloader's thread
+     std::vector<uint32_t> getBuiltFeatures() const;
+
+     const std::string& getVertexPath() const { return vertexPath; }
+     const std::string& getFragmentPath() const { return fragmentPath; }
+     size_t getVariantCount() const { return variants.size(); }
+
+     // Needs calling before glfwTerminate
+     void deleteResources();
+
+private:
+     void setupVariant(ShaderVariant& variant);
+
+     std::string vertexPath;
+     std::string fragmentPath;
+     // Only changed by the render thread, which reads it without locking, the mutex is for getBuiltFeatures
+     std::vector<ShaderVariant> variants;
+     mutable std::mutex variantMutex;
+};
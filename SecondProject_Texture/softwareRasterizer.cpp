@@ -0,0 +1,498 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTER_USE_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+#include "softwareRasterizer.h"
+#include "threadPool.h"
+
+// Outcode bits for the clip planes
+enum ClipPlane {
+     CLIP_LEFT = 1 << 0,
+     CLIP_RIGHT = 1 << 1,
+     CLIP_BOTTOM = 1 << 2,
+     CLIP_TOP = 1 << 3,
+     CLIP_NEAR = 1 << 4,
+     CLIP_FAR = 1 << 5
+};
+
+// fragmentShader.vert mixes the second texture in at this much
+static const float TEXTURE_MIX = 0.2f;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+     return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint32_t packColour(const glm::vec4& colour) {
+     uint32_t r = (uint32_t)(glm::clamp(colour.x, 0.0f, 1.0f) * 255.0f + 0.5f);
+     uint32_t g = (uint32_t)(glm::clamp(colour.y, 0.0f, 1.0f) * 255.0f + 0.5f);
+     uint32_t b = (uint32_t)(glm::clamp(colour.z, 0.0f, 1.0f) * 255.0f + 0.5f);
+     uint32_t a = (uint32_t)(glm::clamp(colour.w, 0.0f, 1.0f) * 255.0f + 0.5f);
+     return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static int wrapCoord(int coord, int size) {
+     coord %= size;
+     return coord < 0 ? coord + size : coord;
+}
+
+bool SoftwareTexture::create(const ImageData& image) {
+     levels.clear();
+     if (!image.pixels || (image.channels != 1 && image.channels != 3 && image.channels != 4)) {
+          std::cout << "Unsupported image for a software texture" << std::endl;
+          return false;
+     }
+
+     // Same as the GL_RGB upload in createTexture, greyscale only fills red and alpha always comes out as 1
+     Level base;
+     base.width = image.width;
+     base.height = image.height;
+     base.texels.resize((size_t)image.width * image.height);
+     for (size_t i = 0; i < base.texels.size(); i++) {
+          const unsigned char* pixel = image.pixels + i * image.channels;
+          uint32_t r = pixel[0];
+          uint32_t g = image.channels >= 3 ? pixel[1] : 0;
+          uint32_t b = image.channels >= 3 ? pixel[2] : 0;
+          base.texels[i] = r | (g << 8) | (b << 16) | (255u << 24);
+     }
+     levels.push_back(std::move(base));
+
+     // Box filtered mips down to 1x1, the same as glGenerateMipmap gives on the usual drivers
+     while (levels.back().width > 1 || levels.back().height > 1) {
+          const Level& previous = levels.back();
+          Level level;
+          level.width = std::max(1, previous.width / 2);
+          level.height = std::max(1, previous.height / 2);
+          level.texels.resize((size_t)level.width * level.height);
+          for (int y = 0; y < level.height; y++) {
+               int y0 = std::min(y * 2, previous.height - 1);
+               int y1 = std::min(y * 2 + 1, previous.height - 1);
+               for (int x = 0; x < level.width; x++) {
+                    int x0 = std::min(x * 2, previous.width - 1);
+                    int x1 = std::min(x * 2 + 1, previous.width - 1);
+                    uint32_t texels[4] = {
+                         previous.texels[(size_t)y0 * previous.width + x0],
+                         previous.texels[(size_t)y0 * previous.width + x1],
+                         previous.texels[(size_t)y1 * previous.width + x0],
+                         previous.texels[(size_t)y1 * previous.width + x1]
+                    };
+                    uint32_t result = 0;
+                    for (int shift = 0; shift < 32; shift += 8) {
+                         uint32_t sum = 2;
+                         for (int i = 0; i < 4; i++) {
+                              sum += (texels[i] >> shift) & 0xFF;
+                         }
+                         result |= (sum / 4) << shift;
+                    }
+                    level.texels[(size_t)y * level.width + x] = result;
+               }
+          }
+          levels.push_back(std::move(level));
+     }
+     return true;
+}
+
+glm::vec4 SoftwareTexture::fetch(const Level& level, int x, int y) const {
+     uint32_t texel = level.texels[(size_t)y * level.width + x];
+     const float scale = 1.0f / 255.0f;
+     return glm::vec4((texel & 0xFF) * scale, ((texel >> 8) & 0xFF) * scale, ((texel >> 16) & 0xFF) * scale, (texel >> 24) * scale);
+}
+
+glm::vec4 SoftwareTexture::sampleNearest(const Level& level, float u, float v) const {
+     int x = wrapCoord((int)std::floor(u * level.width), level.width);
+     int y = wrapCoord((int)std::floor(v * level.height), level.height);
+     return fetch(level, x, y);
+}
+
+glm::vec4 SoftwareTexture::sampleBilinear(const Level& level, float u, float v) const {
+     // Texel centres are at half coords
+     float x = u * level.width - 0.5f;
+     float y = v * level.height - 0.5f;
+     float floorX = std::floor(x);
+     float floorY = std::floor(y);
+     float fracX = x - floorX;
+     float fracY = y - floorY;
+     int x0 = wrapCoord((int)floorX, level.width);
+     int y0 = wrapCoord((int)floorY, level.height);
+     int x1 = wrapCoord(x0 + 1, level.width);
+     int y1 = wrapCoord(y0 + 1, level.height);
+
+     glm::vec4 bottom = glm::mix(fetch(level, x0, y0), fetch(level, x1, y0), fracX);
+     glm::vec4 top = glm::mix(fetch(level, x0, y1), fetch(level, x1, y1), fracX);
+     return glm::mix(bottom, top, fracY);
+}
+
+glm::vec4 SoftwareTexture::sample(float u, float v, float dudx, float dvdx, float dudy, float dvdy) const {
+     if (levels.empty()) {
+          return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); // What GL gives for an incomplete texture
+     }
+
+     // The level of detail calculation from the GL spec, how many texels one pixel step covers
+     const Level& base = levels[0];
+     float xScale = std::sqrt(dudx * dudx * base.width * base.width + dvdx * dvdx * base.height * base.height);
+     float yScale = std::sqrt(dudy * dudy * base.width * base.width + dvdy * dvdy * base.height * base.height);
+     float lod = std::log2(std::max(xScale, yScale));
+
+     // Magnified, GL_NEAREST
+     if (!(lod > 0.0f)) {
+          return sampleNearest(base, u, v);
+     }
+
+     // Minified, GL_LINEAR_MIPMAP_LINEAR
+     int lastLevel = (int)levels.size() - 1;
+     if (lod >= lastLevel) {
+          return sampleBilinear(levels[lastLevel], u, v);
+     }
+     int level = (int)lod;
+     return glm::mix(sampleBilinear(levels[level], u, v), sampleBilinear(levels[level + 1], u, v), lod - level);
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height)
+     : width(width), height(height) {
+     stride = (width + 3) & ~3;
+     tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+     tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+     colourBuffer.resize((size_t)stride * height);
+     depthBuffer.resize((size_t)stride * height);
+     bins.resize((size_t)tilesX * tilesY);
+     clear(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+void SoftwareRasterizer::clear(const glm::vec4& colour) {
+     std::fill(colourBuffer.begin(), colourBuffer.end(), packColour(colour));
+     std::fill(depthBuffer.begin(), depthBuffer.end(), 1.0f);
+     triangles.clear();
+     for (std::vector<uint32_t>& bin : bins) {
+          bin.clear();
+     }
+     stats = SoftwareRenderStats();
+}
+
+void SoftwareRasterizer::bindTextures(const SoftwareTexture* texture, const SoftwareTexture* texture2) {
+     boundTextures[0] = texture;
+     boundTextures[1] = texture2;
+}
+
+void SoftwareRasterizer::drawElements(const float* vertices, const unsigned int* indices, int indexCount, const glm::mat4& mvp) {
+     auto start = std::chrono::steady_clock::now();
+
+     // Vertex shader, each vertex only gets transformed once however many triangles share it
+     unsigned int vertexCount = 0;
+     for (int i = 0; i < indexCount; i++) {
+          vertexCount = std::max(vertexCount, indices[i] + 1);
+     }
+     clipVertices.resize(vertexCount);
+     for (unsigned int i = 0; i < vertexCount; i++) {
+          const float* vertex = vertices + i * 8;
+          ClipVertex& out = clipVertices[i];
+          out.position = mvp * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+          out.u = vertex[6];
+          out.v = vertex[7];
+
+          const glm::vec4& p = out.position;
+          out.outcode = (p.x < -p.w ? CLIP_LEFT : 0) | (p.x > p.w ? CLIP_RIGHT : 0)
+               | (p.y < -p.w ? CLIP_BOTTOM : 0) | (p.y > p.w ? CLIP_TOP : 0)
+               | (p.z < -p.w ? CLIP_NEAR : 0) | (p.z > p.w ? CLIP_FAR : 0);
+     }
+
+     for (int i = 0; i + 2 < indexCount; i += 3) {
+          const ClipVertex& a = clipVertices[indices[i]];
+          const ClipVertex& b = clipVertices[indices[i + 1]];
+          const ClipVertex& c = clipVertices[indices[i + 2]];
+
+          // All outside the same plane, nothing to draw
+          if (a.outcode & b.outcode & c.outcode) {
+               continue;
+          }
+
+          // Only the near plane gets clipped properly, that's the one that would put w at or below 0
+          // The sides are handled by the bounding box and far by the depth test
+          if (!((a.outcode | b.outcode | c.outcode) & CLIP_NEAR)) {
+               setupTriangle(a, b, c);
+               continue;
+          }
+          const ClipVertex* input[3] = { &a, &b, &c };
+          ClipVertex polygon[4];
+          int count = 0;
+          for (int j = 0; j < 3; j++) {
+               const ClipVertex& current = *input[j];
+               const ClipVertex& next = *input[(j + 1) % 3];
+               float currentDistance = current.position.z + current.position.w;
+               float nextDistance = next.position.z + next.position.w;
+               if (currentDistance >= 0.0f) {
+                    polygon[count++] = current;
+               }
+               if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+                    float t = currentDistance / (currentDistance - nextDistance);
+                    ClipVertex& split = polygon[count++];
+                    split.position = glm::mix(current.position, next.position, t);
+                    split.u = glm::mix(current.u, next.u, t);
+                    split.v = glm::mix(current.v, next.v, t);
+                    split.outcode = 0;
+               }
+          }
+          for (int j = 1; j + 1 < count; j++) {
+               setupTriangle(polygon[0], polygon[j], polygon[j + 1]);
+          }
+     }
+     stats.geometryMs += millisecondsSince(start);
+}
+
+void SoftwareRasterizer::setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c) {
+     // Perspective divide and viewport transform, y goes up from the bottom row like GL's window coords
+     const ClipVertex* vertices[3] = { &a, &b, &c };
+     float x[3], y[3], z[3], inverseW[3], uOverW[3], vOverW[3];
+     for (int i = 0; i < 3; i++) {
+          const glm::vec4& p = vertices[i]->position;
+          inverseW[i] = 1.0f / p.w;
+          x[i] = (p.x * inverseW[i] * 0.5f + 0.5f) * width;
+          y[i] = (p.y * inverseW[i] * 0.5f + 0.5f) * height;
+          z[i] = p.z * inverseW[i] * 0.5f + 0.5f;
+          uOverW[i] = vertices[i]->u * inverseW[i];
+          vOverW[i] = vertices[i]->v * inverseW[i];
+     }
+
+     // Face culling is off in the GL path, so flip clockwise triangles round instead of dropping them
+     float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+     if (!(std::fabs(area) > 1e-6f)) {
+          return;
+     }
+     if (area < 0.0f) {
+          std::swap(x[1], x[2]);
+          std::swap(y[1], y[2]);
+          std::swap(z[1], z[2]);
+          std::swap(inverseW[1], inverseW[2]);
+          std::swap(uOverW[1], uOverW[2]);
+          std::swap(vOverW[1], vOverW[2]);
+          area = -area;
+     }
+
+     // Pixels whose centres could be inside
+     Triangle triangle;
+     triangle.minX = std::max(0, (int)std::ceil(std::min({ x[0], x[1], x[2] }) - 0.5f));
+     triangle.maxX = std::min(width - 1, (int)std::floor(std::max({ x[0], x[1], x[2] }) - 0.5f));
+     triangle.minY = std::max(0, (int)std::ceil(std::min({ y[0], y[1], y[2] }) - 0.5f));
+     triangle.maxY = std::min(height - 1, (int)std::floor(std::max({ y[0], y[1], y[2] }) - 0.5f));
+     if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+          return;
+     }
+
+     // Everything is measured from the first vertex to keep the floats small
+     triangle.originX = x[0];
+     triangle.originY = y[0];
+
+     // Edge k is opposite vertex k, so edge k / area is vertex k's barycentric weight
+     // A shared edge goes in opposite directions in its two triangles, so picking edges by the sign of A (then B) means exactly one of them owns the pixels on it
+     for (int k = 0; k < 3; k++) {
+          int from = (k + 1) % 3;
+          int to = (k + 2) % 3;
+          float edgeA = y[from] - y[to];
+          float edgeB = x[to] - x[from];
+          triangle.edgeA[k] = edgeA;
+          triangle.edgeB[k] = edgeB;
+          triangle.edgeC[k] = -(edgeA * (x[from] - x[0]) + edgeB * (y[from] - y[0]));
+          triangle.edgeInclusive[k] = edgeA > 0.0f || (edgeA == 0.0f && edgeB < 0.0f);
+     }
+
+     float inverseArea = 1.0f / area;
+     auto makePlane = [&](const float values[3]) {
+          float delta1 = values[1] - values[0];
+          float delta2 = values[2] - values[0];
+          Plane plane;
+          plane.dx = (delta1 * triangle.edgeA[1] + delta2 * triangle.edgeA[2]) * inverseArea;
+          plane.dy = (delta1 * triangle.edgeB[1] + delta2 * triangle.edgeB[2]) * inverseArea;
+          plane.base = values[0];
+          return plane;
+     };
+     triangle.depth = makePlane(z);
+     triangle.inverseW = makePlane(inverseW);
+     triangle.uOverW = makePlane(uOverW);
+     triangle.vOverW = makePlane(vOverW);
+     triangle.textures[0] = boundTextures[0];
+     triangle.textures[1] = boundTextures[1];
+
+     triangles.push_back(triangle);
+     stats.drawnTriangles++;
+     binTriangle((uint32_t)triangles.size() - 1);
+}
+
+void SoftwareRasterizer::binTriangle(uint32_t index) {
+     const Triangle& triangle = triangles[index];
+     int firstTileX = triangle.minX / TILE_SIZE;
+     int lastTileX = triangle.maxX / TILE_SIZE;
+     int firstTileY = triangle.minY / TILE_SIZE;
+     int lastTileY = triangle.maxY / TILE_SIZE;
+
+     for (int tileY = firstTileY; tileY <= lastTileY; tileY++) {
+          for (int tileX = firstTileX; tileX <= lastTileX; tileX++) {
+               // Skip tiles the bounding box touches but the triangle doesn't, checking the tile corner furthest inside each edge
+               float left = tileX * TILE_SIZE + 0.5f - triangle.originX;
+               float right = std::min((tileX + 1) * TILE_SIZE, width) - 0.5f - triangle.originX;
+               float bottom = tileY * TILE_SIZE + 0.5f - triangle.originY;
+               float top = std::min((tileY + 1) * TILE_SIZE, height) - 0.5f - triangle.originY;
+               bool outside = false;
+               for (int k = 0; k < 3 && !outside; k++) {
+                    float cornerX = triangle.edgeA[k] > 0.0f ? right : left;
+                    float cornerY = triangle.edgeB[k] > 0.0f ? top : bottom;
+                    outside = triangle.edgeA[k] * cornerX + triangle.edgeB[k] * cornerY + triangle.edgeC[k] < 0.0f;
+               }
+               if (!outside) {
+                    bins[(size_t)tileY * tilesX + tileX].push_back(index);
+                    stats.binnedTriangles++;
+               }
+          }
+     }
+}
+
+void SoftwareRasterizer::flush() {
+     auto start = std::chrono::steady_clock::now();
+     ThreadPool::shared().parallelFor(bins.size(), 1, [this](size_t begin, size_t end) {
+          for (size_t tile = begin; tile < end; tile++) {
+               rasterizeTile((int)tile);
+          }
+     });
+     triangles.clear();
+     for (std::vector<uint32_t>& bin : bins) {
+          bin.clear();
+     }
+     stats.rasterMs += millisecondsSince(start);
+}
+
+void SoftwareRasterizer::rasterizeTile(int tileIndex) {
+     int tileX0 = (tileIndex % tilesX) * TILE_SIZE;
+     int tileY0 = (tileIndex / tilesX) * TILE_SIZE;
+     int tileX1 = std::min(tileX0 + TILE_SIZE, width);
+     int tileY1 = std::min(tileY0 + TILE_SIZE, height);
+
+     for (uint32_t index : bins[tileIndex]) {
+          const Triangle& triangle = triangles[index];
+          int startX = std::max(triangle.minX, tileX0) & ~3; // Tiles start on a multiple of 4 so this stays inside the tile
+          int endX = std::min(triangle.maxX + 1, tileX1);
+          int startY = std::max(triangle.minY, tileY0);
+          int endY = std::min(triangle.maxY + 1, tileY1);
+
+          for (int y = startY; y < endY; y++) {
+               float pixelY = y + 0.5f - triangle.originY;
+               uint32_t* colourRow = colourBuffer.data() + (size_t)y * stride;
+               float* depthRow = depthBuffer.data() + (size_t)y * stride;
+#ifdef RASTER_USE_SSE2
+               // 4 pixels at a time, everything linear is evaluated for the whole group and only the texturing is done per pixel
+               __m128 rowEdge[3], edgeA[3], inclusive[3];
+               for (int k = 0; k < 3; k++) {
+                    rowEdge[k] = _mm_set1_ps(triangle.edgeB[k] * pixelY + triangle.edgeC[k]);
+                    edgeA[k] = _mm_set1_ps(triangle.edgeA[k]);
+                    inclusive[k] = _mm_castsi128_ps(_mm_set1_epi32(triangle.edgeInclusive[k] ? -1 : 0));
+               }
+               const Plane* planes[4] = { &triangle.depth, &triangle.inverseW, &triangle.uOverW, &triangle.vOverW };
+               __m128 rowPlane[4], planeDx[4];
+               for (int p = 0; p < 4; p++) {
+                    rowPlane[p] = _mm_set1_ps(planes[p]->dy * pixelY + planes[p]->base);
+                    planeDx[p] = _mm_set1_ps(planes[p]->dx);
+               }
+               const __m128 zero = _mm_setzero_ps();
+               const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+               const __m128 rowEnd = _mm_set1_ps(endX - triangle.originX);
+
+               for (int x = startX; x < endX; x += 4) {
+                    __m128 pixelX = _mm_add_ps(_mm_set1_ps(x - triangle.originX), laneOffsets);
+                    __m128 mask = _mm_cmplt_ps(pixelX, rowEnd);
+                    for (int k = 0; k < 3; k++) {
+                         __m128 edge = _mm_add_ps(_mm_mul_ps(edgeA[k], pixelX), rowEdge[k]);
+                         __m128 inside = _mm_or_ps(_mm_cmpgt_ps(edge, zero), _mm_and_ps(_mm_cmpeq_ps(edge, zero), inclusive[k]));
+                         mask = _mm_and_ps(mask, inside);
+                    }
+                    if (_mm_movemask_ps(mask) == 0) {
+                         continue;
+                    }
+
+                    // GL_LESS
+                    __m128 depth = _mm_add_ps(_mm_mul_ps(planeDx[0], pixelX), rowPlane[0]);
+                    __m128 stored = _mm_loadu_ps(depthRow + x);
+                    mask = _mm_and_ps(mask, _mm_cmplt_ps(depth, stored));
+                    int lanes = _mm_movemask_ps(mask);
+                    if (lanes == 0) {
+                         continue;
+                    }
+                    _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, depth), _mm_andnot_ps(mask, stored)));
+
+                    alignas(16) float inverseW[4], uOverW[4], vOverW[4];
+                    _mm_store_ps(inverseW, _mm_add_ps(_mm_mul_ps(planeDx[1], pixelX), rowPlane[1]));
+                    _mm_store_ps(uOverW, _mm_add_ps(_mm_mul_ps(planeDx[2], pixelX), rowPlane[2]));
+                    _mm_store_ps(vOverW, _mm_add_ps(_mm_mul_ps(planeDx[3], pixelX), rowPlane[3]));
+                    for (int lane = 0; lane < 4; lane++) {
+                         if (lanes & (1 << lane)) {
+                              colourRow[x + lane] = shadePixel(triangle, inverseW[lane], uOverW[lane], vOverW[lane]);
+                         }
+                    }
+               }
+#else
+               for (int x = startX; x < endX; x++) {
+                    float pixelX = x + 0.5f - triangle.originX;
+                    bool inside = true;
+                    for (int k = 0; k < 3 && inside; k++) {
+                         float edge = triangle.edgeA[k] * pixelX + (triangle.edgeB[k] * pixelY + triangle.edgeC[k]);
+                         inside = edge > 0.0f || (edge == 0.0f && triangle.edgeInclusive[k]);
+                    }
+                    if (!inside) {
+                         continue;
+                    }
+                    float depth = triangle.depth.dx * pixelX + (triangle.depth.dy * pixelY + triangle.depth.base);
+                    if (!(depth < depthRow[x])) {
+                         continue;
+                    }
+                    depthRow[x] = depth;
+                    float inverseW = triangle.inverseW.dx * pixelX + (triangle.inverseW.dy * pixelY + triangle.inverseW.base);
+                    float uOverW = triangle.uOverW.dx * pixelX + (triangle.uOverW.dy * pixelY + triangle.uOverW.base);
+                    float vOverW = triangle.vOverW.dx * pixelX + (triangle.vOverW.dy * pixelY + triangle.vOverW.base);
+                    colourRow[x] = shadePixel(triangle, inverseW, uOverW, vOverW);
+               }
+#endif
+          }
+     }
+}
+
+// fragmentShader.vert
+uint32_t SoftwareRasterizer::shadePixel(const Triangle& triangle, float inverseW, float uOverW, float vOverW) const {
+     float w = 1.0f / inverseW;
+     float u = uOverW * w;
+     float v = vOverW * w;
+
+     // The GPU gets these from neighbouring pixels, here they come straight from the planes with the quotient rule
+     float dudx = (triangle.uOverW.dx - u * triangle.inverseW.dx) * w;
+     float dudy = (triangle.uOverW.dy - u * triangle.inverseW.dy) * w;
+     float dvdx = (triangle.vOverW.dx - v * triangle.inverseW.dx) * w;
+     float dvdy = (triangle.vOverW.dy - v * triangle.inverseW.dy) * w;
+
+     glm::vec4 colours[2];
+     for (int i = 0; i < 2; i++) {
+          colours[i] = triangle.textures[i] ? triangle.textures[i]->sample(u, v, dudx, dvdx, dudy, dvdy) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+     }
+     return packColour(glm::mix(colours[0], colours[1], TEXTURE_MIX));
+}
+
+bool SoftwareRasterizer::writePPM(const std::string& path) const {
+     std::ofstream file(path, std::ios::binary);
+     if (!file) {
+          std::cout << "Failed to open " << path << " for writing" << std::endl;
+          return false;
+     }
+     file << "P6\n" << width << " " << height << "\n255\n";
+     std::vector<unsigned char> row((size_t)width * 3);
+     for (int y = height - 1; y >= 0; y--) {
+          for (int x = 0; x < width; x++) {
+               uint32_t pixel = getPixel(x, y);
+               row[x * 3] = pixel & 0xFF;
+               row[x * 3 + 1] = (pixel >> 8) & 0xFF;
+               row[x * 3 + 2] = (pixel >> 16) & 0xFF;
+          }
+          file.write((const char*)row.data(), row.size());
+     }
+     return (bool)file;
+}
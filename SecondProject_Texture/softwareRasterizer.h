@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "textureLoader.h"
+
+// A texture in system memory with its whole mip chain, sampled the same way createTexture sets GL up
+// Repeat wrapping, nearest when magnified and trilinear (GL_LINEAR_MIPMAP_LINEAR) when minified
+class SoftwareTexture {
+public:
+     bool create(const ImageData& image);
+
+     // The derivatives are in texture coords per pixel, they pick the mip level like GL does
+     glm::vec4 sample(float u, float v, float dudx, float dvdx, float dudy, float dvdy) const;
+
+     bool isEmpty() const { return levels.empty(); }
+
+private:
+     struct Level {
+          int width;
+          int height;
+          std::vector<uint32_t> texels; // RGBA8, first row is t = 0 like the GL upload
+     };
+
+     glm::vec4 fetch(const Level& level, int x, int y) const;
+     glm::vec4 sampleNearest(const Level& level, float u, float v) const;
+     glm::vec4 sampleBilinear(const Level& level, float u, float v) const;
+
+     std::vector<Level> levels;
+};
+
+struct SoftwareRenderStats {
+     int drawnTriangles = 0; // After clipping
+     int binnedTriangles = 0; // Counting each tile a triangle lands in
+     double geometryMs = 0.0; // Transform, clip, setup and binning
+     double rasterMs = 0.0;
+};
+
+// CPU version of the cube pass, for machines without a GL driver and as a reference image to check the GL output against
+// drawElements transforms, clips and sets up triangles then bins them into screen tiles, flush rasterizes the tiles in parallel
+// Tiles never share pixels so the workers don't need any locking, and triangles stay in draw order within each tile
+class SoftwareRasterizer {
+public:
+     SoftwareRasterizer(int width, int height);
+
+     // Like glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT), also throws away anything not flushed yet
+     void clear(const glm::vec4& colour);
+
+     // Texture units 0 and 1, ourTexture and ourTexture2 in the fragment shader
+     void bindTextures(const SoftwareTexture* texture, const SoftwareTexture* texture2);
+
+     // Same vertex layout as the VAOs (position, colour, texture coords, 8 floats a vertex)
+     // mvp is projection * view * model * transform, the same order as vertexShader.vert
+     void drawElements(const float* vertices, const unsigned int* indices, int indexCount, const glm::mat4& mvp);
+
+     // Rasterizes everything drawn since the last flush
+     void flush();
+
+     int getWidth() const { return width; }
+     int getHeight() const { return height; }
+     uint32_t getPixel(int x, int y) const { return colourBuffer[(size_t)y * stride + x]; } // RGBA8, bottom row first like glReadPixels
+     const SoftwareRenderStats& getStats() const { return stats; }
+
+     // Binary PPM, flipped so the top row comes first
+     bool writePPM(const std::string& path) const;
+
+private:
+     static const int TILE_SIZE = 64;
+
+     // Something linear in screen space, value = dx * (x - x0) + dy * (y - y0) + base
+     struct Plane {
+          float dx, dy, base;
+     };
+
+     // Everything the tiles need, worked out once when the triangle is drawn
+     struct Triangle {
+          float edgeA[3], edgeB[3], edgeC[3]; // Edge functions, inside is >= 0 (or > 0 for edges the fill rule leaves out)
+          bool edgeInclusive[3];
+          float originX, originY;
+          Plane depth;
+          Plane inverseW;
+          Plane uOverW, vOverW; // Divided by w so they're linear in screen space
+          int minX, minY, maxX, maxY;
+          const SoftwareTexture* textures[2];
+     };
+
+     struct ClipVertex {
+          glm::vec4 position;
+          float u, v;
+          int outcode; // Which clip planes it's outside of
+     };
+
+     void setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+     void binTriangle(uint32_t index);
+     void rasterizeTile(int tileIndex);
+     uint32_t shadePixel(const Triangle& triangle, float inverseW, float uOverW, float vOverW) const;
+
+     int width;
+     int height;
+     int stride; // Rounded up to a multiple of 4 so rows can be read 4 pixels at a time
+     int tilesX;
+     int tilesY;
+     std::vector<uint32_t> colourBuffer;
+     std::vector<float> depthBuffer;
+
+     std::vector<ClipVertex> clipVertices; // Kept between draws so the space gets reused
+     std::vector<Triangle> triangles;
+     std::vector<std::vector<uint32_t>> bins; // Triangle indices for each tile, in draw order
+     const SoftwareTexture* boundTextures[2] = { nullptr, nullptr };
+     SoftwareRenderStats stats;
+};
@@ -0,0 +1,12 @@
+#version 450 core
+out vec4 FragColor;
+
+in vec3 texCoord;
+in vec4 tint;
+
+uniform sampler2DArray sprites;
+
+void main()
+{
+   FragColor = texture(sprites, texCoord) * tint;
+}
@@ -0,0 +1,17 @@
+#version 450 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec3 aTexCoord; // The layer's in z
+layout (location = 2) in vec4 aTint;
+
+out vec3 texCoord;
+out vec4 tint;
+
+uniform mat4 projection;
+
+// The corners were rotated and placed on the CPU, they're already in pixels
+void main()
+{
+   gl_Position = projection * vec4(aPos, 0.0, 1.0);
+   texCoord = aTexCoord;
+   tint = aTint;
+}
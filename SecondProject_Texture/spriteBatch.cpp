@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "shaderVariants.h"
+#include "spriteBatch.h"
+
+namespace {
+
+const int SHAPE_LAYERS = 4;
+// Two triangles per sprite out of its 4 corners, top left, top right, bottom left, bottom right
+const unsigned int QUAD_INDICES[6] = { 0, 2, 1, 1, 2, 3 };
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+     return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+bool SpriteBatch::create(const std::string& vertexPath, const std::string& fragmentPath, size_t maxSprites) {
+     program = compileShaderProgram(vertexPath, fragmentPath, "");
+     if (!program) {
+          return false;
+     }
+     projectionLocation = glGetUniformLocation(program, "projection");
+     texturesLocation = glGetUniformLocation(program, "sprites");
+     this->maxSprites = maxSprites;
+     sprites.resize(maxSprites);
+     order.resize(maxSprites);
+
+     std::vector<unsigned int> indices(maxSprites * 6);
+     for (size_t i = 0; i < maxSprites; i++) {
+          for (int corner = 0; corner < 6; corner++) {
+               indices[i * 6 + corner] = (unsigned int)(i * 4 + QUAD_INDICES[corner]);
+          }
+     }
+     // Room for two full batches, so a frame's worth can go in while the last one's still being drawn from
+     bufferVertices = maxSprites * 4 * 2;
+
+     glGenVertexArrays(1, &vertexArray);
+     glGenBuffers(1, &vertexBuffer);
+     glGenBuffers(1, &indexBuffer);
+     glBindVertexArray(vertexArray);
+     glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+     glBufferData(GL_ARRAY_BUFFER, bufferVertices * sizeof(SpriteVertex), NULL, GL_STREAM_DRAW);
+     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)0);
+     glEnableVertexAttribArray(0);
+     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)(2 * sizeof(float)));
+     glEnableVertexAttribArray(1);
+     glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (void*)(5 * sizeof(float)));
+     glEnableVertexAttribArray(2);
+     glBindVertexArray(0);
+     glBindBuffer(GL_ARRAY_BUFFER, 0);
+     nextVertex = 0;
+     return true;
+}
+
+void SpriteBatch::begin(int viewportWidth, int viewportHeight, bool sortByTexture) {
+     projection = glm::ortho(0.0f, (float)viewportWidth, (float)viewportHeight, 0.0f, -1.0f, 1.0f);
+     this->sortByTexture = sortByTexture;
+     stats.sprites = 0;
+     stats.dropped = 0;
+}
+
+void SpriteBatch::draw(const Sprite& sprite) {
+     if (stats.sprites == maxSprites) {
+          stats.dropped++;
+          return;
+     }
+     sprites[stats.sprites++] = sprite;
+}
+
+void SpriteBatch::end() {
+     stats.drawCalls = 0;
+     stats.bytes = 0;
+     size_t count = stats.sprites;
+     if (!isSupported() || count == 0) {
+          return;
+     }
+
+     // The submission index in the low bits keeps the sort stable without std::stable_sort's buffer
+     auto start = std::chrono::steady_clock::now();
+     for (size_t i = 0; i < count; i++) {
+          order[i] = (sortByTexture ? (uint64_t)sprites[i].texture << 32 : 0) | i;
+     }
+     if (sortByTexture) {
+          std::sort(order.begin(), order.begin() + count);
+     }
+     stats.sortMs = millisecondsSince(start);
+
+     // Carry on after the last batch, or start the buffer again once it's full
+     start = std::chrono::steady_clock::now();
+     size_t vertexCount = count * 4;
+     GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+     glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+     if (nextVertex + vertexCount > bufferVertices) {
+          glBufferData(GL_ARRAY_BUFFER, bufferVertices * sizeof(SpriteVertex), NULL, GL_STREAM_DRAW);
+          nextVertex = 0;
+          stats.orphans++;
+     }
+     SpriteVertex* vertices = (SpriteVertex*)glMapBufferRange(GL_ARRAY_BUFFER, nextVertex * sizeof(SpriteVertex), vertexCount * sizeof(SpriteVertex), access);
+     if (!vertices) {
+          std::cout << "Couldn't map the sprite buffer" << std::endl;
+          glBindBuffer(GL_ARRAY_BUFFER, 0);
+          return;
+     }
+     for (size_t i = 0; i < count; i++) {
+          const Sprite& sprite = sprites[(uint32_t)order[i]];
+          float halfWidth = sprite.size.x * 0.5f;
+          float halfHeight = sprite.size.y * 0.5f;
+          // Each corner is centre + x axis * x + y axis * y, the axes only need a sine and cosine when there's a rotation
+          glm::vec2 xAxis = glm::vec2(halfWidth, 0.0f);
+          glm::vec2 yAxis = glm::vec2(0.0f, halfHeight);
+          if (sprite.rotation != 0.0f) {
+               float c = std::cos(sprite.rotation);
+               float s = std::sin(sprite.rotation);
+               xAxis = glm::vec2(c * halfWidth, s * halfWidth);
+               yAxis = glm::vec2(-s * halfHeight, c * halfHeight);
+          }
+          float layer = (float)sprite.layer;
+          SpriteVertex* corner = vertices + i * 4;
+          glm::vec2 topLeft = sprite.position - xAxis - yAxis;
+          glm::vec2 topRight = sprite.position + xAxis - yAxis;
+          glm::vec2 bottomLeft = sprite.position - xAxis + yAxis;
+          glm::vec2 bottomRight = sprite.position + xAxis + yAxis;
+          corner[0] = { topLeft.x, topLeft.y, sprite.uvRect.x, sprite.uvRect.y, layer, sprite.tint };
+          corner[1] = { topRight.x, topRight.y, sprite.uvRect.z, sprite.uvRect.y, layer, sprite.tint };
+          corner[2] = { bottomLeft.x, bottomLeft.y, sprite.uvRect.x, sprite.uvRect.w, layer, sprite.tint };
+          corner[3] = { bottomRight.x, bottomRight.y, sprite.uvRect.z, sprite.uvRect.w, layer, sprite.tint };
+     }
+     glUnmapBuffer(GL_ARRAY_BUFFER);
+     glBindBuffer(GL_ARRAY_BUFFER, 0);
+     stats.writeMs = millisecondsSince(start);
+     stats.bytes = vertexCount * sizeof(SpriteVertex);
+
+     start = std::chrono::steady_clock::now();
+     glDisable(GL_DEPTH_TEST);
+     glEnable(GL_BLEND);
+     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+     glUseProgram(program);
+     glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+     glUniform1i(texturesLocation, 0);
+     glActiveTexture(GL_TEXTURE0);
+     glBindVertexArray(vertexArray);
+     size_t runStart = 0;
+     for (size_t i = 1; i <= count; i++) {
+          unsigned int texture = sprites[(uint32_t)order[runStart]].texture;
+          if (i < count && sprites[(uint32_t)order[i]].texture == texture) {
+               continue;
+          }
+          glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+          glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)((i - runStart) * 6), GL_UNSIGNED_INT, (void*)(runStart * 6 * sizeof(unsigned int)), (GLint)nextVertex);
+          stats.drawCalls++;
+          runStart = i;
+     }
+     glBindVertexArray(0);
+     glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+     glDisable(GL_BLEND);
+     glEnable(GL_DEPTH_TEST);
+     nextVertex += vertexCount;
+     stats.submitMs = millisecondsSince(start);
+}
+
+void SpriteBatch::deleteResources() {
+     if (!program) {
+          return;
+     }
+     glDeleteProgram(program);
+     glDeleteVertexArrays(1, &vertexArray);
+     glDeleteBuffers(1, &vertexBuffer);
+     glDeleteBuffers(1, &indexBuffer);
+     program = vertexArray = vertexBuffer = indexBuffer = 0;
+}
+
+unsigned int createSpriteShapeTexture(int size) {
+     std::vector<uint8_t> pixels((size_t)size * size * SHAPE_LAYERS * 4);
+     float edge = 1.5f / size; // How far the edges fade over, about a pixel and a half
+     for (int layer = 0; layer < SHAPE_LAYERS; layer++) {
+          for (int y = 0; y < size; y++) {
+               for (int x = 0; x < size; x++) {
+                    // -1 to 1 across the texture, the shapes fill about 90% of it
+                    float u = ((x + 0.5f) / size) * 2.0f - 1.0f;
+                    float v = ((y + 0.5f) / size) * 2.0f - 1.0f;
+                    float distance; // Signed distance to the edge, negative inside
+                    switch (layer) {
+                    case 0: distance = std::sqrt(u * u + v * v) - 0.9f; break;
+                    case 1: distance = std::fabs(std::sqrt(u * u + v * v) - 0.7f) - 0.2f; break;
+                    case 2: {
+                         float dx = std::max(std::fabs(u) - 0.6f, 0.0f);
+                         float dy = std::max(std::fabs(v) - 0.6f, 0.0f);
+                         distance = std::sqrt(dx * dx + dy * dy) - 0.3f;
+                         break;
+                    }
+                    default: distance = (std::fabs(u) + std::fabs(v)) * 0.7071f - 0.65f; break;
+                    }
+                    float alpha = std::min(std::max(0.5f - distance / edge, 0.0f), 1.0f);
+                    uint8_t* pixel = pixels.data() + (((size_t)layer * size + y) * size + x) * 4;
+                    pixel[0] = pixel[1] = pixel[2] = 255;
+                    pixel[3] = (uint8_t)(alpha * 255.0f + 0.5f);
+               }
+          }
+     }
+
+     unsigned int texture;
+     glGenTextures(1, &texture);
+     glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+     glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, SHAPE_LAYERS, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+     glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+     glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+     return texture;
+}
+
+bool benchmarkSprites(size_t count, int textures, int frames) {
+     if (count == 0 || textures <= 0 || frames <= 0) {
+          std::cout << "Nothing to benchmark" << std::endl;
+          return false;
+     }
+     const int WIDTH = 1280;
+     const int HEIGHT = 720;
+     glfwInit();
+     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+     glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+     GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Sprites", NULL, NULL);
+     if (!window) {
+          std::cout << "Failed to create GLFW window" << std::endl;
+          glfwTerminate();
+          return false;
+     }
+     glfwMakeContextCurrent(window);
+     glfwSwapInterval(0);
+     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+          std::cout << "Failed to initialise GLAD" << std::endl;
+          glfwTerminate();
+          return false;
+     }
+     glViewport(0, 0, WIDTH, HEIGHT);
+
+     SpriteBatch batch;
+     if (!batch.create("sprite.vert", "sprite.frag", count)) {
+          glfwTerminate();
+          return false;
+     }
+     std::vector<unsigned int> shapeTextures(textures);
+     for (unsigned int& texture : shapeTextures) {
+          texture = createSpriteShapeTexture(32);
+     }
+
+     // Random sprites with random textures, so without sorting nearly every one starts a new draw call
+     srand(1);
+     auto randomFloat = [](float low, float high) { return low + (high - low) * (rand() / (float)RAND_MAX); };
+     std::vector<Sprite> scene(count);
+     std::vector<glm::vec2> velocities(count);
+     for (size_t i = 0; i < count; i++) {
+          Sprite& sprite = scene[i];
+          sprite.position = glm::vec2(randomFloat(0.0f, (float)WIDTH), randomFloat(0.0f, (float)HEIGHT));
+          sprite.size = glm::vec2(randomFloat(4.0f, 16.0f));
+          sprite.rotation = randomFloat(0.0f, 6.2831853f);
+          sprite.texture = shapeTextures[rand() % textures];
+          sprite.layer = rand() % SHAPE_LAYERS;
+          sprite.tint = 0x80000000u | ((uint32_t)rand() & 0xffffff);
+          velocities[i] = glm::vec2(randomFloat(-60.0f, 60.0f), randomFloat(-60.0f, 60.0f));
+     }
+
+     std::cout << count << " sprites a frame over " << textures << " textures, " << frames << " frames" << std::endl;
+     for (int sorted = 1; sorted >= 0; sorted--) {
+          double cpuMs = 0.0, sortMs = 0.0, writeMs = 0.0, submitMs = 0.0;
+          auto start = std::chrono::steady_clock::now();
+          for (int frame = 0; frame < frames; frame++) {
+               // Moving them every frame means the vertices really do have to be rebuilt
+               auto frameStart = std::chrono::steady_clock::now();
+               glClear(GL_COLOR_BUFFER_BIT);
+               batch.begin(WIDTH, HEIGHT, sorted != 0);
+               for (size_t i = 0; i < count; i++) {
+                    Sprite sprite = scene[i];
+                    sprite.position = scene[i].position + velocities[i] * (frame / 60.0f);
+                    sprite.rotation += frame / 60.0f;
+                    batch.draw(sprite);
+               }
+               batch.end();
+               cpuMs += millisecondsSince(frameStart);
+               sortMs += batch.getStats().sortMs;
+               writeMs += batch.getStats().writeMs;
+               submitMs += batch.getStats().submitMs;
+               glfwSwapBuffers(window);
+          }
+          glFinish();
+          double totalMs = millisecondsSince(start);
+          std::cout << (sorted ? "sorted   " : "unsorted ") << totalMs / frames << " ms a frame, " << count * frames / totalMs / 1e3 << " M sprites/s, "
+               << batch.getStats().drawCalls << " draw calls | cpu " << cpuMs / frames << " ms (sort " << sortMs / frames << ", vertices "
+               << writeMs / frames << ", draw calls " << submitMs / frames << "), " << batch.getStats().bytes / (1024.0 * 1024.0) << " MB, "
+               << batch.getStats().orphans << " orphans" << std::endl;
+     }
+
+     glDeleteTextures((GLsizei)shapeTextures.size(), shapeTextures.data());
+     batch.deleteResources();
+     glfwTerminate();
+     return true;
+}
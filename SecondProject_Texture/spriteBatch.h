@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// One textured rectangle, in pixels with the origin at the top left of the viewport and y going down
+struct Sprite {
+     glm::vec2 position = glm::vec2(0.0f); // Centre
+     glm::vec2 size = glm::vec2(1.0f);
+     float rotation = 0.0f; // Radians clockwise on screen, about the centre
+     glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); // Left, top, right, bottom
+     unsigned int texture = 0; // A GL_TEXTURE_2D_ARRAY, so sprites on different layers of one texture still batch together
+     int layer = 0;
+     uint32_t tint = 0xffffffff; // RGBA8, red in the low byte
+};
+
+struct SpriteBatchStats {
+     // From the last end()
+     size_t sprites = 0;
+     size_t dropped = 0; // Past maxSprites
+     int drawCalls = 0;
+     double sortMs = 0.0;
+     double writeMs = 0.0; // Building the vertices straight into the mapped buffer
+     double submitMs = 0.0; // The draw calls
+     size_t bytes = 0;
+     uint64_t orphans = 0; // Times the stream buffer's been orphaned and started again, since create
+};
+
+// Collects sprites between begin and end, then draws them with as few draw calls as it can, one per run of the same texture
+// Sorting by texture makes those runs as long as possible, it keeps submission order within a texture but not between them, so
+// it's for sprites that don't overlap or where it doesn't matter which is on top
+// The vertices go into a stream buffer written with unsynchronized maps, each end() carries on after the last one's data and the
+// buffer's only orphaned when it runs out of room, so the driver never has to wait for a draw that's still reading it
+// The index buffer's made once for maxSprites and base vertex points it at wherever this batch's vertices went
+// Nothing is allocated after create
+class SpriteBatch {
+public:
+     SpriteBatch() = default;
+     SpriteBatch(const SpriteBatch&) = delete;
+     SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+     // False if the shader didn't compile
+     bool create(const std::string& vertexPath, const std::string& fragmentPath, size_t maxSprites);
+     bool isSupported() const { return program != 0; }
+
+     void begin(int viewportWidth, int viewportHeight, bool sortByTexture = true);
+     // Copies the sprite in, anything past maxSprites is dropped and counted
+     void draw(const Sprite& sprite);
+     // Alpha blends over whatever's there with depth testing off, and turns depth testing back on after
+     void end();
+
+     const SpriteBatchStats& getStats() const { return stats; }
+
+     // Needs calling before glfwTerminate
+     void deleteResources();
+
+private:
+     struct SpriteVertex {
+          float x, y;
+          float u, v, layer;
+          uint32_t tint;
+     };
+
+     size_t maxSprites = 0;
+     std::vector<Sprite> sprites;
+     std::vector<uint64_t> order; // Texture in the top half, submission index in the bottom
+     glm::mat4 projection = glm::mat4(1.0f);
+     bool sortByTexture = true;
+
+     unsigned int program = 0;
+     int projectionLocation = -1;
+     int texturesLocation = -1;
+     unsigned int vertexArray = 0;
+     unsigned int vertexBuffer = 0;
+     unsigned int indexBuffer = 0;
+     size_t bufferVertices = 0;
+     size_t nextVertex = 0; // Where the next batch starts in the stream buffer
+
+     SpriteBatchStats stats;
+};
+
+// A GL_TEXTURE_2D_ARRAY with a white shape with soft edges on each of its 4 layers (disc, ring, rounded square and diamond), for
+// tinting
+unsigned int createSpriteShapeTexture(int size);
+
+// Draws count random sprites a frame spread over some textures, sorted by texture and then in submission order, in a hidden window
+// For `--benchmark-sprites [count] [textures] [frames]`
+bool benchmarkSprites(size_t count, int textures, int frames);
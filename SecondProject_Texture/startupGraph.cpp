@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "startupGraph.h"
+#include "threadPool.h"
+
+StartupGraph::Task StartupGraph::add(const char* name, Thread thread, std::function<bool()> work, std::initializer_list<Task> dependencies) {
+     Task task = (Task)nodes.size();
+     Node node;
+     node.name = name;
+     node.thread = thread;
+     node.work = std::move(work);
+     for (Task dependency : dependencies) {
+          if (dependency >= 0 && dependency < task) {
+               node.dependencies.push_back(dependency);
+          }
+     }
+     nodes.push_back(std::move(node));
+     for (Task dependency : nodes[task].dependencies) {
+          nodes[dependency].dependents.push_back(task);
+     }
+     return task;
+}
+
+double StartupGraph::msSinceStart() const {
+     return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool StartupGraph::run() {
+     start = std::chrono::steady_clock::now();
+     mainThread = std::this_thread::get_id();
+     std::unique_lock<std::mutex> lock(mutex);
+     remaining = (int)nodes.size();
+     for (Node& node : nodes) {
+          node.waitingOn = (int)node.dependencies.size();
+     }
+     for (Task task = 0; task < (Task)nodes.size(); task++) {
+          if (nodes[task].waitingOn == 0) {
+               schedule(task);
+          }
+     }
+
+     // The main thread only ever runs its own tasks, in between it sleeps until one becomes ready or everything's done
+     while (remaining > 0) {
+          changed.wait(lock, [&]() { return !mainReady.empty() || remaining == 0; });
+          if (!mainReady.empty()) {
+               Task task = mainReady.front();
+               mainReady.pop_front();
+               lock.unlock();
+               execute(task);
+               lock.lock();
+          }
+     }
+     runMs = msSinceStart();
+
+     bool succeeded = true;
+     for (const Node& node : nodes) {
+          succeeded = succeeded && !node.failed && !node.skipped;
+     }
+     return succeeded;
+}
+
+// Called with the mutex held
+void StartupGraph::schedule(Task task) {
+     if (nodes[task].thread == MAIN_THREAD) {
+          mainReady.push_back(task);
+          changed.notify_all();
+     }
+     else {
+          ThreadPool::shared().submit([this, task]() { execute(task); });
+     }
+}
+
+// Called with the mutex held
+int StartupGraph::threadIndexFor(std::thread::id id) {
+     if (id == mainThread) {
+          return 0;
+     }
+     for (size_t i = 0; i < workerThreads.size(); i++) {
+          if (workerThreads[i] == id) {
+               return (int)i + 1;
+          }
+     }
+     workerThreads.push_back(id);
+     return (int)workerThreads.size();
+}
+
+void StartupGraph::execute(Task task) {
+     // Nothing else touches a node while it's running, its dependencies are all done and its dependents are still waiting
+     Node& node = nodes[task];
+     node.startMs = msSinceStart();
+     bool succeeded = node.skipped || node.work();
+     node.endMs = msSinceStart();
+
+     std::lock_guard<std::mutex> lock(mutex);
+     node.threadIndex = threadIndexFor(std::this_thread::get_id());
+     if (!succeeded) {
+          node.failed = true;
+          std::cout << "Startup task \"" << node.name << "\" failed" << std::endl;
+     }
+     for (Task dependent : node.dependents) {
+          Node& next = nodes[dependent];
+          next.skipped = next.skipped || node.failed || node.skipped;
+          if (--next.waitingOn == 0) {
+               schedule(dependent);
+          }
+     }
+     remaining--;
+     changed.notify_all();
+}
+
+void StartupGraph::markFirstFrame() {
+     firstFrameMs = msSinceStart();
+}
+
+std::vector<StartupGraph::Task> StartupGraph::criticalPath() const {
+     std::vector<Task> path;
+     Task last = -1;
+     for (Task task = 0; task < (Task)nodes.size(); task++) {
+          if (last < 0 || nodes[task].endMs > nodes[last].endMs) {
+               last = task;
+          }
+     }
+     // A task can be held up by a dependency or, since a thread does one thing at a time, by whatever ran before it on
+     // the same thread, the one of those that finished last is what it was actually waiting on
+     while (last >= 0) {
+          path.push_back(last);
+          const Node& node = nodes[last];
+          Task waitedOn = -1;
+          for (Task dependency : node.dependencies) {
+               if (waitedOn < 0 || nodes[dependency].endMs > nodes[waitedOn].endMs) {
+                    waitedOn = dependency;
+               }
+          }
+          for (Task task = 0; task < (Task)nodes.size(); task++) {
+               const Node& other = nodes[task];
+               bool ranBefore = task != last && other.threadIndex == node.threadIndex && other.endMs <= node.startMs;
+               if (ranBefore && (waitedOn < 0 || other.endMs > nodes[waitedOn].endMs)) {
+                    waitedOn = task;
+               }
+          }
+          last = waitedOn;
+     }
+     std::reverse(path.begin(), path.end());
+     return path;
+}
+
+void StartupGraph::printTrace() const {
+     std::vector<Task> path = criticalPath();
+     std::vector<bool> critical(nodes.size(), false);
+     for (Task task : path) {
+          critical[task] = true;
+     }
+
+     std::vector<Task> order(nodes.size());
+     for (Task task = 0; task < (Task)nodes.size(); task++) {
+          order[task] = task;
+     }
+     std::sort(order.begin(), order.end(), [&](Task a, Task b) { return nodes[a].startMs < nodes[b].startMs; });
+
+     std::cout << "Startup trace, ms from the start, * is on the critical path:" << std::endl;
+     char line[160];
+     for (Task task : order) {
+          const Node& node = nodes[task];
+          char thread[16];
+          if (node.threadIndex == 0) {
+               snprintf(thread, sizeof(thread), "main");
+          }
+          else {
+               snprintf(thread, sizeof(thread), "worker %d", node.threadIndex);
+          }
+          const char* status = node.failed ? " (failed)" : node.skipped ? " (skipped)" : "";
+          snprintf(line, sizeof(line), "  %c %8.2f %8.2f %8.2f  %-9s %s%s", critical[task] ? '*' : ' ', node.startMs, node.endMs,
+               node.endMs - node.startMs, thread, node.name.c_str(), status);
+          std::cout << line << std::endl;
+     }
+
+     // Time the critical path spent running rather than sitting in a queue, the gap between the two is the pool falling behind
+     double busyMs = 0.0;
+     std::cout << "Critical path:";
+     for (size_t i = 0; i < path.size(); i++) {
+          const Node& node = nodes[path[i]];
+          busyMs += node.endMs - node.startMs;
+          snprintf(line, sizeof(line), "%s %s (%.2f)", i > 0 ? " ->" : "", node.name.c_str(), node.endMs - node.startMs);
+          std::cout << line;
+     }
+     std::cout << std::endl;
+     snprintf(line, sizeof(line), "Startup took %.2f ms, %.2f of it running tasks on the critical path", runMs, busyMs);
+     std::cout << line << std::endl;
+     if (firstFrameMs > 0.0) {
+          snprintf(line, sizeof(line), "First frame presented at %.2f ms", firstFrameMs);
+          std::cout << line << std::endl;
+     }
+}
+
+bool StartupGraph::writeChromeTrace(const std::string& path) const {
+     std::ofstream file(path);
+     if (!file) {
+          std::cout << "Failed to create startup trace: " << path << std::endl;
+          return false;
+     }
+     std::vector<Task> criticalTasks = criticalPath();
+     std::vector<bool> critical(nodes.size(), false);
+     for (Task task : criticalTasks) {
+          critical[task] = true;
+     }
+
+     // Task names are all string literals from main, so none of them need escaping
+     file << "{\"traceEvents\":[\n";
+     char event[256];
+     for (Task task = 0; task < (Task)nodes.size(); task++) {
+          const Node& node = nodes[task];
+          snprintf(event, sizeof(event), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.1f,\"dur\":%.1f,\"args\":{\"critical\":%s,\"skipped\":%s}},\n",
+               node.name.c_str(), node.threadIndex, node.startMs * 1000.0, (node.endMs - node.startMs) * 1000.0, critical[task] ? "true" : "false",
+               node.skipped ? "true" : "false");
+          file << event;
+     }
+     if (firstFrameMs > 0.0) {
+          snprintf(event, sizeof(event), "{\"name\":\"first frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.1f},\n", firstFrameMs * 1000.0);
+          file << event;
+     }
+     file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main\"}}\n]}\n";
+     if (!file) {
+          std::cout << "Failed to write startup trace: " << path << std::endl;
+          return false;
+     }
+     return true;
+}
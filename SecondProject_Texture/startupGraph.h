@@ -0,0 +1,71 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Startup as a set of tasks with dependencies, so the work that only needs the CPU (decoding images, reading files, building
+// meshes) runs on the thread pool while the main thread is busy with the window, the GL context and the shaders
+// GL and GLFW only work from the thread that made the context, so tasks that touch them are marked MAIN_THREAD and run on
+// whichever thread calls run(), everything else goes to ThreadPool::shared()
+// Every task's start and end gets recorded, so the trace shows which chain of tasks startup was actually waiting on
+class StartupGraph {
+public:
+     using Task = int;
+     enum Thread { ANY_THREAD, MAIN_THREAD };
+
+     // Tasks return false if they failed, anything depending on them is skipped and run() returns false
+     // Dependencies have to be added first, which keeps the graph from ever having a cycle
+     Task add(const char* name, Thread thread, std::function<bool()> work, std::initializer_list<Task> dependencies = {});
+
+     // Runs every task and returns once they've all finished or been skipped
+     bool run();
+
+     // Call once the first frame has been presented, to get time to first frame in the trace
+     void markFirstFrame();
+
+     // Every task's timing with the critical path marked, then the path itself and time to first frame
+     void printTrace() const;
+     // The same in chrome://tracing / Perfetto's JSON format
+     bool writeChromeTrace(const std::string& path) const;
+
+     double getRunMs() const { return runMs; }
+     double getFirstFrameMs() const { return firstFrameMs; }
+
+private:
+     struct Node {
+          std::string name;
+          Thread thread;
+          std::function<bool()> work;
+          std::vector<Task> dependencies;
+          std::vector<Task> dependents;
+          int waitingOn = 0;
+          bool skipped = false;
+          bool failed = false;
+          double startMs = 0.0, endMs = 0.0; // From the start of run()
+          int threadIndex = 0; // 0 is the main thread, workers are numbered in the order they first picked something up
+     };
+
+     void schedule(Task task);
+     void execute(Task task);
+     int threadIndexFor(std::thread::id id);
+     double msSinceStart() const;
+     // Walks back from the last task to finish, each step going to whatever that task was last waiting on
+     std::vector<Task> criticalPath() const;
+
+     std::vector<Node> nodes;
+     std::deque<Task> mainReady;
+     int remaining = 0;
+     std::mutex mutex;
+     std::condition_variable changed;
+     std::thread::id mainThread;
+     std::vector<std::thread::id> workerThreads;
+     std::chrono::steady_clock::time_point start;
+     double runMs = 0.0;
+     double firstFrameMs = 0.0;
+};
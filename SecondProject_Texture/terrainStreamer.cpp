@@ -0,0 +1,612 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TERRAIN_USE_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+#include "terrainStreamer.h"
+#include "threadPool.h"
+
+namespace {
+
+const uint32_t HASH_X = 0x27d4eb2du;
+const uint32_t HASH_Z = 0x165667b1u;
+const uint32_t HASH_MIX = 0x85ebca6bu;
+const uint32_t OCTAVE_SEED_STEP = 0x9e3779b9u;
+const float LATTICE_SCALE = 2.0f / 16777215.0f;
+// Caps the fixed size lists update keeps on the stack
+const size_t MAX_JOBS = 64;
+
+const glm::vec3 LIGHT_DIRECTION = glm::normalize(glm::vec3(0.4f, 0.8f, 0.3f));
+const glm::vec3 VALLEY_COLOR = glm::vec3(0.22f, 0.40f, 0.18f);
+const glm::vec3 GRASS_COLOR = glm::vec3(0.38f, 0.60f, 0.24f);
+const glm::vec3 ROCK_COLOR = glm::vec3(0.48f, 0.44f, 0.40f);
+const glm::vec3 SNOW_COLOR = glm::vec3(0.92f, 0.93f, 0.95f);
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+     return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Value noise, a random value at every integer lattice point blended with a smoothstep between them
+// The SSE2 version does exactly the same float operations in the same order so the two come out identical, which the
+// benchmark checks
+float latticeValue(int32_t x, int32_t z, uint32_t seed) {
+     uint32_t h = (uint32_t)x * HASH_X + (uint32_t)z * HASH_Z + seed;
+     h ^= h >> 15;
+     h *= HASH_MIX;
+     h ^= h >> 13;
+     return (float)(int32_t)(h & 0xffffff) * LATTICE_SCALE - 1.0f;
+}
+
+float smoothStep(float t) {
+     return t * t * (3.0f - 2.0f * t);
+}
+
+float valueNoise(float x, float z, uint32_t seed) {
+     float floorX = std::floor(x);
+     float floorZ = std::floor(z);
+     int32_t ix = (int32_t)floorX;
+     int32_t iz = (int32_t)floorZ;
+     float tx = smoothStep(x - floorX);
+     float tz = smoothStep(z - floorZ);
+     float a = latticeValue(ix, iz, seed);
+     float b = latticeValue(ix + 1, iz, seed);
+     float c = latticeValue(ix, iz + 1, seed);
+     float d = latticeValue(ix + 1, iz + 1, seed);
+     float nearRow = a + (b - a) * tx;
+     float farRow = c + (d - c) * tx;
+     return nearRow + (farRow - nearRow) * tz;
+}
+
+// Octaves of value noise, each at twice the frequency and half the amplitude of the last, scaled back to about [-1, 1]
+float fractalNoise(const TerrainSettings& settings, float x, float z) {
+     float frequency = 1.0f / settings.featureSize;
+     float amplitude = 1.0f;
+     float sum = 0.0f;
+     float total = 0.0f;
+     for (int octave = 0; octave < settings.octaves; octave++) {
+          sum += valueNoise(x * frequency, z * frequency, settings.seed + (uint32_t)octave * OCTAVE_SEED_STEP) * amplitude;
+          total += amplitude;
+          frequency *= 2.0f;
+          amplitude *= 0.5f;
+     }
+     return sum / total;
+}
+
+#ifdef TERRAIN_USE_SSE2
+// SSE2 has no 32 bit multiply that keeps the low half, so do the even and odd lanes with the 64 bit one and put them back together
+inline __m128i multiplyLow(__m128i a, __m128i b) {
+     __m128i even = _mm_mul_epu32(a, b);
+     __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+     return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+inline __m128 latticeValue4(__m128i x, __m128i z, __m128i seed) {
+     __m128i h = _mm_add_epi32(_mm_add_epi32(multiplyLow(x, _mm_set1_epi32((int)HASH_X)), multiplyLow(z, _mm_set1_epi32((int)HASH_Z))), seed);
+     h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+     h = multiplyLow(h, _mm_set1_epi32((int)HASH_MIX));
+     h = _mm_xor_si128(h, _mm_srli_epi32(h, 13));
+     __m128 value = _mm_cvtepi32_ps(_mm_and_si128(h, _mm_set1_epi32(0xffffff)));
+     return _mm_sub_ps(_mm_mul_ps(value, _mm_set1_ps(LATTICE_SCALE)), _mm_set1_ps(1.0f));
+}
+
+inline __m128 smoothStep4(__m128 t) {
+     return _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_set1_ps(2.0f), t)));
+}
+
+// Truncating and then taking one off wherever that rounded up gives floor for anything that fits in an int
+inline __m128 floor4(__m128 x) {
+     __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+     return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.0f)));
+}
+
+inline __m128 valueNoise4(__m128 x, __m128 z, __m128i seed) {
+     __m128 floorX = floor4(x);
+     __m128 floorZ = floor4(z);
+     __m128i ix = _mm_cvttps_epi32(floorX);
+     __m128i iz = _mm_cvttps_epi32(floorZ);
+     __m128i ix1 = _mm_add_epi32(ix, _mm_set1_epi32(1));
+     __m128i iz1 = _mm_add_epi32(iz, _mm_set1_epi32(1));
+     __m128 tx = smoothStep4(_mm_sub_ps(x, floorX));
+     __m128 tz = smoothStep4(_mm_sub_ps(z, floorZ));
+     __m128 a = latticeValue4(ix, iz, seed);
+     __m128 b = latticeValue4(ix1, iz, seed);
+     __m128 c = latticeValue4(ix, iz1, seed);
+     __m128 d = latticeValue4(ix1, iz1, seed);
+     __m128 nearRow = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), tx));
+     __m128 farRow = _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(d, c), tx));
+     return _mm_add_ps(nearRow, _mm_mul_ps(_mm_sub_ps(farRow, nearRow), tz));
+}
+
+inline __m128 fractalNoise4(const TerrainSettings& settings, __m128 x, __m128 z) {
+     float frequency = 1.0f / settings.featureSize;
+     float amplitude = 1.0f;
+     __m128 sum = _mm_setzero_ps();
+     float total = 0.0f;
+     for (int octave = 0; octave < settings.octaves; octave++) {
+          __m128 scale = _mm_set1_ps(frequency);
+          __m128i seed = _mm_set1_epi32((int)(settings.seed + (uint32_t)octave * OCTAVE_SEED_STEP));
+          sum = _mm_add_ps(sum, _mm_mul_ps(valueNoise4(_mm_mul_ps(x, scale), _mm_mul_ps(z, scale), seed), _mm_set1_ps(amplitude)));
+          total += amplitude;
+          frequency *= 2.0f;
+          amplitude *= 0.5f;
+     }
+     return _mm_div_ps(sum, _mm_set1_ps(total));
+}
+#endif
+
+// Heights for count grid points along one row, starting at global grid column firstColumn
+// Positions come from the global grid index rather than the chunk's corner so neighbouring chunks agree exactly on their edges
+void heightRow(const TerrainSettings& settings, int firstColumn, int row, int count, bool simd, float* heights) {
+     float spacing = settings.chunkSize / settings.chunkQuads;
+     float z = (float)row * spacing;
+     int i = 0;
+#ifdef TERRAIN_USE_SSE2
+     if (simd) {
+          __m128 z4 = _mm_set1_ps(z);
+          __m128 spacing4 = _mm_set1_ps(spacing);
+          __m128 scale4 = _mm_set1_ps(settings.heightScale);
+          for (; i + 4 <= count; i += 4) {
+               __m128i column = _mm_add_epi32(_mm_set1_epi32(firstColumn + i), _mm_setr_epi32(0, 1, 2, 3));
+               __m128 x4 = _mm_mul_ps(_mm_cvtepi32_ps(column), spacing4);
+               _mm_storeu_ps(heights + i, _mm_mul_ps(fractalNoise4(settings, x4, z4), scale4));
+          }
+     }
+#else
+     (void)simd;
+#endif
+     for (; i < count; i++) {
+          float x = (float)(firstColumn + i) * spacing;
+          heights[i] = fractalNoise(settings, x, z) * settings.heightScale;
+     }
+}
+
+glm::vec3 terrainColor(float height, const glm::vec3& normal, float heightScale) {
+     float t = height / heightScale;
+     glm::vec3 color = glm::mix(VALLEY_COLOR, GRASS_COLOR, glm::clamp(t * 2.0f + 0.6f, 0.0f, 1.0f));
+     // Steep slopes are bare rock and the tops get snow
+     color = glm::mix(color, ROCK_COLOR, glm::clamp((0.9f - normal.y) * 6.0f, 0.0f, 1.0f));
+     color = glm::mix(color, SNOW_COLOR, glm::clamp((t - 0.45f) * 8.0f, 0.0f, 1.0f));
+     // Lighting's baked in since the cube shader doesn't do any
+     float light = 0.35f + 0.65f * std::max(glm::dot(normal, LIGHT_DIRECTION), 0.0f);
+     return color * light;
+}
+
+}
+
+uint64_t TerrainStreamer::generateChunk(const TerrainSettings& settings, int chunkX, int chunkZ, bool simd, float* vertices) {
+     const int quads = settings.chunkQuads;
+     const int side = quads + 1;
+     // One extra row and column all round so normals on the edges use the neighbouring chunk's heights
+     const int border = side + 2;
+     float spacing = settings.chunkSize / quads;
+     // Each worker keeps its own, it only grows the first time
+     thread_local std::vector<float> heights;
+     heights.resize((size_t)border * border);
+     int firstColumn = chunkX * quads - 1;
+     int firstRow = chunkZ * quads - 1;
+     for (int j = 0; j < border; j++) {
+          heightRow(settings, firstColumn, firstRow + j, border, simd, heights.data() + j * border);
+     }
+
+     float* out = vertices;
+     for (int j = 0; j < side; j++) {
+          for (int i = 0; i < side; i++) {
+               const float* h = heights.data() + (j + 1) * border + (i + 1);
+               float height = h[0];
+               glm::vec3 normal = glm::normalize(glm::vec3(h[-1] - h[1], 2.0f * spacing, h[-border] - h[border]));
+               glm::vec3 color = terrainColor(height, normal, settings.heightScale);
+               // Positions are relative to the terrain's origin, so every chunk draws with the same model matrix
+               out[0] = (float)(chunkX * quads + i) * spacing;
+               out[1] = height;
+               out[2] = (float)(chunkZ * quads + j) * spacing;
+               out[3] = color.x;
+               out[4] = color.y;
+               out[5] = color.z;
+               out[6] = (float)i / quads;
+               out[7] = (float)j / quads;
+               out += FLOATS_PER_VERTEX;
+          }
+     }
+     return (uint64_t)border * border * settings.octaves * 4;
+}
+
+TerrainStreamer::TerrainStreamer(const TerrainSettings& settings) : settings(settings) {
+     verticesPerChunk = (settings.chunkQuads + 1) * (settings.chunkQuads + 1);
+     indicesPerChunk = settings.chunkQuads * settings.chunkQuads * 6;
+     chunkBytes = (size_t)verticesPerChunk * FLOATS_PER_VERTEX * sizeof(float);
+}
+
+TerrainStreamer::~TerrainStreamer() {
+     if (generator.joinable()) {
+          {
+               std::lock_guard<std::mutex> lock(jobMutex);
+               stopping = true;
+          }
+          jobQueued.notify_all();
+          generator.join();
+     }
+}
+
+bool TerrainStreamer::create() {
+     if (settings.chunkQuads < 1 || settings.chunkQuads > 255) {
+          std::cout << "Terrain chunks need between 1 and 255 quads a side for 16 bit indices, not " << settings.chunkQuads << std::endl;
+          return false;
+     }
+
+     // Chunk centres within the release distance of any point fit in this square, the extra rows cover retiring slots
+     int slotsAcross = 2 * settings.viewRadius + 3;
+     slots.assign(slotsAcross * slotsAcross + 2 * slotsAcross, Slot());
+     candidates.reserve((2 * settings.viewRadius + 1) * (2 * settings.viewRadius + 1));
+     // Enough jobs to keep every thread busy with one queued behind it
+     size_t jobCount = std::min(MAX_JOBS, std::max<size_t>(4, 2 * (ThreadPool::shared().size() + 1)));
+     jobs.resize(jobCount);
+     for (Job& job : jobs) {
+          job.vertices.resize((size_t)verticesPerChunk * FLOATS_PER_VERTEX);
+     }
+     batch.reserve(jobCount);
+
+     // Same grid in every chunk, base vertex picks the slot
+     const int quads = settings.chunkQuads;
+     std::vector<unsigned short> indices;
+     indices.reserve(indicesPerChunk);
+     for (int j = 0; j < quads; j++) {
+          for (int i = 0; i < quads; i++) {
+               unsigned short v = (unsigned short)(j * (quads + 1) + i);
+               unsigned short below = (unsigned short)(v + quads + 1);
+               indices.insert(indices.end(), { v, below, (unsigned short)(v + 1), (unsigned short)(v + 1), below, (unsigned short)(below + 1) });
+          }
+     }
+
+     glGenVertexArrays(1, &vertexArray);
+     glGenBuffers(1, &vertexBuffer);
+     glGenBuffers(1, &indexBuffer);
+     glBindVertexArray(vertexArray);
+     glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+     glBufferData(GL_ARRAY_BUFFER, slots.size() * chunkBytes, NULL, GL_DYNAMIC_DRAW);
+     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)0);
+     glEnableVertexAttribArray(0);
+     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(3 * sizeof(float)));
+     glEnableVertexAttribArray(1);
+     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX * sizeof(float), (void*)(6 * sizeof(float)));
+     glEnableVertexAttribArray(2);
+     glBindVertexArray(0);
+
+     stats.slots = (int)slots.size();
+     statsStart = std::chrono::steady_clock::now();
+     generator = std::thread(&TerrainStreamer::generatorLoop, this);
+     return true;
+}
+
+float TerrainStreamer::chunkDistance(int chunkX, int chunkZ) const {
+     float centerX = (chunkX + 0.5f) * settings.chunkSize;
+     float centerZ = (chunkZ + 0.5f) * settings.chunkSize;
+     return std::sqrt((centerX - viewer.x) * (centerX - viewer.x) + (centerZ - viewer.z) * (centerZ - viewer.z));
+}
+
+void TerrainStreamer::update(const glm::vec3& viewerPosition) {
+     if (!isSupported()) {
+          return;
+     }
+     viewer = viewerPosition;
+     float wantDistance = settings.viewRadius * settings.chunkSize;
+     // A chunk's kept until it's a whole chunk further out than where it gets made, so it doesn't flicker at the boundary
+     float releaseDistance = wantDistance + settings.chunkSize;
+
+     for (Slot& slot : slots) {
+          if (slot.state == SLOT_RETIRING) {
+               GLenum status = glClientWaitSync(slot.fence, 0, 0);
+               if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                    glDeleteSync(slot.fence);
+                    slot.fence = nullptr;
+                    slot.state = SLOT_FREE;
+               }
+          }
+          else if (slot.state == SLOT_RESIDENT && chunkDistance(slot.chunkX, slot.chunkZ) > releaseDistance) {
+               slot.state = SLOT_RETIRING;
+               slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+               stats.chunksReleased++;
+          }
+     }
+
+     // Every chunk in range that isn't resident, nearest first
+     candidates.clear();
+     int centerX = (int)std::floor(viewer.x / settings.chunkSize);
+     int centerZ = (int)std::floor(viewer.z / settings.chunkSize);
+     for (int dz = -settings.viewRadius; dz <= settings.viewRadius; dz++) {
+          for (int dx = -settings.viewRadius; dx <= settings.viewRadius; dx++) {
+               int chunkX = centerX + dx;
+               int chunkZ = centerZ + dz;
+               float distance = chunkDistance(chunkX, chunkZ);
+               if (distance > wantDistance) {
+                    continue;
+               }
+               bool resident = false;
+               for (const Slot& slot : slots) {
+                    if (slot.state == SLOT_RESIDENT && slot.chunkX == chunkX && slot.chunkZ == chunkZ) {
+                         resident = true;
+                         break;
+                    }
+               }
+               if (!resident) {
+                    candidates.push_back({ chunkX, chunkZ, distance });
+               }
+          }
+     }
+     std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+          return a.distance < b.distance;
+     });
+
+     bool queued = false;
+     size_t doneCount = 0;
+     size_t done[MAX_JOBS];
+     {
+          std::lock_guard<std::mutex> lock(jobMutex);
+          for (Job& job : jobs) {
+               // Queued chunks that went out of range before they were started aren't worth making
+               if (job.state == JOB_QUEUED && chunkDistance(job.chunkX, job.chunkZ) > wantDistance) {
+                    job.state = JOB_FREE;
+               }
+          }
+          size_t next = 0;
+          for (size_t i = 0; i < jobs.size(); i++) {
+               Job& job = jobs[i];
+               if (job.state == JOB_DONE) {
+                    done[doneCount++] = i;
+               }
+          }
+          for (const Candidate& candidate : candidates) {
+               bool pending = false;
+               for (const Job& job : jobs) {
+                    if (job.state != JOB_FREE && job.chunkX == candidate.chunkX && job.chunkZ == candidate.chunkZ) {
+                         pending = true;
+                         break;
+                    }
+               }
+               if (pending) {
+                    continue;
+               }
+               while (next < jobs.size() && jobs[next].state != JOB_FREE) {
+                    next++;
+               }
+               if (next == jobs.size()) {
+                    break;
+               }
+               jobs[next].state = JOB_QUEUED;
+               jobs[next].chunkX = candidate.chunkX;
+               jobs[next].chunkZ = candidate.chunkZ;
+               queued = true;
+          }
+     }
+     if (queued) {
+          jobQueued.notify_one();
+     }
+
+     // Done jobs belong to this thread until they're freed, so the upload happens outside the lock
+     auto uploadStart = std::chrono::steady_clock::now();
+     size_t uploadedBytes = 0;
+     size_t freedCount = 0;
+     size_t freed[MAX_JOBS];
+     size_t nextSlot = 0;
+     bool bound = false;
+     for (size_t d = 0; d < doneCount; d++) {
+          Job& job = jobs[done[d]];
+          if (chunkDistance(job.chunkX, job.chunkZ) > releaseDistance) {
+               freed[freedCount++] = done[d];
+               continue;
+          }
+          if (uploadedBytes > 0 && uploadedBytes + chunkBytes > settings.uploadBudgetBytes) {
+               continue;
+          }
+          while (nextSlot < slots.size() && slots[nextSlot].state != SLOT_FREE) {
+               nextSlot++;
+          }
+          if (nextSlot == slots.size()) {
+               continue;
+          }
+          if (!bound) {
+               glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+               bound = true;
+          }
+          glBufferSubData(GL_ARRAY_BUFFER, nextSlot * chunkBytes, chunkBytes, job.vertices.data());
+          slots[nextSlot].state = SLOT_RESIDENT;
+          slots[nextSlot].chunkX = job.chunkX;
+          slots[nextSlot].chunkZ = job.chunkZ;
+          uploadedBytes += chunkBytes;
+          freed[freedCount++] = done[d];
+     }
+     if (bound) {
+          glBindBuffer(GL_ARRAY_BUFFER, 0);
+          windowUploadMs += millisecondsSince(uploadStart);
+          windowUploadBytes += uploadedBytes;
+     }
+
+     int busyJobs = 0;
+     {
+          std::lock_guard<std::mutex> lock(jobMutex);
+          for (size_t f = 0; f < freedCount; f++) {
+               jobs[freed[f]].state = JOB_FREE;
+          }
+          for (const Job& job : jobs) {
+               if (job.state != JOB_FREE) {
+                    busyJobs++;
+               }
+          }
+     }
+     // Candidates covers everything in range that isn't resident yet, whether or not it got a job, the jobs can include
+     // chunks that left range while they were being made
+     stats.pendingChunks = std::max((int)candidates.size(), busyJobs);
+     int resident = 0;
+     for (const Slot& slot : slots) {
+          if (slot.state == SLOT_RESIDENT) {
+               resident++;
+          }
+     }
+     stats.residentChunks = resident;
+     windowFrames++;
+     updateStats();
+}
+
+void TerrainStreamer::updateStats() {
+     double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+     if (seconds < 1.0) {
+          return;
+     }
+     std::lock_guard<std::mutex> lock(jobMutex);
+     stats.chunksGenerated += windowChunks;
+     stats.verticesPerSecond = windowBatchMs > 0.0 ? windowVertices / (windowBatchMs / 1000.0) : 0.0;
+     stats.noiseSamplesPerSecond = windowGenerateMs > 0.0 ? windowNoiseSamples / (windowGenerateMs / 1000.0) : 0.0;
+     stats.generateMsPerChunk = windowChunks > 0 ? windowGenerateMs / windowChunks : 0.0;
+     stats.uploadMsPerFrame = windowUploadMs / windowFrames;
+     stats.uploadKBPerFrame = windowUploadBytes / 1024.0 / windowFrames;
+     windowVertices = 0;
+     windowNoiseSamples = 0;
+     windowGenerateMs = 0.0;
+     windowBatchMs = 0.0;
+     windowChunks = 0;
+     windowUploadMs = 0.0;
+     windowUploadBytes = 0;
+     windowFrames = 0;
+     statsStart = std::chrono::steady_clock::now();
+}
+
+void TerrainStreamer::generatorLoop() {
+     std::unique_lock<std::mutex> lock(jobMutex);
+     while (true) {
+          jobQueued.wait(lock, [this] {
+               if (stopping) {
+                    return true;
+               }
+               for (const Job& job : jobs) {
+                    if (job.state == JOB_QUEUED) {
+                         return true;
+                    }
+               }
+               return false;
+          });
+          if (stopping) {
+               return;
+          }
+          batch.clear();
+          for (size_t i = 0; i < jobs.size(); i++) {
+               if (jobs[i].state == JOB_QUEUED) {
+                    jobs[i].state = JOB_GENERATING;
+                    batch.push_back(i);
+               }
+          }
+          lock.unlock();
+
+          // Generating a batch takes longer than a frame, which is why this has its own thread rather than running from update
+          auto batchStart = std::chrono::steady_clock::now();
+          ThreadPool::shared().parallelFor(batch.size(), 1, [this](size_t begin, size_t end) {
+               for (size_t b = begin; b < end; b++) {
+                    Job& job = jobs[batch[b]];
+                    auto start = std::chrono::steady_clock::now();
+                    job.noiseSamples = generateChunk(settings, job.chunkX, job.chunkZ, true, job.vertices.data());
+                    job.generateMs = millisecondsSince(start);
+               }
+          });
+          double batchMs = millisecondsSince(batchStart);
+
+          lock.lock();
+          for (size_t index : batch) {
+               Job& job = jobs[index];
+               job.state = JOB_DONE;
+               windowVertices += verticesPerChunk;
+               windowNoiseSamples += job.noiseSamples;
+               windowGenerateMs += job.generateMs;
+               windowChunks++;
+          }
+          windowBatchMs += batchMs;
+     }
+}
+
+void TerrainStreamer::draw() const {
+     if (!isSupported()) {
+          return;
+     }
+     glBindVertexArray(vertexArray);
+     for (size_t i = 0; i < slots.size(); i++) {
+          if (slots[i].state == SLOT_RESIDENT) {
+               glDrawElementsBaseVertex(GL_TRIANGLES, indicesPerChunk, GL_UNSIGNED_SHORT, 0, (GLint)(i * verticesPerChunk));
+          }
+     }
+}
+
+void TerrainStreamer::deleteResources() {
+     for (Slot& slot : slots) {
+          if (slot.fence) {
+               glDeleteSync(slot.fence);
+               slot.fence = nullptr;
+          }
+          slot.state = SLOT_FREE;
+     }
+     if (vertexArray) {
+          glDeleteVertexArrays(1, &vertexArray);
+          glDeleteBuffers(1, &vertexBuffer);
+          glDeleteBuffers(1, &indexBuffer);
+          vertexArray = vertexBuffer = indexBuffer = 0;
+     }
+}
+
+bool benchmarkTerrain(int chunks) {
+     if (chunks <= 0) {
+          std::cout << "Nothing to benchmark" << std::endl;
+          return false;
+     }
+     TerrainSettings settings;
+     int across = (int)std::ceil(std::sqrt((double)chunks));
+     int verticesPerChunk = (settings.chunkQuads + 1) * (settings.chunkQuads + 1);
+     size_t floatsPerChunk = (size_t)verticesPerChunk * TerrainStreamer::FLOATS_PER_VERTEX;
+
+     // One thread, scalar against SSE2, on the same chunks
+     std::vector<float> scalarVertices(floatsPerChunk), simdVertices(floatsPerChunk);
+     double milliseconds[2] = { 0.0, 0.0 };
+     uint64_t samples = 0;
+     float maxDifference = 0.0f;
+     for (int c = 0; c < chunks; c++) {
+          int chunkX = c % across - across / 2;
+          int chunkZ = c / across - across / 2;
+          auto start = std::chrono::steady_clock::now();
+          samples += TerrainStreamer::generateChunk(settings, chunkX, chunkZ, false, scalarVertices.data());
+          milliseconds[0] += millisecondsSince(start);
+          start = std::chrono::steady_clock::now();
+          TerrainStreamer::generateChunk(settings, chunkX, chunkZ, true, simdVertices.data());
+          milliseconds[1] += millisecondsSince(start);
+          for (size_t f = 0; f < floatsPerChunk; f++) {
+               maxDifference = std::max(maxDifference, std::fabs(scalarVertices[f] - simdVertices[f]));
+          }
+     }
+
+     // Then every thread at once, the way the streamer runs it
+     std::vector<float> allVertices(floatsPerChunk * chunks);
+     auto start = std::chrono::steady_clock::now();
+     ThreadPool::shared().parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+          for (size_t c = begin; c < end; c++) {
+               TerrainStreamer::generateChunk(settings, (int)c % across - across / 2, (int)c / across - across / 2, true, allVertices.data() + c * floatsPerChunk);
+          }
+     });
+     double parallelMilliseconds = millisecondsSince(start);
+
+     double vertices = (double)verticesPerChunk * chunks;
+     std::cout << chunks << " chunks of " << verticesPerChunk << " vertices, " << settings.octaves << " octaves" << std::endl;
+     std::cout << "scalar " << vertices / milliseconds[0] / 1e3 << " M vertices/s, " << samples / milliseconds[0] / 1e3
+          << " M noise samples/s (" << milliseconds[0] / chunks << " ms a chunk)" << std::endl;
+#ifdef TERRAIN_USE_SSE2
+     std::cout << "SSE2   " << vertices / milliseconds[1] / 1e3 << " M vertices/s, " << samples / milliseconds[1] / 1e3
+          << " M noise samples/s (" << milliseconds[1] / chunks << " ms a chunk), " << milliseconds[0] / milliseconds[1]
+          << "x, max difference from scalar " << maxDifference << std::endl;
+#else
+     std::cout << "No SSE2 in this build, both ran the scalar noise" << std::endl;
+#endif
+     std::cout << ThreadPool::shared().size() + 1 << " threads " << vertices / parallelMilliseconds / 1e3 << " M vertices/s ("
+          << parallelMilliseconds / chunks << " ms a chunk)" << std::endl;
+     return true;
+}
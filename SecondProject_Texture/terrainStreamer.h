@@ -0,0 +1,145 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+struct TerrainSettings {
+     float chunkSize = 16.0f; // World units across a chunk
+     int chunkQuads = 64; // Quads along each side, so (chunkQuads + 1)^2 vertices a chunk
+     int viewRadius = 4; // In chunks, anything whose centre is within this of the viewer gets made
+     float heightScale = 3.0f;
+     float featureSize = 24.0f; // World units across the biggest hills
+     int octaves = 5;
+     uint32_t seed = 1;
+     size_t uploadBudgetBytes = 512 * 1024; // Uploaded per frame at most, finished chunks past this wait for the next one
+};
+
+struct TerrainStats {
+     int residentChunks = 0;
+     int pendingChunks = 0; // Queued, generating or waiting to upload
+     int slots = 0;
+     uint64_t chunksGenerated = 0; // Caught up once a second with the rest
+     uint64_t chunksReleased = 0;
+     // Over the last second
+     double verticesPerSecond = 0.0; // Across every worker, while they're busy
+     double noiseSamplesPerSecond = 0.0; // Per worker thread, over the whole time it spends on a chunk
+     double generateMsPerChunk = 0.0; // One thread's time for one chunk
+     double uploadMsPerFrame = 0.0; // CPU time in glBufferSubData
+     double uploadKBPerFrame = 0.0;
+};
+
+// Procedural terrain in square chunks generated on the thread pool around a moving viewer
+// Every chunk has the same grid, so one index buffer covers all of them and the vertices go into fixed size slots of one
+// vertex buffer sized for every chunk that can be in range at once, nothing gets allocated or resized as the viewer moves
+// Chunks out of range give their slot back once a fence says the GPU has stopped drawing from it
+// The render thread only queues chunks and uploads finished ones, a generator thread hands the queue out to the pool
+class TerrainStreamer {
+public:
+     explicit TerrainStreamer(const TerrainSettings& settings = TerrainSettings());
+     // Waits for the generator thread, doesn't touch GL
+     ~TerrainStreamer();
+     TerrainStreamer(const TerrainStreamer&) = delete;
+     TerrainStreamer& operator=(const TerrainStreamer&) = delete;
+
+     // Makes the buffers and starts the generator thread, false if the settings need more vertices a chunk than 16 bit indices reach
+     bool create();
+     bool isSupported() const { return vertexArray != 0; }
+
+     // Call once a frame on the render thread with the viewer's position in terrain space
+     // Releases chunks that fell out of range, queues the nearest missing ones and uploads what's finished
+     void update(const glm::vec3& viewerPosition);
+     // Binds its VAO and draws every resident chunk, the shader's already bound with terrain space as its model matrix
+     void draw() const;
+
+     // Chunks still being made or waiting to upload, so an on demand render loop knows to keep drawing
+     bool isBusy() const { return stats.pendingChunks > 0; }
+     const TerrainStats& getStats() const { return stats; }
+
+     // Needs calling before glfwTerminate
+     void deleteResources();
+
+     // Vertex layout matches the cube shader, position, colour and texture coordinate
+     static const int FLOATS_PER_VERTEX = 8;
+     // Fills vertices with one chunk's grid, (chunkQuads + 1)^2 vertices in rows of increasing z
+     // Returns the number of noise samples taken, simd picks between the SSE2 noise and the scalar one it has to match
+     static uint64_t generateChunk(const TerrainSettings& settings, int chunkX, int chunkZ, bool simd, float* vertices);
+
+private:
+     enum JobState {
+          JOB_FREE,
+          JOB_QUEUED,
+          JOB_GENERATING,
+          JOB_DONE
+     };
+     // One chunk on its way through the generator, the vertices are allocated once up front and reused
+     struct Job {
+          JobState state = JOB_FREE;
+          int chunkX = 0;
+          int chunkZ = 0;
+          std::vector<float> vertices;
+          uint64_t noiseSamples = 0;
+          double generateMs = 0.0;
+     };
+     enum SlotState {
+          SLOT_FREE,
+          SLOT_RESIDENT,
+          SLOT_RETIRING // Out of range, waiting on its fence
+     };
+     struct Slot {
+          SlotState state = SLOT_FREE;
+          int chunkX = 0;
+          int chunkZ = 0;
+          GLsync fence = nullptr;
+     };
+     struct Candidate {
+          int chunkX;
+          int chunkZ;
+          float distance;
+     };
+
+     void generatorLoop();
+     // From the viewer to the chunk's centre, on the ground plane
+     float chunkDistance(int chunkX, int chunkZ) const;
+     void updateStats();
+
+     TerrainSettings settings;
+     glm::vec3 viewer = glm::vec3(0.0f);
+     int verticesPerChunk = 0;
+     int indicesPerChunk = 0;
+     size_t chunkBytes = 0;
+
+     unsigned int vertexArray = 0;
+     unsigned int vertexBuffer = 0;
+     unsigned int indexBuffer = 0;
+     std::vector<Slot> slots;
+     std::vector<Candidate> candidates; // Reused every frame
+
+     // Jobs are shared with the generator thread, everything else is render thread only
+     std::vector<Job> jobs;
+     std::mutex jobMutex;
+     std::condition_variable jobQueued;
+     std::thread generator;
+     bool stopping = false;
+     std::vector<size_t> batch; // The generator thread's, which jobs it took this time round
+
+     TerrainStats stats;
+     std::chrono::steady_clock::time_point statsStart;
+     // Totals since statsStart, the generator's ones are under jobMutex
+     uint64_t windowVertices = 0;
+     uint64_t windowNoiseSamples = 0;
+     double windowGenerateMs = 0.0;
+     double windowBatchMs = 0.0;
+     uint64_t windowChunks = 0;
+     double windowUploadMs = 0.0;
+     size_t windowUploadBytes = 0;
+     int windowFrames = 0;
+};
+
+// Generates chunks with the scalar and SIMD noise and then across the thread pool, for `--benchmark-terrain [chunks]`
+bool benchmarkTerrain(int chunks);
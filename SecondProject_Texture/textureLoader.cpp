@@ -0,0 +1,85 @@
+#include <glad/glad.h>
+#include <stb/stb_image.h>
+#include <iostream>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "imageDecoder.h"
+#include "textureLoader.h"
+
+bool loadImage(const std::string& path, bool flipVertically, ImageData& image) {
+     // Read the whole file first, the decoders all work from memory
+     std::ifstream file(path, std::ios::binary);
+     std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+     if (data.empty() || !decodeImage(data.data(), data.size(), image)) {
+          std::cout << "Failed to load image: " << path << std::endl;
+          return false;
+     }
+
+     // stbi_set_flip_vertically_on_load is global, so flip the rows here instead
+     if (flipVertically) {
+          size_t rowSize = (size_t)image.width * image.channels;
+          std::vector<unsigned char> temp(rowSize);
+          for (int top = 0, bottom = image.height - 1; top < bottom; top++, bottom--) {
+               unsigned char* topRow = image.pixels + top * rowSize;
+               unsigned char* bottomRow = image.pixels + bottom * rowSize;
+               memcpy(temp.data(), topRow, rowSize);
+               memcpy(topRow, bottomRow, rowSize);
+               memcpy(bottomRow, temp.data(), rowSize);
+          }
+     }
+     return true;
+}
+
+void freeImage(ImageData& image) {
+     stbi_image_free(image.pixels); // Free the image data once we've finished loading it
+     image.pixels = nullptr;
+}
+
+unsigned int createTexture(const ImageData& image) {
+     if (!image.pixels) {
+          return 0;
+     }
+
+     // .png has A value so we need to specify that when loading, note we still store it as GL_RGB
+     GLenum format;
+     switch (image.channels) {
+     case 1: format = GL_RED; break;
+     case 3: format = GL_RGB; break;
+     case 4: format = GL_RGBA; break;
+     default:
+          std::cout << "Unsupported number of image channels: " << image.channels << std::endl;
+          return 0;
+     }
+
+     unsigned int texture;
+     glGenTextures(1, &texture);
+     glBindTexture(GL_TEXTURE_2D, texture);
+          // Params
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+     // Rows of 3 channel images aren't always 4 byte aligned
+     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+     glGenerateMipmap(GL_TEXTURE_2D);
+
+     glBindTexture(GL_TEXTURE_2D, 0);
+     return texture;
+}
+
+unsigned int loadTexture(const std::string& path, bool flipVertically) {
+     ImageData image;
+     if (!loadImage(path, flipVertically, image)) {
+          std::cout << "Failed to load texture" << std::endl;
+          return 0;
+     }
+     unsigned int texture = createTexture(image);
+     freeImage(image);
+     return texture;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+
+// Decoded pixels sitting in CPU memory, ready to be uploaded into a texture
+struct ImageData {
+     int width = 0;
+     int height = 0;
+     int channels = 0;
+     unsigned char* pixels = nullptr;
+};
+
+// Decodes an image file, flipping it so row 0 is the bottom row if asked to
+// This doesn't touch stb's global flip flag, so it's safe to call from more than one thread
+bool loadImage(const std::string& path, bool flipVertically, ImageData& image);
+void freeImage(ImageData& image);
+
+// Creates a repeating, mipmapped texture from the image data and returns its ID (0 on failure)
+unsigned int createTexture(const ImageData& image);
+
+// Both of the above in one go, what main used to do by hand for each texture
+unsigned int loadTexture(const std::string& path, bool flipVertically);
@@ -0,0 +1,451 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "textureLoader.h"
+#include "textureStreamer.h"
+
+namespace fs = std::filesystem;
+
+// Levels this size or smaller are loaded up front and never evicted, they're tiny and mean there's always something to sample
+static const int TAIL_SIZE = 64;
+// Caps how much gets uploaded in one frame so a burst of finished reads doesn't cause a hitch
+static const size_t MAX_UPLOAD_BYTES_PER_FRAME = 4 * 1024 * 1024;
+
+static const char MIP_CACHE_MAGIC[4] = { 'M', 'I', 'P', 'C' };
+// 2 fixed grey + alpha images, which version 1 stored green and opaque, and 3 picked up transparency from PNG tRNS chunks
+static const uint32_t MIP_CACHE_VERSION = 3;
+
+// Sits at the start of the cache file, followed by every level as tightly packed RGBA8, finest first
+struct MipCacheHeader {
+     char magic[4];
+     uint32_t version;
+     int32_t width;
+     int32_t height;
+     int32_t levelCount;
+     uint32_t flipped;
+     // The image the cache was built from, so a changed image gets its cache rebuilt
+     uint64_t sourceSize;
+     int64_t sourceTime;
+};
+
+static int64_t sourceWriteTime(const std::string& path) {
+     std::error_code ec;
+     return (int64_t)fs::last_write_time(path, ec).time_since_epoch().count();
+}
+
+// Builds every level with a 2x2 box filter and writes them out after the header
+static bool buildMipCache(const std::string& imagePath, bool flipVertically, const std::string& cachePath) {
+     ImageData image;
+     if (!loadImage(imagePath, flipVertically, image)) {
+          return false;
+     }
+
+     // Everything is stored as RGBA so every level is 4 byte aligned and uploads the same way
+     std::vector<unsigned char> level((size_t)image.width * image.height * 4);
+     for (size_t i = 0; i < (size_t)image.width * image.height; i++) {
+          const unsigned char* source = image.pixels + i * image.channels;
+          unsigned char* destination = level.data() + i * 4;
+          if (image.channels <= 2) {
+               // Grey images fill in all three colours, grey + alpha keeps its alpha in the second byte
+               destination[0] = destination[1] = destination[2] = source[0];
+               destination[3] = image.channels == 2 ? source[1] : 255;
+          }
+          else {
+               for (int c = 0; c < 3; c++) {
+                    destination[c] = source[c];
+               }
+               destination[3] = image.channels == 4 ? source[3] : 255;
+          }
+     }
+
+     MipCacheHeader header;
+     memcpy(header.magic, MIP_CACHE_MAGIC, 4);
+     header.version = MIP_CACHE_VERSION;
+     header.width = image.width;
+     header.height = image.height;
+     header.levelCount = 1 + (int)std::floor(std::log2((double)std::max(image.width, image.height)));
+     header.flipped = flipVertically ? 1 : 0;
+     std::error_code ec;
+     header.sourceSize = (uint64_t)fs::file_size(imagePath, ec);
+     header.sourceTime = sourceWriteTime(imagePath);
+     freeImage(image);
+
+     std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+     if (!file) {
+          std::cout << "Failed to create mip cache: " << cachePath << std::endl;
+          return false;
+     }
+     file.write((const char*)&header, sizeof(header));
+
+     int width = header.width;
+     int height = header.height;
+     for (int i = 0; i < header.levelCount; i++) {
+          file.write((const char*)level.data(), level.size());
+          if (i == header.levelCount - 1) {
+               break;
+          }
+
+          int nextWidth = std::max(1, width / 2);
+          int nextHeight = std::max(1, height / 2);
+          std::vector<unsigned char> next((size_t)nextWidth * nextHeight * 4);
+          for (int y = 0; y < nextHeight; y++) {
+               for (int x = 0; x < nextWidth; x++) {
+                    // Clamp so odd sizes and 1 pixel wide levels still average in bounds
+                    int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                    int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+                    for (int c = 0; c < 4; c++) {
+                         int sum = level[((size_t)y0 * width + x0) * 4 + c] + level[((size_t)y0 * width + x1) * 4 + c]
+                              + level[((size_t)y1 * width + x0) * 4 + c] + level[((size_t)y1 * width + x1) * 4 + c];
+                         next[((size_t)y * nextWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                    }
+               }
+          }
+          level.swap(next);
+          width = nextWidth;
+          height = nextHeight;
+     }
+     return (bool)file;
+}
+
+static bool readMipCacheHeader(const std::string& cachePath, MipCacheHeader& header) {
+     std::ifstream file(cachePath, std::ios::binary);
+     if (!file.read((char*)&header, sizeof(header))) {
+          return false;
+     }
+     return memcmp(header.magic, MIP_CACHE_MAGIC, 4) == 0 && header.version == MIP_CACHE_VERSION;
+}
+
+TextureStreamer::TextureStreamer(size_t budgetBytes) : budget(budgetBytes) {
+     stats.budgetBytes = budgetBytes;
+     secondStart = std::chrono::steady_clock::now();
+     readerThread = std::thread(&TextureStreamer::readerLoop, this);
+}
+
+TextureStreamer::~TextureStreamer() {
+     {
+          std::lock_guard<std::mutex> lock(readMutex);
+          stopping = true;
+     }
+     readReady.notify_one();
+     readerThread.join();
+}
+
+void TextureStreamer::deleteTextures() {
+     for (StreamedTexture& texture : textures) {
+          glDeleteTextures(1, &texture.id);
+     }
+     textures.clear();
+}
+
+bool TextureStreamer::prepareMipCache(const std::string& path, bool flipVertically) {
+     std::string cachePath = path + ".mipcache";
+     MipCacheHeader header;
+     std::error_code ec;
+     bool cacheValid = readMipCacheHeader(cachePath, header)
+          && header.flipped == (flipVertically ? 1u : 0u)
+          && header.sourceSize == (uint64_t)fs::file_size(path, ec)
+          && header.sourceTime == sourceWriteTime(path);
+     return cacheValid || buildMipCache(path, flipVertically, cachePath);
+}
+
+bool TextureStreamer::rebuildMipCache(const std::string& path, bool flipVertically) {
+     return buildMipCache(path, flipVertically, path + ".mipcache.new");
+}
+
+unsigned int TextureStreamer::addTexture(const std::string& path, bool flipVertically) {
+     StreamedTexture texture;
+     texture.cachePath = path + ".mipcache";
+     if (!prepareMipCache(path, flipVertically) || !createFromCache(texture)) {
+          std::cout << "Failed to load texture" << std::endl;
+          return 0;
+     }
+     textures.push_back(texture);
+     return texture.id;
+}
+
+unsigned int TextureStreamer::reloadTexture(unsigned int texture) {
+     for (StreamedTexture& streamed : textures) {
+          if (streamed.id != texture) {
+               continue;
+          }
+          std::error_code ec;
+          {
+               std::lock_guard<std::mutex> lock(cacheFileMutex);
+               fs::rename(streamed.cachePath + ".new", streamed.cachePath, ec);
+          }
+          StreamedTexture reloaded;
+          reloaded.cachePath = streamed.cachePath;
+          if (ec || !createFromCache(reloaded)) {
+               std::cout << "Failed to reload streamed texture: " << streamed.cachePath << std::endl;
+               return texture;
+          }
+
+          // Everything resident goes with the old texture, and any reads still on their way were for the old cache
+          for (int level = streamed.residentLevel; level < streamed.levelCount; level++) {
+               stats.residentBytes -= streamed.levelSizes[level];
+               stats.residentLevels--;
+          }
+          stats.totalLevels -= streamed.levelCount;
+          glDeleteTextures(1, &streamed.id);
+          reloaded.generation = streamed.generation + 1;
+          streamed = std::move(reloaded);
+          return streamed.id;
+     }
+     return texture;
+}
+
+// Fills the texture in from the header of its cache file and creates it with just the tail resident
+bool TextureStreamer::createFromCache(StreamedTexture& texture) {
+     MipCacheHeader header;
+     if (!readMipCacheHeader(texture.cachePath, header)) {
+          return false;
+     }
+
+     texture.width = header.width;
+     texture.height = header.height;
+     texture.levelCount = header.levelCount;
+     uint64_t offset = sizeof(MipCacheHeader);
+     for (int i = 0; i < texture.levelCount; i++) {
+          texture.levelOffsets.push_back(offset);
+          texture.levelSizes.push_back((size_t)levelWidth(texture, i) * levelHeight(texture, i) * 4);
+          offset += texture.levelSizes.back();
+     }
+     texture.tailLevel = 0;
+     while (texture.tailLevel < texture.levelCount - 1 && std::max(levelWidth(texture, texture.tailLevel), levelHeight(texture, texture.tailLevel)) > TAIL_SIZE) {
+          texture.tailLevel++;
+     }
+     texture.residentLevel = texture.levelCount; // Nothing yet
+     texture.wantedLevel = texture.tailLevel;
+
+     glGenTextures(1, &texture.id);
+     glBindTexture(GL_TEXTURE_2D, texture.id);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levelCount - 1);
+
+     // The tail is small enough to just read right here
+     std::ifstream file(texture.cachePath, std::ios::binary);
+     file.seekg(texture.levelOffsets[texture.tailLevel]);
+     std::vector<unsigned char> tail(offset - texture.levelOffsets[texture.tailLevel]);
+     file.read((char*)tail.data(), tail.size());
+     for (int level = texture.levelCount - 1; level >= texture.tailLevel; level--) {
+          uploadLevel(texture, level, tail.data() + (texture.levelOffsets[level] - texture.levelOffsets[texture.tailLevel]));
+     }
+     glBindTexture(GL_TEXTURE_2D, 0);
+
+     stats.totalLevels += texture.levelCount;
+     return true;
+}
+
+void TextureStreamer::requestSize(unsigned int texture, float screenPixels) {
+     for (StreamedTexture& streamed : textures) {
+          if (streamed.id != texture) {
+               continue;
+          }
+          // One texel per pixel is enough, anything finer just gets filtered away
+          float texelsPerPixel = std::max(streamed.width, streamed.height) / std::max(screenPixels, 1.0f);
+          int level = (int)std::floor(std::log2(std::max(texelsPerPixel, 1.0f)));
+          level = std::min(level, streamed.tailLevel);
+          streamed.wantedLevel = std::min(streamed.wantedLevel, level);
+          streamed.lastUsedFrame = frame;
+          return;
+     }
+}
+
+void TextureStreamer::update() {
+     // Upload whatever the reader has finished, as long as it's the next level down for its texture
+     size_t uploadedThisFrame = 0;
+     while (uploadedThisFrame < MAX_UPLOAD_BYTES_PER_FRAME) {
+          LevelRead read;
+          {
+               std::lock_guard<std::mutex> lock(readMutex);
+               if (finishedReads.empty()) {
+                    break;
+               }
+               read = std::move(finishedReads.front());
+               finishedReads.pop_front();
+          }
+          StreamedTexture& texture = textures[read.textureIndex];
+          stats.bytesRead += read.pixels.size();
+          bytesReadThisSecond += read.pixels.size();
+          if (read.generation != texture.generation) {
+               continue; // Read from before the texture was reloaded
+          }
+          texture.loadInFlight = false;
+          if (read.pixels.empty() || read.level != texture.residentLevel - 1) {
+               continue; // Failed, or no longer fits on the end of what's resident
+          }
+          if (!makeRoom(texture.levelSizes[read.level], read.textureIndex, false)) {
+               continue;
+          }
+
+          glBindTexture(GL_TEXTURE_2D, texture.id);
+          uploadLevel(texture, read.level, read.pixels.data());
+          glBindTexture(GL_TEXTURE_2D, 0);
+          uploadedThisFrame += read.pixels.size();
+          stats.levelsStreamedIn++;
+     }
+
+     // Queue the next level for anything that wants more detail than it has, one level at a time working towards the finest
+     for (size_t i = 0; i < textures.size(); i++) {
+          StreamedTexture& texture = textures[i];
+          if (texture.loadInFlight || texture.wantedLevel >= texture.residentLevel) {
+               continue;
+          }
+          int level = texture.residentLevel - 1;
+          if (!makeRoom(texture.levelSizes[level], i, false)) {
+               continue; // Budget's full of things that are on screen, stay blurry
+          }
+          texture.loadInFlight = true;
+          LevelRead read = { i, texture.generation, level, texture.cachePath, texture.levelOffsets[level], {} };
+          read.pixels.resize(texture.levelSizes[level]);
+          {
+               std::lock_guard<std::mutex> lock(readMutex);
+               pendingReads.push_back(std::move(read));
+          }
+          readReady.notify_one();
+     }
+
+     // Still over budget (it was lowered, or what's on screen doesn't fit), drop levels until it fits even if they're visible
+     makeRoom(0, textures.size(), true);
+
+     // Everything has to ask again next frame
+     for (StreamedTexture& texture : textures) {
+          texture.wantedLevel = texture.tailLevel;
+     }
+     frame++;
+
+     std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+     double elapsed = std::chrono::duration<double>(now - secondStart).count();
+     if (elapsed >= 1.0) {
+          stats.readMBps = bytesReadThisSecond / (1024.0 * 1024.0) / elapsed;
+          stats.uploadMBps = bytesUploadedThisSecond / (1024.0 * 1024.0) / elapsed;
+          bytesReadThisSecond = 0;
+          bytesUploadedThisSecond = 0;
+          secondStart = now;
+     }
+}
+
+void TextureStreamer::setReadCallback(std::function<void()> callback) {
+     std::lock_guard<std::mutex> lock(readMutex);
+     readCallback = std::move(callback);
+}
+
+void TextureStreamer::setBudget(size_t budgetBytes) {
+     budget = budgetBytes;
+     stats.budgetBytes = budgetBytes;
+}
+
+float TextureStreamer::projectedSizePixels(float objectRadius, float distance, float fovYRadians, int viewportHeight) {
+     distance = std::max(distance, 0.001f);
+     return 2.0f * objectRadius / distance * (viewportHeight / (2.0f * std::tan(fovYRadians / 2.0f)));
+}
+
+int TextureStreamer::levelWidth(const StreamedTexture& texture, int level) const {
+     return std::max(1, texture.width >> level);
+}
+
+int TextureStreamer::levelHeight(const StreamedTexture& texture, int level) const {
+     return std::max(1, texture.height >> level);
+}
+
+// Expects the texture to be bound, and level to be one finer than what's resident
+void TextureStreamer::uploadLevel(StreamedTexture& texture, int level, const unsigned char* pixels) {
+     glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, levelWidth(texture, level), levelHeight(texture, level), 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+     // Only sample from what's actually there, the level stays incomplete until it's uploaded otherwise
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+     texture.residentLevel = level;
+
+     stats.residentBytes += texture.levelSizes[level];
+     stats.residentLevels++;
+     stats.bytesUploaded += texture.levelSizes[level];
+     bytesUploadedThisSecond += texture.levelSizes[level];
+}
+
+void TextureStreamer::evictLevel(StreamedTexture& texture) {
+     int level = texture.residentLevel;
+     glBindTexture(GL_TEXTURE_2D, texture.id);
+     // Move the base level off it first so the texture stays complete, then a 0x0 image frees the storage
+     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+     glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+     glBindTexture(GL_TEXTURE_2D, 0);
+     texture.residentLevel = level + 1;
+
+     stats.residentBytes -= texture.levelSizes[level];
+     stats.residentLevels--;
+     stats.levelsEvicted++;
+}
+
+// Evicts least recently used levels until there's space for bytes more, never touching forTexture or anything's tail
+// Levels that are finer than their texture currently wants go first, then whatever was used longest ago
+// Unless evictVisible is set, levels that were needed this frame are left alone so two textures can't keep evicting each other
+bool TextureStreamer::makeRoom(size_t bytes, size_t forTexture, bool evictVisible) {
+     while (stats.residentBytes + bytes > budget) {
+          StreamedTexture* victim = nullptr;
+          for (size_t i = 0; i < textures.size(); i++) {
+               StreamedTexture& texture = textures[i];
+               if (i == forTexture || texture.residentLevel >= texture.tailLevel) {
+                    continue;
+               }
+               bool unneeded = texture.residentLevel < texture.wantedLevel;
+               if (!evictVisible && !unneeded && texture.lastUsedFrame == frame) {
+                    continue;
+               }
+               if (!victim) {
+                    victim = &texture;
+                    continue;
+               }
+               bool victimUnneeded = victim->residentLevel < victim->wantedLevel;
+               if (unneeded != victimUnneeded) {
+                    if (unneeded) {
+                         victim = &texture;
+                    }
+               }
+               else if (texture.lastUsedFrame < victim->lastUsedFrame) {
+                    victim = &texture;
+               }
+          }
+          if (!victim) {
+               return false;
+          }
+          evictLevel(*victim);
+     }
+     return true;
+}
+
+void TextureStreamer::readerLoop() {
+     while (true) {
+          LevelRead read;
+          {
+               std::unique_lock<std::mutex> lock(readMutex);
+               readReady.wait(lock, [this] { return stopping || !pendingReads.empty(); });
+               if (stopping) {
+                    return;
+               }
+               read = std::move(pendingReads.front());
+               pendingReads.pop_front();
+          }
+
+          {
+               std::lock_guard<std::mutex> fileLock(cacheFileMutex);
+               std::ifstream file(read.cachePath, std::ios::binary);
+               if (!file.seekg(read.offset) || !file.read((char*)read.pixels.data(), read.pixels.size())) {
+                    std::cout << "Failed to stream mip level from: " << read.cachePath << std::endl;
+                    read.pixels.clear();
+               }
+          }
+
+          std::lock_guard<std::mutex> lock(readMutex);
+          finishedReads.push_back(std::move(read));
+          if (readCallback) {
+               readCallback();
+          }
+     }
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TextureStreamingStats {
+     size_t residentBytes = 0;
+     size_t budgetBytes = 0;
+     int residentLevels = 0;
+     int totalLevels = 0;
+     uint64_t levelsStreamedIn = 0;
+     uint64_t levelsEvicted = 0;
+     uint64_t bytesRead = 0;
+     uint64_t bytesUploaded = 0;
+     // Over the last second
+     double readMBps = 0.0;
+     double uploadMBps = 0.0;
+};
+
+// Streams texture mip levels in and out so only what's actually visible on screen is resident
+// Each image gets a cache file next to it holding its whole mip chain, so a level can be read straight off disk without decoding
+// Only the small tail mips are loaded up front, finer levels are read on a background thread when something gets close enough to need them,
+// and the least recently used levels are dropped once the resident total goes over the budget
+class TextureStreamer {
+public:
+     TextureStreamer(size_t budgetBytes);
+     ~TextureStreamer();
+     TextureStreamer(const TextureStreamer&) = delete;
+     TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+     // Builds the mip cache if it's missing or older than the image, then creates the texture with just the tail resident
+     // Returns the texture ID, or 0 if the image couldn't be loaded
+     unsigned int addTexture(const std::string& path, bool flipVertically);
+
+     // Just the mip cache half of addTexture, it doesn't touch GL so it can run on any thread ahead of time
+     static bool prepareMipCache(const std::string& path, bool flipVertically);
+
+     // For hot reloading, builds a new mip cache from the changed image next to the one in use, also without touching GL
+     static bool rebuildMipCache(const std::string& path, bool flipVertically);
+     // Then on the render thread, swaps the rebuilt cache in and replaces the texture with a new one that has just the tail resident
+     // Returns the new texture ID, or the old one if there was nothing to swap in
+     unsigned int reloadTexture(unsigned int texture);
+
+     // Call for every on-screen use of the texture each frame, with roughly how many pixels across it covers
+     void requestSize(unsigned int texture, float screenPixels);
+
+     // Call once per frame on the render thread, uploads finished reads, evicts and queues new reads
+     void update();
+
+     // Like Program::deleteProgram, needs calling before glfwTerminate
+     void deleteTextures();
+
+     void setBudget(size_t budgetBytes);
+     const TextureStreamingStats& getStats() const { return stats; }
+
+     // Called on the reader thread whenever a level has been read and is waiting for update() to upload it, so a render loop
+     // that only draws on demand knows to draw another frame
+     void setReadCallback(std::function<void()> callback);
+
+     // Rough on-screen size of something objectRadius big at the given distance from the camera
+     static float projectedSizePixels(float objectRadius, float distance, float fovYRadians, int viewportHeight);
+
+private:
+     struct StreamedTexture {
+          unsigned int id = 0;
+          std::string cachePath;
+          int width = 0;
+          int height = 0;
+          int levelCount = 0;
+          int tailLevel = 0; // This level and every coarser one are always resident
+          int residentLevel = 0; // Finest level currently in VRAM, matches GL_TEXTURE_BASE_LEVEL
+          int wantedLevel = 0; // Finest level asked for this frame
+          bool loadInFlight = false;
+          uint32_t generation = 0; // Goes up with every reload, so reads started for the old cache get thrown away
+          uint64_t lastUsedFrame = 0;
+          std::vector<uint64_t> levelOffsets;
+          std::vector<size_t> levelSizes;
+     };
+     struct LevelRead {
+          size_t textureIndex;
+          uint32_t generation;
+          int level;
+          std::string cachePath;
+          uint64_t offset;
+          std::vector<unsigned char> pixels; // Sized by the render thread, filled in by the reader
+     };
+
+     bool createFromCache(StreamedTexture& texture);
+     int levelWidth(const StreamedTexture& texture, int level) const;
+     int levelHeight(const StreamedTexture& texture, int level) const;
+     void uploadLevel(StreamedTexture& texture, int level, const unsigned char* pixels);
+     void evictLevel(StreamedTexture& texture);
+     bool makeRoom(size_t bytes, size_t forTexture, bool evictVisible);
+     void readerLoop();
+
+     std::vector<StreamedTexture> textures;
+     size_t budget;
+     uint64_t frame = 0;
+
+     // Requests go to the reader thread, finished reads come back for uploading on the render thread
+     std::thread readerThread;
+     std::mutex readMutex;
+     std::condition_variable readReady;
+     std::deque<LevelRead> pendingReads;
+     std::deque<LevelRead> finishedReads;
+     std::function<void()> readCallback;
+     bool stopping = false;
+     // Held by the reader while it has a cache file open, so reloadTexture never replaces one in the middle of a read
+     std::mutex cacheFileMutex;
+
+     TextureStreamingStats stats;
+     uint64_t bytesReadThisSecond = 0;
+     uint64_t bytesUploadedThisSecond = 0;
+     std::chrono::steady_clock::time_point secondStart;
+};
@@ -0,0 +1,122 @@
+#include <algorithm>
+
+#include "threadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+     if (threadCount == 0) {
+          unsigned int cores = std::thread::hardware_concurrency();
+          threadCount = cores > 1 ? cores - 1 : 1;
+     }
+     for (unsigned int i = 0; i < threadCount; i++) {
+          workers.emplace_back(&ThreadPool::workerLoop, this);
+     }
+}
+
+ThreadPool::~ThreadPool() {
+     {
+          std::lock_guard<std::mutex> lock(taskMutex);
+          stopping = true;
+     }
+     taskReady.notify_all();
+     for (std::thread& worker : workers) {
+          worker.join();
+     }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+     {
+          std::lock_guard<std::mutex> lock(taskMutex);
+          tasks.push_back(std::move(task));
+     }
+     taskReady.notify_one();
+}
+
+void ThreadPool::runJob(ParallelJob& job, size_t count, size_t grainSize) {
+     if (count == 0) {
+          return;
+     }
+     grainSize = std::max<size_t>(grainSize, 1);
+     size_t chunks = (count + grainSize - 1) / grainSize;
+     if (chunks == 1) {
+          job.invoke(job.body, 0, count);
+          return;
+     }
+     job.count = count;
+     job.grainSize = grainSize;
+     job.chunks = chunks;
+
+     size_t helperTasks = 0;
+     {
+          std::lock_guard<std::mutex> lock(taskMutex);
+          helperTasks = std::min(std::min<size_t>(workers.size(), chunks - 1), HELPER_SLOTS - helperCount);
+          for (size_t i = 0; i < helperTasks; i++) {
+               helpers[(helperHead + helperCount++) % HELPER_SLOTS] = &job;
+          }
+     }
+     for (size_t i = 0; i < helperTasks; i++) {
+          taskReady.notify_one();
+     }
+     runChunks(job);
+
+     // Every chunk has been taken by now, so helpers that haven't started have nothing to do and come off the ring, and the
+     // job only has to stay alive until the ones that did start have finished their last chunk
+     std::unique_lock<std::mutex> lock(taskMutex);
+     for (size_t i = 0; i < helperCount; i++) {
+          ParallelJob*& helper = helpers[(helperHead + i) % HELPER_SLOTS];
+          if (helper == &job) {
+               helper = nullptr;
+          }
+     }
+     helperFinished.wait(lock, [&] { return job.running == 0; });
+}
+
+void ThreadPool::runChunks(ParallelJob& job) {
+     size_t chunk;
+     while ((chunk = job.next++) < job.chunks) {
+          size_t begin = chunk * job.grainSize;
+          job.invoke(job.body, begin, std::min(job.count, begin + job.grainSize));
+     }
+}
+
+ThreadPool& ThreadPool::shared() {
+     static ThreadPool pool;
+     return pool;
+}
+
+void ThreadPool::workerLoop() {
+     while (true) {
+          std::function<void()> task;
+          ParallelJob* job = nullptr;
+          {
+               std::unique_lock<std::mutex> lock(taskMutex);
+               taskReady.wait(lock, [this] { return stopping || helperCount > 0 || !tasks.empty(); });
+               if (helperCount > 0) {
+                    // parallelFor helpers first, their callers are waiting on them
+                    job = helpers[helperHead];
+                    helperHead = (helperHead + 1) % HELPER_SLOTS;
+                    helperCount--;
+                    if (!job) {
+                         continue;
+                    }
+                    job->running++;
+               }
+               else if (stopping) {
+                    return;
+               }
+               else {
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+               }
+          }
+          if (!job) {
+               task();
+               continue;
+          }
+          runChunks(*job);
+          // Notifying with the lock held means the caller can't see running hit 0 and return while job is still being used
+          std::lock_guard<std::mutex> lock(taskMutex);
+          if (--job->running == 0) {
+               helperFinished.notify_all();
+          }
+     }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for spreading CPU work out
+// parallelFor is the main way in, the calling thread works on the range too so it's safe to call from inside a task
+// parallelFor never touches the heap: its job lives on the caller's stack, the body is called through a plain function pointer
+// rather than a std::function, and its helpers go through a fixed ring rather than the task queue
+class ThreadPool {
+public:
+     // 0 means one thread per core, minus one for the thread that's calling parallelFor
+     explicit ThreadPool(unsigned int threadCount = 0);
+     ~ThreadPool();
+     ThreadPool(const ThreadPool&) = delete;
+     ThreadPool& operator=(const ThreadPool&) = delete;
+
+     unsigned int size() const { return (unsigned int)workers.size(); }
+
+     // Runs the task on a worker at some point, nothing waits for it
+     // This one does allocate, it's for one off work like startup rather than every frame
+     void submit(std::function<void()> task);
+
+     // Splits [0, count) into chunks of grainSize and calls body(begin, end) for each, returning once they're all done
+     template <typename Body>
+     void parallelFor(size_t count, size_t grainSize, const Body& body) {
+          ParallelJob job;
+          job.invoke = [](const void* context, size_t begin, size_t end) { (*(const Body*)context)(begin, end); };
+          job.body = &body;
+          runJob(job, count, grainSize);
+     }
+
+     // One pool shared by everything, made the first time it's asked for
+     static ThreadPool& shared();
+
+private:
+     // Helpers waiting to start, past this many the caller just does more of the chunks itself
+     static const size_t HELPER_SLOTS = 256;
+
+     // Chunks get handed out from a shared counter, so whoever's free grabs the next one
+     struct ParallelJob {
+          void (*invoke)(const void* body, size_t begin, size_t end) = nullptr;
+          const void* body = nullptr;
+          size_t count = 0;
+          size_t grainSize = 0;
+          size_t chunks = 0;
+          std::atomic<size_t> next{ 0 };
+          size_t running = 0; // Helpers that have taken the job off the ring and not finished with it yet, under taskMutex
+     };
+
+     void runJob(ParallelJob& job, size_t count, size_t grainSize);
+     static void runChunks(ParallelJob& job);
+     void workerLoop();
+
+     std::vector<std::thread> workers;
+     std::deque<std::function<void()>> tasks;
+     // A job's entries are nulled out if its caller finishes every chunk before a worker gets to them
+     ParallelJob* helpers[HELPER_SLOTS] = {};
+     size_t helperHead = 0;
+     size_t helperCount = 0;
+     std::mutex taskMutex;
+     std::condition_variable taskReady;
+     std::condition_variable helperFinished;
+     bool stopping = false;
+};
@@ -0,0 +1,25 @@
+#version 450 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+
+uniform sampler2D scene;
+uniform vec2 uvScale; // How much of the texture this frame rendered into
+uniform vec2 uvLimit; // Half a texel in from that, so bilinear never blends in anything past it
+uniform float sharpness;
+
+// Bilinear stretch of the rendered corner of the target over the window, with an optional unsharp mask to win back some edge contrast
+void main()
+{
+   vec2 uv = min(texCoord * uvScale, uvLimit);
+   vec3 color = texture(scene, uv).rgb;
+   if (sharpness > 0.0) {
+      vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+      vec3 neighbours = texture(scene, min(uv + vec2(texel.x, 0.0), uvLimit)).rgb
+                      + texture(scene, max(uv - vec2(texel.x, 0.0), 0.0)).rgb
+                      + texture(scene, min(uv + vec2(0.0, texel.y), uvLimit)).rgb
+                      + texture(scene, max(uv - vec2(0.0, texel.y), 0.0)).rgb;
+      color = clamp(color + sharpness * (color - neighbours * 0.25), 0.0, 1.0);
+   }
+   FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 450 core
+out vec2 texCoord;
+
+// One triangle that covers the whole screen, made from the vertex index so there's nothing to bind
+void main()
+{
+   vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+   texCoord = corner;
+   gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -1,20 +1,30 @@
-#version 460 core
+#version 450 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
+#ifdef INSTANCED
+layout (location = 3) in mat4 aModel; // Per instance, written by the transform compute shader
+#else
+uniform mat4 transform;
+uniform mat4 model;
+#endif
 
 out vec3 ourColor;
 out vec2 texCoord;
+// The depth pre-pass and colour pass use different variants, their depths have to match exactly for GL_LEQUAL to pass
+invariant gl_Position;
 
-uniform mat4 transform;
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Compiled once per feature set by ShaderVariants, which puts the #defines in after the #version line
 void main()
 {
-   // gl_Position = transformation * vec4(aPos, 1.0);
+#ifdef INSTANCED
+   gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+#else
    gl_Position = projection * view * model * transform * vec4(aPos, 1.0);
+#endif
    ourColor = aColor;
    texCoord = vec2(aTexCoord.x, aTexCoord.y);
 }
\ No newline at end of file